@@ -7,8 +7,37 @@
  */
 
 #include "x86_asm_test.h"
+#include "x86_asm_fuzzer.h"
+#include "x86_asm_minimizer.h"
+#include "x86_asm_cmin.h"
+#include "x86_asm_mutation.h"
+#include "x86_asm_cache.h"
+#include "x86_asm_impact.h"
+#include "x86_asm_prefix.h"
+#include "x86_asm_pipeline.h"
+#include "x86_asm_session.h"
+#include "x86_asm_async.h"
+#include "x86_asm_output.h"
+#include "x86_asm_static.h"
+#include "x86_asm_corpus.h"
+#include "x86_asm_table.h"
+#include "x86_asm_generator.h"
+#include "x86_asm_trace.h"
+#include "x86_asm_histogram.h"
+#include "x86_asm_results.h"
+#include "x86_asm_summary.h"
 #include <gtest/gtest.h>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
 #include <format>
+#include <fstream>
+#include <new>
+#include <map>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <unistd.h>
 
 using namespace x86_asm_test;
 
@@ -209,12 +238,1471 @@ TEST_F(CalculatorAsmTest, TestNegativeNumbers) {
     ASM_ASSERT_OUTPUT(get_runner(), input, expected);
 }
 
+/**
+ * @class CalculatorFuzzTest
+ * @brief Coverage-guided fuzzing of the calculator program
+ */
+class CalculatorFuzzTest : public CalculatorAsmTest {
+};
+
+TEST_F(CalculatorFuzzTest, TestCoverageGrowsFromSeed) {
+    FuzzerConfig config;
+    config.max_executions = 300;
+    config.dictionary = {"add", "sub", "mul", "div"};
+    
+    AsmFuzzer fuzzer(*get_runner(), config);
+    fuzzer.add_seed(make_input().add_arg(10).add_arg(5).add_arg("add"));
+    auto stats = fuzzer.run();
+    
+    EXPECT_EQ(stats.executions, 300u);
+    EXPECT_GT(stats.corpus_size, 1u) << "Mutations should reach new edges";
+    
+    CoverageTracer tracer(*get_runner());
+    auto labels = fuzzer.coverage().labels(tracer.image());
+    EXPECT_NE(std::ranges::find(labels, "do_sub"), labels.end());
+    EXPECT_NE(std::ranges::find(labels, "usage_error"), labels.end());
+}
+
+TEST_F(CalculatorFuzzTest, TestCrashBecomesTestCase) {
+    FuzzerConfig config;
+    config.max_executions = 10;
+    config.stop_on_first_finding = true;
+    
+    // INT64_MIN / -1 overflows idiv and raises SIGFPE
+    AsmFuzzer fuzzer(*get_runner(), config);
+    fuzzer.add_seed(make_input().add_arg("-9223372036854775808").add_arg(-1).add_arg("div"));
+    fuzzer.run();
+    
+    ASSERT_EQ(fuzzer.findings().size(), 1u);
+    const auto& finding = fuzzer.findings().front();
+    EXPECT_EQ(finding.kind, FindingKind::Crash);
+    EXPECT_EQ(finding.signal, SIGFPE);
+    EXPECT_EQ(finding.location.rfind("do_div", 0), 0u) << finding.location;
+    
+    auto code = finding.to_test_case("CalculatorAsmTest", "FuzzCrash1");
+    EXPECT_NE(code.find("TEST_F(CalculatorAsmTest, FuzzCrash1)"), std::string::npos);
+    EXPECT_NE(code.find(".add_arg(\"-1\")"), std::string::npos) << code;
+}
+
+TEST_F(CalculatorFuzzTest, TestInstructionLimitFindingChecksUnderTracer) {
+    FuzzerConfig config;
+    config.max_executions = 1;
+    config.instruction_limit = 5;
+    
+    AsmFuzzer fuzzer(*get_runner(), config);
+    fuzzer.add_seed(make_input().add_arg(1).add_arg(2).add_arg("add"));
+    fuzzer.run();
+    
+    ASSERT_EQ(fuzzer.findings().size(), 1u);
+    const auto& finding = fuzzer.findings().front();
+    EXPECT_EQ(finding.kind, FindingKind::Timeout);
+    EXPECT_EQ(finding.instruction_limit, 5u);
+    
+    // Natively the run finishes at once, so only a traced run reproduces it
+    auto code = finding.to_test_case("CalculatorAsmTest", "FuzzTimeout1");
+    EXPECT_NE(code.find("tracer.set_instruction_limit(5);"), std::string::npos) << code;
+    EXPECT_EQ(code.find("get_runner()->run_test(input)"), std::string::npos) << code;
+}
+
+TEST_F(CalculatorAsmTest, TestMinimizeDropsExtraArguments) {
+    auto input = make_input()
+        .add_arg("-9223372036854775808")
+        .add_arg(-1)
+        .add_arg("div")
+        .add_arg("extra")
+        .add_arg("junk");
+    
+    auto minimized = minimize(*get_runner(), input, [](const ExecutionResult& result) {
+        return result.exit_code == 128 + SIGFPE;
+    });
+    
+    ASSERT_EQ(minimized.input.size(), 3u);
+    EXPECT_EQ(minimized.input.args()[2], "div");
+    EXPECT_EQ(minimized.result.exit_code, 128 + SIGFPE);
+    
+    auto code = minimized.to_test_case("CalculatorAsmTest", "TestDivOverflow");
+    EXPECT_NE(code.find("ASM_ASSERT_OUTPUT(get_runner(), input, expected);"), std::string::npos);
+}
+
+TEST_F(StringProcessorTest, TestMinimizeStdin) {
+    std::string noise;
+    for (int i = 0; i < 600; ++i) {
+        noise += static_cast<char>('a' + (i * 7) % 16);  // Only 'a'..'p'
+    }
+    noise.insert(417, "q");
+    
+    auto input = make_input().set_stdin(noise);
+    auto expected = expect_success().stdout_contains("HELLO");
+    ASSERT_FALSE(expected.matches(get_runner()->run_test(input)));
+    
+    MinimizerConfig config;
+    config.jobs = 4;
+    
+    auto minimized = minimize(*get_runner(), input, [](const ExecutionResult& result) {
+        return result.stdout_output.find('Q') != std::string::npos;
+    }, config);
+    
+    ASSERT_TRUE(minimized.input.stdin_data().has_value());
+    EXPECT_EQ(*minimized.input.stdin_data(), "q");
+    EXPECT_GT(minimized.cache_hits + minimized.executions, 0u);
+    
+    EXPECT_THROW((void)minimize(*get_runner(), make_input().set_stdin("abc"), fails_expectation(expect_success())),
+                 std::invalid_argument);
+    
+    // An error while evaluating a candidate stops the workers and reaches the caller
+    std::atomic<int> calls{0};
+    EXPECT_THROW((void)minimize(*get_runner(), input, [&](const ExecutionResult&) {
+        if (calls++ > 0) throw std::runtime_error("predicate failed");
+        return true;
+    }, config), std::runtime_error);
+}
+
+TEST_F(CalculatorAsmTest, TestCorpusMinimizationKeepsCoverage) {
+    std::vector<TestInput> corpus = {
+        make_input().add_arg(1).add_arg(2).add_arg("add"),
+        make_input().add_arg(3).add_arg(4).add_arg("add"),     // Same path as the first
+        make_input().add_arg(12).add_arg(34).add_arg("add"),
+        make_input().add_arg(10).add_arg(5).add_arg("sub"),
+        make_input().add_arg(11).add_arg(6).add_arg("sub"),    // Same path as the previous
+        make_input().add_arg(8).add_arg(0).add_arg("div"),
+        make_input().add_arg(1).add_arg(2),                    // Usage error
+        make_input().add_arg(9).add_arg(9),                    // Same usage error
+    };
+    
+    CorpusMinimizeOptions options;
+    options.granularity = CoverageGranularity::Labels;
+    auto report = minimize_corpus(*get_runner(), corpus, options);
+    
+    EXPECT_GE(report.duplicates.size(), 3u) << report.summary();
+    EXPECT_LT(report.kept.size(), corpus.size()) << report.summary();
+    EXPECT_EQ(report.kept.size() + report.duplicates.size() + report.redundant.size(), corpus.size());
+    
+    // The kept inputs must reach every label the full corpus reached
+    CoverageTracer tracer(*get_runner());
+    CoverageMap full, minimal;
+    for (const auto& input : corpus) full.merge(tracer.run(input).coverage);
+    for (const auto& input : report.select(corpus)) minimal.merge(tracer.run(input).coverage);
+    EXPECT_EQ(minimal.labels(tracer.image()), full.labels(tracer.image()));
+}
+
+TEST_F(CalculatorAsmTest, TestMutationScoreOfArithmeticCases) {
+    std::vector<std::pair<TestInput, ExpectedOutput>> cases = {
+        {make_input().add_arg(10).add_arg(5).add_arg("add"), expect_success().stdout_equals("15\n")},
+        {make_input().add_arg(10).add_arg(3).add_arg("sub"), expect_success().stdout_equals("7\n")},
+        {make_input().add_arg(7).add_arg(8).add_arg("mul"), expect_success().stdout_equals("56\n")},
+        {make_input().add_arg(20).add_arg(4).add_arg("div"), expect_success().stdout_equals("5\n")},
+    };
+    
+    TestConfig mutant_config;
+    mutant_config.timeout = std::chrono::milliseconds(500);
+    
+    MutationEngine engine(get_runner()->executable_path());
+    ASSERT_FALSE(engine.mutants().empty());
+    
+    auto report = engine.run(MutationEngine::cases_suite(cases, mutant_config));
+    ASSERT_EQ(report.outcomes.size(), engine.mutants().size());
+    EXPECT_GT(report.killed(), 0u) << report.summary();
+    
+    // Negating the argc check breaks every case above
+    auto argc_check = std::ranges::find_if(report.outcomes, [](const MutantOutcome& outcome) {
+        return outcome.mutant.op == MutationOperator::FlipCondition &&
+               outcome.mutant.location.starts_with("_start") &&
+               outcome.mutant.description == "jl -> jge";
+    });
+    ASSERT_NE(argc_check, report.outcomes.end());
+    EXPECT_TRUE(argc_check->killed);
+    
+    // No case divides by zero, so the zero check in do_div is not constrained
+    EXPECT_TRUE(report.survivors_by_label().contains("do_div")) << report.summary();
+    
+    // A mutant that cannot be executed is an error even when stderr is not captured
+    auto garbage = std::filesystem::temp_directory_path() / std::format("x86_asm_not_elf_{}", getpid());
+    std::ofstream(garbage) << "not an executable\n";
+    std::filesystem::permissions(garbage, std::filesystem::perms::owner_all);
+    mutant_config.capture_stderr = false;
+    EXPECT_THROW((void)MutationEngine::cases_suite(cases, mutant_config)(garbage), std::runtime_error);
+    std::filesystem::remove(garbage);
+}
+
+TEST_F(CalculatorAsmTest, TestMutationAgainstGtestBinary) {
+    MutationConfig config;
+    config.labels = {"do_add"};
+    config.operators = {MutationOperator::SwapAddSub};
+    
+    MutationEngine engine(get_runner()->executable_path(), config);
+    ASSERT_EQ(engine.mutants().size(), 1u);
+    
+    // Re-run this test binary's addition test with the mutant substituted in
+    auto report = engine.run(MutationEngine::gtest_suite(
+        get_runner()->executable_path(), "/proc/self/exe", "CalculatorAsmTest.TestAddition"));
+    EXPECT_EQ(report.killed(), 1u) << report.summary();
+    
+    // A test binary that cannot start is an error, not a killed mutant
+    EXPECT_THROW((void)engine.run(MutationEngine::gtest_suite(get_runner()->executable_path(),
+                                                              "./no_such_test_binary")),
+                 std::runtime_error);
+}
+
+TEST_F(CalculatorAsmTest, TestResultCacheHitAndInvalidation) {
+    if (has_execution_hook()) {
+        GTEST_SKIP() << "Result cache is bypassed while recording impact coverage";
+    }
+    
+    auto dir = std::filesystem::temp_directory_path() / std::format("x86_asm_cache_{}", getpid());
+    std::filesystem::create_directories(dir);
+    std::filesystem::copy_file("./calc", dir / "calc", std::filesystem::copy_options::overwrite_existing);
+    
+    TestConfig config;
+    config.result_cache = dir / "results.cache";
+    AsmTestRunner runner(dir / "calc", AsmSyntax::Intel, config);
+    auto input = make_input().add_arg(10).add_arg(5).add_arg("add");
+    
+    auto first = runner.run_test(input);
+    EXPECT_FALSE(first.from_cache);
+    
+    auto second = runner.run_test(input);
+    EXPECT_TRUE(second.from_cache);
+    EXPECT_EQ(second.stdout_output, first.stdout_output);
+    EXPECT_EQ(second.exit_code, first.exit_code);
+    
+    // Entries persist on disk and are visible to a separately opened cache
+    EXPECT_EQ(ResultCache(*config.result_cache).size(), 1U);
+    
+    // Changing the binary invalidates its entries
+    std::ofstream(dir / "calc", std::ios::binary | std::ios::app).put('\0');
+    auto rebuilt = runner.run_test(input);
+    EXPECT_FALSE(rebuilt.from_cache);
+    EXPECT_EQ(rebuilt.stdout_output, "15\n");
+    
+    std::filesystem::remove_all(dir);
+}
+
+TEST_F(CalculatorAsmTest, TestResultCacheStartsNewGenerationWhenFull) {
+    auto path = std::filesystem::temp_directory_path() / std::format("x86_asm_cache_full_{}.cache", getpid());
+    std::filesystem::remove(path);
+    ResultCache cache(path, 16);
+    
+    ExecutionResult result;
+    result.stdout_output = "15\n";
+    // 16 slots hold 12 entries; the 13th store starts over instead of failing
+    for (uint64_t i = 1; i <= 13; ++i) {
+        EXPECT_TRUE(cache.store({i, i}, result));
+    }
+    EXPECT_EQ(cache.generation(), 1U);
+    EXPECT_EQ(cache.size(), 1U);
+    EXPECT_TRUE(cache.lookup({13, 13}).has_value());
+    EXPECT_FALSE(cache.lookup({1, 1}).has_value());
+    
+    // Clearing resets the index in place; other mappings of the file stay valid
+    auto file_size = std::filesystem::file_size(path);
+    cache.clear();
+    EXPECT_EQ(cache.size(), 0U);
+    EXPECT_EQ(std::filesystem::file_size(path), file_size);
+    
+    std::filesystem::remove(path);
+}
+
+/**
+ * @brief Assemble and link a static program with as and ld
+ * @param dir Directory receiving name.s, name.o and the executable name
+ * @param name Program name
+ * @param source Assembly source
+ * @return Whether both tools succeeded
+ */
+bool assemble(const std::filesystem::path& dir, const std::string& name, const std::string& source) {
+    std::ofstream(dir / (name + ".s")) << source;
+    auto command = std::format("as --64 -o {0}.o {0}.s && ld -o {0} {0}.o", (dir / name).string());
+    return std::system(command.c_str()) == 0;
+}
+
+TEST_F(CalculatorAsmTest, TestImpactRecorderStretchesTimeouts) {
+    if (has_execution_hook()) {
+        GTEST_SKIP() << "The recorder would replace the installed execution hook";
+    }
+    
+    auto dir = std::filesystem::temp_directory_path() / std::format("x86_asm_impact_long_{}", getpid());
+    std::filesystem::create_directories(dir);
+    ImpactRecorder recorder(dir / "impact.db", 100);
+    auto& unit_test = *::testing::UnitTest::GetInstance();
+    recorder.OnTestProgramStart(unit_test);
+    
+    // Natively a few milliseconds, traced far longer than the runner's timeout
+    constexpr auto batch_timeout = std::chrono::milliseconds(50);
+    TestConfig config;
+    config.timeout = batch_timeout;
+    AsmTestRunner batch("./calc_batch", AsmSyntax::Intel, config);
+    std::string records, expected;
+    for (int i = 0; i < 50; ++i) {
+        records += std::format("{} 3 mul\n", i);
+        expected += std::format("{}\n", i * 3);
+    }
+    auto traced = batch.run_test(make_input().set_stdin(records));
+    
+    // A program blocked in a syscall executes no instructions; the watchdog
+    // still kills it at the stretched deadline (100 x 2 ms)
+    std::optional<ExecutionResult> paused;
+    if (assemble(dir, "pause", ".globl _start\n_start:\n    mov $34, %eax\n    syscall\n    jmp _start\n")) {
+        config.timeout = std::chrono::milliseconds(2);
+        AsmTestRunner pauser(dir / "pause", AsmSyntax::ATT, config);
+        paused = pauser.run_test(make_input());
+    }
+    
+    recorder.OnTestProgramEnd(unit_test);
+    std::filesystem::remove_all(dir);
+    
+    EXPECT_FALSE(traced.timed_out);
+    EXPECT_TRUE(traced.succeeded());
+    EXPECT_EQ(std::string_view(traced.stdout_output), expected);
+    EXPECT_GT(traced.execution_time, batch_timeout);
+    if (paused) {
+        EXPECT_TRUE(paused->timed_out);
+        EXPECT_GE(paused->execution_time, std::chrono::milliseconds(200));
+        EXPECT_LT(paused->execution_time, std::chrono::milliseconds(2000));
+    }
+}
+
+TEST_F(CalculatorAsmTest, TestImpactAnalysisSelectsEditedRoutine) {
+    if (has_execution_hook()) {
+        GTEST_SKIP() << "Cannot record impact coverage of a nested recording run";
+    }
+    
+    auto dir = std::filesystem::temp_directory_path() / std::format("x86_asm_impact_{}", getpid());
+    std::filesystem::create_directories(dir);
+    auto database_path = dir / "impact.db";
+    
+    // Record TestAddition in a child run of this binary
+    setenv("X86_ASM_TEST_IMPACT_DB", database_path.c_str(), 1);
+    AsmTestRunner self("/proc/self/exe");
+    auto recording = self.run_test(make_input().add_arg("--gtest_filter=CalculatorAsmTest.TestAddition"));
+    unsetenv("X86_ASM_TEST_IMPACT_DB");
+    ASSERT_TRUE(recording.succeeded()) << recording.stdout_output;
+    
+    auto database = ImpactDatabase::load(database_path);
+    ASSERT_TRUE(database.tests().contains("CalculatorAsmTest.TestAddition"));
+    auto record = database.tests().at("CalculatorAsmTest.TestAddition");
+    ASSERT_EQ(record.labels.size(), 1u);
+    auto labels = record.labels.begin()->second;
+    EXPECT_TRUE(labels.contains("do_add"));
+    EXPECT_FALSE(labels.contains("do_sub"));
+    EXPECT_TRUE(analyze_impact(database).impacted.empty());
+    
+    // Point the record at a private copy of the binary and edit routines in it
+    auto copy = dir / "calc";
+    std::filesystem::copy_file("./calc", copy, std::filesystem::copy_options::overwrite_existing);
+    record.labels = {{copy.string(), labels}};
+    database.set("CalculatorAsmTest.TestAddition", record);
+    
+    auto patch_label = [&](std::string_view name) {
+        ElfImage image(copy);
+        auto symbol = std::ranges::find(image.symbols(), name, &ElfSymbol::name);
+        ASSERT_NE(symbol, image.symbols().end());
+        std::fstream file(copy, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(static_cast<std::streamoff>(*image.file_offset(symbol->address)));
+        file.put('\x90');
+    };
+    
+    patch_label("do_sub");
+    EXPECT_EQ(analyze_impact(database).gtest_filter(), "-CalculatorAsmTest.TestAddition");
+    
+    patch_label("do_add");
+    auto analysis = analyze_impact(database);
+    EXPECT_EQ(analysis.impacted, std::vector<std::string>{"CalculatorAsmTest.TestAddition"});
+    EXPECT_EQ(analysis.changed_labels, std::vector<std::string>{copy.string() + ":do_add"});
+    EXPECT_EQ(analysis.gtest_filter(), "*");
+    
+    // Without recorded labels nothing shows the test is unaffected
+    database.set("CalculatorBatchTest.TestSessionConversation", TestImpactRecord{});
+    analysis = analyze_impact(database);
+    EXPECT_TRUE(std::ranges::find(analysis.impacted, "CalculatorBatchTest.TestSessionConversation") !=
+                analysis.impacted.end());
+    
+    std::filesystem::remove_all(dir);
+}
+
+TEST_F(CalculatorAsmTest, TestImpactAnalysisSurvivesReassembly) {
+    std::ifstream source_file("calc.s");
+    if (!source_file) {
+        GTEST_SKIP() << "calc.s is not next to the test binary";
+    }
+    std::string source{std::istreambuf_iterator<char>(source_file), {}};
+    
+    // Grow do_mul by one instruction: everything after it moves
+    std::string edited = source;
+    auto at = edited.find("do_mul:\n");
+    ASSERT_NE(at, std::string::npos);
+    edited.insert(at + std::strlen("do_mul:\n"), "    nop\n");
+    
+    auto dir = std::filesystem::temp_directory_path() / std::format("x86_asm_reassemble_{}", getpid());
+    std::filesystem::create_directories(dir);
+    if (!assemble(dir, "original", source) || !assemble(dir, "edited", edited)) {
+        std::filesystem::remove_all(dir);
+        GTEST_SKIP() << "as and ld are needed to reassemble calc.s";
+    }
+    
+    auto before = label_hashes(ElfImage(dir / "original"));
+    auto after = label_hashes(ElfImage(dir / "edited"));
+    ASSERT_EQ(before.size(), after.size());
+    std::vector<std::string> changed;
+    for (const auto& [label, hash] : before) {
+        ASSERT_TRUE(after.contains(label)) << label;
+        if (after.at(label) != hash) {
+            changed.push_back(label);
+        }
+    }
+    EXPECT_EQ(changed, std::vector<std::string>{"do_mul"});
+    
+    // Tests reaching only moved labels stay unaffected
+    auto covering = [&](std::initializer_list<std::string> names) {
+        TestImpactRecord record;
+        for (const auto& name : names) {
+            record.labels[(dir / "edited").string()][name] = before.at(name);
+        }
+        return record;
+    };
+    ImpactDatabase database;
+    database.set("Calc.Add", covering({"_start", "atoi", "do_add", "print_result", "print_int", "exit_program"}));
+    database.set("Calc.Div", covering({"_start", "atoi", "do_div", "div_error", "exit_program"}));
+    database.set("Calc.Mul", covering({"_start", "atoi", "do_mul", "print_result", "print_int", "exit_program"}));
+    auto analysis = analyze_impact(database);
+    EXPECT_EQ(analysis.impacted, std::vector<std::string>{"Calc.Mul"});
+    EXPECT_EQ(analysis.unaffected, (std::vector<std::string>{"Calc.Add", "Calc.Div"}));
+    
+    std::filesystem::remove_all(dir);
+}
+
+/**
+ * @class CalculatorBatchTest
+ * @brief Test fixture for the batch-mode calculator
+ * 
+ * calc_batch reads "<num1> <num2> <operation>" records from stdin and
+ * answers each with one line, so many cases share one process.
+ */
+class CalculatorBatchTest : public AsmTestFixture {
+protected:
+    void SetUp() override {
+        TestConfig config;
+        config.timeout = std::chrono::milliseconds(3000);
+        
+        create_runner("./calc_batch", AsmSyntax::Intel, config);
+    }
+};
+
+TEST_F(CalculatorBatchTest, TestBatchMatchesSingleRunExpectations) {
+    std::vector<std::pair<TestInput, ExpectedOutput>> cases;
+    cases.emplace_back(make_input().add_arg(10).add_arg(5).add_arg("add"), expect_success().stdout_equals("15\n"));
+    cases.emplace_back(make_input().add_arg(10).add_arg(3).add_arg("sub"), expect_success().stdout_equals("7\n"));
+    cases.emplace_back(make_input().add_arg(-6).add_arg(7).add_arg("mul"), expect_success().stdout_equals("-42\n"));
+    cases.emplace_back(make_input().add_arg(20).add_arg(4).add_arg("div"), expect_success().stdout_equals("5\n"));
+    cases.emplace_back(make_input().add_arg(1).add_arg(0).add_arg("div"),
+                       expect_success().stdout_equals("Error: division by zero\n"));
+    
+    get_runner()->assert_batch(cases);
+}
+
+TEST_F(CalculatorBatchTest, TestThousandsOfRecordsInOneProcess) {
+    std::vector<TestInput> inputs;
+    for (int i = 0; i < 20000; ++i) {
+        inputs.push_back(make_input().add_arg(i).add_arg(2).add_arg("mul"));
+    }
+    
+    auto results = get_runner()->run_batch(inputs);
+    ASSERT_EQ(results.size(), inputs.size());
+    EXPECT_EQ(results.front().stdout_output, "0\n");
+    EXPECT_EQ(results.back().stdout_output, "39998\n");
+    EXPECT_TRUE(std::ranges::all_of(results, &ExecutionResult::succeeded));
+}
+
+TEST_F(CalculatorBatchTest, TestCrashIsIsolatedToItsRecord) {
+    std::vector<TestInput> inputs{
+        make_input().add_arg(1).add_arg(1).add_arg("add"),
+        make_input().add_arg("-9223372036854775808").add_arg(-1).add_arg("div"),  // idiv overflow: SIGFPE
+        make_input().add_arg(2).add_arg(2).add_arg("add")
+    };
+    
+    auto results = get_runner()->run_batch(inputs);
+    EXPECT_EQ(results[0].stdout_output, "2\n");
+    EXPECT_EQ(results[1].exit_code, 128 + SIGFPE);
+    EXPECT_TRUE(results[2].succeeded());
+    EXPECT_EQ(results[2].stdout_output, "4\n");
+}
+
+TEST_F(CalculatorBatchTest, TestSharedPrefixMatchesIndependentRuns) {
+    // A long common header of records, then a different final record per input
+    std::string header;
+    for (int i = 0; i < 1000; ++i) {
+        header += std::format("{} 3 mul\n", i);
+    }
+    std::vector<TestInput> inputs{
+        make_input().set_stdin(header + "10 5 add\n"),
+        make_input().set_stdin(header + "10 5 sub\n"),
+        make_input().set_stdin(header + "1 0 div\n"),
+        make_input().set_stdin(header + "10 5 add\n")
+    };
+    
+    auto report = run_shared_prefix(*get_runner(), inputs);
+    ASSERT_EQ(report.results.size(), inputs.size());
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        auto independent = get_runner()->run_test(inputs[i]);
+        EXPECT_EQ(report.results[i].exit_code, independent.exit_code) << "input " << i;
+        EXPECT_EQ(report.results[i].stdout_output, independent.stdout_output) << "input " << i;
+    }
+    
+    EXPECT_EQ(report.processes, 1u);
+    EXPECT_EQ(report.forks, 2u);
+    EXPECT_GT(report.sharing(), 0.5);
+}
+
+TEST_F(CalculatorBatchTest, TestPipelineIntoStringProcessor) {
+    AsmTestRunner upper("./string_processor");
+    AsmPipeline pipeline{*get_runner(), upper};
+    pipeline.expect(0, expect_success().stdout_equals("15\nError: division by zero\n"))
+            .expect(1, expect_success().stdout_equals("15\nERROR: DIVISION BY ZERO\n"));
+    
+    auto result = pipeline.assert_output("10 5 add\n1 0 div\n");
+    EXPECT_TRUE(result.succeeded());
+}
+
+TEST_F(CalculatorBatchTest, TestUntappedPipelineStageIsNotCaptured) {
+    AsmTestRunner upper("./string_processor");
+    auto result = AsmPipeline{*get_runner(), upper}.run("-6 7 mul\n");
+    
+    EXPECT_TRUE(result.succeeded());
+    EXPECT_TRUE(result.stages[0].stdout_output.empty());
+    EXPECT_EQ(result.output().stdout_output, "-42\n");
+}
+
+TEST_F(CalculatorBatchTest, TestTapSurvivesEarlyExitOfNextStage) {
+    // string_processor reads one chunk and exits; the tap must still see everything
+    std::string records;
+    std::string expected;
+    for (int i = 0; i < 20000; ++i) {
+        records += std::format("{} 2 mul\n", i);
+        expected += std::format("{}\n", i * 2);
+    }
+    
+    AsmTestRunner upper("./string_processor");
+    auto result = AsmPipeline{*get_runner(), upper}.tap(0).run(records);
+    
+    EXPECT_TRUE(result.stages[0].succeeded());
+    EXPECT_EQ(std::string_view(result.stages[0].stdout_output), expected);
+    EXPECT_TRUE(result.output().succeeded());
+    EXPECT_TRUE(expected.starts_with(result.output().stdout_output));
+}
+
+TEST_F(CalculatorBatchTest, TestPipelineKillsStageThatOutlivesItsOutput) {
+    // The stage closes stdout and stderr, then keeps running past the timeout
+    TestConfig config;
+    config.timeout = std::chrono::milliseconds(300);
+    AsmTestRunner lingering("/bin/sh", AsmSyntax::Intel, config);
+    AsmPipeline pipeline;
+    pipeline.add_stage(lingering, x86_asm_test::make_input().add_arg("-c").add_arg("exec >&- 2>&-; sleep 5"));
+    
+    auto start = std::chrono::steady_clock::now();
+    auto result = pipeline.run();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(2));
+    EXPECT_TRUE(result.stages[0].timed_out);
+}
+
+TEST_F(CalculatorBatchTest, TestSessionConversation) {
+    auto session = get_runner()->open_session();
+    for (int i = 0; i < 200; ++i) {
+        ASSERT_TRUE(session.send(std::format("{} 3 mul\n", i)));
+        ASSERT_TRUE(session.expect_line(std::to_string(i * 3), std::chrono::milliseconds(500)));
+    }
+    ASSERT_TRUE(session.send("1 0 div\n"));
+    ASSERT_TRUE(session.expect_line("Error: division by zero", std::chrono::milliseconds(500)));
+    
+    auto result = session.close();
+    EXPECT_TRUE(result.succeeded());
+    EXPECT_TRUE(result.stdout_output.empty());
+    
+    auto latency = session.latency();
+    EXPECT_EQ(latency.count, 201u);
+    EXPECT_LE(latency.min, latency.p50);
+    EXPECT_LE(latency.p50, latency.p99);
+    EXPECT_LE(latency.p99, latency.max);
+}
+
+TEST_F(CalculatorBatchTest, TestSessionReadTimesOutWithoutRequest) {
+    auto session = get_runner()->open_session();
+    EXPECT_FALSE(session.read_line(std::chrono::milliseconds(2)).has_value());
+    
+    // Pipelined requests are answered in order; unread answers end up in the result
+    session.send("1 1 add\n");
+    session.send("2 2 add\n");
+    EXPECT_EQ(session.read_line(std::chrono::milliseconds(500)), "2");
+    auto result = session.close();
+    EXPECT_TRUE(result.succeeded());
+    EXPECT_EQ(result.stdout_output, "4\n");
+    EXPECT_FALSE(session.is_open());
+}
+
+TEST_F(CalculatorBatchTest, TestLatencyPercentilesUseNearestRank) {
+    std::vector<std::chrono::microseconds> samples;
+    for (int i = 100; i >= 1; --i) {
+        samples.emplace_back(i);
+    }
+    auto stats = LatencyStats::from_samples(samples);
+    EXPECT_EQ(stats.count, 100u);
+    EXPECT_EQ(stats.min.count(), 1);
+    EXPECT_EQ(stats.p50.count(), 50);
+    EXPECT_EQ(stats.p90.count(), 90);
+    EXPECT_EQ(stats.p99.count(), 99);
+    EXPECT_EQ(stats.max.count(), 100);
+    EXPECT_EQ(stats.mean.count(), 50);
+}
+
+/**
+ * @brief Run one calculation through calc (arguments) and calc_batch (stdin)
+ * @return Whether both programs printed the same answer
+ */
+Task<bool> calculators_agree(const AsmTestRunner& calc, const AsmTestRunner& batch, int a, int b) {
+    auto single = co_await calc.run_async(make_input().add_arg(a).add_arg(b).add_arg("sub"));
+    auto batched = co_await batch.run_async(make_input().set_stdin(std::format("{} {} sub\n", a, b)));
+    co_return single.succeeded() && single.stdout_output == batched.stdout_output;
+}
+
+TEST_F(CalculatorAsmTest, TestRunAsyncWhenAll) {
+    std::vector<Task<ExecutionResult>> runs;
+    for (int i = 0; i < 300; ++i) {
+        runs.push_back(get_runner()->run_async(make_input().add_arg(i).add_arg(2).add_arg("mul")));
+    }
+    auto results = sync_wait(when_all(std::move(runs)));
+    
+    ASSERT_EQ(results.size(), 300u);
+    for (int i = 0; i < 300; ++i) {
+        EXPECT_TRUE(results[i].succeeded()) << "run " << i;
+        EXPECT_EQ(std::string_view(results[i].stdout_output), std::format("{}\n", i * 2)) << "run " << i;
+    }
+}
+
+TEST_F(CalculatorAsmTest, TestCoroutinesCompareTwoPrograms) {
+    AsmTestRunner batch("./calc_batch");
+    std::vector<Task<bool>> checks;
+    for (int i = -20; i < 20; ++i) {
+        checks.push_back(calculators_agree(*get_runner(), batch, i * 7, i));
+    }
+    auto agreed = sync_wait(when_all(std::move(checks)));
+    EXPECT_TRUE(std::ranges::all_of(agreed, [](bool ok) { return ok; }));
+    
+    // A single task can be driven on its own too
+    auto result = sync_wait(get_runner()->run_async(make_input().add_arg(10).add_arg(5).add_arg("add")));
+    EXPECT_EQ(result.stdout_output, "15\n");
+}
+
+TEST_F(CalculatorAsmTest, TestSubmitFromExternalEventLoop) {
+    // Stand-in for a harness's own loop: one epoll set, no extra threads
+    int loop = epoll_create1(EPOLL_CLOEXEC);
+    ASSERT_GE(loop, 0);
+    struct epoll_event registration{};
+    registration.events = EPOLLIN;
+    registration.data.fd = get_runner()->event_fd();
+    ASSERT_EQ(epoll_ctl(loop, EPOLL_CTL_ADD, get_runner()->event_fd(), &registration), 0);
+    
+    std::vector<std::pair<RunHandle, int>> pending;
+    for (int i = 0; i < 40; ++i) {
+        pending.emplace_back(get_runner()->submit(make_input().add_arg(i).add_arg(i).add_arg("add")), i);
+    }
+    
+    std::map<int, ExecutionResult> results;
+    while (!pending.empty()) {
+        struct epoll_event event;
+        ASSERT_GE(epoll_wait(loop, &event, 1, 3000), 1) << "event_fd never became readable";
+        std::erase_if(pending, [&](const auto& run) {
+            auto result = get_runner()->poll(run.first);
+            if (result) results.emplace(run.second, std::move(*result));
+            return result.has_value();
+        });
+    }
+    close(loop);
+    
+    ASSERT_EQ(results.size(), 40u);
+    for (const auto& [i, result] : results) {
+        EXPECT_EQ(std::string_view(result.stdout_output), std::format("{}\n", i + i));
+    }
+}
+
+TEST_F(CalculatorAsmTest, TestSubmittedRunTimeoutAndCancel) {
+    if (!std::filesystem::exists("/bin/sleep")) {
+        GTEST_SKIP() << "needs /bin/sleep as a long-running program";
+    }
+    TestConfig config;
+    config.timeout = std::chrono::milliseconds(50);
+    AsmTestRunner sleeper("/bin/sleep", AsmSyntax::Intel, config);
+    
+    auto slow = sleeper.submit(make_input().add_arg(10));
+    auto cancelled = sleeper.submit(make_input().add_arg(10));
+    EXPECT_TRUE(sleeper.cancel(cancelled));
+    EXPECT_FALSE(sleeper.cancel(cancelled));
+    EXPECT_THROW((void)sleeper.poll(cancelled), std::invalid_argument);
+    
+    // The deadline timer wakes the event descriptor even though the program stays silent
+    struct pollfd wait{sleeper.event_fd(), POLLIN, 0};
+    std::optional<ExecutionResult> result;
+    while (!result) {
+        ASSERT_EQ(::poll(&wait, 1, 3000), 1);
+        result = sleeper.poll(slow);
+    }
+    EXPECT_TRUE(result->timed_out);
+    EXPECT_LT(result->execution_time, std::chrono::milliseconds(2000));
+}
+
+TEST_F(CalculatorAsmTest, TestFailedSubmitLeavesEventFdQuiet) {
+    AsmTestRunner runner("./calc");
+    int event_fd = runner.event_fd();
+    
+    // Run out of descriptors so that creating the run's pipes fails
+    rlimit original{};
+    ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &original), 0);
+    rlimit lowered = original;
+    lowered.rlim_cur = std::min<rlim_t>(original.rlim_cur, 256);
+    ASSERT_EQ(setrlimit(RLIMIT_NOFILE, &lowered), 0);
+    std::vector<int> filler;
+    for (int fd; (fd = dup(event_fd)) >= 0;) {
+        filler.push_back(fd);
+    }
+    auto handle = runner.submit(make_input().add_arg(1).add_arg(2).add_arg("add"));
+    for (int fd : filler) {
+        close(fd);
+    }
+    setrlimit(RLIMIT_NOFILE, &original);
+    
+    // The failure is announced once, then the descriptor must not stay readable
+    struct pollfd wait{event_fd, POLLIN, 0};
+    EXPECT_EQ(::poll(&wait, 1, 0), 1);
+    EXPECT_THROW((void)runner.poll(handle), std::runtime_error);
+    EXPECT_EQ(::poll(&wait, 1, 50), 0);
+}
+
+namespace {
+
+// Heap allocations made by the current thread, counted by the operator new below
+thread_local size_t allocations_on_this_thread = 0;
+
+} // namespace
+
+// GCC pairs inlined calls to these with malloc/free and flags every delete
+// site as mismatched, although both sides are replaced together here
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t size) {
+    ++allocations_on_this_thread;
+    if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) { return ::operator new(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    ++allocations_on_this_thread;
+    return std::malloc(size == 0 ? 1 : size);
+}
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept { return ::operator new(size, tag); }
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+TEST_F(CalculatorAsmTest, TestInputFormatsArgumentsIntoOneBlock) {
+    static_assert(std::ranges::random_access_range<TestInput::ArgList>);
+    
+    auto input = make_input()
+        .add_arg(-42)
+        .add_arg(0.1)
+        .add_arg(true)
+        .add_arg('x')
+        .add_arg(std::string("mul"));
+    
+    ASSERT_EQ(input.size(), 5u);
+    std::vector<std::string> args(input.args().begin(), input.args().end());
+    EXPECT_EQ(args, (std::vector<std::string>{"-42", "0.1", "1", "x", "mul"}));
+    EXPECT_STREQ(input.args().c_str(4), "mul");
+    
+    std::vector<char*> argv;
+    input.fill_argv("./calc", argv);
+    ASSERT_EQ(argv.size(), 7u);
+    EXPECT_STREQ(argv[0], "./calc");
+    EXPECT_STREQ(argv[1], "-42");
+    EXPECT_EQ(argv[6], nullptr);
+}
+
+TEST_F(CalculatorAsmTest, TestRunsDoNotAllocateAfterWarmUp) {
+    if (TraceRecorder::instance().enabled()) {
+        GTEST_SKIP() << "Recording a trace allocates";
+    }
+    if (has_execution_hook()) {
+        GTEST_SKIP() << "The execution hook allocates";
+    }
+    auto input = make_input()
+        .add_arg(1234)
+        .add_arg(66)
+        .add_arg("add");
+    
+    // The first run sizes the output buffers and the thread's argv buffer
+    ExecutionResult result;
+    get_runner()->run_test(input, result);
+    ASSERT_EQ(result.stdout_output, "1300\n");
+    
+    size_t before = allocations_on_this_thread;
+    for (int i = 0; i < 20; ++i) {
+        get_runner()->run_test(input, result);
+    }
+    EXPECT_EQ(allocations_on_this_thread - before, 0u);
+    EXPECT_EQ(result.stdout_output, "1300\n");
+    EXPECT_TRUE(result.succeeded());
+}
+
+TEST_F(CalculatorAsmTest, TestFixtureBuildsCasesInPerTestArena) {
+    size_t before = allocations_on_this_thread;
+    auto input = make_input()
+        .add_arg(6)
+        .add_arg(7)
+        .add_arg("mul");
+    auto expected = expect_success()
+        .stdout_equals("42\n");
+    EXPECT_EQ(allocations_on_this_thread - before, 0u);
+    EXPECT_EQ(input.get_allocator().resource(), memory_resource());
+    EXPECT_EQ(expected.get_allocator().resource(), memory_resource());
+    
+    ExecutionResult result(memory_resource());
+    get_runner()->run_test(input, result);
+    EXPECT_TRUE(expected.matches(result));
+    
+    // Copies may outlive the test, so they go back to the default resource
+    TestInput copy = input;
+    EXPECT_EQ(copy.get_allocator().resource(), std::pmr::get_default_resource());
+    EXPECT_EQ(copy.arg(2), "mul");
+}
+
+TEST_F(CalculatorAsmTest, TestChunkedCaptureOfLargeOutput) {
+    if (!std::filesystem::exists("/bin/cat")) {
+        GTEST_SKIP() << "needs /bin/cat to echo a large stdin";
+    }
+    // string_processor reads a single 1 KB block, so cat produces the volume
+    AsmTestRunner cat("/bin/cat");
+    std::string text;
+    for (int i = 0; text.size() < 3 * ChunkedOutput::kChunkSize; ++i) {
+        text += std::format("line {} of the output\n", i);
+    }
+    
+    auto result = cat.run_chunked(make_input().set_stdin(text));
+    ASSERT_TRUE(result.succeeded());
+    EXPECT_GT(result.stdout_output.chunk_count(), 1u);
+    EXPECT_TRUE(result.stdout_output.equals(text));
+    
+    // A pattern straddling the first chunk boundary is still found
+    auto straddling = std::string_view(text).substr(ChunkedOutput::kChunkSize - 8, 16);
+    auto expected = expect_success()
+        .stdout_contains(straddling)
+        .stdout_contains("line 0 of");
+    EXPECT_TRUE(expected.matches(result)) << expected.get_mismatch_description(result);
+    EXPECT_FALSE(expect_success().stdout_contains("LINE 0").matches(result));
+    EXPECT_EQ(result.stdout_output.view(), text);
+    
+    // Released chunks are recycled by the next capture
+    size_t chunks = result.stdout_output.chunk_count();
+    size_t idle = OutputChunkPool::instance().idle();
+    result.stdout_output.clear();
+    EXPECT_EQ(OutputChunkPool::instance().idle(), idle + chunks);
+}
+
+TEST_F(CalculatorAsmTest, TestStaticExpectationMatchesWithoutAllocating) {
+    using Long = detail::StaticPattern<"OF THE OUTPUT!">;
+    using Horspool = detail::StaticPattern<"needle in a haystack">;
+    static_assert(Long::size == 14 && Long::first_lanes[15] == 'O' && Long::last_lanes[0] == '!');
+    static_assert(Horspool::skip[static_cast<unsigned char>('c')] == 1);
+    static_assert(Horspool::skip[static_cast<unsigned char>('z')] == Horspool::size);
+    
+    constexpr auto expected = static_expect_success()
+        .stdout_equals<"15\n">();
+    auto result = get_runner()->run_test(make_input().add_arg(10).add_arg(5).add_arg("add"));
+    
+    size_t before = allocations_on_this_thread;
+    bool matched = expected.matches(result);
+    EXPECT_EQ(allocations_on_this_thread - before, 0u);
+    EXPECT_TRUE(matched) << expected.get_mismatch_description(result);
+    
+    constexpr auto wrong = static_expect_failure<3>().stdout_contains<"16">();
+    EXPECT_FALSE(wrong.matches(result));
+    EXPECT_EQ(wrong.get_mismatch_description(result),
+              wrong.to_expected_output().get_mismatch_description(result));
+    
+    // Both search strategies agree with std::string_view::find at every offset
+    for (size_t offset = 0; offset < 80; ++offset) {
+        ExecutionResult text;
+        text.stdout_output.assign(offset, 'n');
+        text.stdout_output += "needle in a haystack OF THE OUTPUT!";
+        text.stdout_output.append(offset % 17, 'x');
+        EXPECT_TRUE(static_expect_success().stdout_contains<"needle in a haystack">().matches(text));
+        EXPECT_TRUE(static_expect_success().stdout_contains<"OF THE OUTPUT!">().matches(text));
+        EXPECT_FALSE(static_expect_success().stdout_contains<"OF THE OUTPUT?">().matches(text));
+        EXPECT_FALSE(static_expect_success().stdout_contains<"needle in a haystacks">().matches(text));
+    }
+}
+
+TEST_F(CalculatorAsmTest, TestMismatchReportIsCompactAndBounded) {
+    if (TraceRecorder::instance().enabled()) {
+        GTEST_SKIP() << "Recording a trace allocates";
+    }
+    std::string expected_text(1 << 20, 'a');
+    ExecutionResult result;
+    result.exit_code = 2;
+    result.stdout_output.assign(expected_text);
+    result.stdout_output[500000] = '\n';
+    
+    auto expected = expect_success()
+        .stdout_equals(expected_text)
+        .stdout_contains("needle");
+    
+    size_t before = allocations_on_this_thread;
+    auto report = expected.mismatch_report(result);
+    EXPECT_EQ(allocations_on_this_thread - before, 0u);
+    
+    ASSERT_EQ(report.count, 3u);
+    EXPECT_EQ(report.entries[0].kind, MismatchReport::Kind::ExitCode);
+    EXPECT_EQ(report.entries[1].kind, MismatchReport::Kind::StdoutDiffers);
+    EXPECT_EQ(report.entries[1].first_difference, 500000u);
+    EXPECT_NE(report.entries[1].expected_hash, report.entries[1].actual_hash);
+    EXPECT_EQ(report.entries[1].actual.view(), "aaaaaaaa\naaaaaaaaaaaaaaaaaaaaaaa");
+    EXPECT_EQ(report.entries[2].kind, MismatchReport::Kind::StdoutMissing);
+    
+    auto text = report.render();
+    EXPECT_LE(text.size(), 4096u);
+    EXPECT_NE(text.find("Stdout mismatch at byte 500000"), std::string::npos) << text;
+    EXPECT_NE(text.find("'...aaaaaaaa\\naaa"), std::string::npos) << text;
+    EXPECT_LE(report.render(64).size(), 64u);
+    EXPECT_TRUE(expect_failure(2).mismatch_report(result).empty());
+}
+
+TEST_F(CalculatorAsmTest, TestBinaryCorpusStreamsThroughRunner) {
+    auto path = std::filesystem::temp_directory_path() / std::format("x86_asm_corpus_{}.bin", getpid());
+    {
+        TestCorpusWriter writer(path);
+        for (int i = 0; i < 200; ++i) {
+            writer.add(make_input().add_arg(i).add_arg(7).add_arg("add"), std::format("{}\n", i + 7), 0, {"add"});
+        }
+        writer.add(make_input().add_arg(2).add_arg(2).add_arg("mul").set_stdin("ignored"), "5\n", 0, {"broken"});
+        EXPECT_EQ(writer.size(), 201u);
+        writer.finish();
+    }
+    {
+        // Without finish() nothing is published, not even over an existing corpus
+        TestCorpusWriter abandoned(path);
+        abandoned.add(make_input().add_arg(1), std::nullopt, 0);
+    }
+    EXPECT_FALSE(std::filesystem::exists(path.string() + ".tmp"));
+    
+    TestCorpus corpus(path);
+    ASSERT_EQ(corpus.size(), 201u);
+    auto last = corpus[200];
+    EXPECT_TRUE(last.has_tag("broken"));
+    EXPECT_FALSE(last.has_tag("add"));
+    EXPECT_EQ(std::vector<std::string_view>(last.input.args().begin(), last.input.args().end()),
+              (std::vector<std::string_view>{"2", "2", "mul"}));
+    EXPECT_EQ(last.input.stdin_data(), "ignored");
+    EXPECT_EQ(last.expected.stdout_equals(), "5\n");
+    EXPECT_EQ(corpus[3].input.stdin_data(), std::nullopt);
+    
+    auto added = run_test_corpus(*get_runner(), corpus, {.jobs = 4, .tag = "add"});
+    EXPECT_EQ(added.run, 200u);
+    EXPECT_TRUE(added.all_passed());
+    
+    auto everything = run_test_corpus(*get_runner(), corpus, {.jobs = 4});
+    EXPECT_EQ(everything.passed, 200u);
+    ASSERT_EQ(everything.failures.size(), 1u);
+    EXPECT_EQ(everything.failures[0].index, 200u);
+    EXPECT_EQ(everything.failures[0].report.entries[0].kind, MismatchReport::Kind::StdoutDiffers);
+    
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << "not a corpus";
+    EXPECT_THROW(TestCorpus{path}, std::runtime_error);
+    std::filesystem::remove(path);
+}
+
+TEST_F(CalculatorAsmTest, TestTableCasesParseInParallel) {
+    auto dir = std::filesystem::temp_directory_path() / std::format("x86_asm_table_{}", getpid());
+    std::filesystem::create_directories(dir);
+    
+    std::ofstream(dir / "cases.csv")
+        << "# args,stdin,expected_stdout,exit_code\r\n"
+        << "10 5 add,,15\\n,0\r\n"
+        << "\n"
+        << "\"a\\sb c\",\"x,\"\"y\"\"\",,\r\n";
+    auto csv = load_cases(dir / "cases.csv");
+    ASSERT_EQ(csv.size(), 2u);
+    EXPECT_EQ(csv.line(1), 4u);
+    auto quoted = csv[1];
+    EXPECT_EQ(quoted.input.size(), 2u);
+    EXPECT_EQ(quoted.input.arg(0), "a b");
+    EXPECT_EQ(std::string_view(*quoted.input.stdin_data()), "x,\"y\"");
+    ASM_EXPECT_OUTPUT(get_runner(), csv[0].input, csv[0].expected);
+    
+    {
+        std::ofstream tsv(dir / "many.tsv");
+        for (int i = 0; i < 5000; ++i) {
+            tsv << std::format("{} 3 add\t\t{}\\n\t0\n", i, i + 3);
+        }
+    }
+    auto serial = load_cases(dir / "many.tsv", {.jobs = 1});
+    auto parallel = load_cases(dir / "many.tsv", {.jobs = 4, .min_bytes_per_job = 1024});
+    ASSERT_EQ(parallel.size(), 5000u);
+    for (size_t i : {0u, 1234u, 4999u}) {
+        EXPECT_EQ(parallel.line(i), serial.line(i));
+        EXPECT_EQ(parallel[i].input.arg(0), serial[i].input.arg(0));
+    }
+    EXPECT_TRUE(parallel.expected(4999).matches(get_runner()->run_test(parallel[4999].input)));
+    
+    std::ofstream(dir / "bad.tsv") << "1 2 add\t\t3\\n\t0\n1 2 add\t3\\n\t0\n";
+    try {
+        (void)load_cases(dir / "bad.tsv");
+        ADD_FAILURE() << "malformed row was accepted";
+    } catch (const std::runtime_error& error) {
+        EXPECT_NE(std::string_view(error.what()).find("bad.tsv:2: expected 4 columns, found 3"), std::string_view::npos)
+            << error.what();
+    }
+    std::filesystem::remove_all(dir);
+}
+
+/**
+ * @brief Every operand pair in [-range, range]² with its expected sum, generated lazily
+ */
+auto calc_add_sweep(int range) {
+    int width = 2 * range + 1;
+    return std::views::iota(0, width * width) | std::views::transform([=](int k) {
+        int a = k / width - range, b = k % width - range;
+        return GeneratedCase{make_input().add_arg(a).add_arg(b).add_arg("add"),
+                             expect_success().stdout_equals(std::format("{}\n", a + b))};
+    });
+}
+
+TEST_F(CalculatorAsmTest, TestGeneratedSweepRunsInShards) {
+    auto report = assert_generated(*get_runner(), calc_add_sweep(3), {.jobs = 4});
+    EXPECT_EQ(report.run, 49u);
+    
+    size_t total = 0;
+    for (size_t shard = 0; shard < 3; ++shard) {
+        total += run_generated(*get_runner(), calc_add_sweep(3), {.jobs = 2}, shard, 3).run;
+    }
+    EXPECT_EQ(total, 49u);
+    EXPECT_THROW((void)run_generated(*get_runner(), calc_add_sweep(3), {}, 0, 0), std::invalid_argument);
+    
+    // Expecting the product instead fails all but the pairs where a + b == a * b
+    auto wrong = std::views::iota(0, 9) | std::views::transform([](int k) {
+        int a = k / 3, b = k % 3;
+        return GeneratedCase{x86_asm_test::make_input().add_arg(a).add_arg(b).add_arg("add"),
+                             x86_asm_test::expect_success().stdout_equals(std::format("{}\n", a * b))};
+    });
+    auto failed = run_generated(*get_runner(), wrong, {.jobs = 3, .max_failures = 2});
+    EXPECT_EQ(failed.passed, 2u);
+    EXPECT_EQ(failed.failed, 7u);
+    ASSERT_EQ(failed.failures.size(), 2u);
+    EXPECT_EQ(failed.failures[0].index, 1u);
+    EXPECT_EQ(failed.failures[0].arguments, "0 1 add");
+    EXPECT_EQ(failed.failures[1].index, 2u);
+}
+
+TEST_F(CalculatorAsmTest, TestTraceRecordsRunPhases) {
+    if (TraceRecorder::instance().enabled()) {
+        GTEST_SKIP() << "The whole program is already being traced";
+    }
+    auto& trace = TraceRecorder::instance();
+    trace.start();
+    {
+        std::vector<std::jthread> workers;
+        for (int i = 0; i < 2; ++i) {
+            workers.emplace_back([&, i] {
+                EXPECT_TRUE(expect_success().matches(get_runner()->run_test(make_input().add_arg(i).add_arg(3).add_arg("add"))));
+            });
+        }
+    }
+    std::vector<Task<ExecutionResult>> runs;
+    for (int i = 0; i < 3; ++i) {
+        runs.push_back(get_runner()->run_async(make_input().add_arg(i).add_arg(2).add_arg("mul")));
+    }
+    (void)sync_wait(when_all(std::move(runs)));
+    trace.stop();
+    
+    size_t recorded = trace.event_count();
+    (void)get_runner()->run_test(make_input().add_arg(1).add_arg(1).add_arg("add"));
+    EXPECT_EQ(trace.event_count(), recorded);
+    
+    auto json = trace.to_json();
+    for (std::string_view expected : {R"("name":"run")", R"("name":"spawn")", R"("name":"exec","cat":"x86_asm_test","ph":"X")",
+                                      R"("name":"first byte")", R"("exit_code":0)", R"("name":"match")",
+                                      R"("processes":0)", R"("detail":"calc 1 3 add")", R"("name":"thread_name")"}) {
+        EXPECT_NE(json.find(expected), std::string::npos) << expected;
+    }
+    // Under an execution hook run_async() runs synchronously and is never queued
+    EXPECT_EQ(json.find(R"("name":"queued","cat":"x86_asm_test","ph":"b")") != std::string::npos, !has_execution_hook());
+    EXPECT_NE(json.find(R"("dropped_events":0)"), std::string::npos);
+    
+    // Events over the limit are counted, not kept
+    trace.set_event_limit(3);
+    trace.start();
+    (void)get_runner()->run_test(make_input().add_arg(1).add_arg(1).add_arg("add"));
+    trace.stop();
+    trace.set_event_limit(TraceRecorder::kDefaultEventLimit);
+    EXPECT_EQ(trace.event_count(), 3u);
+    EXPECT_GT(trace.dropped_events(), 0u);
+    EXPECT_NE(trace.to_json().find(std::format(R"("dropped_events":{})", trace.dropped_events())), std::string::npos);
+}
+
+/**
+ * @brief Observer recording the order of run events
+ */
+class EventLog : public RunObserver {
+public:
+    struct Entry {
+        uint64_t id;
+        std::string event;
+        Clock::time_point at;
+    };
+
+    void on_spawn(const RunInfo& run, Clock::time_point at) noexcept override { add(run.id, "spawn", at); }
+    void on_exec(const RunInfo& run, Clock::time_point at, pid_t pid) noexcept override {
+        add(run.id, pid > 0 ? "exec" : "bad pid", at);
+    }
+    void on_output(const RunInfo& run, Clock::time_point at, OutputStream stream, std::string_view data) noexcept override {
+        std::lock_guard lock(mutex_);
+        if (stream == OutputStream::Stdout) stdout_data[run.id] += data;
+        entries.push_back({run.id, "output", at});
+    }
+    void on_exit(const RunInfo& run, Clock::time_point at, int exit_code, bool) noexcept override {
+        add(run.id, std::format("exit {}", exit_code), at);
+    }
+    void on_run(const RunInfo& run, Clock::time_point at, const ExecutionResult&) noexcept override {
+        add(run.id, run.asynchronous ? "async run" : "run", at);
+        // Runs answered without a process (cache, execution hook) have no spawn
+        if (run.spawned != Clock::time_point{}) {
+            EXPECT_LE(run.queued, run.spawned);
+            EXPECT_LE(run.spawned, run.executed);
+        }
+    }
+    void on_match(const RunInfo& run, Clock::time_point begin, Clock::time_point end, bool matched) noexcept override {
+        add(run.id, matched ? "matched" : "mismatched", begin);
+        EXPECT_LE(begin, end);
+    }
+
+    std::vector<Entry> entries;
+    std::map<uint64_t, std::string> stdout_data;
+
+private:
+    void add(uint64_t id, std::string event, Clock::time_point at) {
+        std::lock_guard lock(mutex_);
+        entries.push_back({id, std::move(event), at});
+    }
+
+    std::mutex mutex_;
+};
+
+TEST_F(CalculatorAsmTest, TestRunObserverSeesEveryPhase) {
+    if (has_run_observers()) {
+        GTEST_SKIP() << "Another observer (e.g. the trace exporter) is registered";
+    }
+    auto log = std::make_shared<EventLog>();
+    add_run_observer(log);
+    ASSERT_TRUE(has_run_observers());
+    
+    auto result = get_runner()->run_test(make_input().add_arg(4).add_arg(5).add_arg("add"));
+    EXPECT_FALSE(expect_success().stdout_equals("0\n").matches(result));
+    (void)sync_wait(get_runner()->run_async(make_input().add_arg(2).add_arg(3).add_arg("mul")));
+    remove_run_observer(log.get());
+    EXPECT_FALSE(has_run_observers());
+    (void)get_runner()->run_test(make_input().add_arg(1).add_arg(1).add_arg("add"));
+    
+    // One synchronous and one asynchronous run, in phase order and with non-decreasing timestamps
+    std::map<uint64_t, std::vector<std::string>> events;
+    for (size_t i = 0; i < log->entries.size(); ++i) {
+        if (i > 0 && log->entries[i].id == log->entries[i - 1].id) {
+            EXPECT_LE(log->entries[i - 1].at, log->entries[i].at);
+        }
+        // calc may write the number and the newline separately: count runs of chunks once
+        auto& phases = events[log->entries[i].id];
+        if (phases.empty() || phases.back() != "output" || log->entries[i].event != "output") {
+            phases.push_back(log->entries[i].event);
+        }
+    }
+    // The match is attributed to the run that produced the result
+    ASSERT_EQ(events.size(), 2u);
+    auto run = events.begin();
+    EXPECT_EQ(run->first, result.run_id);
+    EXPECT_EQ(run->second, (std::vector<std::string>{"spawn", "exec", "output", "exit 0", "run", "mismatched"}));
+    EXPECT_EQ(log->stdout_data[run->first], "9\n");
+    ++run;
+    // Under an execution hook run_async() runs synchronously
+    EXPECT_EQ(run->second, (std::vector<std::string>{"spawn", "exec", "output", "exit 0",
+                                                     has_execution_hook() ? "run" : "async run"}));
+    EXPECT_EQ(log->stdout_data[run->first], "6\n");
+}
+
+TEST_F(CalculatorAsmTest, TestRunObserverSeesHookedRuns) {
+    if (has_run_observers()) {
+        GTEST_SKIP() << "Another observer (e.g. the trace exporter) is registered";
+    }
+    if (has_execution_hook()) {
+        GTEST_SKIP() << "Installing a hook would replace the one already installed";
+    }
+    auto log = std::make_shared<EventLog>();
+    add_run_observer(log);
+    
+    // A hook tracing the program reports the traced run with its phases
+    set_execution_hook([](const AsmTestRunner& runner, const TestInput& input) {
+        return CoverageTracer(runner).run(input).result;
+    });
+    auto traced = get_runner()->run_test(make_input().add_arg(4).add_arg(5).add_arg("add"));
+    // A hook that runs nothing observable still finishes one run
+    set_execution_hook([](const AsmTestRunner&, const TestInput&) {
+        ExecutionResult result;
+        result.stdout_output = "42\n";
+        return result;
+    });
+    auto answered = get_runner()->run_test(make_input().add_arg(40).add_arg(2).add_arg("add"));
+    set_execution_hook({});
+    remove_run_observer(log.get());
+    
+    std::map<uint64_t, std::vector<std::string>> events;
+    for (const auto& entry : log->entries) {
+        events[entry.id].push_back(entry.event);
+    }
+    ASSERT_EQ(events.size(), 2u);
+    EXPECT_EQ(events[traced.run_id], (std::vector<std::string>{"spawn", "exec", "output", "exit 0", "run"}));
+    EXPECT_EQ(log->stdout_data[traced.run_id], "9\n");
+    EXPECT_EQ(events[answered.run_id], std::vector<std::string>{"run"});
+}
+
+TEST_F(CalculatorAsmTest, TestHarnessHistogramsMergeThreads) {
+    Histogram values;
+    for (uint64_t v = 1; v <= 100'000; ++v) {
+        values.record(v);
+    }
+    EXPECT_EQ(values.count(), 100'000u);
+    EXPECT_EQ(values.min(), 1u);
+    EXPECT_EQ(values.max(), 100'000u);
+    for (double p : {50.0, 99.0, 99.9}) {
+        auto exact = static_cast<double>(p * 1000);
+        EXPECT_NEAR(static_cast<double>(values.percentile(p)), exact, exact / 64) << p;
+    }
+    for (size_t i = 1; i < Histogram::bucket_count; ++i) {
+        ASSERT_EQ(Histogram::bucket_lower(i), Histogram::bucket_upper(i - 1) + 1);
+        ASSERT_EQ(Histogram::bucket_index(Histogram::bucket_lower(i)), i);
+    }
+    
+    auto& histograms = HarnessHistograms::instance();
+    bool was_enabled = histograms.enabled();
+    histograms.start();
+    auto runs_before = histograms.snapshot(HarnessMetric::RunTime).count();
+    auto spawns_before = histograms.snapshot(HarnessMetric::SpawnLatency).count();
+    {
+        std::vector<std::jthread> workers;
+        for (int i = 0; i < 3; ++i) {
+            workers.emplace_back([&, i] {
+                (void)get_runner()->run_test(x86_asm_test::make_input().add_arg(i).add_arg(7).add_arg("mul"));
+            });
+        }
+    }
+    (void)sync_wait(get_runner()->run_async(make_input().add_arg(2).add_arg(2).add_arg("add")));
+    if (!was_enabled) {
+        histograms.stop();
+    }
+    
+    // Values recorded on exited threads are kept
+    EXPECT_EQ(histograms.snapshot(HarnessMetric::RunTime).count(), runs_before + 4);
+    EXPECT_EQ(histograms.snapshot(HarnessMetric::SpawnLatency).count(), spawns_before + 4);
+    auto first_byte = histograms.snapshot(HarnessMetric::FirstByte);
+    EXPECT_GE(first_byte.count(), 4u);
+    EXPECT_LE(first_byte.percentile(50), first_byte.percentile(99.9));
+    EXPECT_GE(histograms.snapshot(HarnessMetric::OutputBytes).max(), 2u);
+    
+    auto summary = histograms.summary();
+    EXPECT_NE(summary.find("spawn_latency_ns"), std::string::npos);
+    EXPECT_NE(summary.find("p99.9"), std::string::npos);
+    EXPECT_NE(histograms.to_json().find(R"("run_time_ns": {"count":)"), std::string::npos);
+}
+
+TEST_F(CalculatorAsmTest, TestResultStreamWritesEveryRun) {
+    auto directory = std::filesystem::temp_directory_path() / std::format("x86_asm_results_{}", getpid());
+    std::filesystem::create_directories(directory);
+    auto ndjson = directory / "runs.ndjson";
+    auto junit = directory / "runs.xml";
+    
+    auto writer = std::make_shared<ResultStreamWriter>(ResultStreamOptions{ndjson, junit, 512});
+    add_run_observer(writer);
+    writer->begin_test("Calculator", "Stream");
+    for (int i = 0; i < 8; ++i) {
+        (void)get_runner()->run_test(make_input().add_arg(i).add_arg(10).add_arg("add"));
+    }
+    (void)sync_wait(get_runner()->run_async(make_input().add_arg(6).add_arg(7).add_arg("mul")));
+    remove_run_observer(writer.get());
+    
+    // The small buffer was written out while runs were still being recorded
+    EXPECT_GT(std::filesystem::file_size(ndjson), 0u);
+    writer->end_test("failed", std::chrono::milliseconds{3}, "calc.cpp:1: 1 < 0 & \"x\"\n");
+    (void)get_runner()->run_test(make_input().add_arg(1).add_arg(1).add_arg("add"));
+    writer->finish();
+    EXPECT_EQ(writer->runs_written(), 9u);
+    EXPECT_FALSE(writer->failed());
+    
+    std::ifstream lines(ndjson);
+    std::string line;
+    std::vector<std::string> records;
+    while (std::getline(lines, line)) {
+        records.push_back(line);
+    }
+    ASSERT_EQ(records.size(), 10u);
+    EXPECT_NE(records[0].find(R"("type":"run","test":"Calculator.Stream")"), std::string::npos) << records[0];
+    EXPECT_NE(records[0].find(R"("args":["0","10","add"],"exit_code":0)"), std::string::npos) << records[0];
+    for (std::string_view field : {R"("spawn_us":)", R"("first_byte_us":)", R"("max_rss_kb":)", R"("user_us":)",
+                                   R"("minor_faults":)", R"("stdout_bytes":3)"}) {
+        EXPECT_NE(records[0].find(field), std::string::npos) << field;
+    }
+    EXPECT_NE(records[8].find(std::format(R"("async":{},"args":["6","7","mul"])", !has_execution_hook())),
+              std::string::npos) << records[8];
+    EXPECT_NE(records[9].find(R"("type":"test","suite":"Calculator","name":"Stream","status":"failed","runs":9)"),
+              std::string::npos) << records[9];
+    
+    std::ifstream xml_file(junit);
+    std::string xml{std::istreambuf_iterator<char>(xml_file), {}};
+    EXPECT_NE(xml.find(R"(<testsuite name="Calculator.Stream">)"), std::string::npos);
+    // The runs are part of the test's own testcase, not testcases of their own
+    EXPECT_EQ(xml.find("<testcase "), xml.rfind("<testcase "));
+    EXPECT_NE(xml.find(R"(<property name="runs" value="9"/>)"), std::string::npos);
+    EXPECT_NE(xml.find(": 0 10 add exit_code=0 total_us="), std::string::npos);
+    EXPECT_NE(xml.find(" stdout_bytes=3 "), std::string::npos);
+    EXPECT_NE(xml.find("<failure message=\"calc.cpp:1: 1 &lt; 0 &amp; &quot;x&quot;\">"), std::string::npos);
+    EXPECT_TRUE(xml.ends_with("</testsuite>\n</testsuites>\n"));
+    std::filesystem::remove_all(directory);
+    
+    // A full disk is latched, not thrown into the listener
+    ResultStreamWriter full(ResultStreamOptions{"/dev/full", {}, 64});
+    full.begin_test("Calculator", "Full");
+    EXPECT_NO_THROW(full.end_test("passed", std::chrono::milliseconds{1}));
+    EXPECT_NO_THROW(full.finish());
+    EXPECT_TRUE(full.failed());
+}
+
+TEST_F(CalculatorAsmTest, TestPerformanceSummarySplitsOverhead) {
+    auto summary = std::make_shared<PerformanceSummary>(PerformanceSummaryOptions{.slowest_runs = 3, .fixtures = 20});
+    add_run_observer(summary);
+    summary->begin_test("Calculator", "Parallel");
+    {
+        std::vector<std::jthread> workers;
+        for (int i = 0; i < 4; ++i) {
+            workers.emplace_back([&, i] {
+                for (int j = 0; j < 3; ++j) {
+                    (void)get_runner()->run_test(x86_asm_test::make_input().add_arg(i).add_arg(j).add_arg("sub"));
+                }
+            });
+        }
+    }
+    summary->end_test();
+    summary->begin_test("Calculator", "Async");
+    (void)sync_wait(get_runner()->run_async(make_input().add_arg(9).add_arg(9).add_arg("mul")));
+    summary->end_test();
+    remove_run_observer(summary.get());
+    (void)get_runner()->run_test(make_input().add_arg(1).add_arg(1).add_arg("add"));
+    
+    auto totals = summary->totals();
+    EXPECT_EQ(totals.runs, 13u);
+    EXPECT_EQ(totals.processes, 13u);
+    EXPECT_EQ(totals.tests, 2u);
+    EXPECT_GT(totals.child_time.count(), 0);
+    EXPECT_GT(totals.spawn_time.count(), 0);
+    EXPECT_GE(totals.overhead(), totals.queued_time + totals.spawn_time + totals.drain_time - std::chrono::microseconds{1});
+    EXPECT_GE(totals.parallel_saved.count(), 0);
+    
+    auto slowest = summary->slowest_runs();
+    ASSERT_EQ(slowest.size(), 3u);
+    EXPECT_GE(slowest[0].total, slowest[1].total);
+    EXPECT_GE(slowest[1].total, slowest[2].total);
+    EXPECT_TRUE(slowest[0].command.starts_with("calc ")) << slowest[0].command;
+    EXPECT_TRUE(slowest[0].test.starts_with("Calculator.")) << slowest[0].test;
+    
+    auto fixtures = summary->fixtures();
+    ASSERT_EQ(fixtures.size(), 1u);
+    EXPECT_EQ(fixtures[0].name, "Calculator");
+    EXPECT_EQ(fixtures[0].tests, 2u);
+    EXPECT_EQ(fixtures[0].runs, 13u);
+    
+    auto report = summary->render();
+    for (std::string_view expected : {"13 runs (13 processes) in 2 tests", "Harness overhead", "Parallelism saved",
+                                      "Slowest runs:", "Calculator "}) {
+        EXPECT_NE(report.find(expected), std::string::npos) << expected << "\n" << report;
+    }
+}
+
 /**
  * @brief Main function for running the test suite
  */
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     
+    // MutationEngine::gtest_suite() runs this binary against a mutant of an executable
+    if (const char* substitute = std::getenv("X86_ASM_TEST_SUBSTITUTE")) {
+        std::string_view spec{substitute};
+        // The mutant path never contains '=', the original might
+        if (auto separator = spec.rfind('='); separator != std::string_view::npos) {
+            set_executable_substitution(spec.substr(0, separator), spec.substr(separator + 1));
+        }
+    }
+    
+    // Run only tests affected by changed labels and record coverage for next time
+    if (const char* impact_database = std::getenv("X86_ASM_TEST_IMPACT_DB")) {
+        enable_impact_analysis(impact_database);
+    }
+    
+    // Write a timeline of every run, viewable in ui.perfetto.dev
+    if (const char* trace_file = std::getenv("X86_ASM_TEST_TRACE")) {
+        enable_trace_export(trace_file);
+    }
+    
+    // Print tail latencies of the harness at the end
+    if (const char* histogram_file = std::getenv("X86_ASM_TEST_HISTOGRAMS")) {
+        enable_harness_histograms(histogram_file);
+    }
+    
+    // Stream a record of every run for offline analysis
+    const char* results_file = std::getenv("X86_ASM_TEST_RESULTS");
+    const char* junit_file = std::getenv("X86_ASM_TEST_JUNIT");
+    if (results_file || junit_file) {
+        (void)enable_result_stream({.ndjson = results_file ? results_file : "",
+                                    .junit = junit_file ? junit_file : "",
+                                    .buffer_size = 64 * 1024});
+    }
+    
+    // Show where the suite spends its time
+    if (const char* slowest = std::getenv("X86_ASM_TEST_SUMMARY")) {
+        PerformanceSummaryOptions options;
+        std::from_chars(slowest, slowest + std::strlen(slowest), options.slowest_runs);
+        (void)enable_performance_summary(options);
+    }
+    
+    // Tests that re-run this binary must not overwrite the files above or repeat the reports
+    // (a recording child would also filter its tests against the database)
+    for (const char* name : {"X86_ASM_TEST_IMPACT_DB", "X86_ASM_TEST_TRACE", "X86_ASM_TEST_HISTOGRAMS",
+                             "X86_ASM_TEST_RESULTS", "X86_ASM_TEST_JUNIT", "X86_ASM_TEST_SUMMARY"}) {
+        unsetenv(name);
+    }
+    
+    // Cases from the table are added without recompiling
+    if (std::filesystem::exists("calc_cases.tsv")) {
+        register_table_tests("CalculatorTable",
+                             std::make_shared<CaseTable>(load_cases("calc_cases.tsv")),
+                             std::make_shared<AsmTestRunner>("./calc", AsmSyntax::Intel));
+    }
+    
+    // One test per shard; cases are generated while each shard runs
+    register_generated_tests("CalculatorSweep", "add", std::make_shared<AsmTestRunner>("./calc", AsmSyntax::Intel),
+                             [] { return calc_add_sweep(5); }, 3);
+    
     std::cout << "Running x86 Assembly Test Framework Examples\n";
     std::cout << std::format("Current working directory: {}\n", std::filesystem::current_path().string());
     
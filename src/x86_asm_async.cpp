@@ -0,0 +1,542 @@
+/**
+ * @file x86_asm_async.cpp
+ * @brief Implementation of the epoll reactor and the coroutine API
+ */
+
+#include "x86_asm_async.h"
+#include "x86_asm_cache.h"
+#include <thread>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <cerrno>
+#include <format>
+
+namespace x86_asm_test {
+
+namespace detail {
+
+AsyncProcess::AsyncProcess(const AsmTestRunner& runner, TestInput input)
+    : executable_{runner.executable_path()},
+      working_directory_{runner.config().working_directory},
+      timeout_{runner.config().timeout},
+      capture_stderr_{runner.config().capture_stderr},
+      input_{std::move(input)} {
+    if (auto observers = current_run_observers()) {
+        observed_.emplace(std::move(observers), RunInfo{});
+        observed_->info = {.id = next_run_id(), .executable = &executable_, .input = &input_, .asynchronous = true,
+                           .queued = Clock::now()};
+    }
+}
+
+AsyncProcess::~AsyncProcess() {
+    if (pid_ > 0 && !reaped_) {
+        kill(pid_, SIGKILL);
+        waitpid(pid_, nullptr, 0);
+    }
+    close_fd(stdin_fd_);
+    close_fd(stdout_fd_);
+    close_fd(stderr_fd_);
+    close_fd(pid_fd_);
+    if (reactor_) {
+        reactor_->remove(*this);
+    }
+}
+
+void AsyncProcess::close_fd(int& fd) noexcept {
+    if (fd < 0) return;
+    // Deregister first: a child between fork and exec may still share the file
+    if (reactor_) reactor_->forget(fd);
+    close(fd);
+    fd = -1;
+}
+
+void AsyncProcess::start() {
+    started_ = true;
+    if (observed_) {
+        observed_->info.spawned = Clock::now();
+        observed_->notify(&RunObserver::on_spawn, observed_->info.spawned);
+    }
+
+    int stdin_pipe[2], stdout_pipe[2], stderr_pipe[2];
+    if (pipe2(stdin_pipe, O_CLOEXEC) == -1) {
+        throw std::runtime_error("Failed to create pipes");
+    }
+    if (pipe2(stdout_pipe, O_CLOEXEC) == -1) {
+        close(stdin_pipe[0]); close(stdin_pipe[1]);
+        throw std::runtime_error("Failed to create pipes");
+    }
+    if (pipe2(stderr_pipe, O_CLOEXEC) == -1) {
+        close(stdin_pipe[0]); close(stdin_pipe[1]);
+        close(stdout_pipe[0]); close(stdout_pipe[1]);
+        throw std::runtime_error("Failed to create pipes");
+    }
+
+    std::vector<char*> exec_args;
+    input_.fill_argv(executable_.c_str(), exec_args);
+
+    // Resolved before fork: the child must not allocate
+    bool change_directory = !detail::is_current_directory(working_directory_);
+
+    start_time_ = Clock::now();
+    deadline_ = start_time_ + timeout_;
+    pid_t pid = fork();
+    if (pid == -1) {
+        close(stdin_pipe[0]); close(stdin_pipe[1]);
+        close(stdout_pipe[0]); close(stdout_pipe[1]);
+        close(stderr_pipe[0]); close(stderr_pipe[1]);
+        throw std::runtime_error("Fork failed");
+    }
+
+    if (pid == 0) {
+        dup2(stdin_pipe[0], STDIN_FILENO);
+        dup2(stdout_pipe[1], STDOUT_FILENO);
+        dup2(stderr_pipe[1], STDERR_FILENO);
+
+        if (change_directory && chdir(working_directory_.c_str()) != 0) {
+            perror("chdir");
+            _exit(127);
+        }
+
+        execv(executable_.c_str(), exec_args.data());
+        perror("execv");
+        _exit(127);
+    }
+
+    pid_ = pid;
+    if (observed_) {
+        observed_->info.executed = Clock::now();
+        observed_->notify(&RunObserver::on_exec, observed_->info.executed, pid_);
+    }
+    close(stdin_pipe[0]);
+    close(stdout_pipe[1]);
+    close(stderr_pipe[1]);
+    stdin_fd_ = stdin_pipe[1];
+    stdout_fd_ = stdout_pipe[0];
+    stderr_fd_ = stderr_pipe[0];
+    for (int fd : {stdin_fd_, stdout_fd_, stderr_fd_}) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+    pid_fd_ = static_cast<int>(syscall(SYS_pidfd_open, pid_, 0));
+    if (pid_fd_ >= 0) {
+        fcntl(pid_fd_, F_SETFD, FD_CLOEXEC);
+        reactor_->watch(pid_fd_, EPOLLIN, *this);
+    }
+
+    const auto& stdin_data = input_.stdin_data();
+    if (stdin_data && !stdin_data->empty()) {
+        reactor_->watch(stdin_fd_, EPOLLOUT, *this);
+    } else {
+        close_fd(stdin_fd_);
+    }
+    reactor_->watch(stdout_fd_, EPOLLIN, *this);
+    reactor_->watch(stderr_fd_, EPOLLIN, *this);
+}
+
+void AsyncProcess::on_event(int fd) {
+    if (fd == stdin_fd_) {
+        std::string_view pending = std::string_view{*input_.stdin_data()}.substr(written_);
+        ssize_t written = write(stdin_fd_, pending.data(), pending.size());
+        if (written > 0) {
+            written_ += static_cast<size_t>(written);
+            if (written_ == input_.stdin_data()->size()) {
+                close_fd(stdin_fd_);
+            }
+        } else if (written < 0 && errno != EINTR && errno != EAGAIN) {
+            // EPIPE: the program exited without reading all of its input
+            close_fd(stdin_fd_);
+        }
+    } else if (fd == stdout_fd_) {
+        drain(stdout_fd_, &result_.stdout_output, OutputStream::Stdout);
+    } else if (fd == stderr_fd_) {
+        // Uncaptured stderr is still drained so the child never blocks on it
+        drain(stderr_fd_, capture_stderr_ ? &result_.stderr_output : nullptr, OutputStream::Stderr);
+    } else if (fd == pid_fd_) {
+        reap(WNOHANG);
+    }
+    update_finished();
+}
+
+bool AsyncProcess::drain(int& fd, std::pmr::string* sink, OutputStream stream) {
+    char buffer[65536];
+    ssize_t bytes_read = read(fd, buffer, sizeof(buffer));
+    if (bytes_read > 0) {
+        std::string_view data{buffer, static_cast<size_t>(bytes_read)};
+        if (observed_) {
+            observed_->output(Clock::now(), stream, data);
+        }
+        if (sink) sink->append(data);
+        return true;
+    }
+    if (bytes_read == 0 || (errno != EINTR && errno != EAGAIN)) {
+        close_fd(fd);
+    }
+    return false;
+}
+
+void AsyncProcess::reap(int options) {
+    int status = 0;
+    struct rusage usage{};
+    if (wait4(pid_, &status, options, observed_ ? &usage : nullptr) != pid_) {
+        return;
+    }
+    reaped_ = true;
+    close_fd(pid_fd_);
+    if (observed_) {
+        // The pidfd can fire before the pipes: read what the child wrote so
+        // observers see its output before its exit
+        while (stdout_fd_ >= 0 && drain(stdout_fd_, &result_.stdout_output, OutputStream::Stdout)) {}
+        while (stderr_fd_ >= 0 &&
+               drain(stderr_fd_, capture_stderr_ ? &result_.stderr_output : nullptr, OutputStream::Stderr)) {}
+    }
+    if (WIFEXITED(status)) {
+        result_.exit_code = WEXITSTATUS(status);
+    } else if (WIFSIGNALED(status)) {
+        result_.exit_code = 128 + WTERMSIG(status);
+    }
+    if (observed_) {
+        observed_->exit(Clock::now(), result_.exit_code, result_.timed_out, usage);
+    }
+}
+
+void AsyncProcess::update_finished() {
+    if (finished_ || stdout_fd_ >= 0 || stderr_fd_ >= 0) {
+        return;
+    }
+    if (!reaped_ && pid_fd_ < 0) {
+        // Without a pidfd, closed outputs are the only exit notification
+        reap(0);
+    }
+    if (reaped_) {
+        close_fd(stdin_fd_);
+        finished_ = true;
+        auto finished_time = Clock::now();
+        result_.execution_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+            finished_time - start_time_
+        );
+        if (observed_) {
+            result_.run_id = observed_->info.id;
+            observed_->notify(&RunObserver::on_run, finished_time, result_);
+        }
+    }
+}
+
+void AsyncProcess::expire() noexcept {
+    result_.timed_out = true;
+    deadline_ = Clock::time_point::max();
+    kill(pid_, SIGKILL);
+}
+
+void AsyncProcess::cancel() noexcept {
+    if (pid_ > 0 && !reaped_) {
+        deadline_ = Clock::time_point::max();
+        kill(pid_, SIGKILL);
+    }
+}
+
+void AsyncProcess::fail(std::exception_ptr error) noexcept {
+    started_ = true;
+    error_ = std::move(error);
+    finished_ = true;
+}
+
+ExecutionResult AsyncProcess::take_result() {
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+    return std::move(result_);
+}
+
+Reactor::Reactor()
+    : epoll_fd_{epoll_create1(EPOLL_CLOEXEC)},
+      timer_fd_{timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)},
+      max_in_flight_{std::max<size_t>(2 * std::thread::hardware_concurrency(), 4)} {
+    if (epoll_fd_ < 0 || timer_fd_ < 0) {
+        if (epoll_fd_ >= 0) close(epoll_fd_);
+        if (timer_fd_ >= 0) close(timer_fd_);
+        throw std::runtime_error("Failed to create epoll instance");
+    }
+    struct epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = timer_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, timer_fd_, &event);
+}
+
+Reactor::~Reactor() {
+    close(timer_fd_);
+    close(epoll_fd_);
+}
+
+void Reactor::notify() noexcept {
+    struct itimerspec spec{};
+    spec.it_value.tv_nsec = 1;
+    timerfd_settime(timer_fd_, 0, &spec, nullptr);
+}
+
+void Reactor::arm_timer() noexcept {
+    // steady_clock is CLOCK_MONOTONIC, so deadlines can be armed as absolute times
+    if (!ready_.empty()) {
+        notify();
+        return;
+    }
+    struct itimerspec spec{};
+    auto earliest = AsyncProcess::Clock::time_point::max();
+    for (const auto* process : running_) {
+        earliest = std::min(earliest, process->deadline());
+    }
+    if (earliest != AsyncProcess::Clock::time_point::max()) {
+        auto since_epoch = std::chrono::duration_cast<std::chrono::nanoseconds>(earliest.time_since_epoch()).count();
+        spec.it_value.tv_sec = static_cast<time_t>(std::max<int64_t>(since_epoch, 1) / 1'000'000'000);
+        spec.it_value.tv_nsec = static_cast<long>(std::max<int64_t>(since_epoch, 1) % 1'000'000'000);
+    }
+    timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
+
+Reactor& Reactor::current() {
+    thread_local Reactor reactor;
+    return reactor;
+}
+
+void Reactor::watch(int fd, uint32_t events, AsyncProcess& process) {
+    struct epoll_event event{};
+    event.events = events;
+    event.data.fd = fd;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) == -1) {
+        throw std::runtime_error(std::format("Failed to watch descriptor {}", fd));
+    }
+    descriptors_[fd] = &process;
+}
+
+void Reactor::forget(int fd) noexcept {
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    descriptors_.erase(fd);
+}
+
+void Reactor::submit(AsyncProcess& process) {
+    process.reactor_ = this;
+    if (process.observed_) {
+        process.observed_->info.queued = AsyncProcess::Clock::now();
+    }
+    if (running_.size() < max_in_flight_) {
+        try {
+            process.start();
+            running_.push_back(&process);
+        } catch (...) {
+            // Reported by the next run_once(): the waiter cannot be resumed from inside its own suspension
+            process.fail(std::current_exception());
+            ready_.push_back(&process);
+        }
+    } else {
+        queued_.push_back(&process);
+    }
+    arm_timer();
+}
+
+void Reactor::remove(AsyncProcess& process) noexcept {
+    std::erase(running_, &process);
+    std::erase(queued_, &process);
+    std::erase(ready_, &process);
+    std::erase(completed_, &process);
+    process.reactor_ = nullptr;
+}
+
+void Reactor::start_queued(std::vector<AsyncProcess*>& done) {
+    while (!queued_.empty() && running_.size() < max_in_flight_) {
+        auto* process = queued_.front();
+        queued_.pop_front();
+        try {
+            process->start();
+            running_.push_back(process);
+        } catch (...) {
+            process->fail(std::current_exception());
+            done.push_back(process);
+        }
+    }
+}
+
+size_t Reactor::run_once(std::chrono::milliseconds timeout) {
+    std::vector<AsyncProcess*> done = std::exchange(ready_, {});
+    start_queued(done);
+
+    if (done.empty() && !running_.empty()) {
+        // Writes to a program that already exited must fail with EPIPE, not kill us
+        sigset_t pipe_mask, old_mask;
+        sigemptyset(&pipe_mask);
+        sigaddset(&pipe_mask, SIGPIPE);
+        pthread_sigmask(SIG_BLOCK, &pipe_mask, &old_mask);
+
+        struct epoll_event events[64];
+        // The timer fires at the earliest deadline, so waiting needs no timeout of its own
+        int ready = epoll_wait(epoll_fd_, events, 64,
+                               static_cast<int>(std::clamp<int64_t>(timeout.count(), -1, INT32_MAX)));
+        for (int i = 0; i < ready; ++i) {
+            if (events[i].data.fd == timer_fd_) {
+                uint64_t expirations = 0;
+                [[maybe_unused]] auto ignored = read(timer_fd_, &expirations, sizeof(expirations));
+                continue;
+            }
+            // Earlier events of this batch may have closed the descriptor
+            auto found = descriptors_.find(events[i].data.fd);
+            if (found != descriptors_.end()) {
+                found->second->on_event(events[i].data.fd);
+            }
+        }
+
+        struct timespec no_wait{0, 0};
+        while (sigtimedwait(&pipe_mask, nullptr, &no_wait) > 0) {}
+        pthread_sigmask(SIG_SETMASK, &old_mask, nullptr);
+
+        auto now = AsyncProcess::Clock::now();
+        for (auto* process : running_) {
+            if (!process->finished() && now >= process->deadline()) {
+                process->expire();
+            }
+        }
+    }
+
+    for (auto* process : running_) {
+        if (process->finished()) done.push_back(process);
+    }
+    std::erase_if(running_, [](const AsyncProcess* process) { return process->finished(); });
+    start_queued(done);
+    arm_timer();
+
+    // Resuming may destroy the process (it lives in the coroutine frame), so detach first
+    std::vector<std::coroutine_handle<>> waiters;
+    for (auto* process : done) {
+        if (process->waiter) {
+            waiters.push_back(std::exchange(process->waiter, {}));
+        } else {
+            completed_.push_back(process);
+        }
+    }
+    for (auto waiter : waiters) {
+        waiter.resume();
+    }
+    return done.size();
+}
+
+std::vector<AsyncProcess*> Reactor::take_completed() {
+    return std::exchange(completed_, {});
+}
+
+} // namespace detail
+
+namespace {
+
+Task<ExecutionResult> ready_task(ExecutionResult result) {
+    co_return result;
+}
+
+Task<ExecutionResult> run_process(
+    const AsmTestRunner& runner,
+    TestInput input,
+    std::shared_ptr<ResultCache> cache,
+    std::optional<CacheKey> key
+) {
+    // Named rather than a temporary: GCC 12 mishandles non-movable temporaries in co_await
+    detail::ProcessAwaiter execution{{runner, std::move(input)}};
+    auto result = co_await execution;
+    if (cache && key && !result.timed_out) {
+        cache->store(*key, result);
+    }
+    co_return result;
+}
+
+} // namespace
+
+Task<ExecutionResult> AsmTestRunner::run_async(const TestInput& input) const {
+    if (has_execution_hook() || config_.use_strace) {
+        return ready_task(run_test(input));
+    }
+
+    std::optional<CacheKey> key;
+    if (cache_) {
+        key = cache_->make_key(executable_path_, input, config_);
+        if (auto cached = cache_->lookup(*key)) {
+            return ready_task(std::move(*cached));
+        }
+    }
+    return run_process(*this, input, cache_, key);
+}
+
+RunHandle AsmTestRunner::submit(const TestInput& input) {
+    if (!submissions_) {
+        submissions_ = std::make_shared<detail::Submissions>();
+    }
+    auto process = std::make_unique<detail::AsyncProcess>(*this, input);
+    submissions_->reactor.submit(*process);
+    RunHandle handle{submissions_->next_id++};
+    submissions_->runs.emplace(handle.id, std::move(process));
+    return handle;
+}
+
+int AsmTestRunner::event_fd() {
+    if (!submissions_) {
+        submissions_ = std::make_shared<detail::Submissions>();
+    }
+    return submissions_->reactor.fd();
+}
+
+std::optional<ExecutionResult> AsmTestRunner::poll(RunHandle handle) {
+    if (!submissions_ || !submissions_->runs.contains(handle.id)) {
+        throw std::invalid_argument(std::format("Unknown run handle {}", handle.id));
+    }
+    auto found = submissions_->runs.find(handle.id);
+
+    auto& reactor = submissions_->reactor;
+    if (!found->second->finished()) {
+        reactor.run_once(std::chrono::milliseconds{0});
+        for (const auto* process : reactor.take_completed()) {
+            submissions_->unclaimed.insert(process);
+        }
+    }
+
+    std::unique_ptr<detail::AsyncProcess> process;
+    if (found->second->finished()) {
+        // A start failure is finished before the reactor ever reports it
+        process = std::move(found->second);
+        submissions_->runs.erase(found);
+        submissions_->unclaimed.erase(process.get());
+        reactor.remove(*process);
+    }
+    // Runs finished while polling other handles produce no further events
+    if (submissions_->unclaimed.empty()) {
+        reactor.arm_timer();
+    } else {
+        reactor.notify();
+    }
+    if (!process) {
+        return std::nullopt;
+    }
+    return process->take_result();
+}
+
+bool AsmTestRunner::cancel(RunHandle handle) {
+    if (!submissions_) {
+        return false;
+    }
+    auto found = submissions_->runs.find(handle.id);
+    if (found == submissions_->runs.end()) {
+        return false;
+    }
+    submissions_->unclaimed.erase(found->second.get());
+    // Destroying the process kills and reaps it and withdraws it from the reactor
+    submissions_->runs.erase(found);
+    if (submissions_->unclaimed.empty()) {
+        submissions_->reactor.arm_timer();
+    }
+    return true;
+}
+
+void set_max_in_flight(size_t limit) {
+    detail::Reactor::current().set_max_in_flight(limit);
+}
+
+} // namespace x86_asm_test
@@ -0,0 +1,467 @@
+/**
+ * @file x86_asm_async.h
+ * @brief Coroutine API for running programs concurrently from one thread
+ */
+
+#pragma once
+
+#include "x86_asm_test.h"
+#include <algorithm>
+#include <chrono>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <sys/types.h>
+
+namespace x86_asm_test {
+
+template<typename T>
+class Task;
+
+namespace detail {
+
+class Reactor;
+
+/**
+ * @class AsyncProcess
+ * @brief One program execution advanced by readiness events instead of a blocking loop
+ *
+ * The child's stdin, stdout, stderr and a pidfd are non-blocking and
+ * registered with a Reactor, which calls on_event() when one of them is
+ * ready. Shared by the coroutine API and AsmTestRunner::submit().
+ */
+class AsyncProcess {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Prepare an execution (nothing is started yet)
+     * @param runner Runner providing the executable and configuration (copied)
+     * @param input Input to run
+     */
+    AsyncProcess(const AsmTestRunner& runner, TestInput input);
+
+    AsyncProcess(const AsyncProcess&) = delete;
+    AsyncProcess& operator=(const AsyncProcess&) = delete;
+
+    /**
+     * @brief Withdraw from the reactor, killing and reaping a running child
+     */
+    ~AsyncProcess();
+
+    /**
+     * @brief Fork the child and register its descriptors with the reactor it was submitted to
+     * @throws std::runtime_error if the process cannot be started
+     */
+    void start();
+
+    /**
+     * @brief Service a ready descriptor
+     * @param fd Descriptor reported by epoll
+     */
+    void on_event(int fd);
+
+    /**
+     * @brief Kill the child because its timeout expired
+     */
+    void expire() noexcept;
+
+    /**
+     * @brief Kill the child on request; the result keeps the signal exit code
+     */
+    void cancel() noexcept;
+
+    /**
+     * @brief Check whether the child was reaped and its output fully read
+     * @return true once result() is final
+     */
+    [[nodiscard]] bool finished() const noexcept { return finished_; }
+
+    /**
+     * @brief Check whether start() was called
+     * @return true if the process was started (or failed to start)
+     */
+    [[nodiscard]] bool started() const noexcept { return started_; }
+
+    /**
+     * @brief Get the time at which the child is killed
+     * @return Start time plus the runner's timeout
+     */
+    [[nodiscard]] Clock::time_point deadline() const noexcept { return deadline_; }
+
+    /**
+     * @brief Mark the execution as failed before it produced a result
+     * @param error Exception rethrown by take_result()
+     */
+    void fail(std::exception_ptr error) noexcept;
+
+    /**
+     * @brief Get the result, rethrowing a start failure
+     * @return Execution result (moved out)
+     */
+    [[nodiscard]] ExecutionResult take_result();
+
+    std::coroutine_handle<> waiter;   ///< Coroutine resumed on completion, if any
+
+private:
+    friend class Reactor;
+
+    std::filesystem::path executable_;
+    std::filesystem::path working_directory_;
+    std::chrono::milliseconds timeout_;
+    bool capture_stderr_;
+    TestInput input_;
+    Reactor* reactor_{nullptr};
+    pid_t pid_{-1};
+    int stdin_fd_{-1};
+    int stdout_fd_{-1};
+    int stderr_fd_{-1};
+    int pid_fd_{-1};
+    size_t written_{0};
+    bool started_{false};
+    bool reaped_{false};
+    bool finished_{false};
+    Clock::time_point start_time_;
+    Clock::time_point deadline_;
+    ExecutionResult result_;
+    std::exception_ptr error_;
+    std::optional<RunObservation> observed_;   ///< Set if run observers were registered at construction
+
+    void close_fd(int& fd) noexcept;
+    /// Read one chunk; false if nothing was ready or the stream closed
+    bool drain(int& fd, std::pmr::string* sink, OutputStream stream);
+    void reap(int options);
+    void update_finished();
+};
+
+/**
+ * @class Reactor
+ * @brief epoll loop multiplexing many AsyncProcess executions on one thread
+ *
+ * At most max_in_flight() processes run at once; further submissions wait
+ * in a queue and start as earlier ones finish.
+ */
+class Reactor {
+public:
+    /**
+     * @brief Create the epoll instance
+     * @throws std::runtime_error if epoll is unavailable
+     */
+    Reactor();
+    ~Reactor();
+
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+    /**
+     * @brief Get the reactor of the calling thread
+     * @return Thread-local reactor
+     */
+    [[nodiscard]] static Reactor& current();
+
+    /**
+     * @brief Queue a process; it starts as soon as a slot is free
+     * @param process Process to run; must stay alive until finished or removed
+     */
+    void submit(AsyncProcess& process);
+
+    /**
+     * @brief Stop tracking a process
+     * @param process Previously submitted process
+     */
+    void remove(AsyncProcess& process) noexcept;
+
+    /**
+     * @brief Wait for events once and advance the processes they concern
+     *
+     * Finished processes are reported through their waiter (resumed after
+     * the reactor's state is updated) or, without one, collected for
+     * take_completed().
+     *
+     * @param timeout Longest time to wait; negative waits until the next event or deadline
+     * @return Number of processes that finished
+     */
+    size_t run_once(std::chrono::milliseconds timeout = std::chrono::milliseconds{-1});
+
+    /**
+     * @brief Take the finished processes that had no waiter
+     * @return Processes in completion order
+     */
+    [[nodiscard]] std::vector<AsyncProcess*> take_completed();
+
+    /**
+     * @brief Check whether there is nothing left to run or wait for
+     * @return true without running, queued or unreported processes
+     */
+    [[nodiscard]] bool idle() const noexcept {
+        return running_.empty() && queued_.empty() && ready_.empty();
+    }
+
+    /**
+     * @brief Get the epoll descriptor
+     *
+     * Readable whenever run_once() has work: process I/O, an exit, an
+     * expired deadline, or a start failure to report.
+     *
+     * @return epoll file descriptor
+     */
+    [[nodiscard]] int fd() const noexcept { return epoll_fd_; }
+
+    /**
+     * @brief Make fd() readable now, e.g. for results the caller has not collected yet
+     */
+    void notify() noexcept;
+
+    /**
+     * @brief Set the timer to the earliest deadline, or to now while start failures await run_once()
+     *
+     * Re-arming also drops an expiration nobody is going to collect, so
+     * fd() stops being readable once there is nothing left to report.
+     */
+    void arm_timer() noexcept;
+
+    /**
+     * @brief Get the maximum number of concurrently running processes
+     * @return Limit
+     */
+    [[nodiscard]] size_t max_in_flight() const noexcept { return max_in_flight_; }
+
+    /**
+     * @brief Set the maximum number of concurrently running processes
+     * @param limit New limit (at least 1)
+     */
+    void set_max_in_flight(size_t limit) noexcept { max_in_flight_ = std::max<size_t>(limit, 1); }
+
+private:
+    friend class AsyncProcess;
+
+    int epoll_fd_{-1};
+    int timer_fd_{-1};                        ///< Fires at the earliest deadline
+    size_t max_in_flight_;
+    std::vector<AsyncProcess*> running_;
+    std::deque<AsyncProcess*> queued_;
+    std::vector<AsyncProcess*> ready_;        ///< Finished inside submit(), reported by run_once()
+    std::unordered_map<int, AsyncProcess*> descriptors_;
+    std::vector<AsyncProcess*> completed_;
+
+    void watch(int fd, uint32_t events, AsyncProcess& process);
+    void forget(int fd) noexcept;
+    void start_queued(std::vector<AsyncProcess*>& done);
+};
+
+/**
+ * @brief Runs started with AsmTestRunner::submit(), owned by the runner
+ */
+struct Submissions {
+    Reactor reactor;
+    uint64_t next_id{1};
+    std::unordered_set<const AsyncProcess*> unclaimed;   ///< Finished runs reported by the reactor, not yet returned by poll()
+    std::unordered_map<uint64_t, std::unique_ptr<AsyncProcess>> runs;   ///< Destroyed before the reactor
+};
+
+/**
+ * @brief Awaitable running one process on the current thread's reactor
+ */
+struct ProcessAwaiter {
+    AsyncProcess process;
+
+    [[nodiscard]] bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) {
+        process.waiter = handle;
+        Reactor::current().submit(process);
+    }
+    ExecutionResult await_resume() { return process.take_result(); }
+};
+
+/// Common part of Task promises
+struct TaskPromiseBase {
+    std::coroutine_handle<> continuation{std::noop_coroutine()};
+    std::exception_ptr exception;
+    bool started{false};
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    struct FinalAwaiter {
+        [[nodiscard]] bool await_ready() const noexcept { return false; }
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            return handle.promise().continuation;
+        }
+        void await_resume() const noexcept {}
+    };
+
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() noexcept { exception = std::current_exception(); }
+};
+
+template<typename T>
+struct TaskPromise : TaskPromiseBase {
+    std::optional<T> value;
+
+    Task<T> get_return_object() noexcept;
+    void return_value(T result) { value.emplace(std::move(result)); }
+
+    T take() {
+        if (exception) std::rethrow_exception(exception);
+        return std::move(*value);
+    }
+};
+
+template<>
+struct TaskPromise<void> : TaskPromiseBase {
+    Task<void> get_return_object() noexcept;
+    void return_void() noexcept {}
+
+    void take() {
+        if (exception) std::rethrow_exception(exception);
+    }
+};
+
+} // namespace detail
+
+/**
+ * @class Task
+ * @brief Lazily started coroutine producing a T
+ *
+ * Nothing runs until the task is awaited or passed to sync_wait(). A task
+ * that is already running (started by when_all()) may still be awaited.
+ *
+ * @tparam T Result type
+ */
+template<typename T = void>
+class [[nodiscard]] Task {
+public:
+    using promise_type = detail::TaskPromise<T>;
+
+    Task() = default;
+    explicit Task(std::coroutine_handle<promise_type> handle) noexcept : handle_{handle} {}
+    Task(Task&& other) noexcept : handle_{std::exchange(other.handle_, {})} {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (handle_) handle_.destroy();
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() {
+        if (handle_) handle_.destroy();
+    }
+
+    /**
+     * @brief Check whether the coroutine ran to completion
+     * @return true if the result is available
+     */
+    [[nodiscard]] bool done() const noexcept { return !handle_ || handle_.done(); }
+
+    /**
+     * @brief Run the coroutine up to its first suspension without awaiting it
+     */
+    void start() {
+        auto& promise = handle_.promise();
+        if (!promise.started) {
+            promise.started = true;
+            handle_.resume();
+        }
+    }
+
+    auto operator co_await() noexcept {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> handle;
+
+            [[nodiscard]] bool await_ready() const noexcept { return handle.done(); }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                auto& promise = handle.promise();
+                promise.continuation = awaiting;
+                if (promise.started) {
+                    return std::noop_coroutine();
+                }
+                promise.started = true;
+                return handle;
+            }
+            T await_resume() { return handle.promise().take(); }
+        };
+        return Awaiter{handle_};
+    }
+
+    /**
+     * @brief Get the result of a finished task
+     * @return Result (moved out for non-void T)
+     */
+    T take() { return handle_.promise().take(); }
+
+private:
+    std::coroutine_handle<promise_type> handle_;
+};
+
+namespace detail {
+
+template<typename T>
+Task<T> TaskPromise<T>::get_return_object() noexcept {
+    return Task<T>{std::coroutine_handle<TaskPromise<T>>::from_promise(*this)};
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept {
+    return Task<void>{std::coroutine_handle<TaskPromise<void>>::from_promise(*this)};
+}
+
+} // namespace detail
+
+/**
+ * @brief Run a task to completion, driving the calling thread's reactor
+ * @tparam T Result type
+ * @param task Task to run
+ * @return Result of the task
+ * @throws std::logic_error if the task waits on something the reactor cannot complete
+ */
+template<typename T>
+T sync_wait(Task<T> task) {
+    auto& reactor = detail::Reactor::current();
+    task.start();
+    while (!task.done()) {
+        if (reactor.idle()) {
+            throw std::logic_error("sync_wait: task is suspended but no process is running");
+        }
+        reactor.run_once();
+    }
+    return task.take();
+}
+
+/**
+ * @brief Run tasks concurrently and collect their results in order
+ *
+ * Every task is started before the first one is awaited, so all their
+ * processes are in flight together (up to the reactor's limit).
+ *
+ * @tparam T Result type
+ * @param tasks Tasks to run
+ * @return Results in the order of tasks
+ */
+template<typename T>
+Task<std::vector<T>> when_all(std::vector<Task<T>> tasks) {
+    for (auto& task : tasks) {
+        task.start();
+    }
+    std::vector<T> results;
+    results.reserve(tasks.size());
+    for (auto& task : tasks) {
+        results.push_back(co_await task);
+    }
+    co_return results;
+}
+
+/**
+ * @brief Limit how many processes the calling thread's reactor runs at once
+ * @param limit Maximum number of concurrent processes (default: twice the core count)
+ */
+void set_max_in_flight(size_t limit);
+
+} // namespace x86_asm_test
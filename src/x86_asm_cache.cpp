@@ -0,0 +1,384 @@
+/**
+ * @file x86_asm_cache.cpp
+ * @brief Implementation of the persistent execution result cache
+ */
+
+#include "x86_asm_cache.h"
+#include "x86_asm_hash.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <format>
+
+namespace x86_asm_test {
+
+namespace {
+
+constexpr char kMagic[8] = {'X', '8', '6', 'R', 'C', 'A', 'C', 'H'};
+constexpr uint32_t kVersion = 1;
+
+/// File header, followed by slot_count Slots and then the data area
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t slot_count;
+    uint64_t entries;
+    uint64_t data_end;
+    uint64_t generation;    ///< Resets after filling up; zero in files written before it existed
+    uint8_t reserved[24];
+};
+static_assert(sizeof(Header) == 64);
+
+/// Index entry; a zero key marks an empty slot
+struct Slot {
+    uint64_t high;
+    uint64_t low;
+    uint64_t offset;
+    uint32_t length;
+    uint32_t reserved;
+};
+static_assert(sizeof(Slot) == 32);
+
+/// Fixed part of a stored result, followed by stdout and stderr bytes
+struct Record {
+    int32_t exit_code;
+    uint32_t reserved;
+    int64_t execution_time_ms;
+    uint64_t stdout_size;
+    uint64_t stderr_size;
+};
+static_assert(sizeof(Record) == 32);
+
+void lock_file(int fd, int operation) noexcept {
+    while (flock(fd, operation) != 0 && errno == EINTR) {}
+}
+
+/// RAII flock() holder
+class FileLock {
+public:
+    FileLock(int fd, int operation) : fd_{fd} { lock_file(fd_, operation); }
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+    ~FileLock() { flock(fd_, LOCK_UN); }
+
+private:
+    int fd_;
+};
+
+[[nodiscard]] size_t data_start(uint32_t slot_count) noexcept {
+    return sizeof(Header) + size_t{slot_count} * sizeof(Slot);
+}
+
+} // namespace
+
+/**
+ * @brief RAII holder of the shared flock() common to this process's readers
+ *
+ * flock() locks belong to the open file description, which all threads
+ * share: one reader unlocking would drop the lock of every other reader.
+ * The first reader in takes it and the last one out releases it.
+ */
+class ResultCache::ReaderLock {
+public:
+    explicit ReaderLock(const ResultCache& cache) : cache_{cache} {
+        std::lock_guard lock(cache_.readers_mutex_);
+        if (cache_.readers_++ == 0) {
+            lock_file(cache_.fd_, LOCK_SH);
+        }
+    }
+    ReaderLock(const ReaderLock&) = delete;
+    ReaderLock& operator=(const ReaderLock&) = delete;
+    ~ReaderLock() {
+        std::lock_guard lock(cache_.readers_mutex_);
+        if (--cache_.readers_ == 0) {
+            flock(cache_.fd_, LOCK_UN);
+        }
+    }
+
+private:
+    const ResultCache& cache_;
+};
+
+ResultCache::ResultCache(std::filesystem::path path, uint32_t slot_count)
+    : path_{std::move(path)} {
+    slot_count = std::bit_ceil(std::max(slot_count, 16U));
+
+    fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error(
+            std::format("Failed to open result cache {}: {}", path_.string(), std::strerror(errno))
+        );
+    }
+
+    auto fail = [&](std::string_view message) {
+        throw std::runtime_error(std::format("Result cache {}: {}", path_.string(), message));
+    };
+
+    try {
+        FileLock lock(fd_, LOCK_EX);
+        struct stat info{};
+        if (fstat(fd_, &info) != 0) {
+            fail(std::strerror(errno));
+        }
+
+        if (info.st_size == 0) {
+            Header header{};
+            std::memcpy(header.magic, kMagic, sizeof(kMagic));
+            header.version = kVersion;
+            header.slot_count = slot_count;
+            header.data_end = data_start(slot_count);
+            if (ftruncate(fd_, static_cast<off_t>(header.data_end)) != 0 ||
+                pwrite(fd_, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) {
+                fail(std::strerror(errno));
+            }
+        } else {
+            Header header{};
+            if (pread(fd_, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+                std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+                fail("not a result cache file");
+            }
+            if (header.version != kVersion || !std::has_single_bit(header.slot_count) ||
+                static_cast<uint64_t>(info.st_size) < data_start(header.slot_count)) {
+                fail("incompatible or truncated cache file");
+            }
+        }
+
+        // Reserve the maximum size once; pages past EOF become usable as the file grows
+        void* map = mmap(nullptr, max_file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (map == MAP_FAILED) {
+            fail(std::strerror(errno));
+        }
+        map_ = static_cast<char*>(map);
+    } catch (...) {
+        ::close(fd_);
+        throw;
+    }
+}
+
+ResultCache::~ResultCache() {
+    if (map_) munmap(map_, max_file_size);
+    if (fd_ >= 0) ::close(fd_);
+}
+
+std::shared_ptr<ResultCache> ResultCache::open(const std::filesystem::path& path) {
+    static std::mutex registry_mutex;
+    static std::unordered_map<std::string, std::weak_ptr<ResultCache>> registry;
+
+    std::lock_guard lock(registry_mutex);
+    std::error_code ec;
+    auto absolute = std::filesystem::absolute(path, ec).lexically_normal().string();
+    auto& slot = registry[absolute];
+    if (auto existing = slot.lock()) {
+        return existing;
+    }
+    auto cache = std::make_shared<ResultCache>(path);
+    slot = cache;
+    return cache;
+}
+
+std::optional<ExecutionResult> ResultCache::lookup(const CacheKey& key) const {
+    std::shared_lock lock(mutex_);
+    ReaderLock file_lock(*this);
+
+    const auto* header = reinterpret_cast<const Header*>(map_);
+    const auto* slots = reinterpret_cast<const Slot*>(map_ + sizeof(Header));
+    uint32_t mask = header->slot_count - 1;
+
+    for (uint32_t probe = 0, index = key.low & mask; probe <= mask; ++probe, index = (index + 1) & mask) {
+        const Slot& slot = slots[index];
+        if (slot.high == 0 && slot.low == 0) {
+            return std::nullopt;
+        }
+        if (slot.high != key.high || slot.low != key.low) {
+            continue;
+        }
+        if (slot.offset + slot.length > header->data_end || slot.length < sizeof(Record)) {
+            return std::nullopt;
+        }
+
+        Record record{};
+        std::memcpy(&record, map_ + slot.offset, sizeof(record));
+        if (sizeof(Record) + record.stdout_size + record.stderr_size != slot.length) {
+            return std::nullopt;
+        }
+
+        const char* payload = map_ + slot.offset + sizeof(Record);
+        ExecutionResult result;
+        result.exit_code = record.exit_code;
+        result.execution_time = std::chrono::milliseconds(record.execution_time_ms);
+        result.stdout_output.assign(payload, record.stdout_size);
+        result.stderr_output.assign(payload + record.stdout_size, record.stderr_size);
+        result.from_cache = true;
+        return result;
+    }
+    return std::nullopt;
+}
+
+bool ResultCache::store(const CacheKey& key, const ExecutionResult& result) {
+    std::unique_lock lock(mutex_);
+    FileLock file_lock(fd_, LOCK_EX);
+
+    auto* header = reinterpret_cast<Header*>(map_);
+    auto* slots = reinterpret_cast<Slot*>(map_ + sizeof(Header));
+    uint32_t mask = header->slot_count - 1;
+
+    uint64_t length = sizeof(Record) + result.stdout_output.size() + result.stderr_output.size();
+    if (length > UINT32_MAX || data_start(header->slot_count) + length > max_file_size) {
+        return false;
+    }
+    // Start a new generation rather than stop caching once full
+    if (header->entries + 1 > (uint64_t{header->slot_count} * 3) / 4 || header->data_end + length > max_file_size) {
+        reset();
+        ++header->generation;
+    }
+
+    Slot* target = nullptr;
+    for (uint32_t probe = 0, index = key.low & mask; probe <= mask; ++probe, index = (index + 1) & mask) {
+        Slot& slot = slots[index];
+        if (slot.high == key.high && slot.low == key.low) {
+            return true;
+        }
+        if (slot.high == 0 && slot.low == 0) {
+            target = &slot;
+            break;
+        }
+    }
+    if (!target) {
+        return false;
+    }
+
+    uint64_t offset = header->data_end;
+
+    struct stat info{};
+    if (fstat(fd_, &info) != 0) {
+        return false;
+    }
+    if (offset + length > static_cast<uint64_t>(info.st_size)) {
+        uint64_t grown = std::min<uint64_t>(
+            std::max<uint64_t>(offset + length, static_cast<uint64_t>(info.st_size) * 2), max_file_size);
+        if (ftruncate(fd_, static_cast<off_t>(grown)) != 0) {
+            return false;
+        }
+    }
+
+    Record record{};
+    record.exit_code = result.exit_code;
+    record.execution_time_ms = result.execution_time.count();
+    record.stdout_size = result.stdout_output.size();
+    record.stderr_size = result.stderr_output.size();
+
+    char* out = map_ + offset;
+    std::memcpy(out, &record, sizeof(record));
+    std::memcpy(out + sizeof(record), result.stdout_output.data(), result.stdout_output.size());
+    std::memcpy(out + sizeof(record) + record.stdout_size,
+                result.stderr_output.data(), result.stderr_output.size());
+
+    // Publish the record before the key that makes it reachable
+    target->offset = offset;
+    target->length = static_cast<uint32_t>(length);
+    target->low = key.low;
+    target->high = key.high;
+    header->data_end = offset + length;
+    ++header->entries;
+    return true;
+}
+
+size_t ResultCache::size() const {
+    std::shared_lock lock(mutex_);
+    ReaderLock file_lock(*this);
+    return reinterpret_cast<const Header*>(map_)->entries;
+}
+
+uint64_t ResultCache::generation() const {
+    std::shared_lock lock(mutex_);
+    ReaderLock file_lock(*this);
+    return reinterpret_cast<const Header*>(map_)->generation;
+}
+
+void ResultCache::clear() {
+    std::unique_lock lock(mutex_);
+    FileLock file_lock(fd_, LOCK_EX);
+    reset();
+}
+
+void ResultCache::reset() noexcept {
+    // In place: shrinking the file would fault other processes' mappings
+    auto* header = reinterpret_cast<Header*>(map_);
+    size_t start = data_start(header->slot_count);
+    std::memset(map_ + sizeof(Header), 0, start - sizeof(Header));
+    header->entries = 0;
+    header->data_end = start;
+}
+
+uint64_t ResultCache::binary_hash(const std::filesystem::path& executable) const {
+    struct stat info{};
+    if (::stat(executable.c_str(), &info) != 0) {
+        throw std::runtime_error(
+            std::format("Failed to stat {}: {}", executable.string(), std::strerror(errno))
+        );
+    }
+
+    BinaryStamp stamp;
+    stamp.inode = info.st_ino;
+    stamp.size = static_cast<uint64_t>(info.st_size);
+    stamp.mtime_ns = static_cast<int64_t>(info.st_mtim.tv_sec) * 1'000'000'000 + info.st_mtim.tv_nsec;
+
+    std::lock_guard lock(stamps_mutex_);
+    auto& known = stamps_[executable.string()];
+    if (known.inode == stamp.inode && known.size == stamp.size && known.mtime_ns == stamp.mtime_ns &&
+        known.hash != 0) {
+        return known.hash;
+    }
+
+    std::ifstream file(executable, std::ios::binary);
+    std::string contents{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    if (!file.good() && !file.eof()) {
+        throw std::runtime_error(std::format("Failed to read {}", executable.string()));
+    }
+
+    stamp.hash = detail::hash_bytes(contents) | 1;
+    known = stamp;
+    return stamp.hash;
+}
+
+CacheKey ResultCache::make_key(
+    const std::filesystem::path& executable,
+    const TestInput& input,
+    const TestConfig& config
+) const {
+    uint64_t binary = binary_hash(executable);
+
+    auto digest = [&](uint64_t seed) {
+        uint64_t hash = detail::hash_combine(seed, binary);
+        hash = detail::hash_bytes(executable.native(), hash);
+        hash = detail::hash_combine(hash, static_cast<uint64_t>(config.timeout.count()));
+        hash = detail::hash_combine(hash, config.capture_stderr);
+        hash = detail::hash_bytes(config.working_directory.native(), hash);
+        hash = detail::hash_combine(hash, input.args().size());
+        for (const auto& arg : input.args()) {
+            hash = detail::hash_bytes(arg, hash);
+        }
+        hash = detail::hash_combine(hash, input.stdin_data().has_value());
+        if (input.stdin_data()) {
+            hash = detail::hash_bytes(*input.stdin_data(), hash);
+        }
+        return hash;
+    };
+
+    CacheKey key{digest(kVersion), digest(0x5ca1ab1e0ddba11ULL)};
+    if (key.high == 0 && key.low == 0) {
+        key.high = 1;
+    }
+    return key;
+}
+
+} // namespace x86_asm_test
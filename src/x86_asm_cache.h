@@ -0,0 +1,149 @@
+/**
+ * @file x86_asm_cache.h
+ * @brief Persistent, memory-mapped cache of execution results
+ */
+
+#pragma once
+
+#include "x86_asm_test.h"
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace x86_asm_test {
+
+/**
+ * @struct CacheKey
+ * @brief 128-bit key identifying one (executable, input, config) combination
+ */
+struct CacheKey {
+    uint64_t high{0};  ///< First hash word
+    uint64_t low{0};   ///< Second hash word
+
+    [[nodiscard]] bool operator==(const CacheKey&) const noexcept = default;
+};
+
+/**
+ * @class ResultCache
+ * @brief On-disk hash table from CacheKey to ExecutionResult
+ *
+ * The file holds a fixed-size open-addressing index followed by an
+ * append-only data area, and is mapped into memory so that a hit is a
+ * probe plus a copy. Several processes may share a file: writers take an
+ * exclusive flock(), readers a shared one. Once the index is three
+ * quarters full or the file reaches max_file_size, the next store starts
+ * a new generation: every entry is dropped and the space reused, so the
+ * cache keeps the results of the current working set. generation()
+ * counts these resets.
+ *
+ * Keys include a hash of the executable contents, so rebuilding a program
+ * invalidates its entries without any explicit action. The environment is
+ * not part of the key.
+ */
+class ResultCache {
+public:
+    /**
+     * @brief Open or create a cache file
+     * @param path Cache file location
+     * @param slot_count Index size for a new file (rounded up to a power of two)
+     * @throws std::runtime_error if the file cannot be created or is not a cache file
+     */
+    explicit ResultCache(std::filesystem::path path, uint32_t slot_count = 1U << 16);
+
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    ~ResultCache();
+
+    /**
+     * @brief Get the shared cache instance for a file
+     * @param path Cache file location
+     * @return Cache shared by every runner in this process that uses the same file
+     */
+    [[nodiscard]] static std::shared_ptr<ResultCache> open(const std::filesystem::path& path);
+
+    /**
+     * @brief Look up a result
+     * @param key Cache key
+     * @return Cached result (with from_cache set), or std::nullopt on a miss
+     */
+    [[nodiscard]] std::optional<ExecutionResult> lookup(const CacheKey& key) const;
+
+    /**
+     * @brief Store a result
+     * @param key Cache key
+     * @param result Result to store
+     * @return false if the result alone does not fit in the file
+     */
+    bool store(const CacheKey& key, const ExecutionResult& result);
+
+    /**
+     * @brief Number of stored results
+     * @return Entry count
+     */
+    [[nodiscard]] size_t size() const;
+
+    /**
+     * @brief Number of times the cache filled up and started over
+     * @return Generation count, shared by every process using the file
+     */
+    [[nodiscard]] uint64_t generation() const;
+
+    /**
+     * @brief Drop all entries
+     *
+     * The file keeps its size: other processes may have it mapped, and
+     * shrinking it under them would fault their reads.
+     */
+    void clear();
+
+    /**
+     * @brief Build the key for running an executable with an input and config
+     * @param executable Program to run; its contents are hashed (memoised by mtime/size/inode)
+     * @param input Arguments and stdin
+     * @param config Configuration; only fields that affect the result are hashed
+     * @return Cache key
+     */
+    [[nodiscard]] CacheKey make_key(
+        const std::filesystem::path& executable,
+        const TestInput& input,
+        const TestConfig& config
+    ) const;
+
+    /**
+     * @brief Get the cache file location
+     * @return Path
+     */
+    [[nodiscard]] const std::filesystem::path& path() const noexcept { return path_; }
+
+    /// Largest cache file; this much address space is reserved up front
+    static constexpr size_t max_file_size = size_t{1} << 30;
+
+private:
+    struct BinaryStamp {
+        uint64_t inode{0};
+        uint64_t size{0};
+        int64_t mtime_ns{0};
+        uint64_t hash{0};
+    };
+
+    std::filesystem::path path_;
+    int fd_{-1};
+    char* map_{nullptr};
+    mutable std::shared_mutex mutex_;
+    mutable std::mutex readers_mutex_;
+    mutable size_t readers_{0};        ///< Threads in lookup()/size(); the first takes the shared flock()
+    mutable std::mutex stamps_mutex_;
+    mutable std::unordered_map<std::string, BinaryStamp> stamps_;
+
+    class ReaderLock;
+
+    [[nodiscard]] uint64_t binary_hash(const std::filesystem::path& executable) const;
+    void reset() noexcept;
+};
+
+} // namespace x86_asm_test
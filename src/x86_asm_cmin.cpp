@@ -0,0 +1,160 @@
+/**
+ * @file x86_asm_cmin.cpp
+ * @brief Implementation of coverage-based corpus minimization
+ */
+
+#include "x86_asm_cmin.h"
+#include "x86_asm_workers.h"
+#include "x86_asm_hash.h"
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
+#include <unordered_set>
+#include <format>
+
+namespace x86_asm_test {
+
+namespace {
+
+/// Reduce a traced run to sorted, unique feature ids of the requested granularity
+std::vector<uint64_t> extract_features(
+    const CoverageMap& coverage,
+    const ElfImage& image,
+    const CorpusMinimizeOptions& options
+) {
+    std::vector<uint64_t> features;
+
+    switch (options.granularity) {
+        case CoverageGranularity::Edges:
+            features.reserve(coverage.size());
+            for (const auto& [edge, count] : coverage.edges()) {
+                features.push_back(options.use_hit_counts
+                    ? detail::hash_combine(edge, CoverageMap::hit_bucket(count))
+                    : edge);
+            }
+            break;
+        case CoverageGranularity::Blocks:
+            for (uint32_t offset : coverage.instructions()) {
+                features.push_back(offset);
+            }
+            break;
+        case CoverageGranularity::Labels:
+            for (const auto& label : coverage.labels(image)) {
+                features.push_back(detail::hash_bytes(label));
+            }
+            break;
+    }
+
+    std::ranges::sort(features);
+    auto duplicates = std::ranges::unique(features);
+    features.erase(duplicates.begin(), duplicates.end());
+    return features;
+}
+
+} // namespace
+
+size_t input_size(const TestInput& input) noexcept {
+    size_t size = input.stdin_data() ? input.stdin_data()->size() : 0;
+    for (const auto& arg : input.args()) {
+        size += arg.size() + 1;
+    }
+    return size;
+}
+
+std::vector<TestInput> CorpusReport::select(std::span<const TestInput> inputs) const {
+    std::vector<TestInput> selected;
+    selected.reserve(kept.size());
+    for (size_t index : kept) {
+        selected.push_back(inputs[index]);
+    }
+    return selected;
+}
+
+std::string CorpusReport::summary() const {
+    size_t total = kept.size() + duplicates.size() + redundant.size();
+    return std::format("kept {} of {} inputs ({} duplicates, {} redundant), {} features",
+                       kept.size(), total, duplicates.size(), redundant.size(), total_features);
+}
+
+CorpusReport minimize_corpus(
+    const AsmTestRunner& runner,
+    std::span<const TestInput> inputs,
+    CorpusMinimizeOptions options
+) {
+    CoverageTracer tracer(runner);
+    std::vector<std::vector<uint64_t>> features(inputs.size());
+
+    // Trace every input once, fanning out over worker threads
+    std::atomic<size_t> next{0};
+    auto worker = [&] {
+        for (size_t i = next++; i < inputs.size(); i = next++) {
+            auto traced = tracer.run(inputs[i]);
+            features[i] = extract_features(traced.coverage, tracer.image(), options);
+        }
+    };
+    // A failed trace stops the other workers and is rethrown here
+    detail::run_workers(std::min(options.jobs, inputs.size()), worker, [&] { next = inputs.size(); });
+
+    CorpusReport report;
+    report.signatures.reserve(inputs.size());
+    for (const auto& feature_set : features) {
+        uint64_t signature = detail::hash_combine(0, feature_set.size());
+        for (uint64_t feature : feature_set) {
+            signature = detail::hash_combine(signature, feature);
+        }
+        report.signatures.push_back(signature);
+    }
+
+    // Candidates ordered smallest first; ties keep corpus order
+    std::vector<size_t> order(inputs.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::vector<size_t> sizes(inputs.size());
+    for (size_t i = 0; i < inputs.size(); ++i) sizes[i] = input_size(inputs[i]);
+    std::ranges::stable_sort(order, {}, [&](size_t i) { return sizes[i]; });
+
+    // One representative per signature
+    std::unordered_map<uint64_t, size_t> representative;
+    std::vector<size_t> unique;
+    for (size_t index : order) {
+        if (representative.emplace(report.signatures[index], index).second) {
+            unique.push_back(index);
+        } else {
+            report.duplicates.push_back(index);
+        }
+    }
+
+    // For each feature, the smallest unique input that exercises it
+    std::unordered_map<uint64_t, size_t> owner;
+    for (size_t index : unique) {
+        for (uint64_t feature : features[index]) {
+            owner.emplace(feature, index);
+        }
+    }
+    report.total_features = owner.size();
+
+    std::vector<uint64_t> all_features;
+    all_features.reserve(owner.size());
+    for (const auto& entry : owner) all_features.push_back(entry.first);
+    std::ranges::sort(all_features);
+
+    std::unordered_set<uint64_t> covered;
+    std::vector<bool> is_kept(inputs.size(), false);
+    for (uint64_t feature : all_features) {
+        if (covered.contains(feature)) continue;
+        size_t index = owner[feature];
+        is_kept[index] = true;
+        for (uint64_t f : features[index]) {
+            covered.insert(f);
+        }
+    }
+
+    for (size_t index : unique) {
+        (is_kept[index] ? report.kept : report.redundant).push_back(index);
+    }
+    std::ranges::sort(report.kept);
+    std::ranges::sort(report.duplicates);
+    std::ranges::sort(report.redundant);
+    return report;
+}
+
+} // namespace x86_asm_test
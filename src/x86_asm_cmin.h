@@ -0,0 +1,91 @@
+/**
+ * @file x86_asm_cmin.h
+ * @brief Corpus minimization and de-duplication by coverage signature
+ */
+
+#pragma once
+
+#include "x86_asm_test.h"
+#include "x86_asm_coverage.h"
+#include <algorithm>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace x86_asm_test {
+
+/**
+ * @enum CoverageGranularity
+ * @brief Which coverage features must be preserved by corpus minimization
+ */
+enum class CoverageGranularity : uint8_t {
+    Edges,    ///< Instruction-to-instruction transitions (most precise)
+    Blocks,   ///< Executed instructions, i.e. covered basic blocks
+    Labels    ///< Code labels such as "do_add" (coarsest)
+};
+
+/**
+ * @struct CorpusMinimizeOptions
+ * @brief Options for minimize_corpus()
+ */
+struct CorpusMinimizeOptions {
+    CoverageGranularity granularity{CoverageGranularity::Edges};        ///< Coverage to preserve
+    bool use_hit_counts{true};                                           ///< Treat loop count classes as distinct edges
+    size_t jobs{std::max(1U, std::thread::hardware_concurrency())};     ///< Inputs traced in parallel
+};
+
+/**
+ * @struct CorpusReport
+ * @brief Result of minimizing a corpus
+ *
+ * All indices refer to positions in the input span passed to minimize_corpus().
+ */
+struct CorpusReport {
+    std::vector<size_t> kept;            ///< Inputs forming the minimal covering set, ascending
+    std::vector<size_t> duplicates;      ///< Inputs dropped for an identical coverage signature
+    std::vector<size_t> redundant;       ///< Inputs dropped because others cover all their features
+    std::vector<uint64_t> signatures;    ///< Coverage signature of every input
+    size_t total_features{0};            ///< Distinct coverage features of the whole corpus
+
+    /**
+     * @brief Copy the kept inputs out of the original corpus
+     * @param inputs The corpus passed to minimize_corpus()
+     * @return Minimal corpus
+     */
+    [[nodiscard]] std::vector<TestInput> select(std::span<const TestInput> inputs) const;
+
+    /**
+     * @brief One-line human-readable summary
+     * @return e.g. "kept 12 of 120 inputs (95 duplicates, 13 redundant), 48 features"
+     */
+    [[nodiscard]] std::string summary() const;
+};
+
+/**
+ * @brief Size of an input used to prefer small corpus entries
+ * @param input Input to measure
+ * @return Total bytes of arguments and stdin
+ */
+[[nodiscard]] size_t input_size(const TestInput& input) noexcept;
+
+/**
+ * @brief Run every input once with coverage and keep a minimal covering subset
+ *
+ * Inputs with identical coverage signatures collapse to the smallest one.
+ * The remaining inputs are reduced with the afl-cmin greedy cover: for each
+ * feature not yet covered, the smallest input exercising it is kept.
+ *
+ * @param runner Runner for the program under test
+ * @param inputs Corpus to minimize
+ * @param options Granularity and parallelism
+ * @return Report with kept and dropped input indices
+ * @throws std::runtime_error The first error of any trace, once all workers stopped
+ */
+[[nodiscard]] CorpusReport minimize_corpus(
+    const AsmTestRunner& runner,
+    std::span<const TestInput> inputs,
+    CorpusMinimizeOptions options = {}
+);
+
+} // namespace x86_asm_test
@@ -0,0 +1,379 @@
+/**
+ * @file x86_asm_corpus.cpp
+ * @brief Implementation of the memory-mapped test corpus
+ */
+
+#include "x86_asm_corpus.h"
+#include "x86_asm_workers.h"
+#include <atomic>
+#include <cerrno>
+#include <exception>
+#include <fcntl.h>
+#include <format>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace x86_asm_test {
+
+namespace {
+
+constexpr char kMagic[8] = {'X', '8', '6', 'C', 'O', 'R', 'P', 'S'};
+constexpr uint32_t kVersion = 1;
+
+constexpr uint32_t kHasStdin = 1U << 0;
+constexpr uint32_t kHasStdout = 1U << 1;
+constexpr uint32_t kHasExitCode = 1U << 2;
+
+/**
+ * @struct Header
+ * @brief File header; the index of record offsets follows the last record
+ */
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t case_count;
+    uint64_t index_offset;
+};
+
+/**
+ * @struct RecordHeader
+ * @brief Start of every case; offsets are relative to the record
+ *
+ * The argument and tag lists are length-prefixed, NUL-terminated
+ * strings, so an argument can be handed to execv() from the mapping.
+ */
+struct RecordHeader {
+    uint32_t arg_count;
+    uint32_t args_offset;
+    uint32_t tag_count;
+    uint32_t tags_offset;
+    uint32_t stdin_size;
+    uint32_t stdin_offset;
+    uint32_t stdout_size;
+    uint32_t stdout_offset;
+    int32_t exit_code;
+    uint32_t flags;
+};
+
+// Appends one list entry: 32-bit length, bytes, NUL
+void append_string(std::string& record, std::string_view text) {
+    auto length = static_cast<uint32_t>(text.size());
+    record.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    record.append(text);
+    record.push_back('\0');
+}
+
+// Checks a string list and returns its end, or nullptr if it leaves the record
+const char* check_list(const char* position, const char* end, size_t count) noexcept {
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t length;
+        if (end - position < static_cast<ptrdiff_t>(sizeof(length))) return nullptr;
+        std::memcpy(&length, position, sizeof(length));
+        if (static_cast<size_t>(end - position) < sizeof(length) + length + 1) return nullptr;
+        position += sizeof(length) + length + 1;
+    }
+    return position;
+}
+
+} // namespace
+
+void TestInputView::copy_to(TestInput& input) const {
+    input.clear();
+    for (auto arg : args_) {
+        input.add_arg(arg);
+    }
+    if (stdin_data_) {
+        input.set_stdin(*stdin_data_);
+    }
+}
+
+TestInput TestInputView::to_input() const {
+    TestInput input;
+    copy_to(input);
+    return input;
+}
+
+ExpectedOutput ExpectedOutputView::to_expected_output() const {
+    ExpectedOutput expected;
+    if (exit_code_) expected.exit_code(*exit_code_);
+    if (stdout_output_) expected.stdout_equals(*stdout_output_);
+    return expected;
+}
+
+TestCorpusWriter::TestCorpusWriter(std::filesystem::path path)
+    : path_(std::move(path)), temporary_(path_.string() + ".tmp"),
+      file_(temporary_, std::ios::binary | std::ios::trunc) {
+    if (!file_) {
+        throw std::runtime_error(std::format("Cannot create corpus {}", temporary_.string()));
+    }
+    Header header{};
+    file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    position_ = sizeof(header);
+}
+
+TestCorpusWriter::~TestCorpusWriter() {
+    if (!finished_) {
+        // Not finished, e.g. unwinding from an exception: never publish a partial corpus
+        file_.close();
+        std::error_code ec;
+        std::filesystem::remove(temporary_, ec);
+    }
+}
+
+TestCorpusWriter& TestCorpusWriter::add(
+    const TestInput& input,
+    std::optional<std::string_view> expected_stdout,
+    std::optional<int> expected_exit_code,
+    std::initializer_list<std::string_view> tags
+) {
+    if (finished_) {
+        throw std::logic_error("TestCorpusWriter::add() after finish()");
+    }
+
+    RecordHeader header{};
+    record_.assign(sizeof(header), '\0');
+
+    header.arg_count = static_cast<uint32_t>(input.size());
+    header.args_offset = static_cast<uint32_t>(record_.size());
+    for (auto arg : input.args()) {
+        append_string(record_, arg);
+    }
+    if (const auto& stdin_data = input.stdin_data()) {
+        header.flags |= kHasStdin;
+        header.stdin_offset = static_cast<uint32_t>(record_.size());
+        header.stdin_size = static_cast<uint32_t>(stdin_data->size());
+        record_.append(*stdin_data);
+    }
+    if (expected_stdout) {
+        header.flags |= kHasStdout;
+        header.stdout_offset = static_cast<uint32_t>(record_.size());
+        header.stdout_size = static_cast<uint32_t>(expected_stdout->size());
+        record_.append(*expected_stdout);
+    }
+    if (expected_exit_code) {
+        header.flags |= kHasExitCode;
+        header.exit_code = *expected_exit_code;
+    }
+    header.tag_count = static_cast<uint32_t>(tags.size());
+    header.tags_offset = static_cast<uint32_t>(record_.size());
+    for (auto tag : tags) {
+        append_string(record_, tag);
+    }
+    if (record_.size() > std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error(std::format("Corpus case {} exceeds 4 GB", offsets_.size()));
+    }
+    std::memcpy(record_.data(), &header, sizeof(header));
+
+    file_.write(record_.data(), static_cast<std::streamsize>(record_.size()));
+    if (!file_) {
+        throw std::runtime_error(std::format("Cannot write corpus {}", temporary_.string()));
+    }
+    offsets_.push_back(position_);
+    position_ += record_.size();
+    return *this;
+}
+
+void TestCorpusWriter::finish() {
+    if (finished_) return;
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.case_count = offsets_.size();
+    header.index_offset = position_;
+
+    file_.write(reinterpret_cast<const char*>(offsets_.data()),
+                static_cast<std::streamsize>(offsets_.size() * sizeof(uint64_t)));
+    file_.seekp(0);
+    file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file_.close();
+    if (!file_) {
+        throw std::runtime_error(std::format("Cannot write corpus {}", temporary_.string()));
+    }
+    std::filesystem::rename(temporary_, path_);
+    finished_ = true;
+}
+
+TestCorpus::TestCorpus(const std::filesystem::path& path) : path_(path) {
+    auto fail = [&](std::string_view message) {
+        throw std::runtime_error(std::format("Test corpus {}: {}", path_.string(), message));
+    };
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        fail(std::strerror(errno));
+    }
+    struct stat info{};
+    if (fstat(fd, &info) != 0) {
+        int error = errno;
+        ::close(fd);
+        fail(std::strerror(error));
+    }
+    map_size_ = static_cast<size_t>(info.st_size);
+    if (map_size_ < sizeof(Header)) {
+        ::close(fd);
+        fail("not a test corpus");
+    }
+    void* map = mmap(nullptr, map_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        fail(std::strerror(errno));
+    }
+    map_ = static_cast<const char*>(map);
+    madvise(map, map_size_, MADV_SEQUENTIAL);
+
+    Header header{};
+    std::memcpy(&header, map_, sizeof(header));
+    bool valid = std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 && header.version == kVersion &&
+                 header.index_offset >= sizeof(Header) && header.index_offset <= map_size_ &&
+                 header.case_count <= (map_size_ - header.index_offset) / sizeof(uint64_t);
+    if (!valid) {
+        munmap(map, map_size_);
+        map_ = nullptr;
+        fail("not a test corpus or truncated");
+    }
+    count_ = header.case_count;
+    index_offset_ = header.index_offset;
+}
+
+TestCorpus::TestCorpus(TestCorpus&& other) noexcept
+    : map_(std::exchange(other.map_, nullptr)), map_size_(std::exchange(other.map_size_, 0)),
+      count_(std::exchange(other.count_, 0)), index_offset_(other.index_offset_),
+      path_(std::move(other.path_)) {}
+
+TestCorpus& TestCorpus::operator=(TestCorpus&& other) noexcept {
+    if (this != &other) {
+        if (map_) munmap(const_cast<char*>(map_), map_size_);
+        map_ = std::exchange(other.map_, nullptr);
+        map_size_ = std::exchange(other.map_size_, 0);
+        count_ = std::exchange(other.count_, 0);
+        index_offset_ = other.index_offset_;
+        path_ = std::move(other.path_);
+    }
+    return *this;
+}
+
+TestCorpus::~TestCorpus() {
+    if (map_) munmap(const_cast<char*>(map_), map_size_);
+}
+
+TestCorpusCase TestCorpus::operator[](size_t index) const {
+    auto offset_at = [&](size_t i) {
+        uint64_t offset;
+        std::memcpy(&offset, map_ + index_offset_ + i * sizeof(uint64_t), sizeof(offset));
+        return offset;
+    };
+    uint64_t begin = offset_at(index);
+    uint64_t end = index + 1 < count_ ? offset_at(index + 1) : index_offset_;
+    if (begin < sizeof(Header) || end > index_offset_ || end < begin + sizeof(RecordHeader)) {
+        throw std::runtime_error(std::format("Test corpus {}: case {} is corrupt", path_.string(), index));
+    }
+
+    const char* record = map_ + begin;
+    const char* record_end = map_ + end;
+    size_t size = end - begin;
+    RecordHeader header{};
+    std::memcpy(&header, record, sizeof(header));
+
+    auto within = [&](uint64_t field_offset, uint64_t field_size) {
+        return field_offset <= size && field_size <= size - field_offset;
+    };
+    bool valid = within(header.args_offset, 0) && within(header.tags_offset, 0) &&
+                 check_list(record + header.args_offset, record_end, header.arg_count) != nullptr &&
+                 check_list(record + header.tags_offset, record_end, header.tag_count) != nullptr &&
+                 (!(header.flags & kHasStdin) || within(header.stdin_offset, header.stdin_size)) &&
+                 (!(header.flags & kHasStdout) || within(header.stdout_offset, header.stdout_size));
+    if (!valid) {
+        throw std::runtime_error(std::format("Test corpus {}: case {} is corrupt", path_.string(), index));
+    }
+
+    auto optional_bytes = [&](uint32_t flag, uint32_t field_offset, uint32_t field_size) {
+        return (header.flags & flag) ? std::optional<std::string_view>({record + field_offset, field_size})
+                                     : std::nullopt;
+    };
+    TestCorpusCase result;
+    result.index = index;
+    result.input = TestInputView(StringListView(record + header.args_offset, header.arg_count),
+                                 optional_bytes(kHasStdin, header.stdin_offset, header.stdin_size));
+    result.expected = ExpectedOutputView(
+        optional_bytes(kHasStdout, header.stdout_offset, header.stdout_size),
+        (header.flags & kHasExitCode) ? std::optional<int>(header.exit_code) : std::nullopt
+    );
+    result.tags = StringListView(record + header.tags_offset, header.tag_count);
+    return result;
+}
+
+TestCorpusReport run_test_corpus(const AsmTestRunner& runner, const TestCorpus& corpus,
+                                 const TestCorpusOptions& options) {
+    constexpr size_t kBatch = 64;
+    auto start = std::chrono::steady_clock::now();
+
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> run{0}, passed{0}, failed{0};
+    detail::LowestFailures<TestCorpusFailure> failures(options.max_failures);
+
+    auto worker = [&] {
+        TestInput input;
+        ExecutionResult result;
+        for (size_t first = next.fetch_add(kBatch); first < corpus.size(); first = next.fetch_add(kBatch)) {
+            for (size_t i = first; i < std::min(first + kBatch, corpus.size()); ++i) {
+                auto test_case = corpus[i];
+                if (!options.tag.empty() && !test_case.has_tag(options.tag)) continue;
+
+                test_case.input.copy_to(input);
+                runner.run_test(input, result);
+                ++run;
+                if (test_case.expected.matches(result)) {
+                    ++passed;
+                    continue;
+                }
+                ++failed;
+                // Only failures that are kept pay for an ExpectedOutput and a report
+                if (failures.wanted(i)) {
+                    failures.add({i, test_case.expected.to_expected_output().mismatch_report(result)});
+                }
+            }
+        }
+    };
+    detail::run_workers(std::min(options.jobs, (corpus.size() + kBatch - 1) / kBatch), worker,
+                        [&] { next = corpus.size(); });
+
+    TestCorpusReport report;
+    report.failures = failures.take();
+    report.run = run;
+    report.passed = passed;
+    report.failed = failed;
+    report.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start
+    );
+    return report;
+}
+
+TestCorpusReport assert_test_corpus(const AsmTestRunner& runner, const TestCorpus& corpus,
+                                    const TestCorpusOptions& options) {
+    auto report = run_test_corpus(runner, corpus, options);
+    for (const auto& failure : report.failures) {
+        auto input = corpus[failure.index].input;
+        std::string arguments;
+        for (auto arg : input.args()) {
+            if (!arguments.empty()) arguments += ' ';
+            arguments += arg;
+        }
+        ADD_FAILURE() << std::format("Corpus case {} failed for executable: {}\n", failure.index,
+                                     runner.executable_path().string())
+                      << std::format("Arguments: {}\n", arguments)
+                      << failure.report.render();
+    }
+    if (report.failed > report.failures.size()) {
+        ADD_FAILURE() << std::format("{} more corpus cases failed", report.failed - report.failures.size());
+    }
+    return report;
+}
+
+} // namespace x86_asm_test
@@ -0,0 +1,358 @@
+/**
+ * @file x86_asm_corpus.h
+ * @brief Memory-mapped binary corpus of test cases
+ */
+
+#pragma once
+
+#include "x86_asm_test.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace x86_asm_test {
+
+/**
+ * @class StringListView
+ * @brief Zero-copy view of a list of strings stored in a TestCorpus
+ *
+ * Each string is stored as a 32-bit length, its bytes and a NUL.
+ */
+class StringListView {
+public:
+    /**
+     * @brief Forward iterator yielding std::string_view by value
+     */
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using iterator_concept = std::forward_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using reference = std::string_view;
+        using pointer = void;
+
+        iterator() = default;
+        iterator(const char* position, size_t index) noexcept : position_(position), index_(index) {}
+
+        reference operator*() const noexcept {
+            uint32_t length;
+            std::memcpy(&length, position_, sizeof(length));
+            return {position_ + sizeof(length), length};
+        }
+        iterator& operator++() noexcept {
+            position_ += sizeof(uint32_t) + (**this).size() + 1;
+            ++index_;
+            return *this;
+        }
+        iterator operator++(int) noexcept { auto copy = *this; ++*this; return copy; }
+        friend bool operator==(const iterator& a, const iterator& b) noexcept { return a.index_ == b.index_; }
+
+    private:
+        const char* position_{nullptr};
+        size_t index_{0};
+    };
+
+    StringListView() = default;
+    StringListView(const char* data, size_t count) noexcept : data_(data), count_(count) {}
+
+    [[nodiscard]] iterator begin() const noexcept { return {data_, 0}; }
+    [[nodiscard]] iterator end() const noexcept { return {nullptr, count_}; }
+    [[nodiscard]] size_t size() const noexcept { return count_; }
+    [[nodiscard]] bool empty() const noexcept { return count_ == 0; }
+
+private:
+    const char* data_{nullptr};
+    size_t count_{0};
+};
+
+/**
+ * @class TestInputView
+ * @brief Arguments and stdin of a corpus case, pointing into the mapping
+ */
+class TestInputView {
+public:
+    TestInputView() = default;
+    TestInputView(StringListView args, std::optional<std::string_view> stdin_data) noexcept
+        : args_(args), stdin_data_(stdin_data) {}
+
+    /**
+     * @brief Get the arguments
+     * @return View of the arguments (each NUL-terminated in the file)
+     */
+    [[nodiscard]] StringListView args() const noexcept { return args_; }
+
+    /**
+     * @brief Get stdin data
+     * @return stdin bytes, nullopt if the case has none
+     */
+    [[nodiscard]] std::optional<std::string_view> stdin_data() const noexcept { return stdin_data_; }
+
+    /**
+     * @brief Overwrite a TestInput with this case, reusing its storage
+     * @param input Input to fill
+     */
+    void copy_to(TestInput& input) const;
+
+    /**
+     * @brief Copy into a new TestInput
+     * @return Owning input
+     */
+    [[nodiscard]] TestInput to_input() const;
+
+private:
+    StringListView args_;
+    std::optional<std::string_view> stdin_data_;
+};
+
+/**
+ * @class ExpectedOutputView
+ * @brief Expected stdout and exit code of a corpus case
+ */
+class ExpectedOutputView {
+public:
+    ExpectedOutputView() = default;
+    ExpectedOutputView(std::optional<std::string_view> stdout_output, std::optional<int> exit_code) noexcept
+        : stdout_output_(stdout_output), exit_code_(exit_code) {}
+
+    /**
+     * @brief Get the expected stdout
+     * @return Exact stdout, nullopt if not checked
+     */
+    [[nodiscard]] std::optional<std::string_view> stdout_equals() const noexcept { return stdout_output_; }
+
+    /**
+     * @brief Get the expected exit code
+     * @return Exit code, nullopt if not checked
+     */
+    [[nodiscard]] std::optional<int> exit_code() const noexcept { return exit_code_; }
+
+    /**
+     * @brief Check a result against this case
+     * @param result The execution result to check
+     * @return true if all expectations match
+     */
+    [[nodiscard]] bool matches(const ExecutionResult& result) const noexcept {
+        return (!exit_code_ || result.exit_code == *exit_code_) &&
+               (!stdout_output_ || std::string_view(result.stdout_output) == *stdout_output_);
+    }
+
+    /**
+     * @brief Copy into an ExpectedOutput, e.g. to describe a mismatch
+     * @return Owning expectation
+     */
+    [[nodiscard]] ExpectedOutput to_expected_output() const;
+
+private:
+    std::optional<std::string_view> stdout_output_;
+    std::optional<int> exit_code_;
+};
+
+/**
+ * @struct TestCorpusCase
+ * @brief One case of a TestCorpus
+ */
+struct TestCorpusCase {
+    size_t index{0};                 ///< Position in the corpus
+    TestInputView input;             ///< Arguments and stdin
+    ExpectedOutputView expected;     ///< Expected stdout and exit code
+    StringListView tags;             ///< Free-form labels
+
+    /**
+     * @brief Check whether the case carries a tag
+     * @param tag Tag to look for
+     * @return true if present
+     */
+    [[nodiscard]] bool has_tag(std::string_view tag) const noexcept {
+        return std::ranges::find(tags, tag) != tags.end();
+    }
+};
+
+/**
+ * @class TestCorpusWriter
+ * @brief Writes a TestCorpus file
+ *
+ * Cases are streamed to "<path>.tmp"; finish() appends the index and
+ * renames the file into place, so readers never see a partial corpus.
+ * A writer destroyed before finish() (e.g. by an exception) deletes the
+ * temporary file and leaves any existing corpus untouched.
+ *
+ * @code
+ * TestCorpusWriter writer("calc.corpus");
+ * writer.add(make_input().add_arg(2).add_arg(3).add_arg("add"), "5\n", 0, {"add"});
+ * writer.finish();
+ * @endcode
+ */
+class TestCorpusWriter {
+public:
+    /**
+     * @brief Start a corpus
+     * @param path Final location of the corpus
+     * @throws std::runtime_error if the file cannot be created
+     */
+    explicit TestCorpusWriter(std::filesystem::path path);
+
+    TestCorpusWriter(const TestCorpusWriter&) = delete;
+    TestCorpusWriter& operator=(const TestCorpusWriter&) = delete;
+
+    /**
+     * @brief Delete the temporary file unless finish() succeeded
+     */
+    ~TestCorpusWriter();
+
+    /**
+     * @brief Append a case
+     * @param input Arguments and stdin
+     * @param expected_stdout Exact expected stdout, nullopt to not check it
+     * @param expected_exit_code Expected exit code, nullopt to not check it
+     * @param tags Labels used to select cases
+     * @return Reference to this object for chaining
+     * @throws std::runtime_error on write errors or a case larger than 4 GB
+     */
+    TestCorpusWriter& add(const TestInput& input,
+                          std::optional<std::string_view> expected_stdout,
+                          std::optional<int> expected_exit_code,
+                          std::initializer_list<std::string_view> tags = {});
+
+    /**
+     * @brief Write the index and move the corpus into place
+     * @throws std::runtime_error on write errors
+     */
+    void finish();
+
+    /**
+     * @brief Get the number of cases written
+     * @return Case count
+     */
+    [[nodiscard]] size_t size() const noexcept { return offsets_.size(); }
+
+private:
+    std::filesystem::path path_;
+    std::filesystem::path temporary_;
+    std::ofstream file_;
+    std::vector<uint64_t> offsets_;
+    uint64_t position_{0};
+    std::string record_;                 ///< Reused serialization buffer
+    bool finished_{false};
+};
+
+/**
+ * @class TestCorpus
+ * @brief Read-only, memory-mapped corpus of test cases
+ *
+ * Opening maps the file and checks its header and index; cases are
+ * decoded on access into views that point into the mapping, so a corpus
+ * of millions of cases costs neither registration time nor resident
+ * memory beyond the pages being read.
+ */
+class TestCorpus {
+public:
+    /**
+     * @brief Map a corpus written by TestCorpusWriter
+     * @param path Corpus file
+     * @throws std::runtime_error if the file is missing, not a corpus or truncated
+     */
+    explicit TestCorpus(const std::filesystem::path& path);
+
+    TestCorpus(const TestCorpus&) = delete;
+    TestCorpus& operator=(const TestCorpus&) = delete;
+    TestCorpus(TestCorpus&& other) noexcept;
+    TestCorpus& operator=(TestCorpus&& other) noexcept;
+    ~TestCorpus();
+
+    /**
+     * @brief Get the number of cases
+     * @return Case count
+     */
+    [[nodiscard]] size_t size() const noexcept { return count_; }
+
+    /**
+     * @brief Decode a case
+     * @param index Case index (must be below size())
+     * @return Views into the mapping, valid while the corpus is alive
+     * @throws std::runtime_error if the record is corrupt
+     */
+    [[nodiscard]] TestCorpusCase operator[](size_t index) const;
+
+private:
+    const char* map_{nullptr};
+    size_t map_size_{0};
+    size_t count_{0};
+    uint64_t index_offset_{0};
+    std::filesystem::path path_;
+};
+
+/**
+ * @struct TestCorpusOptions
+ * @brief Options for run_test_corpus()
+ */
+struct TestCorpusOptions {
+    size_t jobs{std::max(1U, std::thread::hardware_concurrency())};   ///< Cases executed in parallel
+    std::string tag{};                                                 ///< Only run cases with this tag (empty = all)
+    size_t max_failures{100};                                          ///< Failures kept with their report
+};
+
+/**
+ * @struct TestCorpusFailure
+ * @brief A failed corpus case
+ */
+struct TestCorpusFailure {
+    size_t index{0};          ///< Case index in the corpus
+    MismatchReport report;    ///< What did not match
+};
+
+/**
+ * @struct TestCorpusReport
+ * @brief Outcome of run_test_corpus()
+ */
+struct TestCorpusReport {
+    size_t run{0};                               ///< Cases executed (after tag filtering)
+    size_t passed{0};                            ///< Cases that matched
+    size_t failed{0};                            ///< Cases that did not match
+    std::vector<TestCorpusFailure> failures;     ///< First failures by index, up to max_failures
+    std::chrono::milliseconds elapsed{0};        ///< Wall-clock time
+
+    /**
+     * @brief Check whether every executed case passed
+     * @return true if nothing failed
+     */
+    [[nodiscard]] bool all_passed() const noexcept { return failed == 0; }
+};
+
+/**
+ * @brief Stream a corpus through a runner
+ *
+ * Worker threads claim consecutive batches of cases. Each keeps one
+ * TestInput and one ExecutionResult that are refilled for every case, so
+ * the steady state allocates nothing per case beyond what the program's
+ * stdin requires. Only the failures at the lowest max_failures indices
+ * are kept, and only those are turned into a MismatchReport.
+ *
+ * @param runner Runner for the program under test
+ * @param corpus Cases to execute
+ * @param options Parallelism, tag filter and failure limit
+ * @return Counts and failures
+ */
+[[nodiscard]] TestCorpusReport run_test_corpus(const AsmTestRunner& runner, const TestCorpus& corpus,
+                                               const TestCorpusOptions& options = {});
+
+/**
+ * @brief Run a corpus and report each kept failure as a Google Test failure
+ * @param runner Runner for the program under test
+ * @param corpus Cases to execute
+ * @param options Parallelism, tag filter and failure limit
+ * @return Counts and failures
+ */
+TestCorpusReport assert_test_corpus(const AsmTestRunner& runner, const TestCorpus& corpus,
+                                    const TestCorpusOptions& options = {});
+
+} // namespace x86_asm_test
@@ -0,0 +1,460 @@
+/**
+ * @file x86_asm_coverage.cpp
+ * @brief Implementation of ELF parsing and ptrace-based coverage tracing
+ */
+
+#include "x86_asm_coverage.h"
+#include "x86_asm_hash.h"
+#include <stdexcept>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <algorithm>
+#include <unordered_map>
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <cstddef>
+#include <elf.h>
+#include <sys/ptrace.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <sys/user.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <format>
+
+namespace x86_asm_test {
+
+namespace {
+
+template<typename T>
+T read_struct(const std::string& bytes, uint64_t offset) {
+    if (offset + sizeof(T) > bytes.size()) {
+        throw std::runtime_error("Truncated ELF file");
+    }
+    T value;
+    std::memcpy(&value, bytes.data() + offset, sizeof(T));
+    return value;
+}
+
+/// Create an anonymous in-memory file, optionally pre-filled with data
+int make_memfd(const char* name, std::string_view contents = {}) {
+    int fd = memfd_create(name, MFD_CLOEXEC);
+    if (fd == -1) {
+        throw std::runtime_error("Failed to create memfd");
+    }
+    size_t offset = 0;
+    while (offset < contents.size()) {
+        ssize_t written = write(fd, contents.data() + offset, contents.size() - offset);
+        if (written <= 0) {
+            close(fd);
+            throw std::runtime_error("Failed to write memfd");
+        }
+        offset += static_cast<size_t>(written);
+    }
+    lseek(fd, 0, SEEK_SET);
+    return fd;
+}
+
+std::string slurp_fd(int fd) {
+    struct stat st{};
+    std::string data;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        data.resize(static_cast<size_t>(st.st_size));
+        ssize_t got = pread(fd, data.data(), data.size(), 0);
+        data.resize(got > 0 ? static_cast<size_t>(got) : 0);
+    }
+    return data;
+}
+
+} // namespace
+
+ElfImage::ElfImage(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error(std::format("Cannot open ELF file: {}", path.string()));
+    }
+    bytes_.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    parse();
+}
+
+ElfImage::ElfImage(std::string bytes) : bytes_{std::move(bytes)} {
+    parse();
+}
+
+void ElfImage::parse() {
+    auto header = read_struct<Elf64_Ehdr>(bytes_, 0);
+    if (std::memcmp(header.e_ident, ELFMAG, SELFMAG) != 0 ||
+        header.e_ident[EI_CLASS] != ELFCLASS64 ||
+        header.e_machine != EM_X86_64) {
+        throw std::runtime_error("Not a 64-bit x86 ELF executable");
+    }
+    entry_ = header.e_entry;
+
+    code_base_ = UINT64_MAX;
+    for (uint16_t i = 0; i < header.e_phnum; ++i) {
+        auto phdr = read_struct<Elf64_Phdr>(bytes_, header.e_phoff + uint64_t{i} * header.e_phentsize);
+        if (phdr.p_type != PT_LOAD) continue;
+        Segment segment{phdr.p_vaddr, phdr.p_offset, phdr.p_filesz, (phdr.p_flags & PF_X) != 0};
+        if (segment.executable) {
+            code_base_ = std::min(code_base_, segment.vaddr);
+        }
+        segments_.push_back(segment);
+    }
+    if (code_base_ == UINT64_MAX) {
+        code_base_ = 0;
+    }
+
+    if (header.e_shoff == 0) return;  // Stripped of section headers: no labels
+
+    std::vector<Elf64_Shdr> sections;
+    sections.reserve(header.e_shnum);
+    for (uint16_t i = 0; i < header.e_shnum; ++i) {
+        sections.push_back(read_struct<Elf64_Shdr>(bytes_, header.e_shoff + uint64_t{i} * header.e_shentsize));
+    }
+
+    for (const auto& section : sections) {
+        if (section.sh_type != SHT_SYMTAB || section.sh_link >= sections.size()) continue;
+        const auto& strtab = sections[section.sh_link];
+        size_t count = section.sh_entsize ? section.sh_size / section.sh_entsize : 0;
+
+        for (size_t i = 0; i < count; ++i) {
+            auto sym = read_struct<Elf64_Sym>(bytes_, section.sh_offset + i * section.sh_entsize);
+            if (sym.st_shndx == SHN_UNDEF || sym.st_shndx >= sections.size()) continue;
+            if ((sections[sym.st_shndx].sh_flags & SHF_EXECINSTR) == 0) continue;
+            auto type = ELF64_ST_TYPE(sym.st_info);
+            if (type != STT_NOTYPE && type != STT_FUNC) continue;
+            if (sym.st_name >= strtab.sh_size) continue;
+
+            const char* name = bytes_.data() + strtab.sh_offset + sym.st_name;
+            if (*name == '\0') continue;
+            symbols_.push_back({name, sym.st_value, 0});
+        }
+    }
+
+    std::ranges::sort(symbols_, {}, &ElfSymbol::address);
+    auto duplicates = std::ranges::unique(symbols_, {}, &ElfSymbol::address);
+    symbols_.erase(duplicates.begin(), duplicates.end());
+
+    // Sizes run to the next label or the end of the containing segment
+    for (size_t i = 0; i < symbols_.size(); ++i) {
+        uint64_t end = symbols_[i].address;
+        for (const auto& segment : segments_) {
+            if (segment.executable && symbols_[i].address >= segment.vaddr &&
+                symbols_[i].address < segment.vaddr + segment.file_size) {
+                end = segment.vaddr + segment.file_size;
+            }
+        }
+        if (i + 1 < symbols_.size()) {
+            end = std::min(end, symbols_[i + 1].address);
+        }
+        symbols_[i].size = end - symbols_[i].address;
+    }
+}
+
+const ElfSymbol* ElfImage::symbol_at(uint64_t address) const noexcept {
+    auto it = std::ranges::upper_bound(symbols_, address, {}, &ElfSymbol::address);
+    if (it == symbols_.begin()) return nullptr;
+    --it;
+    return address < it->address + std::max<uint64_t>(it->size, 1) ? &*it : nullptr;
+}
+
+std::string ElfImage::describe(uint64_t address) const {
+    const auto* symbol = symbol_at(address);
+    if (symbol == nullptr) {
+        return std::format("0x{:x}", address);
+    }
+    if (address == symbol->address) {
+        return symbol->name;
+    }
+    return std::format("{}+0x{:x}", symbol->name, address - symbol->address);
+}
+
+bool ElfImage::is_code(uint64_t address) const noexcept {
+    return std::ranges::any_of(segments_, [address](const Segment& segment) {
+        return segment.executable && address >= segment.vaddr &&
+               address < segment.vaddr + segment.file_size;
+    });
+}
+
+std::optional<uint64_t> ElfImage::file_offset(uint64_t address) const noexcept {
+    for (const auto& segment : segments_) {
+        if (address >= segment.vaddr && address < segment.vaddr + segment.file_size) {
+            return segment.offset + (address - segment.vaddr);
+        }
+    }
+    return std::nullopt;
+}
+
+CoverageMap CoverageMap::from_edges(std::vector<Edge> edges) {
+    std::ranges::sort(edges, {}, &Edge::first);
+
+    CoverageMap map;
+    map.edges_.reserve(edges.size());
+    for (const auto& edge : edges) {
+        if (!map.edges_.empty() && map.edges_.back().first == edge.first) {
+            map.edges_.back().second += edge.second;
+        } else {
+            map.edges_.push_back(edge);
+        }
+    }
+    return map;
+}
+
+size_t CoverageMap::merge(const CoverageMap& other) {
+    size_t added = count_new(other);
+    if (added == 0) {
+        // Fast path: only hit counts change
+        auto it = edges_.begin();
+        for (const auto& edge : other.edges_) {
+            it = std::ranges::lower_bound(it, edges_.end(), edge.first, {}, &Edge::first);
+            it->second += edge.second;
+        }
+        return 0;
+    }
+
+    std::vector<Edge> combined = edges_;
+    combined.insert(combined.end(), other.edges_.begin(), other.edges_.end());
+    *this = from_edges(std::move(combined));
+    return added;
+}
+
+size_t CoverageMap::count_new(const CoverageMap& other) const {
+    size_t added = 0;
+    auto it = edges_.begin();
+    for (const auto& edge : other.edges_) {
+        it = std::ranges::lower_bound(it, edges_.end(), edge.first, {}, &Edge::first);
+        if (it == edges_.end() || it->first != edge.first) {
+            ++added;
+        }
+    }
+    return added;
+}
+
+std::vector<uint32_t> CoverageMap::instructions() const {
+    std::vector<uint32_t> offsets;
+    offsets.reserve(edges_.size());
+    for (const auto& edge : edges_) {
+        offsets.push_back(static_cast<uint32_t>(edge.first & 0xffffffffU));
+    }
+    std::ranges::sort(offsets);
+    auto duplicates = std::ranges::unique(offsets);
+    offsets.erase(duplicates.begin(), duplicates.end());
+    return offsets;
+}
+
+std::vector<std::string> CoverageMap::labels(const ElfImage& image) const {
+    std::vector<std::string> names;
+    const ElfSymbol* last = nullptr;
+    for (uint32_t offset : instructions()) {
+        const auto* symbol = image.symbol_at(image.code_base() + offset);
+        if (symbol != nullptr && symbol != last) {
+            names.push_back(symbol->name);
+            last = symbol;
+        }
+    }
+    std::ranges::sort(names);
+    auto duplicates = std::ranges::unique(names);
+    names.erase(duplicates.begin(), duplicates.end());
+    return names;
+}
+
+uint64_t CoverageMap::signature(bool with_hit_counts) const noexcept {
+    uint64_t hash = detail::hash_combine(0, edges_.size());
+    for (const auto& [edge_key, count] : edges_) {
+        hash = detail::hash_combine(hash, edge_key);
+        if (with_hit_counts) {
+            hash = detail::hash_combine(hash, hit_bucket(count));
+        }
+    }
+    return hash;
+}
+
+CoverageTracer::CoverageTracer(const AsmTestRunner& runner)
+    : CoverageTracer(runner, std::make_shared<const ElfImage>(runner.executable_path())) {}
+
+CoverageTracer::CoverageTracer(const AsmTestRunner& runner, std::shared_ptr<const ElfImage> image)
+    : runner_{runner}, image_{std::move(image)} {}
+
+TracedExecution CoverageTracer::run(const TestInput& input) const {
+    const auto& config = runner_.config();
+    TracedExecution traced;
+    auto start_time = std::chrono::steady_clock::now();
+
+    // Observed like run_test(), so observers see traced runs (and runs an
+    // execution hook traces) with their phases
+    std::optional<detail::RunObservation> observed;
+    if (auto observers = detail::current_run_observers()) {
+        observed.emplace(std::move(observers), RunInfo{});
+        observed->info = {.id = detail::next_run_id(), .executable = &runner_.executable_path(), .input = &input,
+                          .queued = start_time, .spawned = start_time};
+        observed->notify(&RunObserver::on_spawn, start_time);
+    }
+
+    std::string_view stdin_view = input.stdin_data() ? std::string_view{*input.stdin_data()} : std::string_view{};
+    int stdin_fd = make_memfd("asm-stdin", stdin_view);
+    int stdout_fd = make_memfd("asm-stdout");
+    int stderr_fd = make_memfd("asm-stderr");
+
+    // Prepare arguments for execv
+    std::vector<char*> exec_args;
+    input.fill_argv(runner_.executable_path().c_str(), exec_args);
+
+    bool change_directory = !detail::is_current_directory(config.working_directory);
+
+    pid_t pid = fork();
+
+    if (pid == -1) {
+        close(stdin_fd); close(stdout_fd); close(stderr_fd);
+        throw std::runtime_error("Fork failed for coverage tracing");
+    }
+
+    if (pid == 0) {
+        // Child process
+        dup2(stdin_fd, STDIN_FILENO);
+        dup2(stdout_fd, STDOUT_FILENO);
+        dup2(stderr_fd, STDERR_FILENO);
+
+        if (change_directory && chdir(config.working_directory.c_str()) != 0) {
+            _exit(127);
+        }
+
+        ptrace(PTRACE_TRACEME, 0, nullptr, nullptr);
+        execv(runner_.executable_path().c_str(), exec_args.data());
+        perror("execv");
+        _exit(127);
+    }
+    if (observed) {
+        observed->info.executed = std::chrono::steady_clock::now();
+        observed->notify(&RunObserver::on_exec, observed->info.executed, pid);
+    }
+
+    // A tracee blocked in a syscall never returns to the loop below, so a
+    // watchdog kills it at the deadline. Through the pidfd it cannot hit a
+    // recycled pid; without one it only signals while the child is unreaped.
+    int pid_fd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+    std::mutex watchdog_mutex;
+    std::condition_variable_any watchdog_cv;
+    bool child_alive = true;
+    std::atomic<bool> deadline_hit{false};
+    std::jthread watchdog([&, deadline = start_time + config.timeout * timeout_scale_](std::stop_token stop) {
+        std::unique_lock lock(watchdog_mutex);
+        if (!watchdog_cv.wait_until(lock, stop, deadline, [] { return false; }) &&
+            !stop.stop_requested() && child_alive) {
+            deadline_hit = true;
+            if (pid_fd != -1) {
+                syscall(SYS_pidfd_send_signal, pid_fd, SIGKILL, nullptr, 0);
+            } else {
+                kill(pid, SIGKILL);
+            }
+        }
+    });
+    auto child_reaped = [&] {
+        std::lock_guard lock(watchdog_mutex);
+        child_alive = false;
+    };
+
+    // Parent process: the child stops with SIGTRAP after a successful exec.
+    // Every wait goes through wait4 so the reaping one leaves the rusage.
+    int status = 0;
+    struct rusage usage{};
+    wait4(pid, &status, 0, &usage);
+
+    std::unordered_map<uint64_t, uint32_t> counts;
+    const uint64_t base = image_->code_base();
+    uint32_t previous = UINT32_MAX;
+    bool exec_stopped = WIFSTOPPED(status);
+
+    if (exec_stopped) {
+        ptrace(PTRACE_SETOPTIONS, pid, nullptr, PTRACE_O_EXITKILL);
+    }
+
+    while (exec_stopped) {
+        auto rip = static_cast<uint64_t>(
+            ptrace(PTRACE_PEEKUSER, pid, offsetof(user_regs_struct, rip), nullptr));
+
+        int pending_signal = WSTOPSIG(status) == SIGTRAP ? 0 : WSTOPSIG(status);
+        if (pending_signal != 0) {
+            traced.signal = pending_signal;
+            traced.fault_address = rip;
+        } else if (image_->is_code(rip)) {
+            auto current = static_cast<uint32_t>(rip - base);
+            ++counts[CoverageMap::key(previous, current)];
+            previous = current;
+            ++traced.instructions;
+        }
+
+        if (instruction_limit_ != 0 && traced.instructions > instruction_limit_) {
+            traced.result.timed_out = true;
+            kill(pid, SIGKILL);
+            wait4(pid, &status, 0, &usage);
+            break;
+        }
+
+        if (ptrace(PTRACE_SINGLESTEP, pid, nullptr, pending_signal) == -1) {
+            wait4(pid, &status, 0, &usage);
+            break;
+        }
+        wait4(pid, &status, 0, &usage);
+        if (!WIFSTOPPED(status)) break;
+    }
+    auto exited = std::chrono::steady_clock::now();
+    child_reaped();
+    watchdog.request_stop();
+    watchdog.join();
+    if (pid_fd != -1) {
+        close(pid_fd);
+    }
+    if (deadline_hit) {
+        traced.result.timed_out = true;
+    }
+
+    if (WIFEXITED(status)) {
+        traced.result.exit_code = WEXITSTATUS(status);
+    } else if (WIFSIGNALED(status)) {
+        traced.result.exit_code = 128 + WTERMSIG(status);
+        if (!traced.result.timed_out && traced.signal == 0) {
+            traced.signal = WTERMSIG(status);
+        }
+    }
+    if (traced.result.timed_out) {
+        traced.signal = 0;
+    }
+
+    traced.result.stdout_output = slurp_fd(stdout_fd);
+    if (config.capture_stderr) {
+        traced.result.stderr_output = slurp_fd(stderr_fd);
+    }
+    close(stdin_fd); close(stdout_fd); close(stderr_fd);
+    if (observed) {
+        // The memfds are only read after the exit, each as a single chunk
+        if (!traced.result.stdout_output.empty()) {
+            observed->output(exited, OutputStream::Stdout, traced.result.stdout_output);
+        }
+        if (!traced.result.stderr_output.empty()) {
+            observed->output(exited, OutputStream::Stderr, traced.result.stderr_output);
+        }
+        observed->exit(exited, traced.result.exit_code, traced.result.timed_out, usage);
+    }
+
+    std::vector<CoverageMap::Edge> edges(counts.begin(), counts.end());
+    traced.coverage = CoverageMap::from_edges(std::move(edges));
+
+    traced.result.execution_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time
+    );
+    if (observed) {
+        traced.result.run_id = observed->info.id;
+        observed->notify(&RunObserver::on_run, std::chrono::steady_clock::now(), traced.result);
+    }
+    return traced;
+}
+
+} // namespace x86_asm_test
@@ -0,0 +1,323 @@
+/**
+ * @file x86_asm_coverage.h
+ * @brief ELF symbol lookup and ptrace-based edge coverage for static assembly programs
+ */
+
+#pragma once
+
+#include "x86_asm_test.h"
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <filesystem>
+
+namespace x86_asm_test {
+
+/**
+ * @struct ElfSymbol
+ * @brief A code label taken from the symbol table of a static ELF executable
+ */
+struct ElfSymbol {
+    std::string name;       ///< Label name (e.g. "do_add")
+    uint64_t address{0};    ///< Virtual address of the label
+    uint64_t size{0};       ///< Bytes until the next label or end of section
+};
+
+/**
+ * @class ElfImage
+ * @brief Minimal read-only view of a static x86-64 ELF executable
+ *
+ * Loads the file contents, the executable segments and the code labels
+ * so that instruction addresses can be mapped back to source labels.
+ */
+class ElfImage {
+public:
+    /**
+     * @struct Segment
+     * @brief A PT_LOAD program header
+     */
+    struct Segment {
+        uint64_t vaddr{0};      ///< Virtual address
+        uint64_t offset{0};     ///< File offset
+        uint64_t file_size{0};  ///< Bytes backed by the file
+        bool executable{false}; ///< Whether the segment is mapped PROT_EXEC
+    };
+
+    /**
+     * @brief Load and parse an ELF executable
+     * @param path Path to the executable
+     * @throws std::runtime_error if the file is not a 64-bit x86 ELF
+     */
+    explicit ElfImage(const std::filesystem::path& path);
+
+    /**
+     * @brief Parse an ELF executable already held in memory
+     * @param bytes Raw file contents
+     * @throws std::runtime_error if the bytes are not a 64-bit x86 ELF
+     */
+    explicit ElfImage(std::string bytes);
+
+    /**
+     * @brief Get the program entry point
+     * @return Entry virtual address
+     */
+    [[nodiscard]] uint64_t entry() const noexcept { return entry_; }
+
+    /**
+     * @brief Get the raw file contents
+     * @return File bytes
+     */
+    [[nodiscard]] const std::string& bytes() const noexcept { return bytes_; }
+
+    /**
+     * @brief Get the loadable segments
+     * @return Segments in program header order
+     */
+    [[nodiscard]] const std::vector<Segment>& segments() const noexcept { return segments_; }
+
+    /**
+     * @brief Get the code labels sorted by address
+     * @return Labels located in executable sections
+     */
+    [[nodiscard]] const std::vector<ElfSymbol>& symbols() const noexcept { return symbols_; }
+
+    /**
+     * @brief Find the label containing an address
+     * @param address Virtual address
+     * @return Pointer to the nearest preceding label, or nullptr
+     */
+    [[nodiscard]] const ElfSymbol* symbol_at(uint64_t address) const noexcept;
+
+    /**
+     * @brief Format an address as "label+0xoff"
+     * @param address Virtual address
+     * @return Symbolic description, or the hex address if no label matches
+     */
+    [[nodiscard]] std::string describe(uint64_t address) const;
+
+    /**
+     * @brief Check whether an address lies in an executable segment
+     * @param address Virtual address
+     * @return true if the address is code
+     */
+    [[nodiscard]] bool is_code(uint64_t address) const noexcept;
+
+    /**
+     * @brief Translate a virtual address into a file offset
+     * @param address Virtual address
+     * @return File offset, or std::nullopt if not file-backed
+     */
+    [[nodiscard]] std::optional<uint64_t> file_offset(uint64_t address) const noexcept;
+
+    /**
+     * @brief Lowest executable address, used as the base for compact edge keys
+     * @return Code base address
+     */
+    [[nodiscard]] uint64_t code_base() const noexcept { return code_base_; }
+
+private:
+    std::string bytes_;
+    uint64_t entry_{0};
+    uint64_t code_base_{0};
+    std::vector<Segment> segments_;
+    std::vector<ElfSymbol> symbols_;
+
+    void parse();
+};
+
+/**
+ * @class CoverageMap
+ * @brief Edge coverage of one or more executions
+ *
+ * An edge is a pair of consecutively executed instruction addresses,
+ * stored relative to ElfImage::code_base() and packed into one 64-bit key.
+ * Hit counts are kept so that loop iteration changes are visible.
+ */
+class CoverageMap {
+public:
+    using Edge = std::pair<uint64_t, uint32_t>; ///< Packed edge key and hit count
+
+    CoverageMap() = default;
+
+    /**
+     * @brief Build a map from raw edge counts
+     * @param edges Edge keys (see key()) with hit counts, in any order
+     * @return Map with edges sorted and duplicate keys summed
+     */
+    [[nodiscard]] static CoverageMap from_edges(std::vector<Edge> edges);
+
+    /**
+     * @brief Merge another map into this one
+     * @param other Map to merge
+     * @return Number of edges that were not present before
+     */
+    size_t merge(const CoverageMap& other);
+
+    /**
+     * @brief Count edges of another map that are not in this one
+     * @param other Map to compare
+     * @return Number of new edges
+     */
+    [[nodiscard]] size_t count_new(const CoverageMap& other) const;
+
+    /**
+     * @brief Get the edges sorted by key
+     * @return Edge keys with hit counts
+     */
+    [[nodiscard]] const std::vector<Edge>& edges() const noexcept { return edges_; }
+
+    /**
+     * @brief Get the number of distinct edges
+     * @return Edge count
+     */
+    [[nodiscard]] size_t size() const noexcept { return edges_.size(); }
+
+    /**
+     * @brief Check if nothing was recorded
+     * @return true if empty
+     */
+    [[nodiscard]] bool empty() const noexcept { return edges_.empty(); }
+
+    /**
+     * @brief Get the distinct executed instruction offsets
+     * @return Sorted instruction offsets relative to the code base
+     */
+    [[nodiscard]] std::vector<uint32_t> instructions() const;
+
+    /**
+     * @brief Get the labels whose code was executed
+     * @param image Image the coverage was recorded from
+     * @return Sorted, unique label names
+     */
+    [[nodiscard]] std::vector<std::string> labels(const ElfImage& image) const;
+
+    /**
+     * @brief Hash of the covered edge set
+     * @param with_hit_counts Fold bucketed hit counts into the signature
+     * @return Coverage signature
+     */
+    [[nodiscard]] uint64_t signature(bool with_hit_counts = true) const noexcept;
+
+    /**
+     * @brief Map a hit count to its AFL-style class (1, 2, 3, 4-7, 8-15, 16-31, 32-127, 128+)
+     * @param count Raw hit count
+     * @return Bucket number
+     */
+    [[nodiscard]] static constexpr uint32_t hit_bucket(uint32_t count) noexcept {
+        if (count <= 3) return count;
+        if (count <= 7) return 4;
+        if (count <= 15) return 5;
+        if (count <= 31) return 6;
+        if (count <= 127) return 7;
+        return 8;
+    }
+
+    /**
+     * @brief Pack an edge into its key
+     * @param from Offset of the previous instruction (UINT32_MAX for process entry)
+     * @param to Offset of the current instruction
+     * @return Packed key
+     */
+    [[nodiscard]] static constexpr uint64_t key(uint32_t from, uint32_t to) noexcept {
+        return (static_cast<uint64_t>(from) << 32) | to;
+    }
+
+private:
+    std::vector<Edge> edges_;
+};
+
+/**
+ * @struct TracedExecution
+ * @brief Execution result together with the coverage it produced
+ */
+struct TracedExecution {
+    ExecutionResult result;      ///< Exit status and captured output
+    CoverageMap coverage;        ///< Covered edges
+    int signal{0};               ///< Terminating signal, 0 if the program exited
+    uint64_t fault_address{0};   ///< Instruction address where the signal was raised
+    uint64_t instructions{0};    ///< Number of executed instructions
+
+    /**
+     * @brief Check whether the program was killed by a signal
+     * @return true on crash
+     */
+    [[nodiscard]] bool crashed() const noexcept { return signal != 0; }
+};
+
+/**
+ * @class CoverageTracer
+ * @brief Runs a program under ptrace single-stepping and records edge coverage
+ *
+ * Intended for small static executables such as the ones in test_programs/.
+ * Output is captured through memfd files rather than pipes, so a traced
+ * child can never block on a full pipe while it is stopped. Run observers
+ * are notified as for AsmTestRunner::run_test, except that each stream's
+ * output arrives as one chunk once the child has exited.
+ */
+class CoverageTracer {
+public:
+    /**
+     * @brief Create a tracer for the runner's executable
+     * @param runner Runner providing the executable path and configuration
+     * @throws std::runtime_error if the executable cannot be parsed
+     */
+    explicit CoverageTracer(const AsmTestRunner& runner);
+
+    /**
+     * @brief Create a tracer reusing an already parsed executable
+     * @param runner Runner providing the executable path and configuration
+     * @param image Parsed runner.executable_path()
+     */
+    CoverageTracer(const AsmTestRunner& runner, std::shared_ptr<const ElfImage> image);
+
+    /**
+     * @brief Execute one input and record its coverage
+     * @param input Test input
+     * @return Result and coverage
+     * @throws std::runtime_error if the process cannot be started
+     */
+    [[nodiscard]] TracedExecution run(const TestInput& input) const;
+
+    /**
+     * @brief Get the parsed executable
+     * @return ELF image
+     */
+    [[nodiscard]] const ElfImage& image() const noexcept { return *image_; }
+
+    /**
+     * @brief Get the runner the tracer was created for
+     * @return Runner reference
+     */
+    [[nodiscard]] const AsmTestRunner& runner() const noexcept { return runner_; }
+
+    /**
+     * @brief Limit the number of traced instructions per run (0 = unlimited)
+     * @param limit Instruction limit; exceeding it is reported as a timeout
+     */
+    void set_instruction_limit(uint64_t limit) noexcept { instruction_limit_ = limit; }
+
+    /**
+     * @brief Stretch the runner's timeout for traced runs
+     *
+     * Single-stepping runs orders of magnitude slower than native
+     * execution, so an input that finishes in time natively may time out
+     * when traced.
+     * The deadline is enforced by a watchdog that kills the tracee, even
+     * if it is blocked in a syscall.
+     *
+     * @param scale Factor applied to TestConfig::timeout (at least 1)
+     */
+    void set_timeout_scale(uint32_t scale) noexcept { timeout_scale_ = std::max<uint32_t>(scale, 1); }
+
+private:
+    const AsmTestRunner& runner_;
+    std::shared_ptr<const ElfImage> image_;
+    uint64_t instruction_limit_{0};
+    uint32_t timeout_scale_{1};
+};
+
+} // namespace x86_asm_test
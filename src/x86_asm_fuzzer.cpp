@@ -0,0 +1,370 @@
+/**
+ * @file x86_asm_fuzzer.cpp
+ * @brief Implementation of the coverage-guided fuzzer
+ */
+
+#include "x86_asm_fuzzer.h"
+#include "x86_asm_hash.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <cstdlib>
+#include <format>
+#include <limits>
+
+namespace x86_asm_test {
+
+namespace {
+
+/// Boundary values that commonly break integer parsing and arithmetic
+constexpr std::array<std::string_view, 21> kInterestingNumbers{
+    "0", "1", "-1", "2", "10", "127", "128", "-128", "255", "256",
+    "32767", "-32768", "65535", "2147483647", "-2147483648", "4294967295",
+    "9223372036854775807", "-9223372036854775808", "18446744073709551615",
+    "-0", ""
+};
+
+constexpr std::array<unsigned char, 10> kInterestingBytes{
+    0x00, 0x01, 0x7f, 0x80, 0xff, '\n', ' ', '-', '0', '9'
+};
+
+} // namespace
+
+std::string FuzzFinding::to_test_case(std::string_view fixture, std::string_view test_name) const {
+    std::string what = kind == FindingKind::Crash
+        ? std::format("crash with signal {} ({})", signal, strsignal(signal))
+        : instruction_limit != 0 ? std::format("over {} instructions", instruction_limit) : std::string("timeout");
+    if (!location.empty()) {
+        what += std::format(" at {}", location);
+    }
+
+    if (instruction_limit != 0) {
+        return std::format(
+            "// Found by AsmFuzzer: {}\n"
+            "TEST_F({}, {}) {{\n"
+            "    auto input = {};\n"
+            "    \n"
+            "    // Runs past the instruction budget; natively it may still finish in time\n"
+            "    x86_asm_test::CoverageTracer tracer(*get_runner());\n"
+            "    tracer.set_instruction_limit({});\n"
+            "    auto traced = tracer.run(input);\n"
+            "    EXPECT_FALSE(traced.result.timed_out) << \"Program ran more than {} instructions\";\n"
+            "    EXPECT_FALSE(traced.crashed()) << \"Program was killed by a signal\";\n"
+            "}}\n",
+            what, fixture, test_name, format_make_input(input), instruction_limit, instruction_limit);
+    }
+
+    return std::format(
+        "// Found by AsmFuzzer: {}\n"
+        "TEST_F({}, {}) {{\n"
+        "    auto input = {};\n"
+        "    \n"
+        "    auto result = get_runner()->run_test(input);\n"
+        "    EXPECT_FALSE(result.timed_out) << \"Program hung\";\n"
+        "    EXPECT_LT(result.exit_code, 128) << \"Program was killed by a signal\";\n"
+        "}}\n",
+        what, fixture, test_name, format_make_input(input));
+}
+
+AsmFuzzer::AsmFuzzer(const AsmTestRunner& runner, FuzzerConfig config)
+    : config_{std::move(config)},
+      tracer_{runner},
+      rng_{config_.seed} {
+    tracer_.set_instruction_limit(config_.instruction_limit);
+}
+
+AsmFuzzer& AsmFuzzer::add_seed(TestInput input) {
+    seeds_.push_back(std::move(input));
+    return *this;
+}
+
+std::vector<TestInput> AsmFuzzer::corpus() const {
+    std::vector<TestInput> inputs;
+    inputs.reserve(corpus_.size());
+    for (const auto& entry : corpus_) {
+        inputs.push_back(entry.input);
+    }
+    return inputs;
+}
+
+std::string AsmFuzzer::findings_as_test_cases(std::string_view fixture) const {
+    std::string code;
+    for (size_t i = 0; i < findings_.size(); ++i) {
+        const char* prefix = findings_[i].kind == FindingKind::Timeout ? "FuzzTimeout" : "FuzzCrash";
+        code += findings_[i].to_test_case(fixture, std::format("{}{}", prefix, i + 1));
+        code += '\n';
+    }
+    return code;
+}
+
+bool AsmFuzzer::exhausted() const {
+    if (stats_.executions >= config_.max_executions) return true;
+    if (config_.stop_on_first_finding && !findings_.empty()) return true;
+    return std::chrono::steady_clock::now() - started_ > config_.max_time;
+}
+
+FuzzStats AsmFuzzer::run() {
+    started_ = std::chrono::steady_clock::now();
+
+    if (seeds_.empty() && corpus_.empty()) {
+        seeds_.push_back(make_input());
+    }
+    for (const auto& seed : seeds_) {
+        if (exhausted()) break;
+        execute(seed);
+    }
+    seeds_.clear();
+
+    // Seeds that crashed never enter the corpus; fall back to an empty input
+    if (corpus_.empty() && !exhausted()) {
+        corpus_.push_back({make_input(), 0, 0, 0, 0});
+    }
+
+    while (!exhausted()) {
+        // New entries appended during the round are picked up in the same pass
+        for (size_t i = 0; i < corpus_.size() && !exhausted(); ++i) {
+            size_t rounds = energy(corpus_[i]);
+            ++corpus_[i].times_fuzzed;
+
+            for (size_t r = 0; r < rounds && !exhausted(); ++r) {
+                execute(mutate(corpus_[i].input));
+            }
+        }
+    }
+
+    stats_.corpus_size = corpus_.size();
+    stats_.edges_covered = coverage_.size();
+    stats_.findings = findings_.size();
+    stats_.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - started_
+    );
+    return stats_;
+}
+
+void AsmFuzzer::execute(const TestInput& input) {
+    auto traced = tracer_.run(input);
+    ++stats_.executions;
+    total_instructions_ += traced.instructions;
+
+    uint64_t signature = traced.coverage.signature();
+    ++path_hits_[signature];
+
+    if (traced.crashed() || traced.result.timed_out) {
+        FindingKind kind = traced.crashed() ? FindingKind::Crash : FindingKind::Timeout;
+
+        // Crashes are unique per faulting instruction, hangs per set of labels reached
+        uint64_t key = detail::hash_combine(static_cast<uint64_t>(kind), static_cast<uint64_t>(traced.signal));
+        if (kind == FindingKind::Crash) {
+            key = detail::hash_combine(key, traced.fault_address);
+        } else {
+            for (const auto& label : traced.coverage.labels(tracer_.image())) {
+                key = detail::hash_combine(key, detail::hash_bytes(label));
+            }
+        }
+
+        if (std::ranges::find(finding_keys_, key) == finding_keys_.end()) {
+            finding_keys_.push_back(key);
+            findings_.push_back({
+                kind,
+                input,
+                traced.result,
+                traced.signal,
+                kind == FindingKind::Crash ? tracer_.image().describe(traced.fault_address) : std::string{},
+                kind == FindingKind::Timeout && config_.instruction_limit != 0 &&
+                        traced.instructions > config_.instruction_limit
+                    ? config_.instruction_limit : 0
+            });
+        }
+        coverage_.merge(traced.coverage);
+        return;
+    }
+
+    if (coverage_.merge(traced.coverage) > 0) {
+        corpus_.push_back({input, signature, traced.instructions, traced.coverage.size(), 0});
+    }
+}
+
+size_t AsmFuzzer::energy(const CorpusEntry& entry) {
+    constexpr double base_energy = 16.0;
+    constexpr size_t max_energy = 256;
+
+    double factor = 1.0;
+
+    // Prefer entries that are cheap to execute
+    if (stats_.executions > 0 && entry.instructions > 0) {
+        double average = static_cast<double>(total_instructions_) / static_cast<double>(stats_.executions);
+        double ratio = static_cast<double>(entry.instructions) / std::max(average, 1.0);
+        if (ratio < 0.5) factor *= 2.0;
+        else if (ratio > 2.0) factor *= 0.5;
+    }
+
+    // Exponential schedule: grow with each visit, shrink for heavily exercised paths
+    factor *= static_cast<double>(1U << std::min<size_t>(entry.times_fuzzed, 5));
+    auto hits = path_hits_.find(entry.signature);
+    if (hits != path_hits_.end() && hits->second > 1) {
+        factor /= static_cast<double>(hits->second);
+    }
+
+    return std::clamp<size_t>(static_cast<size_t>(base_energy * factor), 1, max_energy);
+}
+
+size_t AsmFuzzer::random_below(size_t bound) {
+    return bound == 0 ? 0 : static_cast<size_t>(rng_() % bound);
+}
+
+void AsmFuzzer::mutate_bytes(std::string& data, size_t max_size) {
+    if (data.empty()) {
+        data.push_back(static_cast<char>(random_below(256)));
+        return;
+    }
+
+    size_t pos = random_below(data.size());
+    switch (random_below(8)) {
+        case 0:  // Bit flip
+            data[pos] = static_cast<char>(data[pos] ^ (1 << random_below(8)));
+            break;
+        case 1:  // Random byte
+            data[pos] = static_cast<char>(random_below(256));
+            break;
+        case 2:  // Interesting byte
+            data[pos] = static_cast<char>(kInterestingBytes[random_below(kInterestingBytes.size())]);
+            break;
+        case 3:  // Insert random bytes
+            data.insert(pos, 1 + random_below(4), static_cast<char>(random_below(256)));
+            break;
+        case 4:  // Delete a range
+            data.erase(pos, 1 + random_below(std::min<size_t>(data.size() - pos, 16)));
+            break;
+        case 5: {  // Duplicate a range
+            size_t length = 1 + random_below(std::min<size_t>(data.size() - pos, 32));
+            data.insert(random_below(data.size() + 1), data.substr(pos, length));
+            break;
+        }
+        case 6:  // Small arithmetic
+            data[pos] = static_cast<char>(data[pos] + static_cast<int>(random_below(17)) - 8);
+            break;
+        default: {  // Dictionary token, or an interesting number as text
+            std::string_view token = config_.dictionary.empty()
+                ? kInterestingNumbers[random_below(kInterestingNumbers.size())]
+                : std::string_view{config_.dictionary[random_below(config_.dictionary.size())]};
+            if (random_below(2) == 0) {
+                data.insert(pos, token);
+            } else {
+                data.replace(pos, std::min(token.size(), data.size() - pos), token);
+            }
+            break;
+        }
+    }
+
+    if (data.size() > max_size) {
+        data.resize(max_size);
+    }
+}
+
+TestInput AsmFuzzer::mutate(const TestInput& input) {
+    std::vector<std::string> args(input.args().begin(), input.args().end());
+    std::optional<std::string> stdin_data;
+    if (input.stdin_data()) {
+        stdin_data.emplace(*input.stdin_data());
+    }
+
+    auto interesting = [this]() {
+        return std::string{kInterestingNumbers[random_below(kInterestingNumbers.size())]};
+    };
+
+    size_t stacked = size_t{1} << random_below(4);
+    for (size_t round = 0; round < stacked; ++round) {
+        switch (random_below(10)) {
+            case 0:  // Mutate the bytes of one argument
+                if (!args.empty()) {
+                    mutate_bytes(args[random_below(args.size())], config_.max_arg_length);
+                }
+                break;
+            case 1:  // Replace an argument with a boundary value
+                if (!args.empty()) {
+                    args[random_below(args.size())] = interesting();
+                }
+                break;
+            case 2:  // Replace an argument with a dictionary token
+                if (!args.empty()) {
+                    args[random_below(args.size())] = config_.dictionary.empty()
+                        ? interesting()
+                        : config_.dictionary[random_below(config_.dictionary.size())];
+                }
+                break;
+            case 3:  // Insert an argument
+                if (args.size() < config_.max_args) {
+                    std::string arg = args.empty() || random_below(2) == 0
+                        ? interesting()
+                        : args[random_below(args.size())];
+                    args.insert(args.begin() + static_cast<std::ptrdiff_t>(random_below(args.size() + 1)), std::move(arg));
+                }
+                break;
+            case 4:  // Drop an argument
+                if (!args.empty()) {
+                    args.erase(args.begin() + static_cast<std::ptrdiff_t>(random_below(args.size())));
+                }
+                break;
+            case 5:  // Swap two arguments
+                if (args.size() >= 2) {
+                    std::swap(args[random_below(args.size())], args[random_below(args.size())]);
+                }
+                break;
+            case 6:  // Integer arithmetic on a numeric argument
+                if (!args.empty()) {
+                    auto& arg = args[random_below(args.size())];
+                    char* end = nullptr;
+                    long long value = std::strtoll(arg.c_str(), &end, 10);
+                    if (end != arg.c_str()) {
+                        // Out-of-range text saturates to the limits; keep the
+                        // arithmetic defined there by clamping instead of overflowing
+                        constexpr long long lowest = std::numeric_limits<long long>::min();
+                        constexpr long long highest = std::numeric_limits<long long>::max();
+                        long long delta = static_cast<long long>(random_below(35)) - 17;
+                        if (random_below(4) == 0) {
+                            value = value == lowest ? highest : -value;
+                        } else if (delta > 0 && value > highest - delta) {
+                            value = highest;
+                        } else if (delta < 0 && value < lowest - delta) {
+                            value = lowest;
+                        } else {
+                            value += delta;
+                        }
+                        arg = std::to_string(value);
+                    }
+                }
+                break;
+            case 7:
+            case 8: {  // Mutate stdin
+                std::string data = stdin_data.value_or("");
+                mutate_bytes(data, config_.max_stdin_size);
+                stdin_data = std::move(data);
+                break;
+            }
+            default: {  // Splice stdin with another corpus entry
+                if (corpus_.empty()) break;
+                const auto& other = corpus_[random_below(corpus_.size())].input.stdin_data();
+                if (!other.has_value() || other->empty()) break;
+                std::string data = stdin_data.value_or("");
+                size_t cut = random_below(data.size() + 1);
+                data = data.substr(0, cut) + std::string(other->substr(random_below(other->size())));
+                if (data.size() > config_.max_stdin_size) data.resize(config_.max_stdin_size);
+                stdin_data = std::move(data);
+                break;
+            }
+        }
+    }
+
+    // argv strings cannot carry NUL bytes
+    auto mutated = make_input();
+    for (auto& arg : args) {
+        std::erase(arg, '\0');
+        mutated.add_arg(std::move(arg));
+    }
+    if (stdin_data.has_value()) {
+        mutated.set_stdin(std::move(*stdin_data));
+    }
+    return mutated;
+}
+
+} // namespace x86_asm_test
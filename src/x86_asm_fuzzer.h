@@ -0,0 +1,176 @@
+/**
+ * @file x86_asm_fuzzer.h
+ * @brief Coverage-guided fuzzing of assembly programs through argv and stdin
+ */
+
+#pragma once
+
+#include "x86_asm_test.h"
+#include "x86_asm_coverage.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <unordered_map>
+
+namespace x86_asm_test {
+
+/**
+ * @struct FuzzerConfig
+ * @brief Limits and knobs for an AsmFuzzer campaign
+ */
+struct FuzzerConfig {
+    uint64_t seed{0x5eed};                                 ///< PRNG seed, campaigns are reproducible
+    size_t max_executions{10000};                          ///< Stop after this many runs
+    std::chrono::milliseconds max_time{30000};             ///< Stop after this much wall time
+    size_t max_stdin_size{4096};                           ///< Upper bound for mutated stdin
+    size_t max_args{8};                                    ///< Upper bound for the argument count
+    size_t max_arg_length{64};                             ///< Upper bound for a single argument
+    uint64_t instruction_limit{1'000'000};                 ///< Runs exceeding this count as timeouts
+    bool stop_on_first_finding{false};                     ///< Stop as soon as a crash or hang is found
+    std::vector<std::string> dictionary{};                 ///< Tokens spliced into args and stdin
+};
+
+/**
+ * @enum FindingKind
+ * @brief Category of a fuzzing finding
+ */
+enum class FindingKind : uint8_t {
+    Crash,   ///< Program was terminated by a signal
+    Timeout  ///< Program exceeded the time or instruction budget
+};
+
+/**
+ * @struct FuzzFinding
+ * @brief A crashing or hanging input discovered by the fuzzer
+ */
+struct FuzzFinding {
+    FindingKind kind{FindingKind::Crash};  ///< Crash or timeout
+    TestInput input;                       ///< Input that triggers the finding
+    ExecutionResult result;                ///< Result of the triggering run
+    int signal{0};                         ///< Terminating signal for crashes
+    std::string location;                  ///< Faulting instruction as "label+0xoff"
+    uint64_t instruction_limit{0};         ///< Instruction budget a timeout exceeded, 0 for wall-clock timeouts
+
+    /**
+     * @brief Render the finding as a ready-to-paste Google Test case
+     * @param fixture Test fixture name (e.g. "CalculatorAsmTest")
+     * @param test_name Test name
+     * @return C++ source for a TEST_F that fails while the bug is present;
+     *         inputs over the instruction limit are re-run under CoverageTracer
+     *         with that limit, since natively they may finish in time
+     */
+    [[nodiscard]] std::string to_test_case(std::string_view fixture, std::string_view test_name) const;
+};
+
+/**
+ * @struct FuzzStats
+ * @brief Summary of a fuzzing campaign
+ */
+struct FuzzStats {
+    size_t executions{0};                       ///< Total runs
+    size_t corpus_size{0};                      ///< Inputs kept for new coverage
+    size_t edges_covered{0};                    ///< Distinct edges seen
+    size_t findings{0};                         ///< Unique crashes and timeouts
+    std::chrono::milliseconds elapsed{0};       ///< Campaign duration
+};
+
+/**
+ * @class AsmFuzzer
+ * @brief Coverage-guided mutational fuzzer built on AsmTestRunner
+ *
+ * Every candidate is executed under CoverageTracer. Inputs reaching new
+ * edges are kept in the corpus; corpus entries get an energy (number of
+ * mutations per round) that favours fast, rarely exercised paths. Both the
+ * argument vector and stdin are mutated. Crashes and timeouts are
+ * de-duplicated by faulting location.
+ *
+ * @code
+ * AsmFuzzer fuzzer(*get_runner());
+ * fuzzer.add_seed(make_input().add_arg(10).add_arg(5).add_arg("div"));
+ * fuzzer.run();
+ * for (const auto& finding : fuzzer.findings()) {
+ *     std::cout << finding.to_test_case("CalculatorAsmTest", "FuzzCrash");
+ * }
+ * @endcode
+ */
+class AsmFuzzer {
+public:
+    /**
+     * @brief Create a fuzzer for a runner's executable
+     * @param runner Runner under test (must outlive the fuzzer)
+     * @param config Campaign configuration
+     */
+    explicit AsmFuzzer(const AsmTestRunner& runner, FuzzerConfig config = {});
+
+    /**
+     * @brief Add an initial corpus entry
+     * @param input Seed input
+     * @return Reference to this object for chaining
+     */
+    AsmFuzzer& add_seed(TestInput input);
+
+    /**
+     * @brief Run the campaign until a limit from FuzzerConfig is reached
+     * @return Campaign statistics
+     */
+    FuzzStats run();
+
+    /**
+     * @brief Get the unique findings so far
+     * @return Findings in discovery order
+     */
+    [[nodiscard]] const std::vector<FuzzFinding>& findings() const noexcept { return findings_; }
+
+    /**
+     * @brief Get the inputs kept for their coverage
+     * @return Corpus inputs
+     */
+    [[nodiscard]] std::vector<TestInput> corpus() const;
+
+    /**
+     * @brief Get the accumulated coverage of all executions
+     * @return Coverage map
+     */
+    [[nodiscard]] const CoverageMap& coverage() const noexcept { return coverage_; }
+
+    /**
+     * @brief Render all findings as Google Test cases
+     * @param fixture Test fixture name
+     * @return C++ source with one TEST_F per finding
+     */
+    [[nodiscard]] std::string findings_as_test_cases(std::string_view fixture) const;
+
+private:
+    struct CorpusEntry {
+        TestInput input;
+        uint64_t signature{0};
+        uint64_t instructions{0};
+        size_t edges{0};
+        size_t times_fuzzed{0};
+    };
+
+    FuzzerConfig config_;
+    CoverageTracer tracer_;
+    std::mt19937_64 rng_;
+    std::vector<CorpusEntry> corpus_;
+    std::vector<TestInput> seeds_;
+    std::vector<FuzzFinding> findings_;
+    std::vector<uint64_t> finding_keys_;
+    std::chrono::steady_clock::time_point started_;
+    std::unordered_map<uint64_t, uint32_t> path_hits_;
+    CoverageMap coverage_;
+    FuzzStats stats_;
+    uint64_t total_instructions_{0};
+
+    void execute(const TestInput& input);
+    [[nodiscard]] bool exhausted() const;
+    [[nodiscard]] size_t energy(const CorpusEntry& entry);
+    [[nodiscard]] TestInput mutate(const TestInput& input);
+    void mutate_bytes(std::string& data, size_t max_size);
+    [[nodiscard]] size_t random_below(size_t bound);
+};
+
+} // namespace x86_asm_test
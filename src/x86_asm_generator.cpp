@@ -0,0 +1,31 @@
+/**
+ * @file x86_asm_generator.cpp
+ * @brief Failure reporting for generated test suites
+ */
+
+#include "x86_asm_generator.h"
+#include <format>
+
+namespace x86_asm_test::detail {
+
+std::string join_arguments(const TestInput& input) {
+    std::string arguments;
+    for (auto arg : input.args()) {
+        if (!arguments.empty()) arguments += ' ';
+        arguments += arg;
+    }
+    return arguments;
+}
+
+void report_generated_failures(const GeneratorReport& report) {
+    for (const auto& failure : report.failures) {
+        ADD_FAILURE() << std::format("Generated case {} failed\nArguments: {}\n", failure.index, failure.arguments)
+                      << failure.report.render();
+    }
+    if (report.failed > report.failures.size()) {
+        ADD_FAILURE() << std::format("{} more generated cases failed ({} of {} passed)",
+                                     report.failed - report.failures.size(), report.passed, report.run);
+    }
+}
+
+} // namespace x86_asm_test::detail
@@ -0,0 +1,264 @@
+/**
+ * @file x86_asm_generator.h
+ * @brief Lazily generated, sharded test suites
+ */
+
+#pragma once
+
+#include "x86_asm_test.h"
+#include "x86_asm_workers.h"
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <ranges>
+#include <source_location>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace x86_asm_test {
+
+/**
+ * @struct GeneratedCase
+ * @brief An input and its expectation, as produced by a generator
+ */
+struct GeneratedCase {
+    TestInput input;
+    ExpectedOutput expected;
+};
+
+/**
+ * @concept AsmCaseGenerator
+ * @brief Input range whose elements expose .input and .expected
+ *
+ * The range is consumed once and may compute each case on dereference,
+ * e.g. std::views::iota(0, n) | std::views::transform(make_case).
+ */
+template<typename G>
+concept AsmCaseGenerator = std::ranges::input_range<G> &&
+    requires(std::ranges::range_reference_t<G> generated) {
+        { generated.input } -> std::convertible_to<const TestInput&>;
+        { generated.expected } -> std::convertible_to<const ExpectedOutput&>;
+    };
+
+/**
+ * @struct GeneratorOptions
+ * @brief Options for run_generated()
+ */
+struct GeneratorOptions {
+    size_t jobs{std::max(1U, std::thread::hardware_concurrency())};   ///< Cases executed in parallel
+    size_t max_failures{20};                                           ///< Failures kept per shard
+};
+
+/**
+ * @struct GeneratedFailure
+ * @brief A generated case that did not match
+ */
+struct GeneratedFailure {
+    size_t index{0};          ///< Position in the generated sequence
+    std::string arguments;    ///< Space-separated arguments
+    MismatchReport report;    ///< What did not match
+};
+
+/**
+ * @struct GeneratorReport
+ * @brief Outcome of one shard of a generator
+ */
+struct GeneratorReport {
+    size_t run{0};                              ///< Cases executed
+    size_t passed{0};                           ///< Cases that matched
+    size_t failed{0};                           ///< Cases that did not match
+    std::vector<GeneratedFailure> failures;     ///< First failures, up to max_failures
+
+    /**
+     * @brief Check whether every executed case passed
+     * @return true if nothing failed
+     */
+    [[nodiscard]] bool all_passed() const noexcept { return failed == 0; }
+};
+
+namespace detail {
+
+/**
+ * @brief Join the arguments of an input with spaces
+ */
+[[nodiscard]] std::string join_arguments(const TestInput& input);
+
+/**
+ * @brief Report kept failures of a shard as Google Test failures
+ */
+void report_generated_failures(const GeneratorReport& report);
+
+} // namespace detail
+
+/**
+ * @brief Run one shard of a generator through a runner
+ *
+ * Worker threads pull the next case from the generator under a mutex and
+ * copy it into a TestInput and ExpectedOutput they own, so at most one
+ * case per thread exists at a time, and only the max_failures failures
+ * with the lowest indices are kept: memory is O(jobs + max_failures)
+ * however many cases the generator produces. Case i belongs to shard i % shard_count;
+ * cases of other shards are skipped without being copied.
+ *
+ * @param runner Runner for the program under test
+ * @param cases Generator, consumed once
+ * @param options Parallelism and failure limit
+ * @param shard Shard to run
+ * @param shard_count Number of shards the generator is split into
+ * @return Counts and the first failures by index
+ * @throws std::invalid_argument If shard is not below shard_count
+ */
+template<AsmCaseGenerator G>
+[[nodiscard]] GeneratorReport run_generated(const AsmTestRunner& runner, G&& cases,
+                                            const GeneratorOptions& options = {},
+                                            size_t shard = 0, size_t shard_count = 1) {
+    if (shard >= shard_count) {
+        throw std::invalid_argument("run_generated(): shard must be below shard_count");
+    }
+    auto position = std::ranges::begin(cases);
+    auto end = std::ranges::end(cases);
+    size_t next_index = 0;
+    std::mutex generator_mutex;
+
+    std::atomic<size_t> run{0}, passed{0};
+    detail::LowestFailures<GeneratedFailure> failures(options.max_failures);
+
+    auto worker = [&] {
+        TestInput input;
+        ExpectedOutput expected;
+        ExecutionResult result;
+        for (;;) {
+            size_t index;
+            {
+                std::lock_guard lock(generator_mutex);
+                while (position != end && next_index % shard_count != shard) {
+                    ++position;
+                    ++next_index;
+                }
+                if (position == end) return;
+                auto&& generated = *position;
+                input = generated.input;
+                expected = generated.expected;
+                index = next_index++;
+                ++position;
+            }
+
+            runner.run_test(input, result);
+            ++run;
+            if (expected.matches(result)) {
+                ++passed;
+            } else if (failures.wanted(index)) {
+                failures.add({index, detail::join_arguments(input), expected.mismatch_report(result)});
+            }
+        }
+    };
+    detail::run_workers(options.jobs, worker, [&] {
+        std::lock_guard lock(generator_mutex);
+        position = end;
+    });
+
+    GeneratorReport report;
+    report.run = run;
+    report.passed = passed;
+    report.failed = report.run - report.passed;
+    report.failures = failures.take();
+    return report;
+}
+
+/**
+ * @brief Run a generator and report each kept failure as a Google Test failure
+ * @param runner Runner for the program under test
+ * @param cases Generator, consumed once
+ * @param options Parallelism and failure limit
+ * @return Counts and the first failures by index
+ */
+template<AsmCaseGenerator G>
+GeneratorReport assert_generated(const AsmTestRunner& runner, G&& cases, const GeneratorOptions& options = {}) {
+    auto report = run_generated(runner, std::forward<G>(cases), options);
+    detail::report_generated_failures(report);
+    return report;
+}
+
+namespace detail {
+
+/**
+ * @class GeneratorShardTest
+ * @brief Test registered for one shard of a generator
+ */
+template<typename Factory>
+class GeneratorShardTest : public ::testing::Test {
+public:
+    GeneratorShardTest(std::shared_ptr<const AsmTestRunner> runner, std::shared_ptr<const Factory> make_cases,
+                       GeneratorOptions options, size_t shard, size_t shard_count)
+        : runner_(std::move(runner)), make_cases_(std::move(make_cases)), options_(options),
+          shard_(shard), shard_count_(shard_count) {}
+
+    void TestBody() override {
+        report_generated_failures(run_generated(*runner_, (*make_cases_)(), options_, shard_, shard_count_));
+    }
+
+private:
+    std::shared_ptr<const AsmTestRunner> runner_;
+    std::shared_ptr<const Factory> make_cases_;
+    GeneratorOptions options_;
+    size_t shard_;
+    size_t shard_count_;
+};
+
+} // namespace detail
+
+/**
+ * @brief Register a generator as one Google Test test per shard
+ *
+ * Unlike INSTANTIATE_TEST_SUITE_P, no parameter is materialised at
+ * registration: each shard test calls make_cases() when it runs and
+ * streams its share of the cases through run_generated(). Call after
+ * ::testing::InitGoogleTest() and before RUN_ALL_TESTS().
+ *
+ * @code
+ * register_generated_tests("CalculatorSweep", "add", runner, [] {
+ *     return std::views::iota(0, 2001 * 2001) | std::views::transform([](int k) {
+ *         int a = k / 2001 - 1000, b = k % 2001 - 1000;
+ *         return GeneratedCase{make_input().add_arg(a).add_arg(b).add_arg("add"),
+ *                              expect_success().stdout_equals(std::format("{}\n", a + b))};
+ *     });
+ * }, 16);
+ * @endcode
+ *
+ * @param suite Test suite name
+ * @param name Test name prefix; shards are named "<name>/<shard>"
+ * @param runner Runner for the program under test
+ * @param make_cases Callable returning a fresh AsmCaseGenerator
+ * @param shard_count Number of shard tests
+ * @param options Parallelism within each shard and failure limit
+ * @param location Reported as the tests' source location
+ * @return Number of registered tests
+ */
+template<typename Factory>
+    requires AsmCaseGenerator<std::invoke_result_t<const Factory&>>
+size_t register_generated_tests(const std::string& suite, const std::string& name,
+                                std::shared_ptr<const AsmTestRunner> runner, Factory make_cases,
+                                size_t shard_count = 1, GeneratorOptions options = {},
+                                std::source_location location = std::source_location::current()) {
+    auto factory = std::make_shared<const Factory>(std::move(make_cases));
+    shard_count = std::max<size_t>(shard_count, 1);
+    for (size_t shard = 0; shard < shard_count; ++shard) {
+        ::testing::RegisterTest(
+            suite.c_str(), (name + "/" + std::to_string(shard)).c_str(), nullptr, nullptr,
+            location.file_name(), static_cast<int>(location.line()),
+            [=]() -> ::testing::Test* {
+                return new detail::GeneratorShardTest<Factory>(runner, factory, options, shard, shard_count);
+            }
+        );
+    }
+    return shard_count;
+}
+
+} // namespace x86_asm_test
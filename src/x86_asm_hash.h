@@ -0,0 +1,53 @@
+/**
+ * @file x86_asm_hash.h
+ * @brief Small non-cryptographic hashing helpers shared by the framework
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace x86_asm_test::detail {
+
+/**
+ * @brief Finalisation mixer (splitmix64) used to spread hash bits
+ * @param value Value to mix
+ * @return Mixed value
+ */
+[[nodiscard]] constexpr uint64_t mix64(uint64_t value) noexcept {
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ULL;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebULL;
+    value ^= value >> 31;
+    return value;
+}
+
+/**
+ * @brief Hash a byte sequence (FNV-1a with a splitmix64 finaliser)
+ * @param bytes Bytes to hash
+ * @param seed Starting state, allows chaining several fields
+ * @return 64-bit hash
+ */
+[[nodiscard]] constexpr uint64_t hash_bytes(std::string_view bytes,
+                                            uint64_t seed = 0xcbf29ce484222325ULL) noexcept {
+    uint64_t hash = seed;
+    for (char c : bytes) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3ULL;
+    }
+    return mix64(hash ^ bytes.size());
+}
+
+/**
+ * @brief Combine a value into a running hash
+ * @param seed Running hash
+ * @param value Value to fold in
+ * @return Updated hash
+ */
+[[nodiscard]] constexpr uint64_t hash_combine(uint64_t seed, uint64_t value) noexcept {
+    return mix64(seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)));
+}
+
+} // namespace x86_asm_test::detail
@@ -0,0 +1,347 @@
+/**
+ * @file x86_asm_histogram.cpp
+ * @brief Implementation of the harness histograms
+ */
+
+#include "x86_asm_histogram.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+
+namespace x86_asm_test {
+
+size_t Histogram::bucket_index(uint64_t value) noexcept {
+    if (value < sub_bucket_count) {
+        return static_cast<size_t>(value);
+    }
+    // value >> shift keeps the top sub_bucket_bits + 1 bits: 64 + mantissa
+    unsigned shift = static_cast<unsigned>(std::bit_width(value)) - sub_bucket_bits - 1;
+    return (shift + 1) * sub_bucket_count + static_cast<size_t>(value >> shift) - sub_bucket_count;
+}
+
+uint64_t Histogram::bucket_lower(size_t index) noexcept {
+    if (index < sub_bucket_count) {
+        return index;
+    }
+    unsigned shift = static_cast<unsigned>(index / sub_bucket_count) - 1;
+    return (sub_bucket_count + index % sub_bucket_count) << shift;
+}
+
+uint64_t Histogram::bucket_upper(size_t index) noexcept {
+    return index + 1 < bucket_count ? bucket_lower(index + 1) - 1 : UINT64_MAX;
+}
+
+void Histogram::record(uint64_t value, uint64_t count) noexcept {
+    if (count == 0) return;
+    counts_[bucket_index(value)] += count;
+    count_ += count;
+    sum_ += value * count;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+}
+
+void Histogram::merge(const Histogram& other) noexcept {
+    for (size_t i = 0; i < bucket_count; ++i) {
+        counts_[i] += other.counts_[i];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+}
+
+Histogram Histogram::from_buckets(std::span<const uint64_t> counts, uint64_t sum, uint64_t min, uint64_t max) {
+    Histogram histogram;
+    for (size_t i = 0; i < bucket_count && i < counts.size(); ++i) {
+        histogram.counts_[i] = counts[i];
+        histogram.count_ += counts[i];
+    }
+    if (histogram.count_ > 0) {
+        histogram.sum_ = sum;
+        histogram.min_ = min;
+        histogram.max_ = std::max(min, max);
+    }
+    return histogram;
+}
+
+double Histogram::mean() const noexcept {
+    return count_ ? static_cast<double>(sum_) / static_cast<double>(count_) : 0.0;
+}
+
+uint64_t Histogram::percentile(double percentile) const noexcept {
+    if (count_ == 0) return 0;
+    auto target = static_cast<uint64_t>(std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 * static_cast<double>(count_)));
+    target = std::max<uint64_t>(target, 1);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < bucket_count; ++i) {
+        seen += counts_[i];
+        if (seen >= target) {
+            return std::clamp(bucket_upper(i), min_, max_);
+        }
+    }
+    return max_;
+}
+
+namespace {
+
+/**
+ * @brief Add to a counter only the calling thread writes (no locked instruction)
+ */
+void bump(std::atomic<uint64_t>& counter, uint64_t amount) noexcept {
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Fills the histograms from run notifications
+ */
+class HistogramObserver : public RunObserver {
+public:
+    explicit HistogramObserver(HarnessHistograms& histograms) : histograms_(histograms) {}
+
+    void on_exec(const RunInfo& run, Clock::time_point at, pid_t) noexcept override {
+        histograms_.record(HarnessMetric::SpawnLatency, nanoseconds(at - run.spawned));
+    }
+
+    void on_output(const RunInfo& run, Clock::time_point at, OutputStream, std::string_view) noexcept override {
+        if (run.output_bytes == 0) {
+            histograms_.record(HarnessMetric::FirstByte, nanoseconds(at - run.executed));
+        }
+    }
+
+    void on_run(const RunInfo& run, Clock::time_point at, const ExecutionResult& result) noexcept override {
+        histograms_.record(HarnessMetric::RunTime, nanoseconds(at - run.queued));
+        // Runs answered without a process report the size of their result
+        bool executed = run.executed != Clock::time_point{};
+        histograms_.record(HarnessMetric::OutputBytes,
+                           executed ? run.output_bytes : result.stdout_output.size() + result.stderr_output.size());
+    }
+
+private:
+    static uint64_t nanoseconds(Clock::duration elapsed) noexcept {
+        return static_cast<uint64_t>(std::max<int64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), 0));
+    }
+
+    HarnessHistograms& histograms_;
+};
+
+std::string format_value(HarnessMetric metric, uint64_t value) {
+    if (metric == HarnessMetric::OutputBytes) {
+        return std::format("{} B", value);
+    }
+    if (value < 10'000) return std::format("{} ns", value);
+    if (value < 10'000'000) return std::format("{:.1f} us", static_cast<double>(value) / 1e3);
+    return std::format("{:.1f} ms", static_cast<double>(value) / 1e6);
+}
+
+constexpr std::array<HarnessMetric, HarnessHistograms::metric_count> all_metrics{
+    HarnessMetric::SpawnLatency, HarnessMetric::FirstByte, HarnessMetric::RunTime, HarnessMetric::OutputBytes
+};
+
+constexpr std::array<double, 4> reported_percentiles{50.0, 90.0, 99.0, 99.9};
+
+} // namespace
+
+/**
+ * @brief Returns the calling thread's slot to the free list when the thread exits
+ */
+struct HarnessHistograms::SlotLease {
+    Slot* slot{nullptr};
+
+    ~SlotLease() {
+        if (slot) HarnessHistograms::instance().release(slot);
+    }
+};
+
+HarnessHistograms::Slot::Slot() {
+    for (auto& min : mins) {
+        min.store(UINT64_MAX, std::memory_order_relaxed);
+    }
+}
+
+void HarnessHistograms::Slot::clear() noexcept {
+    for (size_t m = 0; m < metric_count; ++m) {
+        for (auto& count : counts[m]) {
+            count.store(0, std::memory_order_relaxed);
+        }
+        sums[m].store(0, std::memory_order_relaxed);
+        mins[m].store(UINT64_MAX, std::memory_order_relaxed);
+        maxes[m].store(0, std::memory_order_relaxed);
+    }
+}
+
+HarnessHistograms& HarnessHistograms::instance() {
+    static HarnessHistograms histograms;
+    return histograms;
+}
+
+void HarnessHistograms::start() {
+    {
+        std::lock_guard lock(slots_mutex_);
+        enabled_.store(true, std::memory_order_relaxed);
+        if (observer_) return;
+        observer_ = std::make_shared<HistogramObserver>(*this);
+    }
+    add_run_observer(observer_);
+}
+
+void HarnessHistograms::stop() {
+    std::shared_ptr<RunObserver> observer;
+    {
+        std::lock_guard lock(slots_mutex_);
+        enabled_.store(false, std::memory_order_relaxed);
+        observer = std::move(observer_);
+    }
+    if (observer) remove_run_observer(observer.get());
+}
+
+HarnessHistograms::Slot& HarnessHistograms::current_slot() {
+    thread_local SlotLease lease;
+    if (!lease.slot) {
+        std::lock_guard lock(slots_mutex_);
+        if (free_slots_.empty()) {
+            slots_.push_back(std::make_unique<Slot>());
+            lease.slot = slots_.back().get();
+            // release() runs in thread exit and must not allocate
+            free_slots_.reserve(slots_.size());
+        } else {
+            lease.slot = free_slots_.back();
+            free_slots_.pop_back();
+        }
+    }
+    return *lease.slot;
+}
+
+void HarnessHistograms::release(Slot* slot) noexcept {
+    std::lock_guard lock(slots_mutex_);
+    free_slots_.push_back(slot);
+}
+
+void HarnessHistograms::record(HarnessMetric metric, uint64_t value) noexcept {
+    Slot* slot;
+    try {
+        slot = &current_slot();
+    } catch (...) {
+        // Recording must never fail a test; the value is dropped
+        return;
+    }
+    auto m = static_cast<size_t>(metric);
+    bump(slot->counts[m][Histogram::bucket_index(value)], 1);
+    bump(slot->sums[m], value);
+    if (value < slot->mins[m].load(std::memory_order_relaxed)) {
+        slot->mins[m].store(value, std::memory_order_relaxed);
+    }
+    if (value > slot->maxes[m].load(std::memory_order_relaxed)) {
+        slot->maxes[m].store(value, std::memory_order_relaxed);
+    }
+}
+
+Histogram HarnessHistograms::snapshot(HarnessMetric metric) const {
+    auto m = static_cast<size_t>(metric);
+    std::vector<uint64_t> counts(Histogram::bucket_count, 0);
+    uint64_t sum = 0, min = UINT64_MAX, max = 0;
+    std::lock_guard lock(slots_mutex_);
+    for (const auto& slot : slots_) {
+        for (size_t i = 0; i < Histogram::bucket_count; ++i) {
+            counts[i] += slot->counts[m][i].load(std::memory_order_relaxed);
+        }
+        sum += slot->sums[m].load(std::memory_order_relaxed);
+        min = std::min(min, slot->mins[m].load(std::memory_order_relaxed));
+        max = std::max(max, slot->maxes[m].load(std::memory_order_relaxed));
+    }
+    return Histogram::from_buckets(counts, sum, min, max);
+}
+
+void HarnessHistograms::reset() noexcept {
+    std::lock_guard lock(slots_mutex_);
+    for (auto& slot : slots_) {
+        slot->clear();
+    }
+}
+
+std::string_view HarnessHistograms::metric_name(HarnessMetric metric) noexcept {
+    switch (metric) {
+        case HarnessMetric::SpawnLatency: return "spawn_latency_ns";
+        case HarnessMetric::FirstByte: return "first_byte_ns";
+        case HarnessMetric::RunTime: return "run_time_ns";
+        case HarnessMetric::OutputBytes: return "output_bytes";
+    }
+    return "unknown";
+}
+
+std::string HarnessHistograms::summary() const {
+    std::string text = std::format("{:<18}{:>10}{:>12}{:>12}{:>12}{:>12}{:>12}\n",
+                                   "metric", "count", "p50", "p90", "p99", "p99.9", "max");
+    for (auto metric : all_metrics) {
+        auto histogram = snapshot(metric);
+        text += std::format("{:<18}{:>10}", metric_name(metric), histogram.count());
+        for (double percentile : reported_percentiles) {
+            text += std::format("{:>12}", format_value(metric, histogram.percentile(percentile)));
+        }
+        text += std::format("{:>12}\n", format_value(metric, histogram.max()));
+    }
+    return text;
+}
+
+std::string HarnessHistograms::to_json() const {
+    std::string json = "{";
+    bool first_metric = true;
+    for (auto metric : all_metrics) {
+        auto histogram = snapshot(metric);
+        json += std::format("{}\n  \"{}\": {{\"count\":{},\"min\":{},\"mean\":{:.1f},\"max\":{}",
+                            first_metric ? "" : ",", metric_name(metric), histogram.count(),
+                            histogram.min(), histogram.mean(), histogram.max());
+        first_metric = false;
+        for (double percentile : reported_percentiles) {
+            json += std::format(",\"p{}\":{}", percentile, histogram.percentile(percentile));
+        }
+        json += ",\"buckets\":[";
+        auto buckets = histogram.buckets();
+        bool first_bucket = true;
+        for (size_t i = 0; i < buckets.size(); ++i) {
+            if (buckets[i] == 0) continue;
+            json += std::format("{}[{},{},{}]", first_bucket ? "" : ",",
+                                Histogram::bucket_lower(i), Histogram::bucket_upper(i), buckets[i]);
+            first_bucket = false;
+        }
+        json += "]}";
+    }
+    json += "\n}\n";
+    return json;
+}
+
+void HarnessHistograms::write(const std::filesystem::path& path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << to_json();
+    if (!file) {
+        throw std::runtime_error(std::format("Cannot write histograms {}", path.string()));
+    }
+}
+
+HistogramReporter::HistogramReporter(std::filesystem::path path) : path_(std::move(path)) {}
+
+void HistogramReporter::OnTestProgramEnd(const ::testing::UnitTest&) {
+    auto& histograms = HarnessHistograms::instance();
+    histograms.stop();
+    std::printf("\nHarness histograms:\n%s", histograms.summary().c_str());
+    std::fflush(stdout);
+    if (!path_.empty()) {
+        try {
+            histograms.write(path_);
+        } catch (const std::exception& e) {
+            // The test results stand; only the histogram file is lost
+            std::fprintf(stderr, "%s\n", e.what());
+        }
+    }
+}
+
+void enable_harness_histograms(const std::filesystem::path& path) {
+    HarnessHistograms::instance().start();
+    ::testing::UnitTest::GetInstance()->listeners().Append(new HistogramReporter(path));
+}
+
+} // namespace x86_asm_test
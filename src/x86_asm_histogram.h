@@ -0,0 +1,286 @@
+/**
+ * @file x86_asm_histogram.h
+ * @brief Log-linear latency histograms of the harness itself
+ */
+
+#pragma once
+
+#include "x86_asm_test.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace x86_asm_test {
+
+/**
+ * @class Histogram
+ * @brief HdrHistogram-style histogram of unsigned 64-bit values
+ *
+ * Values below 64 get a bucket each. Above that, every power of two is
+ * split into 64 buckets, so a reported percentile is within 1/64 (about
+ * 1.6%) of the recorded value over the whole 64-bit range.
+ */
+class Histogram {
+public:
+    static constexpr unsigned sub_bucket_bits = 6;
+    static constexpr size_t sub_bucket_count = size_t{1} << sub_bucket_bits;
+    static constexpr size_t bucket_count = (64 - sub_bucket_bits + 1) * sub_bucket_count;
+
+    /**
+     * @brief Get the bucket a value falls into
+     * @param value Value to record
+     * @return Bucket index below bucket_count
+     */
+    [[nodiscard]] static size_t bucket_index(uint64_t value) noexcept;
+
+    /**
+     * @brief Get the smallest value of a bucket
+     * @param index Bucket index
+     * @return Lower bound (inclusive)
+     */
+    [[nodiscard]] static uint64_t bucket_lower(size_t index) noexcept;
+
+    /**
+     * @brief Get the largest value of a bucket
+     * @param index Bucket index
+     * @return Upper bound (inclusive)
+     */
+    [[nodiscard]] static uint64_t bucket_upper(size_t index) noexcept;
+
+    Histogram() : counts_(bucket_count, 0) {}
+
+    /**
+     * @brief Record a value
+     * @param value Value to record
+     * @param count Number of times it occurred
+     */
+    void record(uint64_t value, uint64_t count = 1) noexcept;
+
+    /**
+     * @brief Add another histogram's values to this one
+     * @param other Histogram to merge
+     */
+    void merge(const Histogram& other) noexcept;
+
+    /**
+     * @brief Build a histogram from bucket counts kept elsewhere
+     * @param counts bucket_count counts
+     * @param sum Sum of the values
+     * @param min Smallest value
+     * @param max Largest value
+     * @return Histogram with these buckets and statistics
+     */
+    [[nodiscard]] static Histogram from_buckets(std::span<const uint64_t> counts, uint64_t sum,
+                                                uint64_t min, uint64_t max);
+
+    /**
+     * @brief Get the number of recorded values
+     * @return Value count
+     */
+    [[nodiscard]] uint64_t count() const noexcept { return count_; }
+
+    /**
+     * @brief Get the smallest recorded value
+     * @return Minimum, 0 if empty
+     */
+    [[nodiscard]] uint64_t min() const noexcept { return count_ ? min_ : 0; }
+
+    /**
+     * @brief Get the largest recorded value
+     * @return Maximum, 0 if empty
+     */
+    [[nodiscard]] uint64_t max() const noexcept { return max_; }
+
+    /**
+     * @brief Get the mean of the recorded values
+     * @return Mean, 0 if empty
+     */
+    [[nodiscard]] double mean() const noexcept;
+
+    /**
+     * @brief Get the value below or at which a percentage of values fall
+     * @param percentile Percentage in [0, 100], e.g. 99.9
+     * @return Upper bound of the bucket reaching the percentile (at most max())
+     */
+    [[nodiscard]] uint64_t percentile(double percentile) const noexcept;
+
+    /**
+     * @brief Get the per-bucket counts
+     * @return bucket_count counts
+     */
+    [[nodiscard]] std::span<const uint64_t> buckets() const noexcept { return counts_; }
+
+private:
+    std::vector<uint64_t> counts_;
+    uint64_t count_{0};
+    uint64_t sum_{0};
+    uint64_t min_{UINT64_MAX};
+    uint64_t max_{0};
+};
+
+/**
+ * @enum HarnessMetric
+ * @brief Quantities HarnessHistograms records for every run
+ */
+enum class HarnessMetric : uint8_t {
+    SpawnLatency,   ///< Nanoseconds from before the pipes until fork() returned
+    FirstByte,      ///< Nanoseconds from fork() to the first stdout or stderr data
+    RunTime,        ///< Nanoseconds from run_test() (or submit()) until the result was ready
+    OutputBytes     ///< Bytes of stdout and stderr produced
+};
+
+/**
+ * @class HarnessHistograms
+ * @brief Process-wide histograms of spawn latency, first byte, run time and output size
+ *
+ * Each thread records into its own slot, which only it writes: recording
+ * is a few uncontended relaxed atomic stores, without locks or
+ * read-modify-write instructions. snapshot() merges the slots of all
+ * threads. A slot is handed to the next new thread when its thread
+ * exits, so short-lived worker threads keep their counts without
+ * growing memory.
+ *
+ * While started, the histograms are filled by a RunObserver; cached
+ * runs and runs answered by an execution hook only count towards
+ * RunTime and OutputBytes.
+ */
+class HarnessHistograms {
+public:
+    static constexpr size_t metric_count = 4;
+
+    /**
+     * @brief Get the histograms
+     * @return Process-wide instance
+     */
+    [[nodiscard]] static HarnessHistograms& instance();
+
+    /**
+     * @brief Start recording runs; earlier values are kept
+     */
+    void start();
+
+    /**
+     * @brief Stop recording runs; recorded values are kept
+     */
+    void stop();
+
+    /**
+     * @brief Check whether runs are being recorded
+     * @return true between start() and stop()
+     */
+    [[nodiscard]] bool enabled() const noexcept { return enabled_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Record a value on the calling thread's slot
+     * @param metric Histogram to record into
+     * @param value Value (nanoseconds or bytes)
+     */
+    void record(HarnessMetric metric, uint64_t value) noexcept;
+
+    /**
+     * @brief Merge all threads' values of a metric
+     * @param metric Histogram to read
+     * @return Merged histogram (min and max are exact)
+     */
+    [[nodiscard]] Histogram snapshot(HarnessMetric metric) const;
+
+    /**
+     * @brief Discard all recorded values
+     *
+     * Values recorded concurrently may or may not survive.
+     */
+    void reset() noexcept;
+
+    /**
+     * @brief Get a metric's name
+     * @param metric Metric
+     * @return e.g. "spawn_latency_ns"
+     */
+    [[nodiscard]] static std::string_view metric_name(HarnessMetric metric) noexcept;
+
+    /**
+     * @brief Render count, p50, p90, p99, p99.9 and max of every metric as a table
+     * @return Human-readable summary
+     */
+    [[nodiscard]] std::string summary() const;
+
+    /**
+     * @brief Render every metric as JSON, including its non-empty buckets
+     *
+     * Buckets are [lower, upper, count] triples, so histograms of several
+     * machines can be merged offline.
+     *
+     * @return JSON document keyed by metric_name()
+     */
+    [[nodiscard]] std::string to_json() const;
+
+    /**
+     * @brief Write to_json() to a file
+     * @param path Output file
+     * @throws std::runtime_error if the file cannot be written
+     */
+    void write(const std::filesystem::path& path) const;
+
+private:
+    struct Slot {
+        std::array<std::array<std::atomic<uint64_t>, Histogram::bucket_count>, metric_count> counts{};
+        std::array<std::atomic<uint64_t>, metric_count> sums{};
+        std::array<std::atomic<uint64_t>, metric_count> mins{};
+        std::array<std::atomic<uint64_t>, metric_count> maxes{};
+
+        Slot();
+        void clear() noexcept;
+    };
+
+    struct SlotLease;
+
+    HarnessHistograms() = default;
+
+    Slot& current_slot();
+    void release(Slot* slot) noexcept;
+
+    std::atomic<bool> enabled_{false};
+    std::shared_ptr<RunObserver> observer_;   ///< Registered between start() and stop()
+    mutable std::mutex slots_mutex_;
+    std::deque<std::unique_ptr<Slot>> slots_;
+    std::vector<Slot*> free_slots_;
+};
+
+/**
+ * @class HistogramReporter
+ * @brief Google Test listener printing HarnessHistograms at the end of the program
+ */
+class HistogramReporter : public ::testing::EmptyTestEventListener {
+public:
+    /**
+     * @brief Create a reporter
+     * @param path JSON file written at the end, or empty to only print the summary
+     */
+    explicit HistogramReporter(std::filesystem::path path = {});
+
+    void OnTestProgramEnd(const ::testing::UnitTest& unit_test) override;
+
+private:
+    std::filesystem::path path_;
+};
+
+/**
+ * @brief Record harness histograms for the whole test program
+ *
+ * Call after ::testing::InitGoogleTest(). Starts HarnessHistograms and
+ * appends a HistogramReporter that prints the summary (and writes path,
+ * if given) when the program ends.
+ *
+ * @param path JSON file, or empty for the printed summary only
+ */
+void enable_harness_histograms(const std::filesystem::path& path = {});
+
+} // namespace x86_asm_test
@@ -0,0 +1,474 @@
+/**
+ * @file x86_asm_impact.cpp
+ * @brief Implementation of coverage-based test impact analysis
+ */
+
+#include "x86_asm_impact.h"
+#include "x86_asm_hash.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <cerrno>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <format>
+
+namespace x86_asm_test {
+
+namespace {
+
+constexpr std::string_view kHeaderLine = "# x86-asm-test impact database v1";
+
+/// Key under which an executable is recorded
+std::string executable_key(const std::filesystem::path& path) {
+    std::error_code ec;
+    auto absolute = std::filesystem::absolute(path, ec);
+    return (ec ? path : absolute).lexically_normal().string();
+}
+
+/// End of the ELF and program headers, which change whenever any segment grows
+uint64_t headers_end(const std::string& bytes) {
+    if (bytes.size() < 0x40) return bytes.size();
+    uint64_t phoff = 0;
+    uint16_t phentsize = 0;
+    uint16_t phnum = 0;
+    std::memcpy(&phoff, bytes.data() + 0x20, sizeof(phoff));
+    std::memcpy(&phentsize, bytes.data() + 0x36, sizeof(phentsize));
+    std::memcpy(&phnum, bytes.data() + 0x38, sizeof(phnum));
+    return std::max<uint64_t>(0x40, phoff + uint64_t{phentsize} * phnum);
+}
+
+/// Where an instruction keeps an address relative to its own end
+struct Relative {
+    size_t offset{0};  ///< Position of the displacement within the instruction
+    size_t size{0};    ///< 0 (none), 1 or 4 bytes
+};
+
+/// Decoded length of one instruction, and its relative branch or RIP-relative operand
+struct Decoded {
+    size_t length{0};
+    Relative relative;
+};
+
+bool has_modrm_0f(uint8_t op) {
+    if (op >= 0x80 && op <= 0x8F) return false;  // jcc rel32
+    if (op >= 0xC8 && op <= 0xCF) return false;  // bswap
+    if (op >= 0x30 && op <= 0x37) return false;  // wrmsr, rdtsc, rdmsr, rdpmc, sysenter, sysexit, getsec
+    switch (op) {
+        case 0x05: case 0x06: case 0x07: case 0x08: case 0x09: case 0x0B:
+        case 0x77: case 0xA0: case 0xA1: case 0xA2: case 0xA8: case 0xA9: case 0xAA:
+            return false;
+        default:
+            return true;
+    }
+}
+
+bool has_imm8_0f(uint8_t op) {
+    return (op >= 0x70 && op <= 0x73) || op == 0x0F || op == 0xA4 || op == 0xAC || op == 0xBA ||
+           op == 0xC2 || op == 0xC4 || op == 0xC5 || op == 0xC6;
+}
+
+/**
+ * Length-decode one x86-64 instruction. Covers the legacy, 0F, 0F38 and 0F3A
+ * maps plus VEX and EVEX; returns std::nullopt for bytes it cannot decode.
+ */
+std::optional<Decoded> decode_instruction(std::string_view code) {
+    auto byte = [&](size_t i) { return static_cast<uint8_t>(code[i]); };
+    size_t p = 0;
+    bool operand_16 = false;
+    bool address_32 = false;
+    bool rex_w = false;
+
+    for (; p < code.size(); ++p) {
+        uint8_t b = byte(p);
+        if (b == 0x66) operand_16 = true;
+        else if (b == 0x67) address_32 = true;
+        else if (b != 0xF0 && b != 0xF2 && b != 0xF3 && b != 0x2E && b != 0x36 &&
+                 b != 0x3E && b != 0x26 && b != 0x64 && b != 0x65) break;
+    }
+    if (p < code.size() && (byte(p) & 0xF0) == 0x40) {
+        rex_w = (byte(p) & 0x08) != 0;
+        ++p;
+    }
+    if (p >= code.size()) return std::nullopt;
+
+    Decoded decoded;
+    bool modrm = false;
+    size_t immediate = 0;
+    int map = 0;  // 0: one byte, 1: 0F, 2: 0F38, 3: 0F3A
+    uint8_t op = byte(p++);
+
+    if (op == 0xC4 || op == 0xC5 || op == 0x62) {
+        size_t payload = op == 0xC5 ? 1 : (op == 0xC4 ? 2 : 3);
+        if (p + payload >= code.size()) return std::nullopt;
+        map = op == 0xC5 ? 1 : (byte(p) & (op == 0xC4 ? 0x1F : 0x07));
+        p += payload;
+        op = byte(p++);
+        modrm = true;
+        immediate = map == 3 || (map == 1 && has_imm8_0f(op)) ? 1 : 0;
+    } else if (op == 0x0F) {
+        if (p >= code.size()) return std::nullopt;
+        op = byte(p++);
+        map = 1;
+        if (op == 0x38 || op == 0x3A) {
+            if (p >= code.size()) return std::nullopt;
+            map = op == 0x38 ? 2 : 3;
+            op = byte(p++);
+            modrm = true;
+            immediate = map == 3 ? 1 : 0;
+        } else if (op >= 0x80 && op <= 0x8F) {
+            decoded.relative = {p, 4};
+            immediate = 4;
+        } else {
+            modrm = has_modrm_0f(op);
+            immediate = has_imm8_0f(op) ? 1 : 0;
+        }
+    } else {
+        size_t z = operand_16 ? 2 : 4;
+        if (op < 0x40 && (op & 0x07) < 4) modrm = true;
+        else if (op < 0x40 && (op & 0x07) == 4) immediate = 1;
+        else if (op < 0x40 && (op & 0x07) == 5) immediate = z;
+        else if ((op >= 0x84 && op <= 0x8F) || op == 0x63 || (op >= 0xD0 && op <= 0xD3) ||
+                 (op >= 0xD8 && op <= 0xDF) || op == 0xFE || op == 0xFF) modrm = true;
+        else if (op >= 0x70 && op <= 0x7F) { decoded.relative = {p, 1}; immediate = 1; }
+        else if (op >= 0xE0 && op <= 0xE3) { decoded.relative = {p, 1}; immediate = 1; }
+        else if (op == 0xEB) { decoded.relative = {p, 1}; immediate = 1; }
+        else if (op == 0xE8 || op == 0xE9) { decoded.relative = {p, 4}; immediate = 4; }
+        else if (op >= 0xB0 && op <= 0xB7) immediate = 1;
+        else if (op >= 0xB8 && op <= 0xBF) immediate = rex_w ? 8 : z;
+        else if (op >= 0xA0 && op <= 0xA3) immediate = address_32 ? 4 : 8;
+        else {
+            switch (op) {
+                case 0x69: case 0xC7: modrm = true; immediate = z; break;
+                case 0x6B: case 0x80: case 0x82: case 0x83: case 0xC0: case 0xC1: case 0xC6:
+                    modrm = true; immediate = 1; break;
+                case 0x81: modrm = true; immediate = z; break;
+                case 0x68: case 0xA9: immediate = z; break;
+                case 0x6A: case 0xA8: case 0xCD: case 0xE4: case 0xE5: case 0xE6: case 0xE7:
+                    immediate = 1; break;
+                case 0xC2: case 0xCA: immediate = 2; break;
+                case 0xC8: immediate = 3; break;
+                case 0xF6: case 0xF7:
+                    modrm = true;
+                    if (p < code.size() && ((byte(p) >> 3) & 0x07) < 2) immediate = op == 0xF6 ? 1 : z;
+                    break;
+                default: break;
+            }
+        }
+    }
+
+    if (modrm) {
+        if (p >= code.size()) return std::nullopt;
+        uint8_t m = byte(p++);
+        uint8_t mod = m >> 6;
+        uint8_t rm = m & 0x07;
+        if (mod != 3 && rm == 4) {
+            if (p >= code.size()) return std::nullopt;
+            uint8_t sib = byte(p++);
+            if (mod == 0 && (sib & 0x07) == 5) p += 4;
+        } else if (mod == 0 && rm == 5) {
+            decoded.relative = {p, 4};
+            p += 4;
+        }
+        if (mod == 1) p += 1;
+        else if (mod == 2) p += 4;
+    }
+    p += immediate;
+    if (p > code.size() || p > 15) return std::nullopt;
+    decoded.length = p;
+    return decoded;
+}
+
+/// Name an address independently of where the linker placed it
+std::string describe_target(const ElfImage& image, uint64_t address) {
+    if (image.symbol_at(address) != nullptr) {
+        return image.describe(address);
+    }
+    // Not in a code label (data, bss): relative to the segment it falls in
+    const ElfImage::Segment* base = nullptr;
+    size_t index = 0;
+    for (size_t i = 0; i < image.segments().size(); ++i) {
+        const auto& segment = image.segments()[i];
+        if (segment.vaddr <= address && (base == nullptr || segment.vaddr > base->vaddr)) {
+            base = &segment;
+            index = i;
+        }
+    }
+    if (base == nullptr) {
+        return std::format("0x{:x}", address);
+    }
+    return std::format("segment{}+0x{:x}", index, address - base->vaddr);
+}
+
+/**
+ * Hash a label's instructions with every relative branch target and
+ * RIP-relative operand replaced by the label (or segment) offset it points
+ * to, so code moving around does not change the hash of unedited labels.
+ */
+uint64_t hash_label(const ElfImage& image, const ElfSymbol& symbol, std::string_view code) {
+    uint64_t hash = detail::hash_bytes({});
+    size_t p = 0;
+    while (p < code.size()) {
+        auto decoded = decode_instruction(code.substr(p));
+        if (!decoded) {
+            // Data or an unknown encoding: the rest of the label as raw bytes
+            return detail::hash_bytes(code.substr(p), hash);
+        }
+        auto instruction = code.substr(p, decoded->length);
+        auto [at, size] = decoded->relative;
+        if (size == 0) {
+            hash = detail::hash_bytes(instruction, hash);
+        } else {
+            int64_t displacement = 0;
+            if (size == 1) {
+                displacement = static_cast<int8_t>(instruction[at]);
+            } else {
+                int32_t value = 0;
+                std::memcpy(&value, instruction.data() + at, sizeof(value));
+                displacement = value;
+            }
+            uint64_t target = symbol.address + p + decoded->length + static_cast<uint64_t>(displacement);
+            hash = detail::hash_bytes(instruction.substr(0, at), hash);
+            hash = detail::hash_bytes(instruction.substr(at + size), hash);
+            hash = detail::hash_bytes(describe_target(image, target), hash);
+        }
+        p += decoded->length;
+    }
+    return hash;
+}
+
+std::vector<std::string_view> split_tabs(std::string_view line) {
+    std::vector<std::string_view> fields;
+    size_t start = 0;
+    for (size_t tab = line.find('\t'); tab != std::string_view::npos; tab = line.find('\t', start)) {
+        fields.push_back(line.substr(start, tab - start));
+        start = tab + 1;
+    }
+    fields.push_back(line.substr(start));
+    return fields;
+}
+
+} // namespace
+
+std::map<std::string, uint64_t> label_hashes(const ElfImage& image) {
+    std::map<std::string, uint64_t> hashes;
+    std::string_view bytes{image.bytes()};
+
+    for (const auto& symbol : image.symbols()) {
+        auto offset = image.file_offset(symbol.address);
+        if (!offset || *offset > bytes.size()) continue;
+        hashes[symbol.name] = hash_label(image, symbol, bytes.substr(*offset, symbol.size));
+    }
+
+    uint64_t data = detail::hash_bytes({});
+    uint64_t skip = headers_end(image.bytes());
+    for (const auto& segment : image.segments()) {
+        if (segment.executable) continue;
+        uint64_t begin = std::max(segment.offset, skip);
+        uint64_t end = std::min<uint64_t>(segment.offset + segment.file_size, bytes.size());
+        if (begin < end) {
+            data = detail::hash_bytes(bytes.substr(begin, end - begin), data);
+        }
+    }
+    hashes[std::string{kDataLabel}] = data;
+    return hashes;
+}
+
+ImpactDatabase ImpactDatabase::load(const std::filesystem::path& path) {
+    ImpactDatabase database;
+    std::ifstream file(path);
+    if (!file) {
+        return database;
+    }
+
+    std::string line;
+    TestImpactRecord* current = nullptr;
+    size_t line_number = 0;
+    while (std::getline(file, line)) {
+        ++line_number;
+        if (line.empty() || line.starts_with('#')) continue;
+
+        auto fields = split_tabs(line);
+        if (fields[0] == "test" && fields.size() == 3) {
+            auto& record = database.tests_[std::string{fields[1]}];
+            record = {};
+            record.passed = fields[2] == "passed";
+            current = &record;
+        } else if (fields[0] == "label" && fields.size() == 4 && current != nullptr) {
+            uint64_t hash = std::stoull(std::string{fields[1]}, nullptr, 16);
+            current->labels[std::string{fields[3]}][std::string{fields[2]}] = hash;
+        } else {
+            throw std::runtime_error(
+                std::format("Malformed impact database {} at line {}", path.string(), line_number)
+            );
+        }
+    }
+    return database;
+}
+
+void ImpactDatabase::save(const std::filesystem::path& path) const {
+    auto temporary = path;
+    temporary += std::format(".tmp{}", getpid());
+    {
+        std::ofstream file(temporary, std::ios::trunc);
+        file << kHeaderLine << '\n';
+        for (const auto& [name, record] : tests_) {
+            file << std::format("test\t{}\t{}\n", name, record.passed ? "passed" : "failed");
+            for (const auto& [executable, labels] : record.labels) {
+                for (const auto& [label, hash] : labels) {
+                    file << std::format("label\t{:016x}\t{}\t{}\n", hash, label, executable);
+                }
+            }
+        }
+        if (!file.flush()) {
+            throw std::runtime_error(std::format("Failed to write impact database {}", temporary.string()));
+        }
+    }
+    std::filesystem::rename(temporary, path);
+}
+
+std::string ImpactAnalysis::gtest_filter() const {
+    if (unaffected.empty()) {
+        return "*";
+    }
+    std::string filter = "-";
+    for (size_t i = 0; i < unaffected.size(); ++i) {
+        if (i > 0) filter += ':';
+        filter += unaffected[i];
+    }
+    return filter;
+}
+
+ImpactAnalysis analyze_impact(const ImpactDatabase& database) {
+    ImpactAnalysis analysis;
+    std::map<std::string, std::optional<std::map<std::string, uint64_t>>> current;
+
+    auto hashes_of = [&](const std::string& executable) -> const std::optional<std::map<std::string, uint64_t>>& {
+        auto [it, inserted] = current.try_emplace(executable);
+        if (inserted) {
+            try {
+                it->second = label_hashes(ElfImage(std::filesystem::path{executable}));
+            } catch (const std::exception&) {
+                it->second = std::nullopt;
+            }
+        }
+        return it->second;
+    };
+
+    std::vector<std::string> changed;
+    for (const auto& [name, record] : database.tests()) {
+        // Runs outside run_test (sessions, pipelines, submit()...) leave no labels
+        bool impacted = !record.passed || record.labels.empty();
+        for (const auto& [executable, labels] : record.labels) {
+            const auto& now = hashes_of(executable);
+            for (const auto& [label, hash] : labels) {
+                bool same = false;
+                if (now) {
+                    auto found = now->find(label);
+                    same = found != now->end() && found->second == hash;
+                }
+                if (!same) {
+                    changed.push_back(std::format("{}:{}", executable, label));
+                    impacted = true;
+                }
+            }
+        }
+        (impacted ? analysis.impacted : analysis.unaffected).push_back(name);
+    }
+
+    std::ranges::sort(changed);
+    auto duplicates = std::ranges::unique(changed);
+    changed.erase(duplicates.begin(), duplicates.end());
+    analysis.changed_labels = std::move(changed);
+    return analysis;
+}
+
+ImpactRecorder::ImpactRecorder(std::filesystem::path database, uint32_t timeout_scale)
+    : database_path_{std::move(database)}, timeout_scale_{timeout_scale} {}
+
+void ImpactRecorder::OnTestProgramStart(const ::testing::UnitTest&) {
+    database_ = ImpactDatabase::load(database_path_);
+    set_execution_hook([this](const AsmTestRunner& runner, const TestInput& input) {
+        return record(runner, input);
+    });
+}
+
+void ImpactRecorder::OnTestStart(const ::testing::TestInfo&) {
+    std::lock_guard lock(mutex_);
+    current_ = {};
+}
+
+void ImpactRecorder::OnTestEnd(const ::testing::TestInfo& test_info) {
+    std::lock_guard lock(mutex_);
+    if (test_info.result()->Skipped()) {
+        current_ = {};
+        return;
+    }
+    current_.passed = !test_info.result()->Failed();
+    database_.set(std::format("{}.{}", test_info.test_suite_name(), test_info.name()), std::move(current_));
+    current_ = {};
+}
+
+void ImpactRecorder::OnTestProgramEnd(const ::testing::UnitTest&) {
+    set_execution_hook({});
+    std::lock_guard lock(mutex_);
+    database_.save(database_path_);
+}
+
+ImpactRecorder::ParsedExecutable ImpactRecorder::parse(const std::filesystem::path& executable) {
+    struct stat info{};
+    if (::stat(executable.c_str(), &info) != 0) {
+        throw std::runtime_error(
+            std::format("Failed to stat {}: {}", executable.string(), std::strerror(errno))
+        );
+    }
+    auto inode = static_cast<uint64_t>(info.st_ino);
+    auto size = static_cast<uint64_t>(info.st_size);
+    auto mtime_ns = static_cast<int64_t>(info.st_mtim.tv_sec) * 1'000'000'000 + info.st_mtim.tv_nsec;
+
+    std::lock_guard lock(parsed_mutex_);
+    auto& known = parsed_[executable.string()];
+    if (known.image && known.inode == inode && known.size == size && known.mtime_ns == mtime_ns) {
+        return known;
+    }
+    auto image = std::make_shared<const ElfImage>(executable);
+    known = {inode, size, mtime_ns, image, std::make_shared<const std::map<std::string, uint64_t>>(label_hashes(*image))};
+    return known;
+}
+
+ExecutionResult ImpactRecorder::record(const AsmTestRunner& runner, const TestInput& input) {
+    // Parsing the ELF and hashing its labels once per build keeps recording runs cheap
+    auto parsed = parse(runner.executable_path());
+    CoverageTracer tracer(runner, parsed.image);
+    tracer.set_timeout_scale(timeout_scale_);
+    auto traced = tracer.run(input);
+    auto executable = executable_key(runner.executable_path());
+
+    auto hash_of = [&](const std::string& label) {
+        auto it = parsed.hashes->find(label);
+        return it == parsed.hashes->end() ? uint64_t{0} : it->second;
+    };
+
+    std::lock_guard lock(mutex_);
+    auto& covered = current_.labels[executable];
+    covered.emplace(kDataLabel, hash_of(std::string{kDataLabel}));
+    for (const auto& label : traced.coverage.labels(tracer.image())) {
+        covered.emplace(label, hash_of(label));
+    }
+    return std::move(traced.result);
+}
+
+ImpactAnalysis enable_impact_analysis(const std::filesystem::path& database, uint32_t timeout_scale) {
+    ImpactAnalysis analysis;
+    if (std::filesystem::exists(database)) {
+        analysis = analyze_impact(ImpactDatabase::load(database));
+        if (GTEST_FLAG_GET(filter) == "*") {
+            GTEST_FLAG_SET(filter, analysis.gtest_filter());
+        }
+    }
+    ::testing::UnitTest::GetInstance()->listeners().Append(new ImpactRecorder(database, timeout_scale));
+    return analysis;
+}
+
+} // namespace x86_asm_test
@@ -0,0 +1,193 @@
+/**
+ * @file x86_asm_impact.h
+ * @brief Coverage-based test impact analysis for assembly programs
+ */
+
+#pragma once
+
+#include "x86_asm_test.h"
+#include "x86_asm_coverage.h"
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace x86_asm_test {
+
+/**
+ * @brief Pseudo-label standing for all non-executable segments (strings, tables)
+ *
+ * Every test that ran an executable depends on it, so editing data re-runs
+ * all of the executable's tests.
+ */
+inline constexpr std::string_view kDataLabel = "<data>";
+
+/**
+ * @brief Hash the contents of every code label of an executable
+ *
+ * A label covers the instructions from its address up to the next label.
+ * Relative branch targets and RIP-relative operands are hashed as the label
+ * (or segment) offset they point to rather than as raw displacements, so
+ * growing one routine leaves the hashes of the code it moves unchanged.
+ * The non-executable segments are hashed together under kDataLabel.
+ *
+ * @param image Parsed executable
+ * @return Label name to content hash
+ */
+[[nodiscard]] std::map<std::string, uint64_t> label_hashes(const ElfImage& image);
+
+/**
+ * @struct TestImpactRecord
+ * @brief What one test exercised during a recorded run
+ */
+struct TestImpactRecord {
+    bool passed{true};                                                   ///< Outcome of the recorded run
+    std::map<std::string, std::map<std::string, uint64_t>> labels;       ///< Executable -> covered label -> hash at record time
+};
+
+/**
+ * @class ImpactDatabase
+ * @brief Per-test coverage stored between runs
+ *
+ * A plain tab-separated text file, one "test" line per test followed by its
+ * "label" lines. Each test keeps the label hashes from the run that
+ * recorded it, so partial (filtered) runs only replace their own tests.
+ */
+class ImpactDatabase {
+public:
+    /**
+     * @brief Load a database, or return an empty one if the file does not exist
+     * @param path Database file
+     * @return Loaded database
+     * @throws std::runtime_error if the file exists but is malformed
+     */
+    [[nodiscard]] static ImpactDatabase load(const std::filesystem::path& path);
+
+    /**
+     * @brief Write the database
+     * @param path Database file (replaced atomically)
+     * @throws std::runtime_error if the file cannot be written
+     */
+    void save(const std::filesystem::path& path) const;
+
+    /**
+     * @brief Get the recorded tests
+     * @return Full test name ("Suite.Test") to record
+     */
+    [[nodiscard]] const std::map<std::string, TestImpactRecord>& tests() const noexcept { return tests_; }
+
+    /**
+     * @brief Add or replace a test record
+     * @param test_name Full test name
+     * @param record Coverage of the test
+     */
+    void set(std::string test_name, TestImpactRecord record) {
+        tests_.insert_or_assign(std::move(test_name), std::move(record));
+    }
+
+private:
+    std::map<std::string, TestImpactRecord> tests_;
+};
+
+/**
+ * @struct ImpactAnalysis
+ * @brief Tests split by whether the current executables affect them
+ */
+struct ImpactAnalysis {
+    std::vector<std::string> impacted;        ///< Recorded tests that must run again
+    std::vector<std::string> unaffected;      ///< Recorded tests whose labels are unchanged
+    std::vector<std::string> changed_labels;  ///< "executable:label" entries that differ
+
+    /**
+     * @brief Build a --gtest_filter value selecting impacted and unrecorded tests
+     *
+     * The filter excludes unaffected tests rather than listing impacted
+     * ones, so tests added since the recording still run.
+     *
+     * @return Filter such as "-Suite.A:Suite.B", or "*" if nothing is unaffected
+     */
+    [[nodiscard]] std::string gtest_filter() const;
+};
+
+/**
+ * @brief Compare a database against the executables currently on disk
+ *
+ * A test is impacted if it failed when recorded, if no label was recorded
+ * for it (its runs did not go through run_test, or it ran nothing), or if
+ * any label it covered was changed or removed, or its executable is gone.
+ *
+ * @param database Recorded coverage
+ * @return Impacted and unaffected tests
+ */
+[[nodiscard]] ImpactAnalysis analyze_impact(const ImpactDatabase& database);
+
+/**
+ * @class ImpactRecorder
+ * @brief Google Test listener recording which labels each test exercises
+ *
+ * While the test program runs, every AsmTestRunner::run_test call is
+ * executed under CoverageTracer (single-stepping, so recording runs are
+ * slower, and the result cache is bypassed). Timeouts are stretched by
+ * timeout_scale so that inputs fast enough natively still finish while
+ * traced. At the end of the program the touched labels of every test that
+ * ran are merged into the database.
+ */
+class ImpactRecorder : public ::testing::EmptyTestEventListener {
+public:
+    /// Default factor applied to TestConfig::timeout while recording
+    static constexpr uint32_t kDefaultTimeoutScale = 20;
+
+    /**
+     * @brief Create a recorder
+     * @param database Database file to update
+     * @param timeout_scale Factor applied to each runner's timeout for traced runs
+     */
+    explicit ImpactRecorder(std::filesystem::path database, uint32_t timeout_scale = kDefaultTimeoutScale);
+
+    void OnTestProgramStart(const ::testing::UnitTest& unit_test) override;
+    void OnTestStart(const ::testing::TestInfo& test_info) override;
+    void OnTestEnd(const ::testing::TestInfo& test_info) override;
+    void OnTestProgramEnd(const ::testing::UnitTest& unit_test) override;
+
+private:
+    /// Executable parsed once per build, identified like ResultCache stamps binaries
+    struct ParsedExecutable {
+        uint64_t inode{0};
+        uint64_t size{0};
+        int64_t mtime_ns{0};
+        std::shared_ptr<const ElfImage> image;
+        std::shared_ptr<const std::map<std::string, uint64_t>> hashes;  ///< Label hashes
+    };
+
+    std::filesystem::path database_path_;
+    uint32_t timeout_scale_;
+    ImpactDatabase database_;
+    std::mutex mutex_;
+    TestImpactRecord current_;
+    std::mutex parsed_mutex_;
+    std::unordered_map<std::string, ParsedExecutable> parsed_;
+
+    ExecutionResult record(const AsmTestRunner& runner, const TestInput& input);
+    ParsedExecutable parse(const std::filesystem::path& executable);
+};
+
+/**
+ * @brief Run only impacted tests and keep the database up to date
+ *
+ * Call after ::testing::InitGoogleTest(). If the database exists and no
+ * --gtest_filter was given, the filter is set from analyze_impact(). An
+ * ImpactRecorder is appended to the listeners.
+ *
+ * @param database Database file
+ * @param timeout_scale Factor applied to each runner's timeout while recording
+ * @return The analysis used for filtering (empty if there was no database)
+ */
+ImpactAnalysis enable_impact_analysis(const std::filesystem::path& database,
+                                      uint32_t timeout_scale = ImpactRecorder::kDefaultTimeoutScale);
+
+} // namespace x86_asm_test
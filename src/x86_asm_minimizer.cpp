@@ -0,0 +1,254 @@
+/**
+ * @file x86_asm_minimizer.cpp
+ * @brief Implementation of the ddmin input minimizer
+ */
+
+#include "x86_asm_minimizer.h"
+#include "x86_asm_workers.h"
+#include "x86_asm_hash.h"
+#include <span>
+#include <stdexcept>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <optional>
+#include <format>
+
+namespace x86_asm_test {
+
+namespace {
+
+struct Candidate {
+    std::vector<std::string> args;
+    std::optional<std::string> stdin_data;
+};
+
+TestInput to_input(const Candidate& candidate) {
+    auto input = make_input();
+    for (const auto& arg : candidate.args) {
+        input.add_arg(arg);
+    }
+    if (candidate.stdin_data.has_value()) {
+        input.set_stdin(*candidate.stdin_data);
+    }
+    return input;
+}
+
+/// Cache key of an input: a hash, so the cache stays small however large stdin is
+uint64_t cache_key(const TestInput& input) {
+    uint64_t key = detail::hash_combine(0, input.size());
+    for (auto arg : input.args()) {
+        key = detail::hash_bytes(arg, key);
+    }
+    key = detail::hash_combine(key, input.stdin_data().has_value());
+    if (input.stdin_data()) {
+        key = detail::hash_bytes(*input.stdin_data(), key);
+    }
+    return key;
+}
+
+/// A ddmin candidate: the units in [begin, end), or all other units if complement is set
+struct Reduction {
+    size_t begin;
+    size_t end;
+    bool complement;
+};
+
+/**
+ * @class Minimizer
+ * @brief Shared state of one minimize() call: cache, counters and thread fan-out
+ */
+class Minimizer {
+public:
+    Minimizer(const AsmTestRunner& runner, const FailurePredicate& still_fails, const MinimizerConfig& config)
+        : runner_{runner}, still_fails_{still_fails}, config_{config} {}
+
+    bool evaluate(const TestInput& input) {
+        auto key = cache_key(input);
+        {
+            std::lock_guard lock(mutex_);
+            if (auto it = cache_.find(key); it != cache_.end()) {
+                ++cache_hits_;
+                return it->second;
+            }
+        }
+        if (executions_.fetch_add(1) >= config_.max_executions) {
+            return false;
+        }
+
+        bool fails = still_fails_(runner_.run_test(input));
+
+        std::lock_guard lock(mutex_);
+        cache_.emplace(key, fails);
+        return fails;
+    }
+
+    /**
+     * @brief Index of the first failing candidate; every lower index is evaluated
+     * @param count Number of candidates
+     * @param candidate Builds the input of candidate i, called on the worker threads
+     */
+    template<typename MakeCandidate>
+    std::optional<size_t> first_failing(size_t count, const MakeCandidate& candidate) {
+        constexpr size_t none = SIZE_MAX;
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> best{none};
+
+        // Each worker holds only the candidate it is running
+        auto worker = [&] {
+            for (size_t i = next++; i < count; i = next++) {
+                if (i > best.load()) continue;  // A lower candidate already failed
+                if (!evaluate(candidate(i))) continue;
+
+                size_t current = best.load();
+                while (i < current && !best.compare_exchange_weak(current, i)) {}
+            }
+        };
+        detail::run_workers(std::min(config_.jobs, count), worker, [&] { next = count; });
+
+        return best.load() == none ? std::nullopt : std::optional<size_t>{best.load()};
+    }
+
+    /**
+     * @brief Classic ddmin over a sequence of units
+     *
+     * Candidates are described by index ranges and only built when a
+     * worker runs them; the accepted reduction is applied in place.
+     *
+     * @param units Units of the failing input (args or stdin bytes)
+     * @param make Builds an input from the kept units, given as a head and a tail span
+     */
+    template<typename Sequence, typename Make>
+    Sequence ddmin(Sequence units, const Make& make) {
+        using Unit = typename Sequence::value_type;
+        if (units.empty() || first_failing(1, [&](size_t) { return make({}, {}); })) {
+            return {};
+        }
+
+        size_t granularity = 2;
+        while (units.size() >= 2) {
+            granularity = std::min(granularity, units.size());
+
+            // Chunk i covers [bound(i), bound(i + 1)); with two chunks the
+            // subsets and complements are the same candidates
+            auto bound = [&](size_t i) { return i * units.size() / granularity; };
+            auto reduction = [&](size_t i) {
+                size_t chunk = i % granularity;
+                return Reduction{bound(chunk), bound(chunk + 1), i >= granularity};
+            };
+            size_t count = granularity > 2 ? 2 * granularity : granularity;
+
+            std::span<const Unit> all(units.data(), units.size());
+            auto hit = first_failing(count, [&](size_t i) {
+                auto kept = reduction(i);
+                return kept.complement ? make(all.first(kept.begin), all.subspan(kept.end))
+                                       : make(all.subspan(kept.begin, kept.end - kept.begin), {});
+            });
+            if (!hit.has_value()) {
+                if (granularity >= units.size()) break;
+                granularity = std::min(units.size(), granularity * 2);
+                continue;
+            }
+
+            auto kept = reduction(*hit);
+            if (kept.complement) {
+                units.erase(units.begin() + kept.begin, units.begin() + kept.end);
+                granularity = std::max<size_t>(granularity - 1, 2);
+            } else {
+                units.erase(units.begin() + kept.end, units.end());
+                units.erase(units.begin(), units.begin() + kept.begin);
+                granularity = 2;
+            }
+        }
+
+        return units;
+    }
+
+    size_t executions() const noexcept { return std::min(executions_.load(), config_.max_executions); }
+    size_t cache_hits() const noexcept { return cache_hits_.load(); }
+
+private:
+    const AsmTestRunner& runner_;
+    const FailurePredicate& still_fails_;
+    const MinimizerConfig& config_;
+    std::mutex mutex_;
+    std::unordered_map<uint64_t, bool> cache_;
+    std::atomic<size_t> executions_{0};
+    std::atomic<size_t> cache_hits_{0};
+};
+
+} // namespace
+
+std::string MinimizeResult::to_test_case(
+    std::string_view fixture,
+    std::string_view test_name,
+    std::string_view expectation
+) const {
+    return std::format(
+        "TEST_F({}, {}) {{\n"
+        "    auto input = {};\n"
+        "    \n"
+        "    auto expected = {};\n"
+        "    \n"
+        "    ASM_ASSERT_OUTPUT(get_runner(), input, expected);\n"
+        "}}\n",
+        fixture, test_name, format_make_input(input), expectation);
+}
+
+FailurePredicate fails_expectation(ExpectedOutput expected) {
+    return [expected = std::move(expected)](const ExecutionResult& result) {
+        return !expected.matches(result);
+    };
+}
+
+MinimizeResult minimize(
+    const AsmTestRunner& runner,
+    const TestInput& input,
+    const FailurePredicate& still_fails,
+    MinimizerConfig config
+) {
+    Minimizer minimizer(runner, still_fails, config);
+
+    Candidate current{std::vector<std::string>(input.args().begin(), input.args().end()), std::nullopt};
+    if (input.stdin_data()) {
+        current.stdin_data.emplace(*input.stdin_data());
+    }
+    if (!minimizer.evaluate(to_input(current))) {
+        throw std::invalid_argument("minimize(): the original input does not fail");
+    }
+
+    if (config.minimize_args) {
+        current.args = minimizer.ddmin(std::move(current.args), [&](std::span<const std::string> head,
+                                                                     std::span<const std::string> tail) {
+            auto candidate = make_input();
+            candidate.add_args(head).add_args(tail);
+            if (current.stdin_data.has_value()) {
+                candidate.set_stdin(*current.stdin_data);
+            }
+            return candidate;
+        });
+    }
+
+    if (config.minimize_stdin && current.stdin_data.has_value()) {
+        // The bytes being reduced are the only full copy of stdin
+        current.stdin_data = minimizer.ddmin(std::move(*current.stdin_data), [&](std::span<const char> head,
+                                                                                 std::span<const char> tail) {
+            std::pmr::string bytes;
+            bytes.reserve(head.size() + tail.size());
+            bytes.append(head.begin(), head.end()).append(tail.begin(), tail.end());
+            auto candidate = make_input();
+            candidate.add_args(current.args).set_stdin(std::move(bytes));
+            return candidate;
+        });
+    }
+
+    MinimizeResult minimized;
+    minimized.input = to_input(current);
+    minimized.result = runner.run_test(minimized.input);
+    minimized.executions = minimizer.executions() + 1;
+    minimized.cache_hits = minimizer.cache_hits();
+    return minimized;
+}
+
+} // namespace x86_asm_test
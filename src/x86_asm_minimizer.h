@@ -0,0 +1,90 @@
+/**
+ * @file x86_asm_minimizer.h
+ * @brief Delta-debugging (ddmin) reduction of failing test inputs
+ */
+
+#pragma once
+
+#include "x86_asm_test.h"
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace x86_asm_test {
+
+/**
+ * @brief Predicate deciding whether an execution still shows the failure
+ */
+using FailurePredicate = std::function<bool(const ExecutionResult&)>;
+
+/**
+ * @struct MinimizerConfig
+ * @brief Options for minimize()
+ */
+struct MinimizerConfig {
+    size_t jobs{std::max(1U, std::thread::hardware_concurrency())}; ///< Candidates executed in parallel
+    size_t max_executions{100000};                                  ///< Hard cap on program runs
+    bool minimize_args{true};                                       ///< Reduce the argument list
+    bool minimize_stdin{true};                                      ///< Reduce the stdin bytes
+};
+
+/**
+ * @struct MinimizeResult
+ * @brief Outcome of a minimization
+ */
+struct MinimizeResult {
+    TestInput input;            ///< Smallest input found that still fails
+    ExecutionResult result;     ///< Result of running the minimal input
+    size_t executions{0};       ///< Program runs performed
+    size_t cache_hits{0};       ///< Candidates answered from the cache
+
+    /**
+     * @brief Render the reproducer as a Google Test case
+     * @param fixture Test fixture name
+     * @param test_name Test name
+     * @param expectation ExpectedOutput expression the fixed program should satisfy
+     * @return C++ source for a TEST_F
+     */
+    [[nodiscard]] std::string to_test_case(
+        std::string_view fixture,
+        std::string_view test_name,
+        std::string_view expectation = "expect_success()"
+    ) const;
+};
+
+/**
+ * @brief Build a predicate that reports a failure when expectations don't match
+ * @param expected Expectations the program should satisfy
+ * @return Predicate for minimize()
+ */
+[[nodiscard]] FailurePredicate fails_expectation(ExpectedOutput expected);
+
+/**
+ * @brief Shrink a failing input with delta debugging
+ *
+ * The argument list and then the stdin bytes are reduced with ddmin until
+ * no single chunk can be removed without losing the failure. Each ddmin
+ * round evaluates its candidates on `config.jobs` threads and accepts the
+ * first failing one in a fixed order, so results do not depend on timing.
+ * Candidates are built only when run and cached by a hash of the input,
+ * so an input is never executed twice and at most one candidate per
+ * thread is held in memory.
+ *
+ * @param runner Runner for the program under test
+ * @param input Failing input
+ * @param still_fails Returns true if a result still shows the failure (called from worker threads)
+ * @param config Minimizer options
+ * @return Minimal failing input
+ * @throws std::invalid_argument if the original input does not fail
+ * @throws Any exception from a run or from still_fails, once all workers stopped
+ */
+[[nodiscard]] MinimizeResult minimize(
+    const AsmTestRunner& runner,
+    const TestInput& input,
+    const FailurePredicate& still_fails,
+    MinimizerConfig config = {}
+);
+
+} // namespace x86_asm_test
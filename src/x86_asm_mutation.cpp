@@ -0,0 +1,473 @@
+/**
+ * @file x86_asm_mutation.cpp
+ * @brief Implementation of machine-code mutation testing
+ */
+
+#include "x86_asm_mutation.h"
+#include "x86_asm_workers.h"
+#include <stdexcept>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <poll.h>
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <format>
+
+extern char** environ;
+
+namespace x86_asm_test {
+
+namespace {
+
+struct Instruction {
+    uint64_t address{0};
+    std::vector<uint8_t> bytes;
+    std::string mnemonic;
+};
+
+constexpr std::array<std::string_view, 16> kConditionNames{
+    "o", "no", "b", "ae", "e", "ne", "be", "a", "s", "ns", "p", "np", "l", "ge", "le", "g"
+};
+
+/// Run a command and return its stdout
+std::string capture_command(const std::vector<std::string>& command) {
+    int out_pipe[2];
+    if (pipe2(out_pipe, O_CLOEXEC) == -1) {
+        throw std::runtime_error("Failed to create pipe");
+    }
+
+    std::vector<char*> argv;
+    for (const auto& arg : command) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    pid_t pid = fork();
+    if (pid == -1) {
+        close(out_pipe[0]); close(out_pipe[1]);
+        throw std::runtime_error("Fork failed");
+    }
+    if (pid == 0) {
+        dup2(out_pipe[1], STDOUT_FILENO);
+        execvp(argv[0], argv.data());
+        _exit(127);
+    }
+
+    close(out_pipe[1]);
+    std::string output;
+    char buffer[4096];
+    ssize_t bytes_read;
+    while ((bytes_read = read(out_pipe[0], buffer, sizeof(buffer))) > 0) {
+        output.append(buffer, static_cast<size_t>(bytes_read));
+    }
+    close(out_pipe[0]);
+
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        throw std::runtime_error(std::format("Command failed: {}", command.front()));
+    }
+    return output;
+}
+
+/// Parse `objdump -d -w` output into instructions
+std::vector<Instruction> disassemble(const std::filesystem::path& executable) {
+    auto listing = capture_command({"objdump", "-d", "-w", "-M", "intel", executable.string()});
+
+    std::vector<Instruction> instructions;
+    std::istringstream lines(listing);
+    std::string line;
+    while (std::getline(lines, line)) {
+        // "  401000:\t48 8b 3c 24          \tmov    rdi,QWORD PTR [rsp]"
+        auto colon = line.find(":\t");
+        if (colon == std::string::npos) continue;
+        auto text_tab = line.find('\t', colon + 2);
+        if (text_tab == std::string::npos) continue;
+
+        Instruction insn;
+        try {
+            insn.address = std::stoull(line.substr(0, colon), nullptr, 16);
+        } catch (const std::exception&) {
+            continue;
+        }
+
+        std::istringstream hex(line.substr(colon + 2, text_tab - colon - 2));
+        std::string byte;
+        while (hex >> byte) {
+            insn.bytes.push_back(static_cast<uint8_t>(std::stoul(byte, nullptr, 16)));
+        }
+
+        std::istringstream text(line.substr(text_tab + 1));
+        text >> insn.mnemonic;
+        if (!insn.bytes.empty() && !insn.mnemonic.empty()) {
+            instructions.push_back(std::move(insn));
+        }
+    }
+    return instructions;
+}
+
+/// Index of the opcode byte after legacy and REX prefixes
+size_t opcode_index(const std::vector<uint8_t>& bytes, bool& rex_w, bool& operand_16) {
+    size_t p = 0;
+    rex_w = false;
+    operand_16 = false;
+    while (p < bytes.size() && (bytes[p] == 0x66 || bytes[p] == 0x67 || bytes[p] == 0xF0 ||
+                                bytes[p] == 0xF2 || bytes[p] == 0xF3)) {
+        operand_16 = operand_16 || bytes[p] == 0x66;
+        ++p;
+    }
+    if (p < bytes.size() && (bytes[p] & 0xF0) == 0x40) {
+        rex_w = (bytes[p] & 0x08) != 0;
+        ++p;
+    }
+    return p;
+}
+
+/// Width in bytes of the trailing immediate, or 0 if the opcode has none we mutate
+size_t immediate_width(uint8_t opcode, bool rex_w, bool operand_16) {
+    switch (opcode) {
+        case 0x04: case 0x0C: case 0x14: case 0x1C: case 0x24: case 0x2C: case 0x34: case 0x3C:
+        case 0x6A: case 0x6B: case 0x80: case 0x83: case 0xA8: case 0xC0: case 0xC1: case 0xC6:
+            return 1;
+        case 0x05: case 0x0D: case 0x15: case 0x1D: case 0x25: case 0x2D: case 0x35: case 0x3D:
+        case 0x68: case 0x69: case 0x81: case 0xA9: case 0xC7:
+            return operand_16 ? 0 : 4;
+        default:
+            break;
+    }
+    if (opcode >= 0xB0 && opcode <= 0xB7) return 1;
+    if (opcode >= 0xB8 && opcode <= 0xBF) return operand_16 ? 0 : (rex_w ? 8 : 4);
+    return 0;
+}
+
+/// Sealed memfd holding an executable; only a read-only descriptor stays open
+class MemfdExecutable {
+public:
+    explicit MemfdExecutable(const std::string& bytes) {
+        int writable = memfd_create("asm-mutant", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+        if (writable == -1) {
+            throw std::runtime_error("Failed to create memfd");
+        }
+        size_t offset = 0;
+        while (offset < bytes.size()) {
+            ssize_t written = write(writable, bytes.data() + offset, bytes.size() - offset);
+            if (written <= 0) {
+                close(writable);
+                throw std::runtime_error("Failed to write mutant");
+            }
+            offset += static_cast<size_t>(written);
+        }
+        fchmod(writable, 0755);
+
+        // The mutant cannot change under a running process
+        if (fcntl(writable, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) == -1) {
+            close(writable);
+            throw std::runtime_error("Failed to seal mutant");
+        }
+
+        // exec refuses files that are open for writing (ETXTBSY)
+        fd_ = open(std::format("/proc/self/fd/{}", writable).c_str(), O_RDONLY | O_CLOEXEC);
+        close(writable);
+        if (fd_ == -1) {
+            throw std::runtime_error("Failed to reopen mutant read-only");
+        }
+        path_ = std::format("/proc/{}/fd/{}", getpid(), fd_);
+    }
+
+    MemfdExecutable(const MemfdExecutable&) = delete;
+    MemfdExecutable& operator=(const MemfdExecutable&) = delete;
+
+    ~MemfdExecutable() { close(fd_); }
+
+    const std::filesystem::path& path() const noexcept { return path_; }
+
+private:
+    int fd_{-1};
+    std::filesystem::path path_;
+};
+
+} // namespace
+
+size_t MutationReport::killed() const noexcept {
+    return static_cast<size_t>(std::ranges::count_if(outcomes, &MutantOutcome::killed));
+}
+
+double MutationReport::score() const noexcept {
+    return outcomes.empty() ? 1.0 : static_cast<double>(killed()) / static_cast<double>(outcomes.size());
+}
+
+std::map<std::string, std::vector<std::string>> MutationReport::survivors_by_label() const {
+    std::map<std::string, std::vector<std::string>> survivors;
+    for (const auto& outcome : outcomes) {
+        if (outcome.killed) continue;
+        auto plus = outcome.mutant.location.find('+');
+        auto label = outcome.mutant.location.substr(0, plus);
+        survivors[label].push_back(std::format("{}: {}", outcome.mutant.location, outcome.mutant.description));
+    }
+    return survivors;
+}
+
+std::string MutationReport::summary() const {
+    std::string text = std::format("Mutation score: {:.1f}% ({} of {} mutants killed)\n",
+                                   score() * 100.0, killed(), outcomes.size());
+    for (const auto& [label, mutants] : survivors_by_label()) {
+        text += std::format("  {}: {} surviving\n", label, mutants.size());
+        for (const auto& description : mutants) {
+            text += std::format("    {}\n", description);
+        }
+    }
+    return text;
+}
+
+MutationEngine::MutationEngine(std::filesystem::path executable, MutationConfig config)
+    : executable_{std::move(executable)},
+      config_{std::move(config)},
+      image_{executable_} {
+    enumerate();
+}
+
+void MutationEngine::enumerate() {
+    auto enabled = [this](MutationOperator op) {
+        return std::ranges::find(config_.operators, op) != config_.operators.end();
+    };
+
+    for (const auto& insn : disassemble(executable_)) {
+        if (!config_.labels.empty()) {
+            const auto* symbol = image_.symbol_at(insn.address);
+            if (symbol == nullptr || std::ranges::find(config_.labels, symbol->name) == config_.labels.end()) {
+                continue;
+            }
+        }
+        auto file_offset = image_.file_offset(insn.address);
+        if (!file_offset.has_value()) continue;
+
+        auto add_mutant = [&](MutationOperator op, size_t index, std::string original,
+                              std::string replacement, std::string description) {
+            mutants_.push_back({
+                mutants_.size(), op, insn.address, *file_offset + index,
+                std::move(original), std::move(replacement),
+                image_.describe(insn.address), std::move(description)
+            });
+        };
+
+        const auto& b = insn.bytes;
+        bool rex_w = false, operand_16 = false;
+        size_t p = opcode_index(b, rex_w, operand_16);
+        if (p >= b.size()) continue;
+
+        // Conditional jumps: the low opcode bit negates the condition
+        if (enabled(MutationOperator::FlipCondition)) {
+            size_t cc_index = SIZE_MAX;
+            if (b[p] >= 0x70 && b[p] <= 0x7F) {
+                cc_index = p;
+            } else if (b[p] == 0x0F && p + 1 < b.size() && b[p + 1] >= 0x80 && b[p + 1] <= 0x8F) {
+                cc_index = p + 1;
+            }
+            if (cc_index != SIZE_MAX) {
+                uint8_t cc = b[cc_index] & 0x0F;
+                add_mutant(MutationOperator::FlipCondition, cc_index,
+                           std::string(1, static_cast<char>(b[cc_index])),
+                           std::string(1, static_cast<char>(b[cc_index] ^ 0x01)),
+                           std::format("j{} -> j{}", kConditionNames[cc], kConditionNames[cc ^ 1]));
+            }
+        }
+
+        // add <-> sub, both the register forms and the /0 vs /5 immediate groups
+        if (enabled(MutationOperator::SwapAddSub) && (insn.mnemonic == "add" || insn.mnemonic == "sub")) {
+            std::string description = insn.mnemonic == "add" ? "add -> sub" : "sub -> add";
+            if (b[p] <= 0x05) {
+                add_mutant(MutationOperator::SwapAddSub, p, std::string(1, static_cast<char>(b[p])),
+                           std::string(1, static_cast<char>(b[p] + 0x28)), description);
+            } else if (b[p] >= 0x28 && b[p] <= 0x2D) {
+                add_mutant(MutationOperator::SwapAddSub, p, std::string(1, static_cast<char>(b[p])),
+                           std::string(1, static_cast<char>(b[p] - 0x28)), description);
+            } else if ((b[p] == 0x80 || b[p] == 0x81 || b[p] == 0x83) && p + 1 < b.size()) {
+                uint8_t modrm = b[p + 1];
+                uint8_t reg = (modrm >> 3) & 0x07;
+                if (reg == 0 || reg == 5) {
+                    uint8_t swapped = static_cast<uint8_t>((modrm & 0xC7) | ((reg == 0 ? 5 : 0) << 3));
+                    add_mutant(MutationOperator::SwapAddSub, p + 1, std::string(1, static_cast<char>(modrm)),
+                               std::string(1, static_cast<char>(swapped)), description);
+                }
+            }
+        }
+
+        // Immediates are always the trailing bytes of the instruction
+        if (enabled(MutationOperator::ChangeImmediate)) {
+            size_t width = immediate_width(b[p], rex_w, operand_16);
+            if (width != 0 && b.size() >= p + 1 + width) {
+                size_t start = b.size() - width;
+                uint64_t value = 0;
+                for (size_t i = 0; i < width; ++i) {
+                    value |= static_cast<uint64_t>(b[start + i]) << (8 * i);
+                }
+                uint64_t mutated = value + 1;
+
+                std::string original(b.begin() + static_cast<std::ptrdiff_t>(start), b.end());
+                std::string replacement(width, '\0');
+                for (size_t i = 0; i < width; ++i) {
+                    replacement[i] = static_cast<char>((mutated >> (8 * i)) & 0xFF);
+                }
+                uint64_t mask = width == 8 ? UINT64_MAX : ((uint64_t{1} << (8 * width)) - 1);
+                add_mutant(MutationOperator::ChangeImmediate, start, std::move(original), std::move(replacement),
+                           std::format("{} imm 0x{:x} -> 0x{:x}", insn.mnemonic, value, mutated & mask));
+            }
+        }
+    }
+}
+
+std::string MutationEngine::patched_bytes(const Mutant& mutant) const {
+    std::string bytes = image_.bytes();
+    bytes.replace(mutant.file_offset, mutant.replacement.size(), mutant.replacement);
+    return bytes;
+}
+
+MutationReport MutationEngine::run(const MutantSuite& suite) const {
+    MutationReport report;
+    report.outcomes.resize(mutants_.size());
+
+    std::atomic<size_t> next{0};
+    auto worker = [&] {
+        for (size_t i = next++; i < mutants_.size(); i = next++) {
+            MemfdExecutable executable(patched_bytes(mutants_[i]));
+            report.outcomes[i] = {mutants_[i], suite(executable.path())};
+        }
+    };
+    // A suite error stops the other workers and is rethrown here
+    detail::run_workers(std::min(config_.jobs, mutants_.size()), worker, [&] { next = mutants_.size(); });
+
+    return report;
+}
+
+MutantSuite MutationEngine::cases_suite(
+    std::vector<std::pair<TestInput, ExpectedOutput>> cases,
+    TestConfig config
+) {
+    // A failed exec is recognised by the runner child's message on stderr
+    config.capture_stderr = true;
+    return [cases = std::move(cases), config = std::move(config)](const std::filesystem::path& mutant) {
+        AsmTestRunner runner(mutant, AsmSyntax::Intel, config);
+        // Early termination: the first failing case kills the mutant
+        return std::ranges::any_of(cases, [&](const auto& test_case) {
+            auto result = runner.run_test(test_case.first);
+            // The runner's child reports a failed exec this way; it says nothing about the mutant
+            if (result.exit_code == 127 && result.stderr_output.starts_with("execv:")) {
+                throw std::runtime_error(std::format("Cannot execute mutant {}: {}", mutant.string(),
+                                                     result.stderr_output));
+            }
+            return !test_case.second.matches(result);
+        });
+    };
+}
+
+MutantSuite MutationEngine::gtest_suite(
+    std::filesystem::path original,
+    std::filesystem::path test_binary,
+    std::string gtest_filter,
+    std::chrono::milliseconds timeout
+) {
+    original = std::filesystem::absolute(original);
+    test_binary = std::filesystem::absolute(test_binary);
+
+    return [=](const std::filesystem::path& mutant) {
+        // Everything the child needs is built before fork
+        std::vector<std::string> args{test_binary.string(), "--gtest_fail_fast", "--gtest_brief=1"};
+        if (!gtest_filter.empty()) {
+            args.push_back("--gtest_filter=" + gtest_filter);
+        }
+        std::vector<char*> argv;
+        for (auto& arg : args) argv.push_back(arg.data());
+        argv.push_back(nullptr);
+
+        std::string substitute = std::format("X86_ASM_TEST_SUBSTITUTE={}={}", original.string(), mutant.string());
+        // An inherited impact database would narrow the child's tests to those it selects
+        std::vector<char*> envp;
+        for (char** env = environ; *env != nullptr; ++env) {
+            std::string_view entry{*env};
+            if (!entry.starts_with("X86_ASM_TEST_SUBSTITUTE=") && !entry.starts_with("X86_ASM_TEST_IMPACT_DB=")) {
+                envp.push_back(*env);
+            }
+        }
+        envp.push_back(substitute.data());
+        envp.push_back(nullptr);
+
+        // The child writes its errno here if exec fails; a successful exec closes it
+        int error_pipe[2];
+        if (pipe2(error_pipe, O_CLOEXEC) == -1) {
+            throw std::runtime_error("Failed to create pipe for gtest suite");
+        }
+        int null_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+        pid_t pid = fork();
+        if (pid == -1) {
+            close(null_fd);
+            close(error_pipe[0]); close(error_pipe[1]);
+            throw std::runtime_error("Fork failed for gtest suite");
+        }
+        if (pid == 0) {
+            dup2(null_fd, STDOUT_FILENO);
+            dup2(null_fd, STDERR_FILENO);
+            execve(argv[0], argv.data(), envp.data());
+            int error = errno;
+            (void)!write(error_pipe[1], &error, sizeof(error));
+            _exit(127);
+        }
+        close(null_fd);
+        close(error_pipe[1]);
+
+        int exec_error = 0;
+        ssize_t reported;
+        while ((reported = read(error_pipe[0], &exec_error, sizeof(exec_error))) == -1 && errno == EINTR) {}
+        close(error_pipe[0]);
+        if (reported > 0) {
+            waitpid(pid, nullptr, 0);
+            throw std::runtime_error(std::format("Cannot execute {}: {}", test_binary.string(),
+                                                 std::strerror(exec_error)));
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        int status = 0;
+        int pid_fd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+        if (pid_fd != -1) {
+            struct pollfd ready{pid_fd, POLLIN, 0};
+            int polled;
+            do {
+                // A signal cuts the wait short; resume it with the time left
+                auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+                polled = poll(&ready, 1, static_cast<int>(std::max<std::chrono::milliseconds::rep>(remaining.count(), 0)));
+            } while (polled == -1 && errno == EINTR);
+            if (polled == 0) {
+                kill(pid, SIGKILL);  // A hanging mutant counts as killed
+            }
+            close(pid_fd);
+            waitpid(pid, &status, 0);
+        } else {
+            // No pidfd (kernels before 5.3): poll for the exit until the deadline
+            while (waitpid(pid, &status, WNOHANG) == 0) {
+                if (std::chrono::steady_clock::now() >= deadline) {
+                    kill(pid, SIGKILL);
+                    waitpid(pid, &status, 0);
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+        }
+
+        // 127 means the binary could not start (e.g. missing libraries), not that a test failed
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 127) {
+            throw std::runtime_error(std::format("{} exited with 127; it could not be started",
+                                                 test_binary.string()));
+        }
+        return !(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    };
+}
+
+} // namespace x86_asm_test
@@ -0,0 +1,212 @@
+/**
+ * @file x86_asm_mutation.h
+ * @brief Mutation testing of assembled programs by patching their machine code
+ */
+
+#pragma once
+
+#include "x86_asm_test.h"
+#include "x86_asm_coverage.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace x86_asm_test {
+
+/**
+ * @enum MutationOperator
+ * @brief Kinds of machine-code mutations
+ */
+enum class MutationOperator : uint8_t {
+    FlipCondition,   ///< Negate a conditional jump (jl -> jge)
+    SwapAddSub,      ///< Replace add with sub and vice versa
+    ChangeImmediate  ///< Increment an immediate operand
+};
+
+/**
+ * @struct Mutant
+ * @brief One patched variant of the executable
+ */
+struct Mutant {
+    size_t id{0};                                         ///< Index in MutationEngine::mutants()
+    MutationOperator op{MutationOperator::FlipCondition}; ///< Applied operator
+    uint64_t address{0};                                  ///< Address of the mutated instruction
+    uint64_t file_offset{0};                              ///< File offset of the first patched byte
+    std::string original;                                 ///< Original bytes at file_offset
+    std::string replacement;                              ///< Patched bytes at file_offset
+    std::string location;                                 ///< Address as "label+0xoff"
+    std::string description;                              ///< e.g. "jl -> jge"
+};
+
+/**
+ * @struct MutantOutcome
+ * @brief Whether the suite detected a mutant
+ */
+struct MutantOutcome {
+    Mutant mutant;       ///< The mutant
+    bool killed{false};  ///< true if at least one test failed
+};
+
+/**
+ * @struct MutationReport
+ * @brief Results of a mutation testing run
+ */
+struct MutationReport {
+    std::vector<MutantOutcome> outcomes;  ///< One entry per mutant, in mutant order
+
+    /**
+     * @brief Count killed mutants
+     * @return Number of killed mutants
+     */
+    [[nodiscard]] size_t killed() const noexcept;
+
+    /**
+     * @brief Count surviving mutants
+     * @return Number of mutants no test detected
+     */
+    [[nodiscard]] size_t survived() const noexcept { return outcomes.size() - killed(); }
+
+    /**
+     * @brief Fraction of killed mutants
+     * @return Mutation score in [0, 1], 1 for an empty report
+     */
+    [[nodiscard]] double score() const noexcept;
+
+    /**
+     * @brief Group surviving mutants by the label they live in
+     * @return Label name to mutant descriptions
+     */
+    [[nodiscard]] std::map<std::string, std::vector<std::string>> survivors_by_label() const;
+
+    /**
+     * @brief Human-readable summary listing survivors per label
+     * @return Multi-line report
+     */
+    [[nodiscard]] std::string summary() const;
+};
+
+/**
+ * @brief A test suite run against one mutant
+ *
+ * Receives the path of the mutant executable and returns true if the
+ * mutant was killed (some test failed). Called concurrently.
+ */
+using MutantSuite = std::function<bool(const std::filesystem::path& mutant)>;
+
+/**
+ * @struct MutationConfig
+ * @brief Options for MutationEngine
+ */
+struct MutationConfig {
+    std::vector<MutationOperator> operators{
+        MutationOperator::FlipCondition,
+        MutationOperator::SwapAddSub,
+        MutationOperator::ChangeImmediate
+    };                                                                  ///< Operators to apply
+    std::vector<std::string> labels{};                                  ///< Only mutate these labels (empty = all)
+    size_t jobs{std::max(1U, std::thread::hardware_concurrency())};    ///< Mutants evaluated in parallel
+};
+
+/**
+ * @class MutationEngine
+ * @brief Generates machine-code mutants of an executable and scores a suite against them
+ *
+ * Instructions are located with `objdump -d` (GNU binutils, already needed
+ * to build the test programs). Each mutant is written to a sealed memfd
+ * and executed through its /proc path, so nothing touches the disk.
+ *
+ * @code
+ * MutationEngine engine("./calc");
+ * auto report = engine.run(MutationEngine::cases_suite(cases));
+ * std::cout << report.summary();
+ * @endcode
+ */
+class MutationEngine {
+public:
+    /**
+     * @brief Disassemble an executable and enumerate its mutants
+     * @param executable Program to mutate
+     * @param config Operators, label filter and parallelism
+     * @throws std::runtime_error if the executable cannot be disassembled
+     */
+    explicit MutationEngine(std::filesystem::path executable, MutationConfig config = {});
+
+    /**
+     * @brief Get the generated mutants
+     * @return Mutants in address order
+     */
+    [[nodiscard]] const std::vector<Mutant>& mutants() const noexcept { return mutants_; }
+
+    /**
+     * @brief Get the original executable image
+     * @return ELF image
+     */
+    [[nodiscard]] const ElfImage& image() const noexcept { return image_; }
+
+    /**
+     * @brief Run a suite against every mutant in parallel
+     * @param suite Suite deciding whether a mutant is killed
+     * @return Outcome per mutant
+     * @throws std::runtime_error The first error of any suite, once all workers stopped
+     */
+    [[nodiscard]] MutationReport run(const MutantSuite& suite) const;
+
+    /**
+     * @brief Build a patched copy of the executable
+     * @param mutant Mutant to apply
+     * @return Executable bytes
+     */
+    [[nodiscard]] std::string patched_bytes(const Mutant& mutant) const;
+
+    /**
+     * @brief Suite running in-process test cases, stopping at the first failure
+     * @param cases Inputs with their expectations
+     * @param config Configuration for the mutant runners (keep the timeout short;
+     *               stderr is always captured)
+     * @return Suite for run(); it throws std::runtime_error if the mutant cannot be executed
+     */
+    [[nodiscard]] static MutantSuite cases_suite(
+        std::vector<std::pair<TestInput, ExpectedOutput>> cases,
+        TestConfig config = {}
+    );
+
+    /**
+     * @brief Suite running an existing Google Test binary against the mutant
+     *
+     * The binary is started with X86_ASM_TEST_SUBSTITUTE set to
+     * "<original>=<mutant>" and with --gtest_fail_fast so the run ends at
+     * the first failing test; X86_ASM_TEST_IMPACT_DB is removed from its
+     * environment so it runs every test. Its main() must pass the two paths, split at
+     * the last '=', to set_executable_substitution() so that every
+     * AsmTestRunner for the original executable runs the mutant instead.
+     *
+     * @param original Path the tests use for the executable (e.g. "./calc")
+     * @param test_binary Google Test executable
+     * @param gtest_filter Optional --gtest_filter pattern
+     * @param timeout Kill the test binary after this long (counts as killed)
+     * @return Suite for run(); it throws std::runtime_error if the test binary
+     *         cannot be executed or exits with 127
+     */
+    [[nodiscard]] static MutantSuite gtest_suite(
+        std::filesystem::path original,
+        std::filesystem::path test_binary,
+        std::string gtest_filter = {},
+        std::chrono::milliseconds timeout = std::chrono::milliseconds(60000)
+    );
+
+private:
+    std::filesystem::path executable_;
+    MutationConfig config_;
+    ElfImage image_;
+    std::vector<Mutant> mutants_;
+
+    void enumerate();
+};
+
+} // namespace x86_asm_test
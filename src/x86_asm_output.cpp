@@ -0,0 +1,217 @@
+/**
+ * @file x86_asm_output.cpp
+ * @brief Implementation of chunked output capture
+ */
+
+#include "x86_asm_output.h"
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+
+namespace x86_asm_test {
+
+OutputChunkPool& OutputChunkPool::instance() {
+    static OutputChunkPool pool;
+    return pool;
+}
+
+std::unique_ptr<char[]> OutputChunkPool::acquire() {
+    {
+        std::lock_guard lock(mutex_);
+        if (!free_.empty()) {
+            auto chunk = std::move(free_.back());
+            free_.pop_back();
+            return chunk;
+        }
+    }
+    return std::make_unique_for_overwrite<char[]>(kChunkSize);
+}
+
+void OutputChunkPool::release(std::unique_ptr<char[]> chunk) noexcept {
+    std::lock_guard lock(mutex_);
+    if (free_.size() < capacity_) {
+        try {
+            free_.push_back(std::move(chunk));
+        } catch (...) {
+            // Out of memory: the chunk is simply freed
+        }
+    }
+}
+
+void OutputChunkPool::set_capacity(size_t chunks) {
+    std::lock_guard lock(mutex_);
+    capacity_ = chunks;
+    if (free_.size() > capacity_) {
+        free_.resize(capacity_);
+    }
+}
+
+size_t OutputChunkPool::idle() const {
+    std::lock_guard lock(mutex_);
+    return free_.size();
+}
+
+ChunkedOutput::ChunkedOutput(ChunkedOutput&& other) noexcept
+    : chunks_(std::move(other.chunks_)), size_(std::exchange(other.size_, 0)),
+      joined_(std::move(other.joined_)), joined_valid_(std::exchange(other.joined_valid_, false)) {
+    other.chunks_.clear();
+}
+
+ChunkedOutput& ChunkedOutput::operator=(ChunkedOutput&& other) noexcept {
+    if (this != &other) {
+        clear();
+        chunks_ = std::move(other.chunks_);
+        other.chunks_.clear();
+        size_ = std::exchange(other.size_, 0);
+        joined_ = std::move(other.joined_);
+        joined_valid_ = std::exchange(other.joined_valid_, false);
+    }
+    return *this;
+}
+
+ChunkedOutput::~ChunkedOutput() {
+    clear();
+}
+
+std::span<char> ChunkedOutput::prepare() {
+    if (size_ == chunks_.size() * kChunkSize) {
+        chunks_.push_back(OutputChunkPool::instance().acquire());
+    }
+    size_t used = size_ % kChunkSize;
+    return {chunks_.back().get() + used, kChunkSize - used};
+}
+
+void ChunkedOutput::commit(size_t bytes) noexcept {
+    size_ += bytes;
+    joined_valid_ = false;
+}
+
+void ChunkedOutput::append(std::string_view data) {
+    while (!data.empty()) {
+        auto space = prepare();
+        size_t bytes = std::min(space.size(), data.size());
+        std::memcpy(space.data(), data.data(), bytes);
+        commit(bytes);
+        data.remove_prefix(bytes);
+    }
+}
+
+std::string_view ChunkedOutput::chunk(size_t index) const noexcept {
+    size_t offset = index * kChunkSize;
+    return {chunks_[index].get(), std::min(kChunkSize, size_ - offset)};
+}
+
+bool ChunkedOutput::equals(std::string_view expected) const noexcept {
+    if (expected.size() != size_) {
+        return false;
+    }
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+        auto part = chunk(i);
+        if (expected.substr(i * kChunkSize, part.size()) != part) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ChunkedOutput::contains(std::string_view pattern) const {
+    if (pattern.empty()) {
+        return true;
+    }
+    if (pattern.size() > size_) {
+        return false;
+    }
+    // Longer patterns may span more than two chunks; rare enough to join
+    if (pattern.size() > kChunkSize) {
+        return view().find(pattern) != std::string_view::npos;
+    }
+    // A match crossing a boundary lies within pattern.size() - 1 bytes on either side of it
+    std::string window;
+    if (chunks_.size() > 1) {
+        window.reserve(2 * (pattern.size() - 1));
+    }
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+        auto current = chunk(i);
+        if (current.find(pattern) != std::string_view::npos) {
+            return true;
+        }
+        if (i + 1 == chunks_.size()) {
+            break;
+        }
+        auto next = chunk(i + 1);
+        window.assign(current.substr(current.size() - std::min(pattern.size() - 1, current.size())));
+        window.append(next.substr(0, pattern.size() - 1));
+        if (window.find(pattern) != std::string::npos) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string_view ChunkedOutput::view() const {
+    if (chunks_.size() <= 1) {
+        return chunks_.empty() ? std::string_view{} : chunk(0);
+    }
+    if (!joined_valid_) {
+        joined_.clear();
+        joined_.reserve(size_);
+        for (size_t i = 0; i < chunks_.size(); ++i) {
+            joined_.append(chunk(i));
+        }
+        joined_valid_ = true;
+    }
+    return joined_;
+}
+
+void ChunkedOutput::clear() noexcept {
+    auto& pool = OutputChunkPool::instance();
+    for (auto& chunk : chunks_) {
+        pool.release(std::move(chunk));
+    }
+    chunks_.clear();
+    size_ = 0;
+    joined_.clear();
+    joined_valid_ = false;
+}
+
+bool ExpectedOutput::matches(const ChunkedResult& result) const noexcept {
+    if (expected_exit_code_.has_value() && result.exit_code != expected_exit_code_.value()) {
+        return false;
+    }
+    if (exact_stdout_.has_value() && !result.stdout_output.equals(*exact_stdout_)) {
+        return false;
+    }
+    if (exact_stderr_.has_value() && !result.stderr_output.equals(*exact_stderr_)) {
+        return false;
+    }
+    try {
+        for (const auto& pattern : stdout_contains_) {
+            if (!result.stdout_output.contains(pattern)) {
+                return false;
+            }
+        }
+        for (const auto& pattern : stderr_contains_) {
+            if (!result.stderr_output.contains(pattern)) {
+                return false;
+            }
+        }
+    } catch (...) {
+        // Joining the output for a pattern longer than a chunk failed
+        return false;
+    }
+    return true;
+}
+
+std::string ExpectedOutput::get_mismatch_description(const ChunkedResult& result) const {
+    // Only failures need the text, so joining the chunks here is fine
+    ExecutionResult joined;
+    joined.exit_code = result.exit_code;
+    joined.stdout_output = result.stdout_output.view();
+    joined.stderr_output = result.stderr_output.view();
+    joined.execution_time = result.execution_time;
+    joined.timed_out = result.timed_out;
+    return get_mismatch_description(joined);
+}
+
+} // namespace x86_asm_test
@@ -0,0 +1,201 @@
+/**
+ * @file x86_asm_output.h
+ * @brief Chunked capture of large program output
+ */
+
+#pragma once
+
+#include "x86_asm_test.h"
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace x86_asm_test {
+
+/**
+ * @class OutputChunkPool
+ * @brief Process-wide free list of output chunks
+ *
+ * Chunks released by a ChunkedOutput are kept (up to a capacity) and
+ * handed to the next capture, so a suite that produces a lot of output
+ * reuses the same memory instead of going back to the allocator.
+ */
+class OutputChunkPool {
+public:
+    static constexpr size_t kChunkSize = 64 * 1024;   ///< Bytes per chunk
+
+    /**
+     * @brief Get the pool shared by all captures
+     * @return Process-wide pool
+     */
+    [[nodiscard]] static OutputChunkPool& instance();
+
+    /**
+     * @brief Take a chunk, reusing a released one when possible
+     * @return Uninitialized chunk of kChunkSize bytes
+     */
+    [[nodiscard]] std::unique_ptr<char[]> acquire();
+
+    /**
+     * @brief Return a chunk; it is freed if the pool is full
+     * @param chunk Chunk obtained from acquire()
+     */
+    void release(std::unique_ptr<char[]> chunk) noexcept;
+
+    /**
+     * @brief Limit the number of idle chunks kept
+     * @param chunks Maximum idle chunks (default 256, i.e. 16 MB)
+     */
+    void set_capacity(size_t chunks);
+
+    /**
+     * @brief Get the number of idle chunks
+     * @return Chunks ready for reuse
+     */
+    [[nodiscard]] size_t idle() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<char[]>> free_;
+    size_t capacity_{256};
+};
+
+/**
+ * @class ChunkedOutput
+ * @brief Output stored as a list of fixed-size, pool-recycled chunks
+ *
+ * The capture loop reads straight into the free tail of the last chunk,
+ * so capturing costs only the kernel's copy: there is no intermediate
+ * buffer and nothing is moved when the output grows. Every chunk except
+ * the last is full.
+ *
+ * equals() and contains() work across chunk boundaries without joining
+ * the chunks. view() joins them on first use (a single chunk is returned
+ * as is) and caches the result until the output changes.
+ */
+class ChunkedOutput {
+public:
+    static constexpr size_t kChunkSize = OutputChunkPool::kChunkSize;
+
+    ChunkedOutput() = default;
+    ChunkedOutput(const ChunkedOutput&) = delete;
+    ChunkedOutput& operator=(const ChunkedOutput&) = delete;
+    ChunkedOutput(ChunkedOutput&& other) noexcept;
+    ChunkedOutput& operator=(ChunkedOutput&& other) noexcept;
+
+    /**
+     * @brief Return the chunks to the pool
+     */
+    ~ChunkedOutput();
+
+    /**
+     * @brief Get writable space at the end of the output
+     * @return Free tail of the last chunk, taking a new chunk when it is full
+     */
+    [[nodiscard]] std::span<char> prepare();
+
+    /**
+     * @brief Append bytes written into the space from prepare()
+     * @param bytes Number of bytes written
+     */
+    void commit(size_t bytes) noexcept;
+
+    /**
+     * @brief Append bytes by copying them
+     * @param data Bytes to append
+     */
+    void append(std::string_view data);
+
+    /**
+     * @brief Get the total number of bytes
+     * @return Output size
+     */
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+
+    /**
+     * @brief Check whether no output was captured
+     * @return true if empty
+     */
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+
+    /**
+     * @brief Get the number of chunks
+     * @return Chunk count
+     */
+    [[nodiscard]] size_t chunk_count() const noexcept { return chunks_.size(); }
+
+    /**
+     * @brief Get the bytes stored in one chunk
+     * @param index Chunk index (must be below chunk_count())
+     * @return View of the chunk's bytes
+     */
+    [[nodiscard]] std::string_view chunk(size_t index) const noexcept;
+
+    /**
+     * @brief Compare with a string without joining the chunks
+     * @param expected Expected contents
+     * @return true if the output equals expected
+     */
+    [[nodiscard]] bool equals(std::string_view expected) const noexcept;
+
+    /**
+     * @brief Search for a pattern, including matches that span two chunks
+     * @param pattern Pattern to find
+     * @return true if the output contains pattern
+     */
+    [[nodiscard]] bool contains(std::string_view pattern) const;
+
+    /**
+     * @brief Get the output as one contiguous string
+     * @return View valid until the output is modified or destroyed
+     */
+    [[nodiscard]] std::string_view view() const;
+
+    /**
+     * @brief Copy the output into a string
+     * @return Output contents
+     */
+    [[nodiscard]] std::string str() const { return std::string(view()); }
+
+    /**
+     * @brief Drop the contents and return the chunks to the pool
+     */
+    void clear() noexcept;
+
+private:
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    size_t size_{0};
+    mutable std::string joined_;             ///< Cache of view() for multi-chunk output
+    mutable bool joined_valid_{false};
+};
+
+/**
+ * @struct ChunkedResult
+ * @brief Result of AsmTestRunner::run_chunked()
+ */
+struct ChunkedResult {
+    int exit_code{0};                                    ///< Process exit code
+    ChunkedOutput stdout_output;                         ///< Standard output content
+    ChunkedOutput stderr_output;                         ///< Standard error content
+    std::chrono::milliseconds execution_time{0};         ///< Execution duration
+    bool timed_out{false};                               ///< Whether execution timed out
+
+    /**
+     * @brief Check if the execution succeeded (exit code 0 and no timeout)
+     * @return true if successful, false otherwise
+     */
+    [[nodiscard]] bool succeeded() const noexcept { return exit_code == 0 && !timed_out; }
+
+    /**
+     * @brief Check if the program produced any output
+     * @return true if stdout is not empty
+     */
+    [[nodiscard]] bool has_output() const noexcept { return !stdout_output.empty(); }
+};
+
+} // namespace x86_asm_test
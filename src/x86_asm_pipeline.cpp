@@ -0,0 +1,511 @@
+/**
+ * @file x86_asm_pipeline.cpp
+ * @brief Implementation of pipelines connected by kernel pipes
+ */
+
+#include "x86_asm_pipeline.h"
+#include <stdexcept>
+#include <sstream>
+#include <utility>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <cerrno>
+#include <format>
+
+namespace x86_asm_test {
+
+namespace {
+
+constexpr size_t kChunk = 65536;
+
+/// Owned file descriptor
+class Descriptor {
+public:
+    Descriptor() = default;
+    explicit Descriptor(int fd) noexcept : fd_{fd} {}
+    Descriptor(Descriptor&& other) noexcept : fd_{std::exchange(other.fd_, -1)} {}
+    Descriptor& operator=(Descriptor&& other) noexcept {
+        reset(std::exchange(other.fd_, -1));
+        return *this;
+    }
+    ~Descriptor() { reset(); }
+
+    [[nodiscard]] int get() const noexcept { return fd_; }
+    explicit operator bool() const noexcept { return fd_ >= 0; }
+
+    void reset(int fd = -1) noexcept {
+        if (fd_ >= 0) close(fd_);
+        fd_ = fd;
+    }
+
+private:
+    int fd_{-1};
+};
+
+struct Pipe {
+    Descriptor read;
+    Descriptor write;
+};
+
+/// O_CLOEXEC keeps every stage from inheriting the other stages' pipe ends
+Pipe make_pipe() {
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) == -1) {
+        throw std::runtime_error("Failed to create pipes");
+    }
+    return {Descriptor{fds[0]}, Descriptor{fds[1]}};
+}
+
+void set_nonblocking(const Descriptor& fd) {
+    fcntl(fd.get(), F_SETFL, fcntl(fd.get(), F_GETFL) | O_NONBLOCK);
+}
+
+/// A tapped stage: its stdout is tee'd into a capture pipe and spliced on to the next stage
+struct Forward {
+    size_t stage{0};
+    Descriptor from;           ///< Read end of the stage's stdout
+    Descriptor to;             ///< Write end of the next stage's stdin
+    Descriptor capture_read;
+    Descriptor capture_write;
+    size_t pending{0};         ///< Bytes duplicated into the capture pipe but still in `from`
+    bool capture_full{false};
+};
+
+/// A descriptor drained straight into a result string
+struct Sink {
+    Descriptor fd;
+    std::pmr::string* output{nullptr};
+};
+
+/// A started stage process
+struct Child {
+    pid_t pid{-1};
+    bool reaped{false};
+    Descriptor exit_fd;        ///< pidfd, readable once the stage exits; empty if unsupported
+};
+
+void record_status(ExecutionResult& result, int status) {
+    if (WIFEXITED(status)) {
+        result.exit_code = WEXITSTATUS(status);
+    } else if (WIFSIGNALED(status)) {
+        result.exit_code = 128 + WTERMSIG(status);
+    }
+}
+
+/// Drop bytes that were already captured but cannot be forwarded
+void discard(const Descriptor& fd, size_t count) {
+    char buffer[4096];
+    while (count > 0) {
+        ssize_t bytes_read = read(fd.get(), buffer, std::min(count, sizeof(buffer)));
+        if (bytes_read <= 0) {
+            if (bytes_read < 0 && errno == EINTR) continue;
+            return;
+        }
+        count -= static_cast<size_t>(bytes_read);
+    }
+}
+
+pid_t spawn_stage(
+    const AsmTestRunner& runner,
+    const TestInput& args,
+    int stdin_fd, int stdout_fd, int stderr_fd
+) {
+    const auto& config = runner.config();
+
+    std::vector<char*> exec_args;
+    args.fill_argv(runner.executable_path().c_str(), exec_args);
+
+    // Resolved before fork: the child must not allocate
+    bool change_directory = !detail::is_current_directory(config.working_directory);
+
+    pid_t pid = fork();
+    if (pid == -1) {
+        throw std::runtime_error("Fork failed for pipeline stage");
+    }
+
+    if (pid == 0) {
+        dup2(stdin_fd, STDIN_FILENO);
+        dup2(stdout_fd, STDOUT_FILENO);
+        dup2(stderr_fd, STDERR_FILENO);
+
+        if (change_directory && chdir(config.working_directory.c_str()) != 0) {
+            perror("chdir");
+            _exit(127);
+        }
+
+        execv(runner.executable_path().c_str(), exec_args.data());
+        perror("execv");
+        _exit(127);
+    }
+    return pid;
+}
+
+} // namespace
+
+AsmPipeline::AsmPipeline(std::initializer_list<std::reference_wrapper<const AsmTestRunner>> runners) {
+    stages_.reserve(runners.size());
+    for (const auto& runner : runners) {
+        stages_.push_back(Stage{runner, {}, false, std::nullopt});
+    }
+}
+
+AsmPipeline& AsmPipeline::add_stage(const AsmTestRunner& runner, TestInput args) {
+    stages_.push_back(Stage{std::cref(runner), std::move(args), false, std::nullopt});
+    return *this;
+}
+
+AsmPipeline::Stage& AsmPipeline::stage_at(size_t stage) {
+    if (stage >= stages_.size()) {
+        throw std::out_of_range(
+            std::format("Pipeline stage {} does not exist ({} stages)", stage, stages_.size())
+        );
+    }
+    return stages_[stage];
+}
+
+AsmPipeline& AsmPipeline::args(size_t stage, TestInput args) {
+    stage_at(stage).args = std::move(args);
+    return *this;
+}
+
+AsmPipeline& AsmPipeline::tap(size_t stage) {
+    stage_at(stage).tapped = true;
+    return *this;
+}
+
+AsmPipeline& AsmPipeline::expect(size_t stage, ExpectedOutput expected) {
+    auto& target = stage_at(stage);
+    target.tapped = true;
+    target.expected = std::move(expected);
+    return *this;
+}
+
+PipelineResult AsmPipeline::run(std::string_view stdin_data) const {
+    if (stages_.empty()) {
+        throw std::runtime_error("Cannot run an empty pipeline");
+    }
+
+    PipelineResult result;
+    result.stages.resize(stages_.size());
+    auto start_time = std::chrono::steady_clock::now();
+
+    auto timeout = std::chrono::milliseconds{0};
+    for (const auto& stage : stages_) {
+        timeout = std::max(timeout, stage.runner.get().config().timeout);
+    }
+
+    Descriptor null_fd{open("/dev/null", O_RDWR | O_CLOEXEC)};
+    if (!null_fd) {
+        throw std::runtime_error("Failed to open /dev/null");
+    }
+
+    std::vector<Child> children;
+    children.reserve(stages_.size());
+    std::vector<Forward> forwards;
+    std::vector<Sink> sinks;
+    Descriptor feed;
+
+    // Never leave stages behind if starting a later one fails
+    struct Reaper {
+        std::vector<Child>& children;
+        bool armed{true};
+        ~Reaper() {
+            if (!armed) return;
+            for (auto& child : children) {
+                kill(child.pid, SIGKILL);
+                waitpid(child.pid, nullptr, 0);
+            }
+        }
+    } reaper{children};
+
+    Descriptor next_stdin;
+    {
+        auto input = make_pipe();
+        next_stdin = std::move(input.read);
+        feed = std::move(input.write);
+    }
+
+    for (size_t i = 0; i < stages_.size(); ++i) {
+        const auto& stage = stages_[i];
+        const auto& config = stage.runner.get().config();
+        bool last = i + 1 == stages_.size();
+
+        Descriptor stage_stdin = std::move(next_stdin);
+        Descriptor stage_stdout;
+
+        if (last) {
+            auto output = make_pipe();
+            stage_stdout = std::move(output.write);
+            sinks.push_back(Sink{std::move(output.read), &result.stages[i].stdout_output});
+        } else if (stage.tapped) {
+            auto output = make_pipe();
+            auto onward = make_pipe();
+            auto capture = make_pipe();
+            stage_stdout = std::move(output.write);
+            next_stdin = std::move(onward.read);
+            forwards.push_back(Forward{
+                i, std::move(output.read), std::move(onward.write),
+                std::move(capture.read), std::move(capture.write), 0, false
+            });
+        } else {
+            auto link = make_pipe();
+            stage_stdout = std::move(link.write);
+            next_stdin = std::move(link.read);
+        }
+
+        Descriptor stage_stderr;
+        if (config.capture_stderr) {
+            auto error = make_pipe();
+            stage_stderr = std::move(error.write);
+            sinks.push_back(Sink{std::move(error.read), &result.stages[i].stderr_output});
+        }
+
+        pid_t pid = spawn_stage(stage.runner.get(), stage.args, stage_stdin.get(), stage_stdout.get(),
+                                stage_stderr ? stage_stderr.get() : null_fd.get());
+        children.push_back(Child{pid, false, Descriptor{static_cast<int>(syscall(SYS_pidfd_open, pid, 0))}});
+    }
+
+    if (stdin_data.empty()) {
+        feed.reset();
+    } else {
+        set_nonblocking(feed);
+    }
+    for (const auto& sink : sinks) set_nonblocking(sink.fd);
+    for (const auto& forward : forwards) {
+        set_nonblocking(forward.from);
+        set_nonblocking(forward.to);
+        set_nonblocking(forward.capture_read);
+    }
+
+    // Writes to a stage that already exited must fail with EPIPE, not kill us
+    sigset_t pipe_mask, old_mask;
+    sigemptyset(&pipe_mask);
+    sigaddset(&pipe_mask, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipe_mask, &old_mask);
+    bool broken = false;
+
+    auto reap = [&](int options) {
+        for (size_t i = 0; i < children.size(); ++i) {
+            if (children[i].reaped) continue;
+            int status = 0;
+            if (waitpid(children[i].pid, &status, options) == children[i].pid) {
+                children[i].reaped = true;
+                record_status(result.stages[i], status);
+                result.stages[i].execution_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - start_time
+                );
+            }
+        }
+    };
+
+    // Tee whatever the stage wrote into the capture pipe, then splice the same bytes on
+    auto service_from = [&](Forward& forward) {
+        ssize_t duplicated = tee(forward.from.get(), forward.capture_write.get(), kChunk, SPLICE_F_NONBLOCK);
+        if (duplicated > 0) {
+            forward.pending = static_cast<size_t>(duplicated);
+            if (!forward.to) {
+                discard(forward.from, forward.pending);
+                forward.pending = 0;
+            }
+        } else if (duplicated == 0) {
+            forward.from.reset();
+            forward.to.reset();
+            forward.capture_write.reset();
+        } else if (errno == EAGAIN) {
+            // Either a spurious wakeup or the capture pipe is full
+            int queued = 0;
+            forward.capture_full = ioctl(forward.capture_read.get(), FIONREAD, &queued) == 0 && queued > 0;
+        } else if (errno != EINTR) {
+            forward.from.reset();
+            forward.to.reset();
+            forward.capture_write.reset();
+        }
+    };
+
+    auto service_to = [&](Forward& forward) {
+        ssize_t moved = splice(forward.from.get(), nullptr, forward.to.get(), nullptr,
+                               forward.pending, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (moved > 0) {
+            forward.pending -= static_cast<size_t>(moved);
+        } else if (moved < 0 && errno != EAGAIN && errno != EINTR) {
+            // The next stage stopped reading: keep capturing, drop the rest
+            broken = broken || errno == EPIPE;
+            forward.to.reset();
+            discard(forward.from, forward.pending);
+            forward.pending = 0;
+        }
+    };
+
+    char buffer[kChunk];
+    auto drain = [&](Descriptor& fd, std::pmr::string& output) {
+        ssize_t bytes_read = read(fd.get(), buffer, sizeof(buffer));
+        if (bytes_read > 0) {
+            output.append(buffer, static_cast<size_t>(bytes_read));
+        } else if (bytes_read == 0 || (errno != EINTR && errno != EAGAIN)) {
+            fd.reset();
+        }
+    };
+
+    auto deadline = start_time + timeout;
+    std::vector<struct pollfd> fds;
+    std::vector<std::pair<int, size_t>> owners;   // (kind, index) per pollfd
+    enum : int { kFeed, kSink, kFrom, kTo, kCapture, kExit };
+
+    while (true) {
+        fds.clear();
+        owners.clear();
+        if (feed) {
+            fds.push_back({feed.get(), POLLOUT, 0});
+            owners.emplace_back(kFeed, 0);
+        }
+        for (size_t i = 0; i < sinks.size(); ++i) {
+            if (!sinks[i].fd) continue;
+            fds.push_back({sinks[i].fd.get(), POLLIN, 0});
+            owners.emplace_back(kSink, i);
+        }
+        for (size_t i = 0; i < forwards.size(); ++i) {
+            auto& forward = forwards[i];
+            if (forward.from && forward.pending == 0 && !forward.capture_full) {
+                fds.push_back({forward.from.get(), POLLIN, 0});
+                owners.emplace_back(kFrom, i);
+            }
+            if (forward.to && forward.pending > 0) {
+                fds.push_back({forward.to.get(), POLLOUT, 0});
+                owners.emplace_back(kTo, i);
+            }
+            if (forward.capture_read) {
+                fds.push_back({forward.capture_read.get(), POLLIN, 0});
+                owners.emplace_back(kCapture, i);
+            }
+        }
+        // A stage may close its stdout and keep running: wait for every exit within the deadline
+        bool unwatched = false;
+        for (size_t i = 0; i < children.size(); ++i) {
+            if (children[i].reaped) continue;
+            if (children[i].exit_fd) {
+                fds.push_back({children[i].exit_fd.get(), POLLIN, 0});
+                owners.emplace_back(kExit, i);
+            } else {
+                unwatched = true;
+            }
+        }
+        if (fds.empty() && !unwatched) break;
+
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()
+        );
+        // Without pidfds, exits are noticed by polling for them every few milliseconds
+        auto wait = unwatched ? std::min(remaining, std::chrono::milliseconds{10}) : remaining;
+        int ready = remaining.count() > 0
+            ? poll(fds.data(), fds.size(), static_cast<int>(std::min<int64_t>(wait.count(), INT32_MAX)))
+            : 0;
+
+        if (ready == 0 && wait < remaining) {
+            reap(WNOHANG);
+            continue;
+        }
+        if (ready == 0) {
+            reap(WNOHANG);
+            for (size_t i = 0; i < children.size(); ++i) {
+                if (!children[i].reaped) {
+                    result.stages[i].timed_out = true;
+                    kill(children[i].pid, SIGKILL);
+                }
+            }
+            break;
+        }
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            for (const auto& child : children) kill(child.pid, SIGKILL);
+            break;
+        }
+
+        for (size_t p = 0; p < fds.size(); ++p) {
+            if (fds[p].revents == 0) continue;
+            auto [kind, index] = owners[p];
+            switch (kind) {
+            case kFeed: {
+                ssize_t written = write(feed.get(), stdin_data.data(), stdin_data.size());
+                if (written > 0) {
+                    stdin_data.remove_prefix(static_cast<size_t>(written));
+                } else if (written < 0 && errno != EINTR && errno != EAGAIN) {
+                    broken = broken || errno == EPIPE;
+                    stdin_data = {};
+                }
+                if (stdin_data.empty()) feed.reset();
+                break;
+            }
+            case kSink:
+                drain(sinks[index].fd, *sinks[index].output);
+                break;
+            case kFrom:
+                service_from(forwards[index]);
+                break;
+            case kTo:
+                service_to(forwards[index]);
+                break;
+            case kCapture:
+                forwards[index].capture_full = false;
+                drain(forwards[index].capture_read, result.stages[forwards[index].stage].stdout_output);
+                break;
+            case kExit:
+                // Reaped below
+                break;
+            }
+        }
+        reap(WNOHANG);
+    }
+
+    // Only stages that were just killed (or poll() failures) are left to wait for
+    feed.reset();
+    sinks.clear();
+    forwards.clear();
+    reap(0);
+    reaper.armed = false;
+
+    if (broken) {
+        // Discard the SIGPIPE raised for this thread before unblocking
+        struct timespec no_wait{0, 0};
+        sigtimedwait(&pipe_mask, nullptr, &no_wait);
+    }
+    pthread_sigmask(SIG_SETMASK, &old_mask, nullptr);
+
+    result.execution_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time
+    );
+    return result;
+}
+
+PipelineResult AsmPipeline::assert_output(std::string_view stdin_data) const {
+    auto result = run(stdin_data);
+
+    for (size_t i = 0; i < stages_.size(); ++i) {
+        const auto& stage = stages_[i];
+        if (!stage.expected) continue;
+        auto report = stage.expected->mismatch_report(result.stages[i]);
+        if (report.empty()) continue;
+
+        std::ostringstream error_msg;
+        error_msg << std::format("Pipeline stage {} of {} failed: {}\n", i, stages_.size(),
+                                 stage.runner.get().executable_path().string())
+                  << "Arguments: ";
+        bool first = true;
+        for (const auto& arg : stage.args.args()) {
+            if (!first) error_msg << " ";
+            error_msg << arg;
+            first = false;
+        }
+        error_msg << std::format("\nExecution time: {}ms\n", result.stages[i].execution_time.count())
+                  << report.render();
+        ADD_FAILURE() << error_msg.str();
+    }
+    return result;
+}
+
+} // namespace x86_asm_test
@@ -0,0 +1,150 @@
+/**
+ * @file x86_asm_pipeline.h
+ * @brief Running programs connected stdout-to-stdin, like a shell pipeline
+ */
+
+#pragma once
+
+#include "x86_asm_test.h"
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace x86_asm_test {
+
+/**
+ * @struct PipelineResult
+ * @brief Results of one AsmPipeline run, one entry per stage
+ *
+ * Every stage reports its exit code, stderr and the time until it was
+ * reaped. stdout is only captured for the last stage and for tapped
+ * stages; the output of other stages goes straight into the next program
+ * and is never seen.
+ */
+struct PipelineResult {
+    std::vector<ExecutionResult> stages;           ///< Per-stage results, in pipeline order
+    std::chrono::milliseconds execution_time{0};   ///< Wall time of the whole pipeline
+
+    /**
+     * @brief Get the result of the last stage (the pipeline's output)
+     * @return Last stage result
+     */
+    [[nodiscard]] const ExecutionResult& output() const { return stages.back(); }
+
+    /**
+     * @brief Check if every stage succeeded (like "set -o pipefail")
+     * @return true if all stages exited with 0 and none timed out
+     */
+    [[nodiscard]] bool succeeded() const noexcept {
+        return std::ranges::all_of(stages, [](const auto& stage) { return stage.succeeded(); });
+    }
+};
+
+/**
+ * @class AsmPipeline
+ * @brief Chain of programs where each stage's stdout feeds the next stage's stdin
+ *
+ * Untapped stages are connected by a kernel pipe and the data never passes
+ * through the test process. A tapped stage writes into a pipe owned by the
+ * framework instead; its output is duplicated with tee(2) into a capture
+ * pipe and moved on to the next stage with splice(2), so forwarding costs
+ * no copies to user space.
+ *
+ * @code
+ * AsmPipeline pipeline{calc_batch, string_processor};
+ * pipeline.expect(0, expect_success().stdout_equals("15\n"))
+ *         .expect(1, expect_success().stdout_equals("15\n"));
+ * pipeline.assert_output("10 5 add\n");
+ * @endcode
+ */
+class AsmPipeline {
+public:
+    AsmPipeline() = default;
+
+    /**
+     * @brief Create a pipeline from runners, without stage arguments
+     * @param runners Stages in order; they must outlive the pipeline
+     */
+    AsmPipeline(std::initializer_list<std::reference_wrapper<const AsmTestRunner>> runners);
+
+    /**
+     * @brief Append a stage
+     * @param runner Runner providing the executable and configuration
+     * @param args Command-line arguments of the stage (its stdin data is ignored)
+     * @return Reference to this pipeline for chaining
+     */
+    AsmPipeline& add_stage(const AsmTestRunner& runner, TestInput args = {});
+
+    /**
+     * @brief Set the command-line arguments of a stage
+     * @param stage Stage index
+     * @param args Arguments (stdin data is ignored)
+     * @return Reference to this pipeline for chaining
+     * @throws std::out_of_range if the stage does not exist
+     */
+    AsmPipeline& args(size_t stage, TestInput args);
+
+    /**
+     * @brief Capture the stdout of an intermediate stage
+     * @param stage Stage index
+     * @return Reference to this pipeline for chaining
+     * @throws std::out_of_range if the stage does not exist
+     */
+    AsmPipeline& tap(size_t stage);
+
+    /**
+     * @brief Set expectations for a stage (taps the stage)
+     * @param stage Stage index
+     * @param expected Expected exit code and output of that stage
+     * @return Reference to this pipeline for chaining
+     * @throws std::out_of_range if the stage does not exist
+     */
+    AsmPipeline& expect(size_t stage, ExpectedOutput expected);
+
+    /**
+     * @brief Run the pipeline
+     *
+     * The overall timeout is the longest timeout of the stages' runners;
+     * when it expires every stage still running is killed and marked as
+     * timed out.
+     * Results do not use the result cache and strace is not applied.
+     *
+     * @param stdin_data Data fed to the first stage
+     * @return Per-stage results
+     * @throws std::runtime_error if the pipeline is empty or cannot be started
+     */
+    [[nodiscard]] PipelineResult run(std::string_view stdin_data = {}) const;
+
+    /**
+     * @brief Run the pipeline and check every stage's expectations
+     *
+     * Each mismatching stage is reported as a separate Google Test failure.
+     *
+     * @param stdin_data Data fed to the first stage
+     * @return Per-stage results
+     */
+    PipelineResult assert_output(std::string_view stdin_data = {}) const;
+
+    /**
+     * @brief Get the number of stages
+     * @return Stage count
+     */
+    [[nodiscard]] size_t size() const noexcept { return stages_.size(); }
+
+private:
+    struct Stage {
+        std::reference_wrapper<const AsmTestRunner> runner;
+        TestInput args;
+        bool tapped{false};
+        std::optional<ExpectedOutput> expected;
+    };
+
+    std::vector<Stage> stages_;
+
+    Stage& stage_at(size_t stage);
+};
+
+} // namespace x86_asm_test
@@ -0,0 +1,363 @@
+/**
+ * @file x86_asm_prefix.cpp
+ * @brief Implementation of prefix-sharing execution under ptrace
+ */
+
+#include "x86_asm_prefix.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <sys/ptrace.h>
+#include <sys/uio.h>
+#include <sys/user.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <format>
+
+namespace x86_asm_test {
+
+namespace {
+
+constexpr uint64_t kSysRead = 0;
+constexpr uint64_t kSysWrite = 1;
+constexpr uint64_t kSysFork = 57;
+constexpr uint64_t kSyscallLength = 2;          // "syscall" is 0f 05
+constexpr uint64_t kMaxWrite = uint64_t{1} << 24;
+
+/// One traced process and the inputs it still stands for
+struct Tracee {
+    enum class Pending : uint8_t { None, Emulated, Fork };
+
+    std::vector<size_t> inputs;        ///< Inputs that agree on everything read so far
+    uint64_t offset{0};                ///< stdin bytes consumed
+    std::string stdout_output;
+    std::string stderr_output;
+    bool in_syscall{false};            ///< Between syscall-entry and syscall-exit stops
+    bool awaiting_start{false};        ///< Forked, first stop not handled yet
+    bool restart_read{false};          ///< Injected fork: repeat the interrupted read
+    Pending pending{Pending::None};
+    int64_t result{0};                 ///< Return value of an emulated syscall
+    std::vector<size_t> child_inputs;  ///< Inputs handed to the child of an injected fork
+};
+
+/// Runs one group of inputs sharing the same argv
+class PrefixGroupRun {
+public:
+    PrefixGroupRun(const AsmTestRunner& runner, std::span<const TestInput> inputs,
+                   PrefixRunReport& report)
+        : runner_{runner}, inputs_{inputs}, report_{report} {}
+
+    /// Run the group; returns inputs that could not be forked off and need a plain run
+    std::vector<size_t> run(std::vector<size_t> group);
+
+private:
+    const AsmTestRunner& runner_;
+    std::span<const TestInput> inputs_;
+    PrefixRunReport& report_;
+    std::unordered_map<pid_t, Tracee> tracees_;
+    std::unordered_set<pid_t> early_stops_;
+    std::vector<size_t> fallback_;
+    std::chrono::steady_clock::time_point start_;
+    std::atomic<bool> timed_out_{false};
+
+    pid_t spawn(const TestInput& input);
+    void on_syscall_stop(pid_t pid, Tracee& tracee);
+    void start_child(pid_t pid, Tracee& tracee);
+    void finish(const Tracee& tracee, int status);
+
+    [[nodiscard]] std::string_view stdin_of(size_t index) const {
+        const auto& data = inputs_[index].stdin_data();
+        return data ? std::string_view{*data} : std::string_view{};
+    }
+};
+
+pid_t PrefixGroupRun::spawn(const TestInput& input) {
+    const auto& config = runner_.config();
+
+    std::vector<char*> exec_args;
+    input.fill_argv(runner_.executable_path().c_str(), exec_args);
+
+    bool change_directory = !detail::is_current_directory(config.working_directory);
+    int null_fd = open("/dev/null", O_RDWR | O_CLOEXEC);
+    if (null_fd < 0) {
+        throw std::runtime_error("Failed to open /dev/null");
+    }
+
+    pid_t pid = fork();
+    if (pid == -1) {
+        close(null_fd);
+        throw std::runtime_error("Fork failed for prefix-shared execution");
+    }
+
+    if (pid == 0) {
+        // Child process: its own process group, so the tracer can wait on the whole tree
+        setpgid(0, 0);
+        dup2(null_fd, STDIN_FILENO);
+        dup2(null_fd, STDOUT_FILENO);
+        dup2(null_fd, STDERR_FILENO);
+
+        if (change_directory && chdir(config.working_directory.c_str()) != 0) {
+            _exit(127);
+        }
+
+        ptrace(PTRACE_TRACEME, 0, nullptr, nullptr);
+        execv(runner_.executable_path().c_str(), exec_args.data());
+        _exit(127);
+    }
+
+    close(null_fd);
+    setpgid(pid, pid);
+    return pid;
+}
+
+std::vector<size_t> PrefixGroupRun::run(std::vector<size_t> group) {
+    start_ = std::chrono::steady_clock::now();
+    pid_t root = spawn(inputs_[group.front()]);
+    ++report_.processes;
+
+    Tracee root_tracee;
+    root_tracee.inputs = std::move(group);
+
+    // The child stops with SIGTRAP after a successful exec
+    int status = 0;
+    waitpid(root, &status, 0);
+    if (!WIFSTOPPED(status)) {
+        finish(root_tracee, status);
+        return {};
+    }
+    ptrace(PTRACE_SETOPTIONS, root, nullptr,
+           PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACEFORK | PTRACE_O_EXITKILL);
+    tracees_.emplace(root, std::move(root_tracee));
+
+    // Processes that never make a syscall cannot be stopped by the loop below.
+    // Once the last member is reaped the group id may be recycled, so the
+    // group is only signalled while some member is still unreaped.
+    std::mutex watchdog_mutex;
+    std::condition_variable_any watchdog_cv;
+    bool group_alive = true;
+    auto group_reaped = [&] {
+        std::lock_guard lock(watchdog_mutex);
+        group_alive = false;
+    };
+    std::jthread watchdog([&, deadline = start_ + runner_.config().timeout](std::stop_token stop) {
+        std::unique_lock lock(watchdog_mutex);
+        if (!watchdog_cv.wait_until(lock, stop, deadline, [] { return false; }) &&
+            !stop.stop_requested() && group_alive) {
+            timed_out_ = true;
+            kill(-root, SIGKILL);
+        }
+    });
+
+    ptrace(PTRACE_SYSCALL, root, nullptr, 0);
+
+    while (!tracees_.empty()) {
+        pid_t pid = waitpid(-root, &status, __WALL);
+        if (pid < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        auto it = tracees_.find(pid);
+        if (WIFEXITED(status) || WIFSIGNALED(status)) {
+            if (it != tracees_.end()) {
+                finish(it->second, status);
+                tracees_.erase(it);
+                if (tracees_.empty()) group_reaped();
+            }
+            continue;
+        }
+        if (!WIFSTOPPED(status)) continue;
+
+        if (it == tracees_.end()) {
+            // A new child can report its first stop before the parent's fork event
+            early_stops_.insert(pid);
+            continue;
+        }
+
+        Tracee& tracee = it->second;
+        int signal = WSTOPSIG(status);
+        int event = status >> 16;
+
+        if (event == PTRACE_EVENT_FORK) {
+            unsigned long child_pid = 0;
+            ptrace(PTRACE_GETEVENTMSG, pid, nullptr, &child_pid);
+
+            Tracee child;
+            child.awaiting_start = true;
+            if (tracee.pending == Tracee::Pending::Fork) {
+                child.inputs = std::move(tracee.child_inputs);
+                child.offset = tracee.offset;
+                child.stdout_output = tracee.stdout_output;
+                child.stderr_output = tracee.stderr_output;
+                child.restart_read = true;
+                ++report_.forks;
+            }
+            auto& registered = tracees_.insert_or_assign(static_cast<pid_t>(child_pid), std::move(child)).first->second;
+            if (early_stops_.erase(static_cast<pid_t>(child_pid)) != 0) {
+                start_child(static_cast<pid_t>(child_pid), registered);
+            }
+            ptrace(PTRACE_SYSCALL, pid, nullptr, 0);
+        } else if (signal == (SIGTRAP | 0x80)) {
+            on_syscall_stop(pid, tracee);
+            ptrace(PTRACE_SYSCALL, pid, nullptr, 0);
+        } else if (signal == SIGSTOP && tracee.awaiting_start) {
+            start_child(pid, tracee);
+        } else {
+            // Deliver signals raised by the program itself
+            ptrace(PTRACE_SYSCALL, pid, nullptr, event != 0 ? 0 : signal);
+        }
+    }
+
+    group_reaped();
+    watchdog.request_stop();
+    return std::move(fallback_);
+}
+
+void PrefixGroupRun::start_child(pid_t pid, Tracee& tracee) {
+    tracee.awaiting_start = false;
+    if (tracee.restart_read) {
+        // The child resumes after the injected fork: repeat the read it interrupted
+        user_regs_struct regs{};
+        ptrace(PTRACE_GETREGS, pid, nullptr, &regs);
+        regs.rip -= kSyscallLength;
+        regs.rax = kSysRead;
+        ptrace(PTRACE_SETREGS, pid, nullptr, &regs);
+        tracee.restart_read = false;
+    }
+    ptrace(PTRACE_SYSCALL, pid, nullptr, 0);
+}
+
+void PrefixGroupRun::on_syscall_stop(pid_t pid, Tracee& tracee) {
+    user_regs_struct regs{};
+    ptrace(PTRACE_GETREGS, pid, nullptr, &regs);
+
+    if (tracee.in_syscall) {
+        // Syscall exit
+        tracee.in_syscall = false;
+        if (tracee.pending == Tracee::Pending::Emulated) {
+            regs.rax = static_cast<uint64_t>(tracee.result);
+            ptrace(PTRACE_SETREGS, pid, nullptr, &regs);
+        } else if (tracee.pending == Tracee::Pending::Fork) {
+            if (static_cast<int64_t>(regs.rax) < 0) {
+                // fork failed: those inputs get a plain run instead
+                fallback_.insert(fallback_.end(), tracee.child_inputs.begin(), tracee.child_inputs.end());
+                tracee.child_inputs.clear();
+            }
+            regs.rip -= kSyscallLength;
+            regs.rax = kSysRead;
+            ptrace(PTRACE_SETREGS, pid, nullptr, &regs);
+        }
+        tracee.pending = Tracee::Pending::None;
+        return;
+    }
+
+    // Syscall entry
+    tracee.in_syscall = true;
+    tracee.pending = Tracee::Pending::None;
+
+    if (regs.orig_rax == kSysRead && regs.rdi == STDIN_FILENO) {
+        auto chunk_of = [&](size_t index) {
+            auto data = stdin_of(index);
+            return data.substr(std::min<uint64_t>(tracee.offset, data.size()), regs.rdx);
+        };
+
+        std::string_view chunk = chunk_of(tracee.inputs.front());
+        std::vector<size_t> same, different;
+        for (size_t index : tracee.inputs) {
+            (chunk_of(index) == chunk ? same : different).push_back(index);
+        }
+
+        if (!different.empty()) {
+            // Inputs diverge here: turn this read into a fork and retry it on both sides
+            tracee.inputs = std::move(same);
+            tracee.child_inputs = std::move(different);
+            tracee.pending = Tracee::Pending::Fork;
+            regs.orig_rax = kSysFork;
+        } else {
+            struct iovec local{const_cast<char*>(chunk.data()), chunk.size()};
+            struct iovec remote{reinterpret_cast<void*>(regs.rsi), chunk.size()};
+            bool ok = chunk.empty() || process_vm_writev(pid, &local, 1, &remote, 1, 0) ==
+                                           static_cast<ssize_t>(chunk.size());
+            tracee.result = ok ? static_cast<int64_t>(chunk.size()) : -EFAULT;
+            if (ok) {
+                tracee.offset += chunk.size();
+                report_.stdin_bytes_read += chunk.size();
+            }
+            tracee.pending = Tracee::Pending::Emulated;
+            regs.orig_rax = UINT64_MAX;  // skip the real syscall
+        }
+        ptrace(PTRACE_SETREGS, pid, nullptr, &regs);
+    } else if (regs.orig_rax == kSysWrite && (regs.rdi == STDOUT_FILENO || regs.rdi == STDERR_FILENO)) {
+        std::string buffer(std::min<uint64_t>(regs.rdx, kMaxWrite), '\0');
+        struct iovec local{buffer.data(), buffer.size()};
+        struct iovec remote{reinterpret_cast<void*>(regs.rsi), buffer.size()};
+        ssize_t copied = buffer.empty() ? 0 : process_vm_readv(pid, &local, 1, &remote, 1, 0);
+        if (copied >= 0) {
+            auto& sink = regs.rdi == STDOUT_FILENO ? tracee.stdout_output : tracee.stderr_output;
+            sink.append(buffer.data(), static_cast<size_t>(copied));
+            tracee.result = copied;
+        } else {
+            tracee.result = -EFAULT;
+        }
+        tracee.pending = Tracee::Pending::Emulated;
+        regs.orig_rax = UINT64_MAX;
+        ptrace(PTRACE_SETREGS, pid, nullptr, &regs);
+    }
+}
+
+void PrefixGroupRun::finish(const Tracee& tracee, int status) {
+    ExecutionResult result;
+    if (WIFEXITED(status)) {
+        result.exit_code = WEXITSTATUS(status);
+    } else if (WIFSIGNALED(status)) {
+        result.exit_code = 128 + WTERMSIG(status);
+    }
+    result.timed_out = timed_out_;
+    result.stdout_output = tracee.stdout_output;
+    if (runner_.config().capture_stderr) {
+        result.stderr_output = tracee.stderr_output;
+    }
+    result.execution_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_
+    );
+
+    for (size_t index : tracee.inputs) {
+        report_.results[index] = result;
+        report_.stdin_bytes_consumed += tracee.offset;
+    }
+}
+
+} // namespace
+
+PrefixRunReport run_shared_prefix(const AsmTestRunner& runner, std::span<const TestInput> inputs) {
+    PrefixRunReport report;
+    report.results.resize(inputs.size());
+
+    // Inputs can only share a process if their argv is identical
+    std::map<std::vector<std::string>, std::vector<size_t>> groups;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        auto args = inputs[i].args();
+        groups[std::vector<std::string>(args.begin(), args.end())].push_back(i);
+    }
+
+    for (auto& [args, group] : groups) {
+        PrefixGroupRun run(runner, inputs, report);
+        for (size_t index : run.run(std::move(group))) {
+            report.results[index] = runner.run_test(inputs[index]);
+            ++report.processes;
+        }
+    }
+    return report;
+}
+
+} // namespace x86_asm_test
@@ -0,0 +1,62 @@
+/**
+ * @file x86_asm_prefix.h
+ * @brief Running inputs with common stdin prefixes as a tree of forked processes
+ */
+
+#pragma once
+
+#include "x86_asm_test.h"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace x86_asm_test {
+
+/**
+ * @struct PrefixRunReport
+ * @brief Results of run_shared_prefix() and how much work was shared
+ */
+struct PrefixRunReport {
+    std::vector<ExecutionResult> results;  ///< One per input, in input order
+    size_t processes{0};                   ///< Programs started with execv (one per distinct argv)
+    size_t forks{0};                       ///< Processes split where inputs diverged
+    uint64_t stdin_bytes_read{0};          ///< stdin bytes actually delivered to processes
+    uint64_t stdin_bytes_consumed{0};      ///< stdin bytes consumed summed over inputs
+
+    /**
+     * @brief Fraction of stdin reads saved by sharing prefixes
+     * @return 1 - read/consumed, 0 when nothing was consumed
+     */
+    [[nodiscard]] double sharing() const noexcept {
+        return stdin_bytes_consumed == 0
+            ? 0.0
+            : 1.0 - static_cast<double>(stdin_bytes_read) / static_cast<double>(stdin_bytes_consumed);
+    }
+};
+
+/**
+ * @brief Run inputs so that work on a common stdin prefix happens once
+ *
+ * Inputs with identical arguments start in one process traced with ptrace.
+ * The tracer serves read(2) on stdin and captures write(2) on stdout and
+ * stderr itself. When the inputs still attached to a process would receive
+ * different bytes from a read, the tracer makes the process fork at that
+ * read and hands each side a subset of the inputs, so everything before
+ * the divergence point executes once.
+ *
+ * Intended for single-threaded programs that do their I/O with read/write
+ * on descriptors 0-2 and do not fork themselves, such as the ones in
+ * test_programs/. The runner's timeout applies to each argument group as a
+ * whole. Results do not use the result cache.
+ *
+ * @param runner Runner providing the executable and configuration
+ * @param inputs Inputs to run
+ * @return Per-input results and sharing statistics
+ * @throws std::runtime_error if a process cannot be started
+ */
+[[nodiscard]] PrefixRunReport run_shared_prefix(
+    const AsmTestRunner& runner,
+    std::span<const TestInput> inputs
+);
+
+} // namespace x86_asm_test
@@ -0,0 +1,311 @@
+/**
+ * @file x86_asm_results.cpp
+ * @brief Implementation of the streaming result writer
+ */
+
+#include "x86_asm_results.h"
+#include <cstdio>
+#include <format>
+#include <iterator>
+#include <stdexcept>
+
+namespace x86_asm_test {
+
+namespace {
+
+void append_json_string(std::string& out, std::string_view text) {
+    out += '"';
+    for (char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    std::format_to(std::back_inserter(out), "\\u{:04x}", static_cast<unsigned>(c));
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+void append_xml_text(std::string& out, std::string_view text) {
+    for (char c : text) {
+        switch (c) {
+            case '<': out += "&lt;"; break;
+            case '>': out += "&gt;"; break;
+            case '&': out += "&amp;"; break;
+            case '"': out += "&quot;"; break;
+            case '\n': out += "&#10;"; break;
+            default:
+                // Other control characters are not allowed in XML 1.0
+                out += static_cast<unsigned char>(c) < 0x20 && c != '\t' ? '?' : c;
+        }
+    }
+}
+
+double microseconds(RunInfo::Clock::duration elapsed) {
+    return std::chrono::duration<double, std::micro>(elapsed).count();
+}
+
+/**
+ * @brief Timing breakdown and resource usage of a run as (name, value) pairs
+ */
+template<typename Emit>
+void for_each_metric(const RunInfo& run, RunInfo::Clock::time_point finished, const ExecutionResult& result,
+                     Emit emit) {
+    emit("total_us", microseconds(finished - run.queued));
+    if (run.executed != RunInfo::Clock::time_point{}) {
+        emit("queued_us", microseconds(run.spawned - run.queued));
+        emit("spawn_us", microseconds(run.executed - run.spawned));
+        if (run.output_chunks > 0) {
+            emit("first_byte_us", microseconds(run.first_output - run.executed));
+        }
+        emit("exec_us", microseconds(run.exited - run.executed));
+        emit("drain_us", microseconds(finished - run.exited));
+        emit("user_us", static_cast<double>(run.usage.user_time.count()));
+        emit("sys_us", static_cast<double>(run.usage.system_time.count()));
+        emit("max_rss_kb", static_cast<double>(run.usage.max_rss_kb));
+        emit("minor_faults", static_cast<double>(run.usage.minor_faults));
+        emit("major_faults", static_cast<double>(run.usage.major_faults));
+        emit("voluntary_switches", static_cast<double>(run.usage.voluntary_switches));
+        emit("involuntary_switches", static_cast<double>(run.usage.involuntary_switches));
+    }
+    emit("stdout_bytes", static_cast<double>(result.stdout_output.size()));
+    emit("stderr_bytes", static_cast<double>(result.stderr_output.size()));
+    emit("output_chunks", static_cast<double>(run.output_chunks));
+}
+
+} // namespace
+
+ResultStreamWriter::ResultStreamWriter(ResultStreamOptions options) : options_(std::move(options)) {
+    auto open = [&](Output& output, const std::filesystem::path& path) {
+        if (path.empty()) return;
+        output.path = path;
+        output.file.open(path, std::ios::binary | std::ios::trunc);
+        if (!output.file) {
+            throw std::runtime_error(std::format("Cannot open result stream {}", path.string()));
+        }
+        output.buffer.reserve(options_.buffer_size);
+    };
+    open(ndjson_, options_.ndjson);
+    open(junit_, options_.junit);
+    append(junit_, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<testsuites name=\"x86_asm_test\">\n");
+}
+
+ResultStreamWriter::~ResultStreamWriter() {
+    try {
+        finish();
+    } catch (...) {
+        // Destructors must not throw; the files may be truncated
+    }
+}
+
+void ResultStreamWriter::append(Output& output, std::string_view text) {
+    if (!output.file.is_open()) return;
+    if (output.buffer.size() + text.size() > options_.buffer_size) {
+        flush(output);
+    }
+    if (text.size() > options_.buffer_size) {
+        output.file.write(text.data(), static_cast<std::streamsize>(text.size()));
+        check(output);
+    } else {
+        output.buffer += text;
+    }
+}
+
+void ResultStreamWriter::flush(Output& output) {
+    if (!output.file.is_open()) return;
+    output.file.write(output.buffer.data(), static_cast<std::streamsize>(output.buffer.size()));
+    output.file.flush();
+    output.buffer.clear();
+    check(output);
+}
+
+void ResultStreamWriter::check(Output& output) {
+    if (output.file) return;
+    // Stop writing this file rather than throw into a callback
+    output.file.close();
+    output.buffer.clear();
+    if (!failed_) {
+        failed_ = true;
+        std::fprintf(stderr, "Cannot write result stream %s\n", output.path.c_str());
+    }
+}
+
+void ResultStreamWriter::begin_test(std::string_view suite, std::string_view name) {
+    std::lock_guard lock(mutex_);
+    if (finished_) return;
+    suite_ = suite;
+    test_ = name;
+    test_id_ = std::format("{}.{}", suite_, test_);
+    in_test_ = true;
+    test_runs_ = 0;
+    test_output_.clear();
+    test_output_dropped_ = 0;
+
+    std::string xml = "  <testsuite name=\"";
+    append_xml_text(xml, test_id_);
+    xml += "\">\n";
+    append(junit_, xml);
+}
+
+void ResultStreamWriter::end_test(std::string_view status, std::chrono::milliseconds elapsed,
+                                  std::string_view failure) {
+    std::lock_guard lock(mutex_);
+    if (finished_ || !in_test_) return;
+
+    std::string line = R"({"type":"test","suite":)";
+    append_json_string(line, suite_);
+    line += R"(,"name":)";
+    append_json_string(line, test_);
+    line += R"(,"status":)";
+    append_json_string(line, status);
+    std::format_to(std::back_inserter(line), R"(,"runs":{},"elapsed_ms":{}}})" "\n", test_runs_, elapsed.count());
+    append(ndjson_, line);
+
+    std::string xml = "    <testcase classname=\"";
+    append_xml_text(xml, suite_);
+    xml += "\" name=\"";
+    append_xml_text(xml, test_);
+    std::format_to(std::back_inserter(xml), "\" time=\"{:.3f}\">\n", static_cast<double>(elapsed.count()) / 1000.0);
+    std::format_to(std::back_inserter(xml), "      <properties><property name=\"runs\" value=\"{}\"/></properties>\n",
+                   test_runs_);
+    if (status == "skipped") {
+        xml += "      <skipped/>\n";
+    } else if (status == "failed") {
+        xml += "      <failure message=\"";
+        append_xml_text(xml, failure.substr(0, failure.find('\n')));
+        xml += "\">";
+        append_xml_text(xml, failure);
+        xml += "</failure>\n";
+    }
+    if (!test_output_.empty() || test_output_dropped_ > 0) {
+        xml += "      <system-out>";
+        xml += test_output_;
+        if (test_output_dropped_ > 0) {
+            std::format_to(std::back_inserter(xml), "{} more runs not shown\n", test_output_dropped_);
+        }
+        xml += "</system-out>\n";
+    }
+    xml += "    </testcase>\n";
+    xml += "  </testsuite>\n";
+    append(junit_, xml);
+    in_test_ = false;
+
+    flush(ndjson_);
+    flush(junit_);
+}
+
+void ResultStreamWriter::finish() {
+    std::lock_guard lock(mutex_);
+    if (finished_) return;
+    finished_ = true;
+    if (in_test_) {
+        append(junit_, "  </testsuite>\n");
+    }
+    append(junit_, "</testsuites>\n");
+    flush(ndjson_);
+    flush(junit_);
+}
+
+uint64_t ResultStreamWriter::runs_written() const {
+    std::lock_guard lock(mutex_);
+    return runs_;
+}
+
+bool ResultStreamWriter::failed() const {
+    std::lock_guard lock(mutex_);
+    return failed_;
+}
+
+void ResultStreamWriter::on_run(const RunInfo& run, Clock::time_point at, const ExecutionResult& result) noexcept {
+    // Reused per thread, so steady-state runs format without allocating
+    thread_local std::string line;
+    thread_local std::string xml;
+    try {
+        std::lock_guard lock(mutex_);
+        if (finished_) return;
+
+        line.clear();
+        line += R"({"type":"run","test":)";
+        if (in_test_) {
+            append_json_string(line, test_id_);
+        } else {
+            line += "null";
+        }
+        std::format_to(std::back_inserter(line), R"(,"run":{},"async":{},"args":[)", run.id, run.asynchronous);
+        bool first = true;
+        for (auto arg : run.input->args()) {
+            if (!first) line += ',';
+            append_json_string(line, arg);
+            first = false;
+        }
+        std::format_to(std::back_inserter(line), R"(],"exit_code":{},"timed_out":{},"from_cache":{})",
+                       result.exit_code, result.timed_out, result.from_cache);
+        for_each_metric(run, at, result, [&](const char* name, double value) {
+            std::format_to(std::back_inserter(line), R"(,"{}":{})", name, value);
+        });
+        line += "}\n";
+        append(ndjson_, line);
+
+        if (in_test_ && junit_.file.is_open()) {
+            xml.clear();
+            std::format_to(std::back_inserter(xml), "run {}:", run.id);
+            for (auto arg : run.input->args()) {
+                xml += ' ';
+                append_xml_text(xml, arg);
+            }
+            std::format_to(std::back_inserter(xml), " exit_code={}", result.exit_code);
+            for_each_metric(run, at, result, [&](const char* name, double value) {
+                std::format_to(std::back_inserter(xml), " {}={}", name, value);
+            });
+            xml += '\n';
+            if (test_output_.size() + xml.size() <= options_.buffer_size) {
+                test_output_ += xml;
+            } else {
+                ++test_output_dropped_;
+            }
+        }
+        ++runs_;
+        ++test_runs_;
+    } catch (...) {
+        // Writing results must never fail a test; the record is dropped
+    }
+}
+
+ResultStreamListener::ResultStreamListener(std::shared_ptr<ResultStreamWriter> writer) : writer_(std::move(writer)) {}
+
+void ResultStreamListener::OnTestStart(const ::testing::TestInfo& test_info) {
+    writer_->begin_test(test_info.test_suite_name(), test_info.name());
+}
+
+void ResultStreamListener::OnTestEnd(const ::testing::TestInfo& test_info) {
+    const auto& result = *test_info.result();
+    std::string failure;
+    for (int i = 0; i < result.total_part_count(); ++i) {
+        const auto& part = result.GetTestPartResult(i);
+        if (!part.failed()) continue;
+        failure += std::format("{}:{}: {}\n", part.file_name() ? part.file_name() : "unknown",
+                               part.line_number(), part.summary());
+    }
+    auto status = result.Skipped() ? "skipped" : result.Failed() ? "failed" : "passed";
+    writer_->end_test(status, std::chrono::milliseconds{result.elapsed_time()}, failure);
+}
+
+void ResultStreamListener::OnTestProgramEnd(const ::testing::UnitTest&) {
+    remove_run_observer(writer_.get());
+    writer_->finish();
+}
+
+std::shared_ptr<ResultStreamWriter> enable_result_stream(ResultStreamOptions options) {
+    auto writer = std::make_shared<ResultStreamWriter>(std::move(options));
+    add_run_observer(writer);
+    ::testing::UnitTest::GetInstance()->listeners().Append(new ResultStreamListener(writer));
+    return writer;
+}
+
+} // namespace x86_asm_test
@@ -0,0 +1,167 @@
+/**
+ * @file x86_asm_results.h
+ * @brief Streaming NDJSON and JUnit XML records of every program run
+ */
+
+#pragma once
+
+#include "x86_asm_test.h"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace x86_asm_test {
+
+/**
+ * @struct ResultStreamOptions
+ * @brief Destinations and buffering of a ResultStreamWriter
+ */
+struct ResultStreamOptions {
+    std::filesystem::path ndjson;        ///< One JSON object per line; empty for none
+    std::filesystem::path junit;         ///< JUnit XML; empty for none
+    size_t buffer_size{64 * 1024};       ///< Bytes buffered per file before they are written
+};
+
+/**
+ * @class ResultStreamWriter
+ * @brief RunObserver writing a record of every run as it finishes
+ *
+ * Each finished run becomes one NDJSON line with:
+ * - its arguments, exit code, timeout and cache flags
+ * - a timing breakdown: queued, spawn, first byte, exec, drain and total (microseconds)
+ * - the child's rusage: CPU times, peak RSS, page faults and context switches
+ * - output sizes and chunk counts
+ *
+ * After each Google Test test, a "test" line follows with its outcome.
+ * Records go into a buffer of at most buffer_size bytes per file, which
+ * is written out when full and at the end of each test.
+ *
+ * The JUnit file has one <testsuite> per Google Test test holding the
+ * <testcase> of the test itself: its failures, its number of runs as a
+ * property, and one <system-out> line per run with the metrics. At most
+ * buffer_size bytes of run lines are kept per test, so memory stays
+ * bounded however many runs there are; the count of the others is noted.
+ * Runs outside any test only appear in the NDJSON file.
+ *
+ * Write errors never throw out of the writer, since it is driven from
+ * run and Google Test callbacks: the first one is reported on stderr,
+ * failed() becomes true and that file receives no further records.
+ */
+class ResultStreamWriter : public RunObserver {
+public:
+    /**
+     * @brief Open the output files
+     * @param options Destinations and buffer size
+     * @throws std::runtime_error if a file cannot be opened
+     */
+    explicit ResultStreamWriter(ResultStreamOptions options);
+
+    ResultStreamWriter(const ResultStreamWriter&) = delete;
+    ResultStreamWriter& operator=(const ResultStreamWriter&) = delete;
+
+    /**
+     * @brief Finish the files
+     */
+    ~ResultStreamWriter() override;
+
+    /**
+     * @brief Attribute the following runs to a test
+     * @param suite Test suite name
+     * @param name Test name
+     */
+    void begin_test(std::string_view suite, std::string_view name);
+
+    /**
+     * @brief Record the outcome of the current test and write out the buffers
+     * @param status "passed", "failed" or "skipped"
+     * @param elapsed Test duration
+     * @param failure Failure messages (for JUnit), empty if none
+     */
+    void end_test(std::string_view status, std::chrono::milliseconds elapsed, std::string_view failure = {});
+
+    /**
+     * @brief Close the JUnit document and write out everything buffered
+     *
+     * Later runs are ignored.
+     */
+    void finish();
+
+    /**
+     * @brief Get the number of runs written
+     * @return Run records so far
+     */
+    [[nodiscard]] uint64_t runs_written() const;
+
+    /**
+     * @brief Check whether writing an output file failed
+     * @return true after the first write error
+     */
+    [[nodiscard]] bool failed() const;
+
+    void on_run(const RunInfo& run, Clock::time_point at, const ExecutionResult& result) noexcept override;
+
+private:
+    struct Output {
+        std::filesystem::path path;
+        std::ofstream file;
+        std::string buffer;
+    };
+
+    void append(Output& output, std::string_view text);
+    void flush(Output& output);
+    void check(Output& output);
+
+    ResultStreamOptions options_;
+    mutable std::mutex mutex_;
+    Output ndjson_;
+    Output junit_;
+    std::string suite_;
+    std::string test_;
+    std::string test_id_;                ///< "suite.test", formatted once per test
+    bool in_test_{false};
+    bool finished_{false};
+    bool failed_{false};
+    uint64_t runs_{0};
+    uint64_t test_runs_{0};
+    std::string test_output_;            ///< JUnit <system-out> lines of the current test's runs
+    uint64_t test_output_dropped_{0};    ///< Runs of the current test left out of test_output_
+};
+
+/**
+ * @class ResultStreamListener
+ * @brief Google Test listener feeding test boundaries to a ResultStreamWriter
+ */
+class ResultStreamListener : public ::testing::EmptyTestEventListener {
+public:
+    /**
+     * @brief Create a listener
+     * @param writer Writer, registered as a run observer until the program ends
+     */
+    explicit ResultStreamListener(std::shared_ptr<ResultStreamWriter> writer);
+
+    void OnTestStart(const ::testing::TestInfo& test_info) override;
+    void OnTestEnd(const ::testing::TestInfo& test_info) override;
+    void OnTestProgramEnd(const ::testing::UnitTest& unit_test) override;
+
+private:
+    std::shared_ptr<ResultStreamWriter> writer_;
+};
+
+/**
+ * @brief Stream a record of every run of the test program
+ *
+ * Call after ::testing::InitGoogleTest(). Registers a ResultStreamWriter
+ * as a run observer and appends a ResultStreamListener that finishes
+ * the files when the program ends.
+ *
+ * @param options Destinations and buffer size
+ * @return The writer
+ * @throws std::runtime_error if a file cannot be opened
+ */
+std::shared_ptr<ResultStreamWriter> enable_result_stream(ResultStreamOptions options);
+
+} // namespace x86_asm_test
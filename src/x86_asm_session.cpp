@@ -0,0 +1,399 @@
+/**
+ * @file x86_asm_session.cpp
+ * @brief Implementation of interactive sessions
+ */
+
+#include "x86_asm_session.h"
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <cerrno>
+#include <format>
+
+namespace x86_asm_test {
+
+namespace {
+
+void close_fd(int& fd) noexcept {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+int poll_timeout(AsmSession::Clock::time_point deadline) {
+    auto remaining = deadline - AsmSession::Clock::now();
+    if (remaining <= AsmSession::Clock::duration::zero()) {
+        return 0;
+    }
+    // Round up so sub-millisecond waits do not degenerate into busy polling
+    auto milliseconds = std::chrono::ceil<std::chrono::milliseconds>(remaining).count();
+    return static_cast<int>(std::min<int64_t>(milliseconds, INT32_MAX));
+}
+
+} // namespace
+
+LatencyStats LatencyStats::from_samples(std::vector<std::chrono::microseconds> samples) {
+    LatencyStats stats;
+    if (samples.empty()) {
+        return stats;
+    }
+    std::ranges::sort(samples);
+
+    // Nearest-rank percentile
+    auto percentile = [&](size_t p) {
+        size_t rank = (p * samples.size() + 99) / 100;
+        return samples[std::max<size_t>(rank, 1) - 1];
+    };
+
+    stats.count = samples.size();
+    stats.min = samples.front();
+    stats.p50 = percentile(50);
+    stats.p90 = percentile(90);
+    stats.p99 = percentile(99);
+    stats.max = samples.back();
+    stats.mean = std::accumulate(samples.begin(), samples.end(), std::chrono::microseconds{0}) /
+                 static_cast<int64_t>(samples.size());
+    return stats;
+}
+
+std::string LatencyStats::summary() const {
+    return std::format("{} requests: min {}us p50 {}us p90 {}us p99 {}us max {}us mean {}us",
+                       count, min.count(), p50.count(), p90.count(), p99.count(), max.count(),
+                       mean.count());
+}
+
+AsmSession::AsmSession(const AsmTestRunner& runner, const TestInput& args)
+    : capture_stderr_{runner.config().capture_stderr} {
+    const auto& config = runner.config();
+
+    int stdin_pipe[2], stdout_pipe[2], stderr_pipe[2];
+    if (pipe2(stdin_pipe, O_CLOEXEC) == -1) {
+        throw std::runtime_error("Failed to create pipes");
+    }
+    if (pipe2(stdout_pipe, O_CLOEXEC) == -1) {
+        ::close(stdin_pipe[0]); ::close(stdin_pipe[1]);
+        throw std::runtime_error("Failed to create pipes");
+    }
+    if (pipe2(stderr_pipe, O_CLOEXEC) == -1) {
+        ::close(stdin_pipe[0]); ::close(stdin_pipe[1]);
+        ::close(stdout_pipe[0]); ::close(stdout_pipe[1]);
+        throw std::runtime_error("Failed to create pipes");
+    }
+
+    std::vector<char*> exec_args;
+    args.fill_argv(runner.executable_path().c_str(), exec_args);
+
+    // Resolved before fork: the child must not allocate
+    bool change_directory = !detail::is_current_directory(config.working_directory);
+
+    started_ = Clock::now();
+    pid_t pid = fork();
+    if (pid == -1) {
+        ::close(stdin_pipe[0]); ::close(stdin_pipe[1]);
+        ::close(stdout_pipe[0]); ::close(stdout_pipe[1]);
+        ::close(stderr_pipe[0]); ::close(stderr_pipe[1]);
+        throw std::runtime_error("Fork failed");
+    }
+
+    if (pid == 0) {
+        dup2(stdin_pipe[0], STDIN_FILENO);
+        dup2(stdout_pipe[1], STDOUT_FILENO);
+        dup2(stderr_pipe[1], STDERR_FILENO);
+
+        if (change_directory && chdir(config.working_directory.c_str()) != 0) {
+            perror("chdir");
+            _exit(127);
+        }
+
+        execv(runner.executable_path().c_str(), exec_args.data());
+        perror("execv");
+        _exit(127);
+    }
+
+    ::close(stdin_pipe[0]);
+    ::close(stdout_pipe[1]);
+    ::close(stderr_pipe[1]);
+    pid_ = pid;
+    stdin_fd_ = stdin_pipe[1];
+    stdout_fd_ = stdout_pipe[0];
+    stderr_fd_ = stderr_pipe[0];
+    for (int fd : {stdin_fd_, stdout_fd_, stderr_fd_}) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+    pid_fd_ = static_cast<int>(syscall(SYS_pidfd_open, pid_, 0));
+}
+
+AsmSession::AsmSession(AsmSession&& other) noexcept
+    : pid_{std::exchange(other.pid_, -1)},
+      stdin_fd_{std::exchange(other.stdin_fd_, -1)},
+      stdout_fd_{std::exchange(other.stdout_fd_, -1)},
+      stderr_fd_{std::exchange(other.stderr_fd_, -1)},
+      pid_fd_{std::exchange(other.pid_fd_, -1)},
+      capture_stderr_{other.capture_stderr_},
+      started_{other.started_},
+      partial_{std::move(other.partial_)},
+      lines_{std::move(other.lines_)},
+      stderr_output_{std::move(other.stderr_output_)},
+      requests_{std::move(other.requests_)},
+      latencies_{std::move(other.latencies_)} {}
+
+AsmSession& AsmSession::operator=(AsmSession&& other) noexcept {
+    if (this != &other) {
+        release();
+        pid_ = std::exchange(other.pid_, -1);
+        stdin_fd_ = std::exchange(other.stdin_fd_, -1);
+        stdout_fd_ = std::exchange(other.stdout_fd_, -1);
+        stderr_fd_ = std::exchange(other.stderr_fd_, -1);
+        pid_fd_ = std::exchange(other.pid_fd_, -1);
+        capture_stderr_ = other.capture_stderr_;
+        started_ = other.started_;
+        partial_ = std::move(other.partial_);
+        lines_ = std::move(other.lines_);
+        stderr_output_ = std::move(other.stderr_output_);
+        requests_ = std::move(other.requests_);
+        latencies_ = std::move(other.latencies_);
+    }
+    return *this;
+}
+
+AsmSession::~AsmSession() {
+    release();
+}
+
+void AsmSession::release() noexcept {
+    close_fd(stdin_fd_);
+    close_fd(stdout_fd_);
+    close_fd(stderr_fd_);
+    close_fd(pid_fd_);
+    if (pid_ > 0) {
+        kill(pid_, SIGKILL);
+        waitpid(pid_, nullptr, 0);
+        pid_ = -1;
+    }
+}
+
+void AsmSession::read_stdout() {
+    char buffer[65536];
+    ssize_t bytes_read = read(stdout_fd_, buffer, sizeof(buffer));
+    if (bytes_read == 0 || (bytes_read < 0 && errno != EINTR && errno != EAGAIN)) {
+        close_fd(stdout_fd_);
+        return;
+    }
+    if (bytes_read < 0) {
+        return;
+    }
+
+    auto arrived = Clock::now();
+    std::string_view chunk{buffer, static_cast<size_t>(bytes_read)};
+    for (size_t newline = chunk.find('\n'); newline != std::string_view::npos; newline = chunk.find('\n')) {
+        partial_.append(chunk.substr(0, newline));
+        lines_.push_back(std::move(partial_));
+        partial_.clear();
+        chunk.remove_prefix(newline + 1);
+
+        if (!requests_.empty()) {
+            latencies_.push_back(
+                std::chrono::duration_cast<std::chrono::microseconds>(arrived - requests_.front())
+            );
+            requests_.pop_front();
+        }
+    }
+    partial_.append(chunk);
+}
+
+bool AsmSession::pump(Clock::time_point deadline, std::string_view* pending_write) {
+    struct pollfd fds[4];
+    nfds_t count = 0;
+    int stdin_index = -1, stdout_index = -1, stderr_index = -1;
+    if (pending_write && stdin_fd_ >= 0) { stdin_index = static_cast<int>(count); fds[count++] = {stdin_fd_, POLLOUT, 0}; }
+    if (stdout_fd_ >= 0) { stdout_index = static_cast<int>(count); fds[count++] = {stdout_fd_, POLLIN, 0}; }
+    if (stderr_fd_ >= 0) { stderr_index = static_cast<int>(count); fds[count++] = {stderr_fd_, POLLIN, 0}; }
+    if (count == 0) {
+        return false;
+    }
+
+    int ready = poll(fds, count, poll_timeout(deadline));
+    if (ready == 0) {
+        return false;
+    }
+    if (ready < 0) {
+        return errno == EINTR;
+    }
+
+    if (stdin_index >= 0 && fds[stdin_index].revents != 0) {
+        ssize_t written = write(stdin_fd_, pending_write->data(), pending_write->size());
+        if (written > 0) {
+            pending_write->remove_prefix(static_cast<size_t>(written));
+        } else if (written < 0 && errno != EINTR && errno != EAGAIN) {
+            close_fd(stdin_fd_);
+        }
+    }
+    if (stdout_index >= 0 && fds[stdout_index].revents != 0) {
+        read_stdout();
+    }
+    // Uncaptured stderr is still drained so the program never blocks on it
+    if (stderr_index >= 0 && fds[stderr_index].revents != 0) {
+        char buffer[4096];
+        ssize_t bytes_read = read(stderr_fd_, buffer, sizeof(buffer));
+        if (bytes_read > 0) {
+            if (capture_stderr_) stderr_output_.append(buffer, static_cast<size_t>(bytes_read));
+        } else if (bytes_read == 0 || (errno != EINTR && errno != EAGAIN)) {
+            close_fd(stderr_fd_);
+        }
+    }
+    return true;
+}
+
+bool AsmSession::send(std::string_view data, std::chrono::milliseconds timeout) {
+    if (stdin_fd_ < 0) {
+        return false;
+    }
+
+    // A program that already exited must produce EPIPE, not kill the test with SIGPIPE
+    sigset_t pipe_mask, old_mask;
+    sigemptyset(&pipe_mask);
+    sigaddset(&pipe_mask, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipe_mask, &old_mask);
+
+    auto deadline = Clock::now() + timeout;
+    while (!data.empty() && stdin_fd_ >= 0) {
+        // Try the write first: a request usually fits in the pipe without polling
+        ssize_t written = write(stdin_fd_, data.data(), data.size());
+        if (written > 0) {
+            data.remove_prefix(static_cast<size_t>(written));
+            continue;
+        }
+        if (written < 0 && errno != EINTR && errno != EAGAIN) {
+            close_fd(stdin_fd_);
+            break;
+        }
+        if (!pump(deadline, &data)) {
+            break;
+        }
+    }
+
+    if (stdin_fd_ < 0) {
+        // Discard the SIGPIPE raised for this thread before unblocking
+        struct timespec no_wait{0, 0};
+        sigtimedwait(&pipe_mask, nullptr, &no_wait);
+    }
+    pthread_sigmask(SIG_SETMASK, &old_mask, nullptr);
+
+    if (!data.empty()) {
+        return false;
+    }
+    requests_.push_back(Clock::now());
+    return true;
+}
+
+std::optional<std::string> AsmSession::read_line(std::chrono::microseconds timeout) {
+    auto deadline = Clock::now() + timeout;
+    while (lines_.empty()) {
+        if (stdout_fd_ < 0) {
+            if (partial_.empty()) {
+                return std::nullopt;
+            }
+            return std::exchange(partial_, {});
+        }
+        if (!pump(deadline, nullptr)) {
+            return std::nullopt;
+        }
+    }
+    auto line = std::move(lines_.front());
+    lines_.pop_front();
+    return line;
+}
+
+bool AsmSession::expect_line(std::string_view expected, std::chrono::microseconds timeout) {
+    auto line = read_line(timeout);
+    if (!line) {
+        ADD_FAILURE() << std::format("No line within {}us, expected: \"{}\"", timeout.count(), expected);
+        return false;
+    }
+    if (*line != expected) {
+        ADD_FAILURE() << std::format("Unexpected line\nExpected: \"{}\"\nActual:   \"{}\"", expected, *line);
+        return false;
+    }
+    return true;
+}
+
+void AsmSession::close_stdin() noexcept {
+    close_fd(stdin_fd_);
+}
+
+ExecutionResult AsmSession::close(std::chrono::milliseconds timeout) {
+    ExecutionResult result;
+    if (pid_ <= 0) {
+        return result;
+    }
+    close_stdin();
+
+    auto deadline = Clock::now() + timeout;
+    bool exited = false;
+    int status = 0;
+    while (!exited) {
+        if (waitpid(pid_, &status, WNOHANG) == pid_) {
+            exited = true;
+            break;
+        }
+        if (Clock::now() >= deadline) {
+            break;
+        }
+        if (stdout_fd_ < 0 && stderr_fd_ < 0) {
+            // Outputs closed but still running: wait on the pidfd, or nap without one
+            if (pid_fd_ >= 0) {
+                struct pollfd exit_fd{pid_fd_, POLLIN, 0};
+                poll(&exit_fd, 1, poll_timeout(deadline));
+            } else {
+                usleep(1000);
+            }
+        } else {
+            pump(deadline, nullptr);
+        }
+    }
+
+    if (!exited) {
+        result.timed_out = true;
+        kill(pid_, SIGKILL);
+        waitpid(pid_, &status, 0);
+    }
+    pid_ = -1;
+
+    // Collect output written just before exit
+    while (stdout_fd_ >= 0 || stderr_fd_ >= 0) {
+        if (!pump(Clock::now(), nullptr)) break;
+    }
+    close_fd(stdout_fd_);
+    close_fd(stderr_fd_);
+    close_fd(pid_fd_);
+
+    if (WIFEXITED(status)) {
+        result.exit_code = WEXITSTATUS(status);
+    } else if (WIFSIGNALED(status)) {
+        result.exit_code = 128 + WTERMSIG(status);
+    }
+    for (auto& line : lines_) {
+        result.stdout_output += line;
+        result.stdout_output += '\n';
+    }
+    lines_.clear();
+    result.stdout_output += std::exchange(partial_, {});
+    result.stderr_output = std::move(stderr_output_);
+    result.execution_time = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - started_);
+    return result;
+}
+
+AsmSession AsmTestRunner::open_session(const TestInput& args) const {
+    return AsmSession(*this, args);
+}
+
+} // namespace x86_asm_test
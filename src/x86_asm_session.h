@@ -0,0 +1,172 @@
+/**
+ * @file x86_asm_session.h
+ * @brief Interactive sessions with long-lived, conversational programs
+ */
+
+#pragma once
+
+#include "x86_asm_test.h"
+#include <chrono>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <vector>
+
+namespace x86_asm_test {
+
+/**
+ * @struct LatencyStats
+ * @brief Distribution of request/response latencies of a session
+ */
+struct LatencyStats {
+    size_t count{0};                          ///< Number of answered requests
+    std::chrono::microseconds min{0};         ///< Fastest response
+    std::chrono::microseconds p50{0};         ///< Median
+    std::chrono::microseconds p90{0};         ///< 90th percentile
+    std::chrono::microseconds p99{0};         ///< 99th percentile
+    std::chrono::microseconds max{0};         ///< Slowest response
+    std::chrono::microseconds mean{0};        ///< Arithmetic mean
+
+    /**
+     * @brief Compute the statistics of latency samples
+     * @param samples Latencies in any order
+     * @return Statistics (all zero without samples)
+     */
+    [[nodiscard]] static LatencyStats from_samples(std::vector<std::chrono::microseconds> samples);
+
+    /**
+     * @brief Format as a one-line report
+     * @return e.g. "1000 requests: p50 12us p90 15us p99 40us max 210us"
+     */
+    [[nodiscard]] std::string summary() const;
+};
+
+/**
+ * @class AsmSession
+ * @brief A running program driven one request at a time
+ *
+ * Created by AsmTestRunner::open_session(). The process stays alive
+ * between exchanges: send() writes a request and read_line() or
+ * expect_line() wait for the answer, servicing stdout and stderr with
+ * poll() so the program never blocks on a full pipe.
+ *
+ * Each send() starts a request and the next line the program prints
+ * answers it; the time between the end of the write and the arrival of
+ * that line is recorded as the request's latency. Requests may be
+ * pipelined, answers are matched to them in order.
+ *
+ * @code
+ * auto session = runner.open_session();
+ * session.send("10 5 add\n");
+ * session.expect_line("15", std::chrono::milliseconds(5));
+ * auto result = session.close();
+ * std::cout << session.latency().summary() << '\n';
+ * @endcode
+ */
+class AsmSession {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Start a session
+     * @param runner Runner providing the executable and configuration
+     * @param args Command-line arguments (stdin data is ignored)
+     * @throws std::runtime_error if the process cannot be started
+     */
+    AsmSession(const AsmTestRunner& runner, const TestInput& args);
+
+    AsmSession(const AsmSession&) = delete;
+    AsmSession& operator=(const AsmSession&) = delete;
+    AsmSession(AsmSession&& other) noexcept;
+    AsmSession& operator=(AsmSession&& other) noexcept;
+
+    /**
+     * @brief Kill the program if the session was not closed
+     */
+    ~AsmSession();
+
+    /**
+     * @brief Write a request to the program's stdin
+     * @param data Bytes to write
+     * @param timeout Time allowed for the program to accept the bytes
+     * @return false if stdin was closed or the timeout expired first
+     */
+    bool send(std::string_view data, std::chrono::milliseconds timeout = std::chrono::milliseconds(1000));
+
+    /**
+     * @brief Wait for the next line of stdout
+     * @param timeout Time to wait
+     * @return Line without its newline; a final unterminated line is
+     *         returned at EOF; nullopt on timeout or after EOF
+     */
+    [[nodiscard]] std::optional<std::string> read_line(std::chrono::microseconds timeout);
+
+    /**
+     * @brief Wait for the next line and check its contents
+     * @param expected Expected line (without newline)
+     * @param timeout Time to wait
+     * @return true if the line arrived in time and matched
+     * @throws Google Test non-fatal failure on timeout or mismatch
+     */
+    bool expect_line(std::string_view expected, std::chrono::microseconds timeout);
+
+    /**
+     * @brief Close stdin, signalling end of input to the program
+     */
+    void close_stdin() noexcept;
+
+    /**
+     * @brief End the session and wait for the program to exit
+     *
+     * stdin is closed first. The result holds the exit code, stderr, the
+     * stdout that was never read as a line, and the session's duration.
+     * The program is killed and marked as timed out if it does not exit
+     * in time.
+     *
+     * @param timeout Time allowed for the program to exit
+     * @return Execution result of the whole session
+     */
+    ExecutionResult close(std::chrono::milliseconds timeout = std::chrono::milliseconds(1000));
+
+    /**
+     * @brief Check whether the process has not been reaped yet
+     * @return true until close() returned
+     */
+    [[nodiscard]] bool is_open() const noexcept { return pid_ > 0; }
+
+    /**
+     * @brief Get the latency of every answered request, in request order
+     * @return Latency samples
+     */
+    [[nodiscard]] const std::vector<std::chrono::microseconds>& latencies() const noexcept {
+        return latencies_;
+    }
+
+    /**
+     * @brief Summarize the latencies of answered requests
+     * @return Latency percentiles
+     */
+    [[nodiscard]] LatencyStats latency() const { return LatencyStats::from_samples(latencies_); }
+
+private:
+    pid_t pid_{-1};
+    int stdin_fd_{-1};
+    int stdout_fd_{-1};
+    int stderr_fd_{-1};
+    int pid_fd_{-1};                         ///< pidfd signalling exit, -1 if unsupported
+    bool capture_stderr_{true};
+    Clock::time_point started_;
+    std::string partial_;                    ///< stdout after the last complete line
+    std::deque<std::string> lines_;          ///< Complete lines not read yet
+    std::string stderr_output_;
+    std::deque<Clock::time_point> requests_; ///< Send times of unanswered requests
+    std::vector<std::chrono::microseconds> latencies_;
+
+    bool pump(Clock::time_point deadline, std::string_view* pending_write);
+    void read_stdout();
+    void release() noexcept;
+};
+
+} // namespace x86_asm_test
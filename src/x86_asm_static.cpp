@@ -0,0 +1,28 @@
+/**
+ * @file x86_asm_static.cpp
+ * @brief Mismatch descriptions for compile-time expectations
+ */
+
+#include "x86_asm_static.h"
+#include <format>
+
+namespace x86_asm_test::detail {
+
+void describe_mismatch(std::string& description, StaticStream stream,
+                       std::string_view expected, std::string_view actual) {
+    description += std::format("{} mismatch:\nExpected: '{}'\nActual: '{}'\n",
+                               stream == StaticStream::Stdout ? "Stdout" : "Stderr", expected, actual);
+}
+
+void describe_missing(std::string& description, StaticStream stream,
+                      std::string_view pattern, std::string_view actual) {
+    bool out = stream == StaticStream::Stdout;
+    description += std::format("{} missing pattern: '{}'\nActual {}: '{}'\n",
+                               out ? "Stdout" : "Stderr", pattern, out ? "stdout" : "stderr", actual);
+}
+
+void describe_exit_code(std::string& description, int expected, int actual) {
+    description += std::format("Exit code mismatch: expected {}, got {}\n", expected, actual);
+}
+
+} // namespace x86_asm_test::detail
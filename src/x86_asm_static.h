@@ -0,0 +1,325 @@
+/**
+ * @file x86_asm_static.h
+ * @brief Expectations fixed at compile time with fixed_string patterns
+ */
+
+#pragma once
+
+#include "x86_asm_test.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace x86_asm_test {
+
+/**
+ * @struct fixed_string
+ * @brief String literal usable as a template argument
+ * @tparam N Size of the literal including its terminating NUL
+ */
+template<size_t N>
+struct fixed_string {
+    char data[N]{};
+
+    consteval fixed_string(const char (&text)[N]) {
+        std::copy_n(text, N, data);
+    }
+
+    /**
+     * @brief Get the length without the terminating NUL
+     * @return Number of characters
+     */
+    [[nodiscard]] static constexpr size_t size() noexcept { return N - 1; }
+
+    /**
+     * @brief Get the characters as a view
+     * @return View without the terminating NUL
+     */
+    [[nodiscard]] constexpr std::string_view view() const noexcept { return {data, N - 1}; }
+};
+
+namespace detail {
+
+/// Patterns at least this long are searched with Boyer-Moore-Horspool
+inline constexpr size_t kHorspoolMinLength = 16;
+
+/**
+ * @struct StaticPattern
+ * @brief Search tables for a pattern, all computed at compile time
+ *
+ * Short patterns are found by comparing 16 candidate positions at once
+ * against the pattern's first and last byte (SSE2) and verifying the
+ * survivors; long patterns use Boyer-Moore-Horspool with a precomputed
+ * bad-character table. Neither allocates nor builds anything at runtime.
+ */
+template<fixed_string Pattern>
+struct StaticPattern {
+    static constexpr std::string_view text = Pattern.view();
+    static constexpr size_t size = Pattern.size();
+
+    static constexpr std::array<size_t, 256> skip = [] {
+        std::array<size_t, 256> table{};
+        table.fill(size);
+        for (size_t i = 0; i + 1 < size; ++i) {
+            table[static_cast<unsigned char>(text[i])] = size - 1 - i;
+        }
+        return table;
+    }();
+
+    /// The first and last byte repeated across a 16-byte SSE2 register
+    alignas(16) static constexpr std::array<char, 16> first_lanes = [] {
+        std::array<char, 16> lanes{};
+        lanes.fill(size > 0 ? text[0] : '\0');
+        return lanes;
+    }();
+    alignas(16) static constexpr std::array<char, 16> last_lanes = [] {
+        std::array<char, 16> lanes{};
+        lanes.fill(size > 0 ? text[size - 1] : '\0');
+        return lanes;
+    }();
+
+    /**
+     * @brief Check whether a text contains the pattern
+     * @param haystack Text to search
+     * @return true if found
+     */
+    [[nodiscard]] static bool found_in(std::string_view haystack) noexcept {
+        if constexpr (size == 0) {
+            return true;
+        } else if constexpr (size == 1) {
+            return haystack.find(text[0]) != std::string_view::npos;
+        } else if constexpr (size >= kHorspoolMinLength) {
+            return horspool(haystack);
+        } else {
+            return first_last_scan(haystack);
+        }
+    }
+
+private:
+    static bool horspool(std::string_view haystack) noexcept {
+        size_t position = 0;
+        while (position + size <= haystack.size()) {
+            char last = haystack[position + size - 1];
+            if (last == text[size - 1] &&
+                std::memcmp(haystack.data() + position, text.data(), size - 1) == 0) {
+                return true;
+            }
+            position += skip[static_cast<unsigned char>(last)];
+        }
+        return false;
+    }
+
+    static bool first_last_scan(std::string_view haystack) noexcept {
+        size_t position = 0;
+#if defined(__SSE2__)
+        const __m128i first = _mm_load_si128(reinterpret_cast<const __m128i*>(first_lanes.data()));
+        const __m128i last = _mm_load_si128(reinterpret_cast<const __m128i*>(last_lanes.data()));
+        for (; position + size - 1 + 16 <= haystack.size(); position += 16) {
+            const char* block = haystack.data() + position;
+            __m128i starts = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+            __m128i ends = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + size - 1));
+            auto candidates = static_cast<unsigned>(_mm_movemask_epi8(
+                _mm_and_si128(_mm_cmpeq_epi8(starts, first), _mm_cmpeq_epi8(ends, last))
+            ));
+            while (candidates != 0) {
+                int offset = std::countr_zero(candidates);
+                if (std::memcmp(block + offset + 1, text.data() + 1, size - 2) == 0) {
+                    return true;
+                }
+                candidates &= candidates - 1;
+            }
+        }
+#endif
+        return haystack.substr(position).find(text) != std::string_view::npos;
+    }
+};
+
+enum class StaticStream : uint8_t { Stdout, Stderr };
+
+template<StaticStream Stream>
+[[nodiscard]] const std::pmr::string& select_stream(const ExecutionResult& result) noexcept {
+    if constexpr (Stream == StaticStream::Stdout) {
+        return result.stdout_output;
+    } else {
+        return result.stderr_output;
+    }
+}
+
+/**
+ * @brief Append the description of an exact-match failure
+ */
+void describe_mismatch(std::string& description, StaticStream stream,
+                       std::string_view expected, std::string_view actual);
+
+/**
+ * @brief Append the description of a missing pattern
+ */
+void describe_missing(std::string& description, StaticStream stream,
+                      std::string_view pattern, std::string_view actual);
+
+/**
+ * @brief Append the description of an exit code mismatch
+ */
+void describe_exit_code(std::string& description, int expected, int actual);
+
+template<int Code>
+struct ExitCodeIs {
+    [[nodiscard]] static bool check(const ExecutionResult& result) noexcept { return result.exit_code == Code; }
+    static void describe(const ExecutionResult& result, std::string& description) {
+        if (!check(result)) describe_exit_code(description, Code, result.exit_code);
+    }
+    static void add_to(ExpectedOutput& expected) { expected.exit_code(Code); }
+};
+
+template<StaticStream Stream, fixed_string Expected>
+struct StreamEquals {
+    [[nodiscard]] static bool check(const ExecutionResult& result) noexcept {
+        return std::string_view(select_stream<Stream>(result)) == Expected.view();
+    }
+    static void describe(const ExecutionResult& result, std::string& description) {
+        if (!check(result)) describe_mismatch(description, Stream, Expected.view(), select_stream<Stream>(result));
+    }
+    static void add_to(ExpectedOutput& expected) {
+        if constexpr (Stream == StaticStream::Stdout) expected.stdout_equals(Expected.view());
+        else expected.stderr_equals(Expected.view());
+    }
+};
+
+template<StaticStream Stream, fixed_string Pattern>
+struct StreamContains {
+    [[nodiscard]] static bool check(const ExecutionResult& result) noexcept {
+        return StaticPattern<Pattern>::found_in(select_stream<Stream>(result));
+    }
+    static void describe(const ExecutionResult& result, std::string& description) {
+        if (!check(result)) describe_missing(description, Stream, Pattern.view(), select_stream<Stream>(result));
+    }
+    static void add_to(ExpectedOutput& expected) {
+        if constexpr (Stream == StaticStream::Stdout) expected.stdout_contains(Pattern.view());
+        else expected.stderr_contains(Pattern.view());
+    }
+};
+
+} // namespace detail
+
+/**
+ * @class StaticExpectation
+ * @brief ExpectedOutput whose patterns are fixed at compile time
+ *
+ * Every expectation is a type, so a whole StaticExpectation is an empty
+ * constexpr object: pattern lengths, Horspool skip tables and the SIMD
+ * first/last-byte registers are computed by the compiler, and matches()
+ * neither allocates nor prepares anything at runtime. Use ExpectedOutput
+ * for expectations built at runtime.
+ *
+ * @code
+ * constexpr auto expected = static_expect_success().stdout_equals<"15\n">();
+ * EXPECT_TRUE(expected.matches(runner.run_test(input)));
+ * @endcode
+ *
+ * @tparam Checks detail check types, applied in order
+ */
+template<typename... Checks>
+class StaticExpectation {
+public:
+    /**
+     * @brief Expect exact stdout match
+     * @tparam Expected Expected stdout content
+     */
+    template<fixed_string Expected>
+    [[nodiscard]] consteval auto stdout_equals() const noexcept {
+        return StaticExpectation<Checks..., detail::StreamEquals<detail::StaticStream::Stdout, Expected>>{};
+    }
+
+    /**
+     * @brief Expect exact stderr match
+     * @tparam Expected Expected stderr content
+     */
+    template<fixed_string Expected>
+    [[nodiscard]] consteval auto stderr_equals() const noexcept {
+        return StaticExpectation<Checks..., detail::StreamEquals<detail::StaticStream::Stderr, Expected>>{};
+    }
+
+    /**
+     * @brief Expect stdout to contain a pattern
+     * @tparam Pattern Pattern that should be present in stdout
+     */
+    template<fixed_string Pattern>
+    [[nodiscard]] consteval auto stdout_contains() const noexcept {
+        return StaticExpectation<Checks..., detail::StreamContains<detail::StaticStream::Stdout, Pattern>>{};
+    }
+
+    /**
+     * @brief Expect stderr to contain a pattern
+     * @tparam Pattern Pattern that should be present in stderr
+     */
+    template<fixed_string Pattern>
+    [[nodiscard]] consteval auto stderr_contains() const noexcept {
+        return StaticExpectation<Checks..., detail::StreamContains<detail::StaticStream::Stderr, Pattern>>{};
+    }
+
+    /**
+     * @brief Set expected exit code
+     * @tparam Code Expected exit code
+     */
+    template<int Code>
+    [[nodiscard]] consteval auto exit_code() const noexcept {
+        return StaticExpectation<Checks..., detail::ExitCodeIs<Code>>{};
+    }
+
+    /**
+     * @brief Check if the actual result matches expectations
+     * @param result The execution result to check
+     * @return true if all expectations match
+     */
+    [[nodiscard]] bool matches(const ExecutionResult& result) const noexcept {
+        return (Checks::check(result) && ...);
+    }
+
+    /**
+     * @brief Get a description of mismatches
+     * @param result The execution result to compare against
+     * @return String describing what didn't match (same wording as ExpectedOutput)
+     */
+    [[nodiscard]] std::string get_mismatch_description(const ExecutionResult& result) const {
+        std::string description;
+        (Checks::describe(result, description), ...);
+        return description;
+    }
+
+    /**
+     * @brief Convert to a runtime expectation, e.g. for assert_output()
+     * @return Equivalent ExpectedOutput
+     */
+    [[nodiscard]] ExpectedOutput to_expected_output() const {
+        ExpectedOutput expected;
+        (Checks::add_to(expected), ...);
+        return expected;
+    }
+};
+
+/**
+ * @brief Compile-time counterpart of expect_success()
+ * @return StaticExpectation requiring exit code 0
+ */
+[[nodiscard]] consteval auto static_expect_success() noexcept {
+    return StaticExpectation<detail::ExitCodeIs<0>>{};
+}
+
+/**
+ * @brief Compile-time counterpart of expect_failure()
+ * @tparam Code Expected exit code (default: 1)
+ * @return StaticExpectation requiring the exit code
+ */
+template<int Code = 1>
+[[nodiscard]] consteval auto static_expect_failure() noexcept {
+    return StaticExpectation<detail::ExitCodeIs<Code>>{};
+}
+
+} // namespace x86_asm_test
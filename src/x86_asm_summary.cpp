@@ -0,0 +1,208 @@
+/**
+ * @file x86_asm_summary.cpp
+ * @brief Implementation of the performance summary
+ */
+
+#include "x86_asm_summary.h"
+#include <algorithm>
+#include <cstdio>
+#include <format>
+#include <iterator>
+
+namespace x86_asm_test {
+
+namespace {
+
+std::string format_duration(std::chrono::nanoseconds duration) {
+    auto ns = static_cast<double>(duration.count());
+    if (ns < 1e6) return std::format("{:.1f} us", ns / 1e3);
+    if (ns < 1e9) return std::format("{:.1f} ms", ns / 1e6);
+    return std::format("{:.2f} s", ns / 1e9);
+}
+
+double share(std::chrono::nanoseconds part, std::chrono::nanoseconds whole) {
+    return whole.count() > 0 ? 100.0 * static_cast<double>(part.count()) / static_cast<double>(whole.count()) : 0.0;
+}
+
+/**
+ * @brief Heap order keeping the fastest of the slowest runs on top
+ */
+bool slower(const SlowRun& a, const SlowRun& b) {
+    return a.total > b.total;
+}
+
+} // namespace
+
+PerformanceSummary::PerformanceSummary(PerformanceSummaryOptions options) : options_(options) {
+    slowest_.reserve(options_.slowest_runs);
+}
+
+void PerformanceSummary::begin_test(std::string_view suite, std::string_view name) {
+    std::lock_guard lock(mutex_);
+    auto fixture = fixtures_.find(suite);
+    if (fixture == fixtures_.end()) {
+        fixture = fixtures_.emplace(std::string(suite), FixtureStats{}).first;
+        fixture->second.name = suite;
+    }
+    fixture_ = &fixture->second;
+    test_ = std::format("{}.{}", suite, name);
+    test_run_time_ = {};
+    test_start_ = Clock::now();
+}
+
+void PerformanceSummary::end_test() {
+    std::lock_guard lock(mutex_);
+    if (!fixture_) return;
+    auto wall = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - test_start_);
+    ++fixture_->tests;
+    fixture_->test_time += wall;
+    ++totals_.tests;
+    totals_.test_time += wall;
+    totals_.parallel_saved += std::max(test_run_time_ - wall, std::chrono::nanoseconds{0});
+    fixture_ = nullptr;
+    test_.clear();
+}
+
+void PerformanceSummary::on_run(const RunInfo& run, Clock::time_point at, const ExecutionResult& result) noexcept {
+    using std::chrono::nanoseconds;
+    auto total = std::chrono::duration_cast<nanoseconds>(at - run.queued);
+    bool executed = run.executed != Clock::time_point{};
+    auto child = executed ? std::chrono::duration_cast<nanoseconds>(run.exited - run.executed) : nanoseconds{0};
+    try {
+        std::lock_guard lock(mutex_);
+        ++totals_.runs;
+        totals_.run_time += total;
+        if (executed) {
+            ++totals_.processes;
+            totals_.child_time += child;
+            totals_.queued_time += std::chrono::duration_cast<nanoseconds>(run.spawned - run.queued);
+            totals_.spawn_time += std::chrono::duration_cast<nanoseconds>(run.executed - run.spawned);
+            totals_.drain_time += std::chrono::duration_cast<nanoseconds>(at - run.exited);
+        } else {
+            totals_.without_process += total;
+        }
+        if (fixture_) {
+            ++fixture_->runs;
+            fixture_->run_time += total;
+            fixture_->child_time += child;
+            // Waiting for a reactor slot is not work that parallelism saved
+            test_run_time_ += executed ? std::chrono::duration_cast<nanoseconds>(at - run.spawned) : total;
+        }
+
+        // Only a run that enters the top N pays for formatting its command
+        if (options_.slowest_runs == 0) return;
+        if (slowest_.size() == options_.slowest_runs) {
+            if (total <= slowest_.front().total) return;
+            std::ranges::pop_heap(slowest_, slower);
+            slowest_.pop_back();
+        }
+        std::string command = run.executable->filename().string();
+        for (auto arg : run.input->args()) {
+            command += ' ';
+            command += arg;
+        }
+        slowest_.push_back({total, child, test_, std::move(command), result.exit_code, result.timed_out});
+        std::ranges::push_heap(slowest_, slower);
+    } catch (...) {
+        // The summary must never fail a test; the run is not listed
+    }
+}
+
+std::vector<SlowRun> PerformanceSummary::slowest_runs() const {
+    std::lock_guard lock(mutex_);
+    auto runs = slowest_;
+    std::ranges::sort(runs, slower);
+    return runs;
+}
+
+std::vector<FixtureStats> PerformanceSummary::fixtures() const {
+    std::lock_guard lock(mutex_);
+    std::vector<FixtureStats> fixtures;
+    fixtures.reserve(fixtures_.size());
+    for (const auto& [name, stats] : fixtures_) {
+        fixtures.push_back(stats);
+    }
+    std::ranges::stable_sort(fixtures, std::ranges::greater{}, &FixtureStats::run_time);
+    return fixtures;
+}
+
+PerformanceTotals PerformanceSummary::totals() const {
+    std::lock_guard lock(mutex_);
+    return totals_;
+}
+
+std::string PerformanceSummary::render() const {
+    auto totals = this->totals();
+    std::string text;
+    auto line = std::back_inserter(text);
+
+    std::format_to(line, "Performance summary: {} runs ({} processes) in {} tests, {} in runs\n",
+                   totals.runs, totals.processes, totals.tests, format_duration(totals.run_time));
+    std::format_to(line, "  Child execution  {:>10}  {:5.1f}%\n",
+                   format_duration(totals.child_time), share(totals.child_time, totals.run_time));
+    std::format_to(line, "  Harness overhead {:>10}  {:5.1f}%  (queued {}, spawn {}, drain {}, no process {})\n",
+                   format_duration(totals.overhead()), share(totals.overhead(), totals.run_time),
+                   format_duration(totals.queued_time), format_duration(totals.spawn_time),
+                   format_duration(totals.drain_time), format_duration(totals.without_process));
+    auto serial = totals.test_time + totals.parallel_saved;
+    double speedup = totals.test_time.count() > 0
+        ? static_cast<double>(serial.count()) / static_cast<double>(totals.test_time.count()) : 1.0;
+    std::format_to(line, "  Parallelism saved {} of {} test wall time ({:.2f}x)\n",
+                   format_duration(totals.parallel_saved), format_duration(totals.test_time), speedup);
+
+    auto slowest = slowest_runs();
+    if (!slowest.empty()) {
+        text += "  Slowest runs:\n";
+        for (const auto& run : slowest) {
+            std::format_to(line, "    {:>10}  {}  [{}] exit {}{}\n", format_duration(run.total), run.command,
+                           run.test.empty() ? "-" : run.test, run.exit_code, run.timed_out ? ", timed out" : "");
+        }
+    }
+
+    auto fixtures = this->fixtures();
+    if (!fixtures.empty()) {
+        size_t shown = std::min(fixtures.size(), options_.fixtures);
+        size_t width = std::string_view("Fixture").size();
+        for (size_t i = 0; i < shown; ++i) {
+            width = std::max(width, fixtures[i].name.size());
+        }
+        std::format_to(line, "  {:<{}}{:>7}{:>9}{:>12}{:>12}{:>12}\n", "Fixture", width, "tests", "runs", "run time",
+                       "overhead", "wall");
+        for (size_t i = 0; i < shown; ++i) {
+            const auto& fixture = fixtures[i];
+            std::format_to(line, "  {:<{}}{:>7}{:>9}{:>12}{:>12}{:>12}\n", fixture.name, width, fixture.tests, fixture.runs,
+                           format_duration(fixture.run_time), format_duration(fixture.overhead()),
+                           format_duration(fixture.test_time));
+        }
+        if (fixtures.size() > shown) {
+            std::format_to(line, "  ... {} more fixtures\n", fixtures.size() - shown);
+        }
+    }
+    return text;
+}
+
+PerformanceSummaryListener::PerformanceSummaryListener(std::shared_ptr<PerformanceSummary> summary)
+    : summary_(std::move(summary)) {}
+
+void PerformanceSummaryListener::OnTestStart(const ::testing::TestInfo& test_info) {
+    summary_->begin_test(test_info.test_suite_name(), test_info.name());
+}
+
+void PerformanceSummaryListener::OnTestEnd(const ::testing::TestInfo&) {
+    summary_->end_test();
+}
+
+void PerformanceSummaryListener::OnTestProgramEnd(const ::testing::UnitTest&) {
+    remove_run_observer(summary_.get());
+    std::printf("\n%s", summary_->render().c_str());
+    std::fflush(stdout);
+}
+
+std::shared_ptr<PerformanceSummary> enable_performance_summary(PerformanceSummaryOptions options) {
+    auto summary = std::make_shared<PerformanceSummary>(options);
+    add_run_observer(summary);
+    ::testing::UnitTest::GetInstance()->listeners().Append(new PerformanceSummaryListener(summary));
+    return summary;
+}
+
+} // namespace x86_asm_test
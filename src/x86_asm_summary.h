@@ -0,0 +1,188 @@
+/**
+ * @file x86_asm_summary.h
+ * @brief End-of-run performance summary of a test suite
+ */
+
+#pragma once
+
+#include "x86_asm_test.h"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace x86_asm_test {
+
+/**
+ * @struct PerformanceSummaryOptions
+ * @brief Size of a PerformanceSummary report
+ */
+struct PerformanceSummaryOptions {
+    size_t slowest_runs{10};   ///< Slowest runs kept and listed
+    size_t fixtures{20};       ///< Fixtures listed, by total run time
+};
+
+/**
+ * @struct SlowRun
+ * @brief One of the slowest runs
+ */
+struct SlowRun {
+    std::chrono::nanoseconds total{0};   ///< From run_test() (or submit()) until the result was ready
+    std::chrono::nanoseconds child{0};   ///< From fork() until the child was reaped, 0 without a process
+    std::string test;                    ///< "Suite.Test", empty outside tests
+    std::string command;                 ///< Executable name and arguments
+    int exit_code{0};
+    bool timed_out{false};
+};
+
+/**
+ * @struct FixtureStats
+ * @brief Aggregates of the runs of one test suite (fixture)
+ */
+struct FixtureStats {
+    std::string name;                          ///< Test suite name
+    size_t tests{0};                           ///< Tests that finished
+    uint64_t runs{0};                          ///< Runs made by those tests
+    std::chrono::nanoseconds run_time{0};      ///< Sum of run times
+    std::chrono::nanoseconds child_time{0};    ///< Sum of child execution times
+    std::chrono::nanoseconds test_time{0};     ///< Wall time of the tests
+
+    /**
+     * @brief Get the time spent in the harness rather than in children
+     * @return run_time - child_time
+     */
+    [[nodiscard]] std::chrono::nanoseconds overhead() const noexcept { return run_time - child_time; }
+};
+
+/**
+ * @struct PerformanceTotals
+ * @brief Where the run time of the whole suite went
+ */
+struct PerformanceTotals {
+    uint64_t runs{0};                            ///< Finished runs
+    uint64_t processes{0};                       ///< Runs that started a process
+    size_t tests{0};                             ///< Finished tests
+    std::chrono::nanoseconds run_time{0};        ///< Sum of run times
+    std::chrono::nanoseconds child_time{0};      ///< fork() until reaped
+    std::chrono::nanoseconds queued_time{0};     ///< Waiting to be spawned (asynchronous runs)
+    std::chrono::nanoseconds spawn_time{0};      ///< Pipes and fork()
+    std::chrono::nanoseconds drain_time{0};      ///< From reaping until the result was ready
+    std::chrono::nanoseconds without_process{0}; ///< Runs answered by the cache or an execution hook
+    std::chrono::nanoseconds test_time{0};       ///< Wall time of the tests
+    std::chrono::nanoseconds parallel_saved{0};  ///< Run time (from spawn) beyond the wall time of the tests that ran them
+
+    /**
+     * @brief Get the time spent in the harness rather than in children
+     * @return run_time - child_time
+     */
+    [[nodiscard]] std::chrono::nanoseconds overhead() const noexcept { return run_time - child_time; }
+};
+
+/**
+ * @class PerformanceSummary
+ * @brief RunObserver aggregating run timings into a compact report
+ *
+ * Uses the timestamps AsmTestRunner already takes for every run. Memory
+ * is bounded by the number of fixtures plus the slowest runs kept: the
+ * command line of a run is only formatted if the run is among them.
+ *
+ * Parallelism savings are measured per test: when the runs of a test,
+ * counted from spawn so that time queued behind other runs is excluded,
+ * add up to more than its wall time, the difference was saved by running
+ * them concurrently.
+ */
+class PerformanceSummary : public RunObserver {
+public:
+    /**
+     * @brief Create an empty summary
+     * @param options Report size
+     */
+    explicit PerformanceSummary(PerformanceSummaryOptions options = {});
+
+    /**
+     * @brief Attribute the following runs to a test
+     * @param suite Test suite name
+     * @param name Test name
+     */
+    void begin_test(std::string_view suite, std::string_view name);
+
+    /**
+     * @brief Close the current test, measuring its wall time
+     */
+    void end_test();
+
+    /**
+     * @brief Get the slowest runs
+     * @return Up to slowest_runs runs, slowest first
+     */
+    [[nodiscard]] std::vector<SlowRun> slowest_runs() const;
+
+    /**
+     * @brief Get per-fixture aggregates
+     * @return Every fixture, by descending run time
+     */
+    [[nodiscard]] std::vector<FixtureStats> fixtures() const;
+
+    /**
+     * @brief Get suite-wide totals
+     * @return Totals so far
+     */
+    [[nodiscard]] PerformanceTotals totals() const;
+
+    /**
+     * @brief Render the report
+     * @return Totals, overhead split, parallelism, slowest runs and fixtures
+     */
+    [[nodiscard]] std::string render() const;
+
+    void on_run(const RunInfo& run, Clock::time_point at, const ExecutionResult& result) noexcept override;
+
+private:
+    PerformanceSummaryOptions options_;
+    mutable std::mutex mutex_;
+    PerformanceTotals totals_;
+    std::vector<SlowRun> slowest_;                         ///< Min-heap on total
+    std::map<std::string, FixtureStats, std::less<>> fixtures_;
+    FixtureStats* fixture_{nullptr};                       ///< Fixture of the current test
+    std::string test_;                                     ///< "Suite.Test" of the current test
+    Clock::time_point test_start_;
+    std::chrono::nanoseconds test_run_time_{0};
+};
+
+/**
+ * @class PerformanceSummaryListener
+ * @brief Google Test listener feeding a PerformanceSummary and printing it at the end
+ */
+class PerformanceSummaryListener : public ::testing::EmptyTestEventListener {
+public:
+    /**
+     * @brief Create a listener
+     * @param summary Summary, registered as a run observer until the program ends
+     */
+    explicit PerformanceSummaryListener(std::shared_ptr<PerformanceSummary> summary);
+
+    void OnTestStart(const ::testing::TestInfo& test_info) override;
+    void OnTestEnd(const ::testing::TestInfo& test_info) override;
+    void OnTestProgramEnd(const ::testing::UnitTest& unit_test) override;
+
+private:
+    std::shared_ptr<PerformanceSummary> summary_;
+};
+
+/**
+ * @brief Print a performance summary when the test program ends
+ *
+ * Call after ::testing::InitGoogleTest(). Registers a PerformanceSummary
+ * as a run observer and appends a PerformanceSummaryListener.
+ *
+ * @param options Report size
+ * @return The summary
+ */
+std::shared_ptr<PerformanceSummary> enable_performance_summary(PerformanceSummaryOptions options = {});
+
+} // namespace x86_asm_test
@@ -0,0 +1,309 @@
+/**
+ * @file x86_asm_table.cpp
+ * @brief Implementation of TSV/CSV test tables
+ */
+
+#include "x86_asm_table.h"
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace x86_asm_test {
+
+namespace {
+
+/**
+ * @struct RowError
+ * @brief Malformed row, thrown with a line relative to its chunk
+ */
+struct RowError {
+    size_t line;
+    std::string message;
+};
+
+/**
+ * @struct Chunk
+ * @brief Rows parsed from one slice of the file
+ */
+struct Chunk {
+    std::vector<detail::TableRow> rows;
+    size_t lines{0};
+    std::optional<RowError> error;
+};
+
+// First delimiter, newline, backslash or quote in [position, end)
+const char* find_special(const char* position, const char* end, char delimiter, char quote) noexcept {
+#if defined(__SSE2__)
+    const __m128i delimiters = _mm_set1_epi8(delimiter);
+    const __m128i newlines = _mm_set1_epi8('\n');
+    const __m128i backslashes = _mm_set1_epi8('\\');
+    const __m128i quotes = _mm_set1_epi8(quote);
+    for (; end - position >= 16; position += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(position));
+        __m128i hits = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(block, delimiters), _mm_cmpeq_epi8(block, newlines)),
+            _mm_or_si128(_mm_cmpeq_epi8(block, backslashes), _mm_cmpeq_epi8(block, quotes))
+        );
+        if (auto mask = static_cast<unsigned>(_mm_movemask_epi8(hits))) {
+            return position + std::countr_zero(mask);
+        }
+    }
+#endif
+    for (; position < end; ++position) {
+        char c = *position;
+        if (c == delimiter || c == '\n' || c == '\\' || c == quote) return position;
+    }
+    return end;
+}
+
+char unescape(char c) noexcept {
+    switch (c) {
+        case 'n': return '\n';
+        case 't': return '\t';
+        case 'r': return '\r';
+        case 's': return ' ';
+        case '\\': return '\\';
+        default: return '\0';
+    }
+}
+
+void decode(std::string_view raw, bool quoted, std::string& out) {
+    out.clear();
+    for (size_t i = 0; i < raw.size(); ++i) {
+        if (raw[i] == '\\') {
+            out.push_back(unescape(raw[++i]));
+        } else {
+            out.push_back(raw[i]);
+            if (quoted && raw[i] == '"') ++i;   // "" inside quotes
+        }
+    }
+}
+
+/**
+ * @brief Parse the rows of [begin, end), which starts at a line boundary
+ *
+ * A TSV table passes its delimiter as quote, which disables quoting.
+ */
+void parse_chunk(const char* begin, const char* end, char delimiter, char quote, Chunk& chunk) {
+    const char* p = begin;
+    while (p < end) {
+        size_t line = ++chunk.lines;
+        if (*p == '#' || *p == '\n' || (*p == '\r' && (p + 1 == end || p[1] == '\n'))) {
+            const void* newline = std::memchr(p, '\n', static_cast<size_t>(end - p));
+            p = newline ? static_cast<const char*>(newline) + 1 : end;
+            continue;
+        }
+
+        detail::TableRow row;
+        row.line = line;
+        size_t cell = 0;
+        for (;;) {
+            if (cell == row.cells.size()) {
+                throw RowError{line, std::format("more than {} columns", row.cells.size())};
+            }
+            bool quoted = quote != delimiter && p < end && *p == quote;
+            const char* start = quoted ? p + 1 : p;
+            const char* q = start;
+            const char* cell_end;
+            for (;;) {
+                q = find_special(q, end, delimiter, quote);
+                if (q == end || *q == '\n') {
+                    if (quoted) throw RowError{line, "unterminated quote"};
+                    cell_end = q;
+                    break;
+                }
+                if (*q == '\\') {
+                    if (q + 1 == end || unescape(q[1]) == '\0') {
+                        throw RowError{line, "invalid escape sequence"};
+                    }
+                    q += 2;
+                } else if (*q == delimiter) {
+                    if (!quoted) {
+                        cell_end = q;
+                        break;
+                    }
+                    ++q;
+                } else if (!quoted) {
+                    throw RowError{line, "quote inside an unquoted cell"};
+                } else if (q + 1 < end && q[1] == quote) {
+                    q += 2;
+                } else {
+                    cell_end = q++;
+                    if (q < end && *q == '\r') ++q;
+                    if (q < end && *q != delimiter && *q != '\n') {
+                        throw RowError{line, "text after closing quote"};
+                    }
+                    break;
+                }
+            }
+
+            std::string_view text(start, static_cast<size_t>(cell_end - start));
+            bool last = q == end || *q == '\n';
+            if (!quoted && last && text.ends_with('\r')) text.remove_suffix(1);
+            row.cells[cell] = text;
+            if (quoted) row.quoted |= static_cast<uint8_t>(1U << cell);
+            ++cell;
+            p = last ? std::min(q + 1, end) : q + 1;
+            if (last) break;
+        }
+        if (cell != row.cells.size()) {
+            throw RowError{line, std::format("expected {} columns, found {}", row.cells.size(), cell)};
+        }
+
+        std::string_view exit_code = row.cells[3];
+        if (!exit_code.empty()) {
+            int value = 0;
+            auto [end_of_number, error] = std::from_chars(exit_code.data(), exit_code.data() + exit_code.size(), value);
+            if (error != std::errc{} || end_of_number != exit_code.data() + exit_code.size()) {
+                throw RowError{line, std::format("invalid exit code '{}'", exit_code)};
+            }
+            row.exit_code = value;
+        }
+        chunk.rows.push_back(row);
+    }
+}
+
+/**
+ * @class TableCaseTest
+ * @brief Test registered for one row of a CaseTable
+ */
+class TableCaseTest : public ::testing::Test {
+public:
+    TableCaseTest(std::shared_ptr<const CaseTable> table, size_t index, std::shared_ptr<const AsmTestRunner> runner)
+        : table_(std::move(table)), index_(index), runner_(std::move(runner)) {}
+
+    void TestBody() override {
+        auto test_case = (*table_)[index_];
+        runner_->assert_output(test_case.input, test_case.expected);
+    }
+
+private:
+    std::shared_ptr<const CaseTable> table_;
+    size_t index_;
+    std::shared_ptr<const AsmTestRunner> runner_;
+};
+
+} // namespace
+
+void CaseTable::copy_input(size_t index, TestInput& input) const {
+    thread_local std::string scratch;
+    const auto& row = rows_[index];
+    input.clear();
+
+    std::string_view args = row.cells[0];
+    bool quoted = row.quoted & 1U;
+    while (!args.empty()) {
+        size_t space = args.find(' ');
+        if (space != 0) {
+            decode(args.substr(0, space), quoted, scratch);
+            input.add_arg(scratch);
+        }
+        args.remove_prefix(space == std::string_view::npos ? args.size() : space + 1);
+    }
+    if (!row.cells[1].empty()) {
+        decode(row.cells[1], row.quoted & 2U, scratch);
+        input.set_stdin(scratch);
+    }
+}
+
+ExpectedOutput CaseTable::expected(size_t index) const {
+    const auto& row = rows_[index];
+    ExpectedOutput expected;
+    if (row.exit_code) {
+        expected.exit_code(*row.exit_code);
+    }
+    if (!row.cells[2].empty()) {
+        std::string stdout_output;
+        decode(row.cells[2], row.quoted & 4U, stdout_output);
+        expected.stdout_equals(stdout_output);
+    }
+    return expected;
+}
+
+TableCase CaseTable::operator[](size_t index) const {
+    TableCase test_case;
+    test_case.line = rows_[index].line;
+    copy_input(index, test_case.input);
+    test_case.expected = expected(index);
+    return test_case;
+}
+
+CaseTable load_cases(const std::filesystem::path& path, const TableOptions& options) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error(std::format("Cannot open test table {}", path.string()));
+    }
+    CaseTable table;
+    table.path_ = path;
+    table.text_.assign(std::istreambuf_iterator<char>(file), {});
+    std::string_view text(table.text_.data(), table.text_.size());
+
+    char delimiter = options.delimiter != '\0' ? options.delimiter : path.extension() == ".csv" ? ',' : '\t';
+    char quote = delimiter == ',' ? '"' : delimiter;
+
+    // Chunk boundaries fall right after a newline
+    size_t jobs = std::clamp<size_t>(text.size() / std::max<size_t>(options.min_bytes_per_job, 1), 1,
+                                     std::max<size_t>(options.jobs, 1));
+    std::vector<size_t> bounds{0};
+    for (size_t j = 1; j < jobs; ++j) {
+        size_t newline = text.find('\n', std::max(bounds.back(), j * text.size() / jobs));
+        bounds.push_back(newline == std::string_view::npos ? text.size() : newline + 1);
+    }
+    bounds.push_back(text.size());
+
+    std::vector<Chunk> chunks(jobs);
+    auto parse = [&](size_t j) {
+        try {
+            parse_chunk(text.data() + bounds[j], text.data() + bounds[j + 1], delimiter, quote, chunks[j]);
+        } catch (RowError& error) {
+            chunks[j].error = std::move(error);
+        }
+    };
+    {
+        std::vector<std::jthread> threads;
+        for (size_t j = 1; j < jobs; ++j) {
+            threads.emplace_back(parse, j);
+        }
+        parse(0);
+    }
+
+    size_t rows = 0;
+    for (const auto& chunk : chunks) rows += chunk.rows.size();
+    table.rows_.reserve(rows);
+    size_t first_line = 0;
+    for (auto& chunk : chunks) {
+        if (chunk.error) {
+            throw std::runtime_error(std::format("{}:{}: {}", path.string(),
+                                                 first_line + chunk.error->line, chunk.error->message));
+        }
+        for (auto& row : chunk.rows) {
+            row.line += first_line;
+            table.rows_.push_back(row);
+        }
+        first_line += chunk.lines;
+    }
+    return table;
+}
+
+size_t register_table_tests(const std::string& suite, std::shared_ptr<const CaseTable> table,
+                            std::shared_ptr<const AsmTestRunner> runner) {
+    std::string file = table->path().string();
+    for (size_t i = 0; i < table->size(); ++i) {
+        size_t line = table->line(i);
+        ::testing::RegisterTest(
+            suite.c_str(), std::format("line_{}", line).c_str(), nullptr, nullptr,
+            file.c_str(), static_cast<int>(line),
+            [table, i, runner]() -> ::testing::Test* { return new TableCaseTest(table, i, runner); }
+        );
+    }
+    return table->size();
+}
+
+} // namespace x86_asm_test
@@ -0,0 +1,160 @@
+/**
+ * @file x86_asm_table.h
+ * @brief Data-driven test cases loaded from TSV/CSV tables
+ */
+
+#pragma once
+
+#include "x86_asm_test.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace x86_asm_test {
+
+namespace detail {
+
+/**
+ * @struct TableRow
+ * @brief Cell positions of one table row, still escaped
+ */
+struct TableRow {
+    size_t line{0};
+    std::array<std::string_view, 4> cells{};
+    uint8_t quoted{0};                ///< Bit per cell written in CSV quotes
+    std::optional<int> exit_code;
+};
+
+} // namespace detail
+
+/**
+ * @struct TableOptions
+ * @brief Options for load_cases()
+ */
+struct TableOptions {
+    char delimiter{'\0'};                                              ///< Column separator ('\0': ',' for .csv, tab otherwise)
+    size_t jobs{std::max(1U, std::thread::hardware_concurrency())};   ///< Threads used for large files (0 acts as 1)
+    size_t min_bytes_per_job{1 << 20};                                 ///< Smaller files use fewer threads
+};
+
+/**
+ * @struct TableCase
+ * @brief One decoded row of a CaseTable
+ */
+struct TableCase {
+    size_t line{0};             ///< 1-based line in the table file
+    TestInput input;            ///< Arguments and stdin
+    ExpectedOutput expected;    ///< Expected stdout and exit code
+};
+
+/**
+ * @class CaseTable
+ * @brief Table of test cases in the format "args | stdin | expected_stdout | exit_code"
+ *
+ * Loading finds and validates every row and column but keeps the cells
+ * as views into the file contents; TestInput and ExpectedOutput are only
+ * built when a case is accessed.
+ *
+ * Cells may use the escapes \\n, \\t, \\r, \\s (space) and \\\\. Arguments
+ * are separated by spaces. An empty cell means "no stdin" or "not
+ * checked". Blank lines and lines starting with '#' are skipped. CSV
+ * cells may be quoted ("a,b", with "" for a quote) but, as in TSV, a row
+ * never spans lines; this is what allows the file to be split between
+ * threads at arbitrary newlines.
+ */
+class CaseTable {
+public:
+    CaseTable() = default;
+    CaseTable(CaseTable&&) = default;
+    CaseTable& operator=(CaseTable&&) = default;
+
+    // A copy's cells would still view the source's buffer
+    CaseTable(const CaseTable&) = delete;
+    CaseTable& operator=(const CaseTable&) = delete;
+
+    /**
+     * @brief Get the number of cases
+     * @return Row count
+     */
+    [[nodiscard]] size_t size() const noexcept { return rows_.size(); }
+
+    /**
+     * @brief Get the file the table was loaded from
+     * @return Path passed to load_cases()
+     */
+    [[nodiscard]] const std::filesystem::path& path() const noexcept { return path_; }
+
+    /**
+     * @brief Get the line of a case
+     * @param index Case index
+     * @return 1-based line number
+     */
+    [[nodiscard]] size_t line(size_t index) const noexcept { return rows_[index].line; }
+
+    /**
+     * @brief Decode a case's input into an existing TestInput, reusing its storage
+     * @param index Case index
+     * @param input Input to fill
+     */
+    void copy_input(size_t index, TestInput& input) const;
+
+    /**
+     * @brief Decode a case's expectation
+     * @param index Case index
+     * @return Expected stdout and exit code
+     */
+    [[nodiscard]] ExpectedOutput expected(size_t index) const;
+
+    /**
+     * @brief Decode a case
+     * @param index Case index
+     * @return Line, input and expectation
+     */
+    [[nodiscard]] TableCase operator[](size_t index) const;
+
+private:
+    friend CaseTable load_cases(const std::filesystem::path& path, const TableOptions& options);
+
+    std::filesystem::path path_;
+    std::vector<char> text_;             ///< File contents; a moved vector keeps its buffer, so cells stay valid
+    std::vector<detail::TableRow> rows_;
+};
+
+/**
+ * @brief Load a table of test cases
+ *
+ * Large files are split at newlines into one chunk per thread. Each
+ * chunk is tokenized by scanning 16 bytes at a time (SSE2) for the
+ * delimiter, newline, backslash and quote.
+ *
+ * @param path TSV or CSV file
+ * @param options Delimiter and parallelism
+ * @return Validated table
+ * @throws std::runtime_error with "path:line: message" for malformed rows
+ */
+[[nodiscard]] CaseTable load_cases(const std::filesystem::path& path, const TableOptions& options = {});
+
+/**
+ * @brief Register each case of a table as a Google Test test
+ *
+ * Call after ::testing::InitGoogleTest() and before RUN_ALL_TESTS().
+ * Tests are named "<suite>.line_<N>" and report the table's path and
+ * line, so adding cases needs no recompilation and no static
+ * initialisation. Each test only decodes its own row when it runs.
+ *
+ * @param suite Test suite name
+ * @param table Cases, shared by all registered tests
+ * @param runner Runner for the program under test, shared by all registered tests
+ * @return Number of registered tests
+ */
+size_t register_table_tests(const std::string& suite, std::shared_ptr<const CaseTable> table,
+                            std::shared_ptr<const AsmTestRunner> runner);
+
+} // namespace x86_asm_test
@@ -4,50 +4,447 @@
  */
 
 #include "x86_asm_test.h"
+#include "x86_asm_cache.h"
+#include "x86_asm_output.h"
+#include "x86_asm_hash.h"
 #include <stdexcept>
 #include <sstream>
 #include <algorithm>
 #include <ranges>
 #include <cstdlib>
+#include <sys/resource.h>
 #include <sys/wait.h>
 #include <unistd.h>
 #include <signal.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <atomic>
+#include <mutex>
+#include <cerrno>
+#include <climits>
+#include <ctime>
 #include <format>
 
 namespace x86_asm_test {
 
-bool ExpectedOutput::matches(const ExecutionResult& result) const noexcept {
-    // Check exit code if specified
-    if (expected_exit_code_.has_value() && result.exit_code != expected_exit_code_.value()) {
-        return false;
+namespace {
+
+/**
+ * @brief Read once from fd and append to sink (the bytes are dropped if sink is null)
+ *
+ * data is set to the bytes read, for run observers.
+ */
+ssize_t read_output(int fd, std::pmr::string* sink, std::span<char> buffer, std::string_view& data) {
+    ssize_t bytes_read = read(fd, buffer.data(), buffer.size());
+    if (bytes_read > 0) {
+        data = {buffer.data(), static_cast<size_t>(bytes_read)};
+        if (sink) sink->append(data);
     }
+    return bytes_read;
+}
+
+/**
+ * @brief Read once from fd straight into the free tail of a chunked sink
+ */
+ssize_t read_output(int fd, ChunkedOutput* sink, std::span<char> buffer, std::string_view& data) {
+    auto space = sink ? sink->prepare() : buffer;
+    ssize_t bytes_read = read(fd, space.data(), space.size());
+    if (bytes_read > 0) {
+        data = {space.data(), static_cast<size_t>(bytes_read)};
+        if (sink) sink->commit(static_cast<size_t>(bytes_read));
+    }
+    return bytes_read;
+}
+
+/**
+ * @brief Feed a child's stdin and drain its stdout/stderr concurrently
+ *
+ * Writing all input before reading deadlocks once the child blocks on a
+ * full output pipe while we still block on its stdin, so all three pipes
+ * are serviced from one poll() loop. A child may exit without consuming
+ * its input; the resulting EPIPE must not kill the test process with
+ * SIGPIPE. The child is killed when the timeout expires.
+ *
+ * Takes ownership of stdin_fd; the output descriptors stay open.
+ */
+template<typename Result>
+void pump_io(
+    pid_t pid,
+    int stdin_fd, std::string_view input,
+    int stdout_fd, int stderr_fd,
+    bool capture_stderr,
+    std::chrono::milliseconds timeout,
+    Result& result,
+    detail::RunObservation* observed
+) {
+    sigset_t pipe_mask, old_mask;
+    sigemptyset(&pipe_mask);
+    sigaddset(&pipe_mask, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipe_mask, &old_mask);
     
-    // Check exact stdout match
-    if (exact_stdout_.has_value() && result.stdout_output != exact_stdout_.value()) {
-        return false;
+    if (input.empty()) {
+        close(stdin_fd);
+        stdin_fd = -1;
+    } else {
+        fcntl(stdin_fd, F_SETFL, fcntl(stdin_fd, F_GETFL) | O_NONBLOCK);
     }
     
-    // Check exact stderr match
-    if (exact_stderr_.has_value() && result.stderr_output != exact_stderr_.value()) {
-        return false;
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    bool broken = false;
+    char buffer[65536];
+    
+    // Returns false once the descriptor reached EOF or failed
+    auto drain = [&](int fd, auto* sink, OutputStream stream) {
+        std::string_view data;
+        ssize_t bytes_read = read_output(fd, sink, buffer, data);
+        if (bytes_read > 0) {
+            if (observed) {
+                observed->output(std::chrono::steady_clock::now(), stream, data);
+            }
+            return true;
+        }
+        return bytes_read < 0 && (errno == EINTR || errno == EAGAIN);
+    };
+    
+    while (stdout_fd >= 0 || stderr_fd >= 0) {
+        struct pollfd fds[3];
+        nfds_t count = 0;
+        int stdin_index = -1, stdout_index = -1, stderr_index = -1;
+        if (stdin_fd >= 0) { stdin_index = static_cast<int>(count); fds[count++] = {stdin_fd, POLLOUT, 0}; }
+        if (stdout_fd >= 0) { stdout_index = static_cast<int>(count); fds[count++] = {stdout_fd, POLLIN, 0}; }
+        if (stderr_fd >= 0) { stderr_index = static_cast<int>(count); fds[count++] = {stderr_fd, POLLIN, 0}; }
+        
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()
+        );
+        int ready = remaining.count() > 0
+            ? poll(fds, count, static_cast<int>(std::min<int64_t>(remaining.count(), INT32_MAX)))
+            : 0;
+        
+        if (ready == 0) {
+            result.timed_out = true;
+            kill(pid, SIGKILL);
+            break;
+        }
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            kill(pid, SIGKILL);
+            break;
+        }
+        
+        if (stdin_index >= 0 && fds[stdin_index].revents != 0) {
+            ssize_t written = write(stdin_fd, input.data(), input.size());
+            if (written > 0) {
+                input.remove_prefix(static_cast<size_t>(written));
+            } else if (written < 0 && errno != EINTR && errno != EAGAIN) {
+                broken = errno == EPIPE;
+                input = {};
+            }
+            if (input.empty()) {
+                close(stdin_fd);
+                stdin_fd = -1;
+            }
+        }
+        if (stdout_index >= 0 && fds[stdout_index].revents != 0 &&
+            !drain(stdout_fd, &result.stdout_output, OutputStream::Stdout)) {
+            stdout_fd = -1;
+        }
+        // Uncaptured stderr is still drained so the child never blocks on it
+        if (stderr_index >= 0 && fds[stderr_index].revents != 0 &&
+            !drain(stderr_fd, capture_stderr ? &result.stderr_output : nullptr, OutputStream::Stderr)) {
+            stderr_fd = -1;
+        }
     }
     
-    // Check stdout contains patterns
-    for (const auto& pattern : stdout_contains_) {
-        if (result.stdout_output.find(pattern) == std::string::npos) {
-            return false;
+    if (stdin_fd >= 0) {
+        close(stdin_fd);
+    }
+    if (broken) {
+        // Discard the SIGPIPE raised for this thread before unblocking
+        struct timespec no_wait{0, 0};
+        sigtimedwait(&pipe_mask, nullptr, &no_wait);
+    }
+    pthread_sigmask(SIG_SETMASK, &old_mask, nullptr);
+}
+
+/**
+ * @brief Clear a result for reuse, keeping the capacity of its buffers
+ */
+void reset_result(ExecutionResult& result) noexcept {
+    result.exit_code = 0;
+    result.stdout_output.clear();
+    result.stderr_output.clear();
+    result.execution_time = std::chrono::milliseconds{0};
+    result.timed_out = false;
+    result.from_cache = false;
+    result.run_id = 0;
+}
+
+/**
+ * @brief Run the program directly and capture its output into result
+ *
+ * Shared by execute_process (one growing string per stream) and
+ * run_chunked (pooled chunks); the result's output starts out empty.
+ */
+template<typename Result>
+void spawn_and_capture(
+    const std::filesystem::path& executable,
+    const TestConfig& config,
+    const TestInput& input,
+    Result& result,
+    detail::RunObservation* observed
+) {
+    auto start_time = std::chrono::steady_clock::now();
+    if (observed) {
+        observed->info.spawned = start_time;
+        observed->notify(&RunObserver::on_spawn, start_time);
+    }
+    
+    // Create pipes for stdout, stderr, and stdin
+    int stdout_pipe[2], stderr_pipe[2], stdin_pipe[2];
+    
+    // O_CLOEXEC keeps concurrent runs from leaking pipe ends into each other's children
+    if (pipe2(stdout_pipe, O_CLOEXEC) == -1 || pipe2(stderr_pipe, O_CLOEXEC) == -1 ||
+        pipe2(stdin_pipe, O_CLOEXEC) == -1) {
+        throw std::runtime_error("Failed to create pipes");
+    }
+    
+    // Reused by every run on this thread, so building argv does not allocate
+    thread_local std::vector<char*> exec_args;
+    input.fill_argv(executable.c_str(), exec_args);
+    
+    // Resolved before fork: the child must not allocate
+    bool change_directory = !detail::is_current_directory(config.working_directory);
+    
+    pid_t pid = fork();
+    
+    if (pid == -1) {
+        // Fork failed - cleanup pipes
+        close(stdout_pipe[0]); close(stdout_pipe[1]);
+        close(stderr_pipe[0]); close(stderr_pipe[1]);
+        close(stdin_pipe[0]); close(stdin_pipe[1]);
+        throw std::runtime_error("Fork failed");
+    }
+    
+    if (pid == 0) {
+        // Child process
+        dup2(stdout_pipe[1], STDOUT_FILENO);
+        dup2(stderr_pipe[1], STDERR_FILENO);
+        dup2(stdin_pipe[0], STDIN_FILENO);
+        
+        // Close all pipe file descriptors in child
+        close(stdout_pipe[0]); close(stdout_pipe[1]);
+        close(stderr_pipe[0]); close(stderr_pipe[1]);
+        close(stdin_pipe[0]); close(stdin_pipe[1]);
+        
+        // Change working directory if specified
+        if (change_directory) {
+            if (chdir(config.working_directory.c_str()) != 0) {
+                perror("chdir");
+                _exit(127);
+            }
+        }
+        
+        // Execute the program. A file another thread just wrote (such as a
+        // mutant memfd) stays open for writing in children it forked until
+        // they exec, which older kernels report as ETXTBSY: retry briefly
+        for (int attempt = 0; execv(executable.c_str(), exec_args.data()) == -1 && errno == ETXTBSY &&
+                              attempt < 100; ++attempt) {
+            struct timespec pause{0, 1000000};
+            nanosleep(&pause, nullptr);
+        }
+        perror("execv");
+        _exit(127);
+    } else {
+        // Parent process
+        if (observed) {
+            observed->info.executed = std::chrono::steady_clock::now();
+            observed->notify(&RunObserver::on_exec, observed->info.executed, pid);
+        }
+        close(stdout_pipe[1]);
+        close(stderr_pipe[1]);
+        close(stdin_pipe[0]);
+        
+        pump_io(pid, stdin_pipe[1], input.stdin_data() ? std::string_view{*input.stdin_data()} : std::string_view{},
+                stdout_pipe[0], stderr_pipe[0], config.capture_stderr, config.timeout, result, observed);
+        
+        // Close remaining pipes
+        close(stdout_pipe[0]);
+        close(stderr_pipe[0]);
+        
+        // Wait for child process (its rusage is only needed by observers)
+        int status;
+        struct rusage usage{};
+        wait4(pid, &status, 0, observed ? &usage : nullptr);
+        
+        if (WIFEXITED(status)) {
+            result.exit_code = WEXITSTATUS(status);
+        } else if (WIFSIGNALED(status)) {
+            result.exit_code = 128 + WTERMSIG(status);
+        }
+        
+        auto end_time = std::chrono::steady_clock::now();
+        result.execution_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+            end_time - start_time
+        );
+        if (observed) {
+            observed->exit(end_time, result.exit_code, result.timed_out, usage);
         }
     }
+}
+
+std::mutex execution_hook_mutex;
+std::shared_ptr<const ExecutionHook> execution_hook;
+std::atomic<bool> execution_hook_installed{false};
+
+std::mutex substitution_mutex;
+std::pair<std::filesystem::path, std::filesystem::path> substitution;  ///< Original and replacement
+
+std::shared_ptr<const ExecutionHook> current_execution_hook() {
+    if (!execution_hook_installed.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    std::lock_guard lock(execution_hook_mutex);
+    return execution_hook;
+}
+
+} // namespace
+
+void set_execution_hook(ExecutionHook hook) {
+    std::lock_guard lock(execution_hook_mutex);
+    execution_hook = hook ? std::make_shared<const ExecutionHook>(std::move(hook)) : nullptr;
+    execution_hook_installed.store(execution_hook != nullptr, std::memory_order_release);
+}
+
+bool has_execution_hook() noexcept {
+    return execution_hook_installed.load(std::memory_order_acquire);
+}
+
+void set_executable_substitution(std::filesystem::path original, std::filesystem::path replacement) {
+    std::lock_guard lock(substitution_mutex);
+    substitution = {std::move(original), std::move(replacement)};
+}
+
+namespace {
+
+std::mutex run_observers_mutex;   ///< Serializes add and remove; runs load the list atomically
+std::shared_ptr<const detail::RunObserverList> run_observers;
+std::atomic<bool> run_observers_installed{false};
+std::atomic<uint64_t> run_ids{0};
+
+} // namespace
+
+void add_run_observer(std::shared_ptr<RunObserver> observer) {
+    std::lock_guard lock(run_observers_mutex);
+    auto current = std::atomic_load(&run_observers);
+    auto observers = current ? std::make_shared<detail::RunObserverList>(*current)
+                             : std::make_shared<detail::RunObserverList>();
+    observers->push_back(std::move(observer));
+    std::atomic_store(&run_observers, std::shared_ptr<const detail::RunObserverList>(std::move(observers)));
+    run_observers_installed.store(true, std::memory_order_release);
+}
+
+void remove_run_observer(const RunObserver* observer) {
+    std::lock_guard lock(run_observers_mutex);
+    auto current = std::atomic_load(&run_observers);
+    if (!current) return;
+    auto observers = std::make_shared<detail::RunObserverList>(*current);
+    std::erase_if(*observers, [&](const auto& registered) { return registered.get() == observer; });
+    bool installed = !observers->empty();
+    std::atomic_store(&run_observers, installed ? std::shared_ptr<const detail::RunObserverList>(std::move(observers))
+                                                : nullptr);
+    run_observers_installed.store(installed, std::memory_order_release);
+}
+
+bool has_run_observers() noexcept {
+    return run_observers_installed.load(std::memory_order_acquire);
+}
+
+namespace detail {
+
+bool is_current_directory(const std::filesystem::path& directory) noexcept {
+    char cwd[PATH_MAX];
+    return getcwd(cwd, sizeof(cwd)) != nullptr && directory.native() == cwd;
+}
+
+std::shared_ptr<const RunObserverList> current_run_observers() noexcept {
+    if (!run_observers_installed.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    return std::atomic_load(&run_observers);
+}
+
+uint64_t next_run_id() noexcept {
+    return run_ids.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+void RunObservation::exit(RunInfo::Clock::time_point at, int exit_code, bool timed_out,
+                          const ::rusage& usage) noexcept {
+    auto microseconds = [](const timeval& time) {
+        return std::chrono::seconds{time.tv_sec} + std::chrono::microseconds{time.tv_usec};
+    };
+    info.exited = at;
+    info.usage = {
+        .user_time = microseconds(usage.ru_utime),
+        .system_time = microseconds(usage.ru_stime),
+        .max_rss_kb = usage.ru_maxrss,
+        .minor_faults = usage.ru_minflt,
+        .major_faults = usage.ru_majflt,
+        .voluntary_switches = usage.ru_nvcsw,
+        .involuntary_switches = usage.ru_nivcsw,
+    };
+    notify(&RunObserver::on_exit, at, exit_code, timed_out);
+}
+
+} // namespace detail
+
+bool ExpectedOutput::matches(const ExecutionResult& result) const noexcept {
+    auto check = [&]() noexcept {
+        // Check exit code if specified
+        if (expected_exit_code_.has_value() && result.exit_code != expected_exit_code_.value()) {
+            return false;
+        }
     
-    // Check stderr contains patterns
-    for (const auto& pattern : stderr_contains_) {
-        if (result.stderr_output.find(pattern) == std::string::npos) {
+        // Check exact stdout match
+        if (exact_stdout_.has_value() && result.stdout_output != exact_stdout_.value()) {
             return false;
         }
-    }
     
-    return true;
+        // Check exact stderr match
+        if (exact_stderr_.has_value() && result.stderr_output != exact_stderr_.value()) {
+            return false;
+        }
+    
+        // Check stdout contains patterns
+        for (const auto& pattern : stdout_contains_) {
+            if (result.stdout_output.find(pattern) == std::string::npos) {
+                return false;
+            }
+        }
+    
+        // Check stderr contains patterns
+        for (const auto& pattern : stderr_contains_) {
+            if (result.stderr_output.find(pattern) == std::string::npos) {
+                return false;
+            }
+        }
+    
+        return true;
+    };
+    
+    auto observers = detail::current_run_observers();
+    if (!observers) {
+        return check();
+    }
+    auto begin = std::chrono::steady_clock::now();
+    bool matched = check();
+    auto end = std::chrono::steady_clock::now();
+    RunInfo run{.id = result.run_id};
+    for (const auto& observer : *observers) {
+        observer->on_match(run, begin, end, matched);
+    }
+    return matched;
 }
 
 std::string ExpectedOutput::get_mismatch_description(const ExecutionResult& result) const {
@@ -87,6 +484,149 @@ std::string ExpectedOutput::get_mismatch_description(const ExecutionResult& resu
     return oss.str();
 }
 
+namespace {
+
+MismatchReport::Excerpt make_excerpt(std::string_view text, size_t offset) noexcept {
+    MismatchReport::Excerpt excerpt;
+    excerpt.offset = std::min(offset, text.size());
+    auto bytes = text.substr(excerpt.offset, MismatchReport::kExcerptSize);
+    std::copy(bytes.begin(), bytes.end(), excerpt.bytes.begin());
+    excerpt.size = bytes.size();
+    return excerpt;
+}
+
+void report_difference(MismatchReport& report, MismatchReport::Kind kind,
+                       std::string_view expected, std::string_view actual) noexcept {
+    auto [expected_end, actual_end] = std::ranges::mismatch(expected, actual);
+    size_t difference = static_cast<size_t>(expected_end - expected.begin());
+    // A little context before the first difference
+    size_t start = difference > 8 ? difference - 8 : 0;
+    
+    MismatchReport::Entry entry;
+    entry.kind = kind;
+    entry.first_difference = difference;
+    entry.expected_size = expected.size();
+    entry.actual_size = actual.size();
+    entry.expected_hash = detail::hash_bytes(expected);
+    entry.actual_hash = detail::hash_bytes(actual);
+    entry.expected = make_excerpt(expected, start);
+    entry.actual = make_excerpt(actual, start);
+    report.add(entry);
+}
+
+void report_missing(MismatchReport& report, MismatchReport::Kind kind,
+                    std::string_view pattern, std::string_view actual) noexcept {
+    MismatchReport::Entry entry;
+    entry.kind = kind;
+    entry.expected_size = pattern.size();
+    entry.actual_size = actual.size();
+    entry.expected_hash = detail::hash_bytes(pattern);
+    entry.actual_hash = detail::hash_bytes(actual);
+    entry.expected = make_excerpt(pattern, 0);
+    entry.actual = make_excerpt(actual, 0);
+    report.add(entry);
+}
+
+// Quote an excerpt, escaping control bytes and marking cut-off ends
+std::string quote_excerpt(const MismatchReport::Excerpt& excerpt, size_t text_size) {
+    std::string quoted = excerpt.offset > 0 ? "'..." : "'";
+    for (char c : excerpt.view()) {
+        switch (c) {
+        case '\n': quoted += "\\n"; break;
+        case '\t': quoted += "\\t"; break;
+        case '\'': quoted += "\\'"; break;
+        case '\\': quoted += "\\\\"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20 || c == 0x7f) {
+                quoted += std::format("\\x{:02x}", static_cast<unsigned char>(c));
+            } else {
+                quoted += c;
+            }
+        }
+    }
+    quoted += excerpt.offset + excerpt.size < text_size ? "...'" : "'";
+    return quoted;
+}
+
+} // namespace
+
+MismatchReport ExpectedOutput::mismatch_report(const ExecutionResult& result) const noexcept {
+    auto observers = detail::current_run_observers();
+    auto begin = observers ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+    MismatchReport report;
+    
+    if (expected_exit_code_.has_value() && result.exit_code != expected_exit_code_.value()) {
+        MismatchReport::Entry entry;
+        entry.kind = MismatchReport::Kind::ExitCode;
+        entry.expected_code = expected_exit_code_.value();
+        entry.actual_code = result.exit_code;
+        report.add(entry);
+    }
+    if (exact_stdout_.has_value() && result.stdout_output != exact_stdout_.value()) {
+        report_difference(report, MismatchReport::Kind::StdoutDiffers, *exact_stdout_, result.stdout_output);
+    }
+    if (exact_stderr_.has_value() && result.stderr_output != exact_stderr_.value()) {
+        report_difference(report, MismatchReport::Kind::StderrDiffers, *exact_stderr_, result.stderr_output);
+    }
+    for (const auto& pattern : stdout_contains_) {
+        if (result.stdout_output.find(pattern) == std::string::npos) {
+            report_missing(report, MismatchReport::Kind::StdoutMissing, pattern, result.stdout_output);
+        }
+    }
+    for (const auto& pattern : stderr_contains_) {
+        if (result.stderr_output.find(pattern) == std::string::npos) {
+            report_missing(report, MismatchReport::Kind::StderrMissing, pattern, result.stderr_output);
+        }
+    }
+    if (observers) {
+        auto end = std::chrono::steady_clock::now();
+        RunInfo run{.id = result.run_id};
+        for (const auto& observer : *observers) {
+            observer->on_report(run, begin, end, report);
+        }
+    }
+    return report;
+}
+
+std::string MismatchReport::render(size_t max_size) const {
+    std::string text;
+    for (const auto& entry : failures()) {
+        bool out = entry.kind == Kind::StdoutDiffers || entry.kind == Kind::StdoutMissing;
+        const char* stream = out ? "Stdout" : "Stderr";
+        switch (entry.kind) {
+        case Kind::ExitCode:
+            text += std::format("Exit code mismatch: expected {}, got {}\n", entry.expected_code, entry.actual_code);
+            break;
+        case Kind::StdoutDiffers:
+        case Kind::StderrDiffers:
+            text += std::format("{} mismatch at byte {}: expected {} bytes (hash {:016x}), got {} bytes (hash {:016x})\n"
+                                "Expected: {}\nActual:   {}\n",
+                                stream, entry.first_difference, entry.expected_size, entry.expected_hash,
+                                entry.actual_size, entry.actual_hash,
+                                quote_excerpt(entry.expected, entry.expected_size),
+                                quote_excerpt(entry.actual, entry.actual_size));
+            break;
+        case Kind::StdoutMissing:
+        case Kind::StderrMissing:
+            text += std::format("{} missing pattern: {}\nActual {} ({} bytes, hash {:016x}): {}\n",
+                                stream, quote_excerpt(entry.expected, entry.expected_size),
+                                out ? "stdout" : "stderr", entry.actual_size, entry.actual_hash,
+                                quote_excerpt(entry.actual, entry.actual_size));
+            break;
+        }
+        if (text.size() > max_size) break;
+    }
+    if (dropped > 0) {
+        text += std::format("... and {} more mismatches\n", dropped);
+    }
+    if (text.size() > max_size) {
+        constexpr std::string_view marker = "... (report truncated)\n";
+        text.resize(max_size > marker.size() ? max_size - marker.size() : 0);
+        text += marker.substr(0, std::min(marker.size(), max_size));
+    }
+    return text;
+}
+
 AsmTestRunner::AsmTestRunner(
     std::filesystem::path executable_path,
     AsmSyntax syntax,
@@ -95,6 +635,15 @@ AsmTestRunner::AsmTestRunner(
     syntax_{syntax}, 
     config_{std::move(config)} {
     
+    // Mutation testing swaps the program under test without touching the tests
+    {
+        std::lock_guard lock(substitution_mutex);
+        std::error_code ec;
+        if (!substitution.first.empty() && std::filesystem::equivalent(substitution.first, executable_path_, ec)) {
+            executable_path_ = substitution.second;
+        }
+    }
+    
     // Validate executable exists and is executable
     if (!std::filesystem::exists(executable_path_)) {
         throw std::runtime_error(
@@ -114,170 +663,44 @@ AsmTestRunner::AsmTestRunner(
             std::format("File is not executable: {}", executable_path_.string())
         );
     }
+    
+    if (config_.result_cache) {
+        cache_ = ResultCache::open(*config_.result_cache);
+    }
+}
+
+void AsmTestRunner::set_config(TestConfig new_config) {
+    cache_ = new_config.result_cache ? ResultCache::open(*new_config.result_cache) : nullptr;
+    config_ = std::move(new_config);
 }
 
-ExecutionResult AsmTestRunner::execute_process(
-    std::span<const std::string> args,
-    const std::optional<std::string>& stdin_data
-) const {
+void AsmTestRunner::execute_process(const TestInput& input, ExecutionResult& result,
+                                    detail::RunObservation* observed) const {
     
     if (config_.use_strace) {
-        return execute_with_strace(args, stdin_data);
+        execute_with_strace(input, result, observed);
+        return;
     }
     
-    ExecutionResult result;
-    auto start_time = std::chrono::steady_clock::now();
-    
-    // Create pipes for stdout, stderr, and stdin
-    int stdout_pipe[2], stderr_pipe[2], stdin_pipe[2];
-    
-    if (pipe(stdout_pipe) == -1 || pipe(stderr_pipe) == -1 || pipe(stdin_pipe) == -1) {
-        throw std::runtime_error("Failed to create pipes");
-    }
-    
-    // Prepare arguments for execv
-    std::vector<char*> exec_args;
-    exec_args.reserve(args.size() + 2);
-    exec_args.push_back(const_cast<char*>(executable_path_.c_str()));
-    
-    for (const auto& arg : args) {
-        exec_args.push_back(const_cast<char*>(arg.c_str()));
-    }
-    exec_args.push_back(nullptr);
-    
-    pid_t pid = fork();
-    
-    if (pid == -1) {
-        // Fork failed - cleanup pipes
-        close(stdout_pipe[0]); close(stdout_pipe[1]);
-        close(stderr_pipe[0]); close(stderr_pipe[1]);
-        close(stdin_pipe[0]); close(stdin_pipe[1]);
-        throw std::runtime_error("Fork failed");
-    }
-    
-    if (pid == 0) {
-        // Child process
-        dup2(stdout_pipe[1], STDOUT_FILENO);
-        dup2(stderr_pipe[1], STDERR_FILENO);
-        dup2(stdin_pipe[0], STDIN_FILENO);
-        
-        // Close all pipe file descriptors in child
-        close(stdout_pipe[0]); close(stdout_pipe[1]);
-        close(stderr_pipe[0]); close(stderr_pipe[1]);
-        close(stdin_pipe[0]); close(stdin_pipe[1]);
-        
-        // Change working directory if specified
-        if (config_.working_directory != std::filesystem::current_path()) {
-            if (chdir(config_.working_directory.c_str()) != 0) {
-                perror("chdir");
-                _exit(127);
-            }
-        }
-        
-        // Execute the program
-        execv(executable_path_.c_str(), exec_args.data());
-        perror("execv");
-        _exit(127);
+    reset_result(result);
+    spawn_and_capture(executable_path_, config_, input, result, observed);
+}
+
+ChunkedResult AsmTestRunner::run_chunked(const TestInput& input) const {
+    ChunkedResult result;
+    if (auto observers = detail::current_run_observers()) {
+        detail::RunObservation observed{std::move(observers), {}};
+        observed.info = {.id = detail::next_run_id(), .executable = &executable_path_, .input = &input,
+                         .queued = std::chrono::steady_clock::now()};
+        spawn_and_capture(executable_path_, config_, input, result, &observed);
     } else {
-        // Parent process
-        close(stdout_pipe[1]);
-        close(stderr_pipe[1]);
-        close(stdin_pipe[0]);
-        
-        // Write stdin data if provided
-        if (stdin_data.has_value() && !stdin_data->empty()) {
-            ssize_t written = write(stdin_pipe[1], stdin_data->c_str(), stdin_data->size());
-            (void)written; // Suppress unused variable warning
-        }
-        close(stdin_pipe[1]);
-        
-        // Set up for non-blocking reads with timeout
-        fd_set read_fds;
-        struct timeval timeout_val;
-        
-        // Read stdout and stderr
-        char buffer[4096];
-        bool stdout_open = true, stderr_open = true;
-        
-        while (stdout_open || stderr_open) {
-            FD_ZERO(&read_fds);
-            int max_fd = -1;
-            
-            if (stdout_open) {
-                FD_SET(stdout_pipe[0], &read_fds);
-                max_fd = std::max(max_fd, stdout_pipe[0]);
-            }
-            if (stderr_open && config_.capture_stderr) {
-                FD_SET(stderr_pipe[0], &read_fds);
-                max_fd = std::max(max_fd, stderr_pipe[0]);
-            }
-            
-            if (max_fd == -1) break;
-            
-            // Set timeout
-            timeout_val.tv_sec = config_.timeout.count() / 1000;
-            timeout_val.tv_usec = (config_.timeout.count() % 1000) * 1000;
-            
-            int select_result = select(max_fd + 1, &read_fds, nullptr, nullptr, &timeout_val);
-            
-            if (select_result == -1) {
-                break;
-            } else if (select_result == 0) {
-                result.timed_out = true;
-                kill(pid, SIGKILL);
-                break;
-            }
-            
-            // Read from stdout
-            if (stdout_open && FD_ISSET(stdout_pipe[0], &read_fds)) {
-                ssize_t bytes_read = read(stdout_pipe[0], buffer, sizeof(buffer) - 1);
-                if (bytes_read > 0) {
-                    buffer[bytes_read] = '\0';
-                    result.stdout_output += std::string(buffer, bytes_read);
-                } else {
-                    stdout_open = false;
-                }
-            }
-            
-            // Read from stderr
-            if (stderr_open && config_.capture_stderr && FD_ISSET(stderr_pipe[0], &read_fds)) {
-                ssize_t bytes_read = read(stderr_pipe[0], buffer, sizeof(buffer) - 1);
-                if (bytes_read > 0) {
-                    buffer[bytes_read] = '\0';
-                    result.stderr_output += std::string(buffer, bytes_read);
-                } else {
-                    stderr_open = false;
-                }
-            }
-        }
-        
-        // Close remaining pipes
-        close(stdout_pipe[0]);
-        close(stderr_pipe[0]);
-        
-        // Wait for child process
-        int status;
-        waitpid(pid, &status, 0);
-        
-        if (WIFEXITED(status)) {
-            result.exit_code = WEXITSTATUS(status);
-        } else if (WIFSIGNALED(status)) {
-            result.exit_code = 128 + WTERMSIG(status);
-        }
-        
-        auto end_time = std::chrono::steady_clock::now();
-        result.execution_time = std::chrono::duration_cast<std::chrono::milliseconds>(
-            end_time - start_time
-        );
+        spawn_and_capture(executable_path_, config_, input, result, nullptr);
     }
-    
     return result;
 }
 
-ExecutionResult AsmTestRunner::execute_with_strace(
-    std::span<const std::string> args,
-    const std::optional<std::string>& stdin_data
-) const {
+void AsmTestRunner::execute_with_strace(const TestInput& input, ExecutionResult& result,
+                                        detail::RunObservation* observed) const {
     
     // Build strace command
     std::vector<std::string> strace_args;
@@ -292,15 +715,23 @@ ExecutionResult AsmTestRunner::execute_with_strace(
     strace_args.push_back(executable_path_.string());
     
     // Add original arguments
-    strace_args.insert(strace_args.end(), args.begin(), args.end());
+    for (auto arg : input.args()) {
+        strace_args.emplace_back(arg);
+    }
     
-    ExecutionResult result;
+    reset_result(result);
     auto start_time = std::chrono::steady_clock::now();
+    if (observed) {
+        observed->info.spawned = start_time;
+        observed->notify(&RunObserver::on_spawn, start_time);
+    }
     
     // Create pipes
     int stdout_pipe[2], stderr_pipe[2], stdin_pipe[2];
     
-    if (pipe(stdout_pipe) == -1 || pipe(stderr_pipe) == -1 || pipe(stdin_pipe) == -1) {
+    // O_CLOEXEC keeps concurrent runs from leaking pipe ends into each other's children
+    if (pipe2(stdout_pipe, O_CLOEXEC) == -1 || pipe2(stderr_pipe, O_CLOEXEC) == -1 ||
+        pipe2(stdin_pipe, O_CLOEXEC) == -1) {
         throw std::runtime_error("Failed to create pipes for strace execution");
     }
     
@@ -313,6 +744,9 @@ ExecutionResult AsmTestRunner::execute_with_strace(
     }
     exec_args.push_back(nullptr);
     
+    // Resolved before fork: the child must not allocate
+    bool change_directory = !detail::is_current_directory(config_.working_directory);
+    
     pid_t pid = fork();
     
     if (pid == -1) {
@@ -332,7 +766,7 @@ ExecutionResult AsmTestRunner::execute_with_strace(
         close(stderr_pipe[0]); close(stderr_pipe[1]);
         close(stdin_pipe[0]); close(stdin_pipe[1]);
         
-        if (config_.working_directory != std::filesystem::current_path()) {
+        if (change_directory) {
             if (chdir(config_.working_directory.c_str()) != 0) {
                 perror("chdir");
                 _exit(127);
@@ -344,74 +778,23 @@ ExecutionResult AsmTestRunner::execute_with_strace(
         _exit(127);
     } else {
         // Parent process - same logic as execute_process
+        if (observed) {
+            observed->info.executed = std::chrono::steady_clock::now();
+            observed->notify(&RunObserver::on_exec, observed->info.executed, pid);
+        }
         close(stdout_pipe[1]);
         close(stderr_pipe[1]);
         close(stdin_pipe[0]);
         
-        if (stdin_data.has_value() && !stdin_data->empty()) {
-            ssize_t written = write(stdin_pipe[1], stdin_data->c_str(), stdin_data->size());
-            (void)written;
-        }
-        close(stdin_pipe[1]);
-        
-        // Read output with timeout
-        char buffer[4096];
-        bool stdout_open = true, stderr_open = true;
-        fd_set read_fds;
-        struct timeval timeout_val;
-        
-        while (stdout_open || stderr_open) {
-            FD_ZERO(&read_fds);
-            int max_fd = -1;
-            
-            if (stdout_open) {
-                FD_SET(stdout_pipe[0], &read_fds);
-                max_fd = std::max(max_fd, stdout_pipe[0]);
-            }
-            if (stderr_open) {
-                FD_SET(stderr_pipe[0], &read_fds);
-                max_fd = std::max(max_fd, stderr_pipe[0]);
-            }
-            
-            if (max_fd == -1) break;
-            
-            timeout_val.tv_sec = config_.timeout.count() / 1000;
-            timeout_val.tv_usec = (config_.timeout.count() % 1000) * 1000;
-            
-            int select_result = select(max_fd + 1, &read_fds, nullptr, nullptr, &timeout_val);
-            
-            if (select_result <= 0) {
-                if (select_result == 0) result.timed_out = true;
-                kill(pid, SIGKILL);
-                break;
-            }
-            
-            if (stdout_open && FD_ISSET(stdout_pipe[0], &read_fds)) {
-                ssize_t bytes_read = read(stdout_pipe[0], buffer, sizeof(buffer) - 1);
-                if (bytes_read > 0) {
-                    buffer[bytes_read] = '\0';
-                    result.stdout_output += std::string(buffer, bytes_read);
-                } else {
-                    stdout_open = false;
-                }
-            }
-            
-            if (stderr_open && FD_ISSET(stderr_pipe[0], &read_fds)) {
-                ssize_t bytes_read = read(stderr_pipe[0], buffer, sizeof(buffer) - 1);
-                if (bytes_read > 0) {
-                    buffer[bytes_read] = '\0';
-                    result.stderr_output += std::string(buffer, bytes_read);
-                } else {
-                    stderr_open = false;
-                }
-            }
-        }
+        pump_io(pid, stdin_pipe[1], input.stdin_data() ? std::string_view{*input.stdin_data()} : std::string_view{},
+                stdout_pipe[0], stderr_pipe[0], true, config_.timeout, result, observed);
         
         close(stdout_pipe[0]);
         close(stderr_pipe[0]);
         
         int status;
-        waitpid(pid, &status, 0);
+        struct rusage usage{};
+        wait4(pid, &status, 0, observed ? &usage : nullptr);
         
         if (WIFEXITED(status)) {
             result.exit_code = WEXITSTATUS(status);
@@ -423,19 +806,58 @@ ExecutionResult AsmTestRunner::execute_with_strace(
         result.execution_time = std::chrono::duration_cast<std::chrono::milliseconds>(
             end_time - start_time
         );
+        if (observed) {
+            observed->exit(end_time, result.exit_code, result.timed_out, usage);
+        }
     }
-    
-    return result;
 }
 
 ExecutionResult AsmTestRunner::run_test(const TestInput& input) const {
-    return execute_process(input.args(), input.stdin_data());
+    ExecutionResult result;
+    run_test(input, result);
+    return result;
+}
+
+void AsmTestRunner::run_test(const TestInput& input, ExecutionResult& result) const {
+    std::optional<detail::RunObservation> observed;
+    if (auto observers = detail::current_run_observers()) {
+        observed.emplace(std::move(observers), RunInfo{});
+        observed->info = {.id = detail::next_run_id(), .executable = &executable_path_, .input = &input,
+                          .queued = std::chrono::steady_clock::now()};
+    }
+    auto* observation = observed ? &*observed : nullptr;
+    
+    if (auto hook = current_execution_hook()) {
+        result = (*hook)(*this, input);
+        if (result.run_id != 0) {
+            // The hook ran the program observed (e.g. under CoverageTracer): its run stands for this one
+            return;
+        }
+    } else if (!cache_ || config_.use_strace) {
+        execute_process(input, result, observation);
+    } else {
+        auto key = cache_->make_key(executable_path_, input, config_);
+        if (auto cached = cache_->lookup(key)) {
+            result = std::move(*cached);
+        } else {
+            execute_process(input, result, observation);
+            if (!result.timed_out) {
+                cache_->store(key, result);
+            }
+        }
+    }
+    
+    result.run_id = observed ? observed->info.id : 0;
+    if (observed) {
+        observed->notify(&RunObserver::on_run, std::chrono::steady_clock::now(), result);
+    }
 }
 
 void AsmTestRunner::assert_output(const TestInput& input, const ExpectedOutput& expected) const {
     auto result = run_test(input);
+    auto report = expected.mismatch_report(result);
     
-    if (!expected.matches(result)) {
+    if (!report.empty()) {
         std::ostringstream error_msg;
         error_msg << std::format("Assembly test failed for executable: {}\n", executable_path_.string())
                   << std::format("Syntax: {}\n", get_syntax_string())
@@ -450,12 +872,138 @@ void AsmTestRunner::assert_output(const TestInput& input, const ExpectedOutput&
         }
         
         error_msg << std::format("\nExecution time: {}ms\n", result.execution_time.count())
-                  << expected.get_mismatch_description(result);
+                  << report.render();
         
         FAIL() << error_msg.str();
     }
 }
 
+std::vector<ExecutionResult> AsmTestRunner::run_batch(std::span<const TestInput> inputs) const {
+    const auto& protocol = config_.batch;
+    if (protocol.input_delimiter.empty() || protocol.output_delimiter.empty()) {
+        throw std::invalid_argument("Batch delimiters must not be empty");
+    }
+    
+    // Frame every input once up front
+    std::vector<std::string> records;
+    records.reserve(inputs.size());
+    for (const auto& input : inputs) {
+        std::string record;
+        for (const auto& arg : input.args()) {
+            if (!record.empty()) record += protocol.arg_separator;
+            record += arg;
+        }
+        if (input.stdin_data()) {
+            if (!record.empty()) record += protocol.arg_separator;
+            record += *input.stdin_data();
+        }
+        if (record.find(protocol.input_delimiter) != std::string::npos) {
+            throw std::invalid_argument(
+                std::format("Batch record {} contains the input delimiter", records.size())
+            );
+        }
+        records.push_back(std::move(record));
+    }
+    
+    std::vector<ExecutionResult> results(inputs.size());
+    size_t next = 0;
+    bool isolate = false;
+    while (next < records.size()) {
+        size_t count = records.size() - next;
+        if (isolate) {
+            count = 1;
+        } else if (protocol.max_records != 0) {
+            count = std::min(count, protocol.max_records);
+        }
+        
+        // Built with the default resource, like TestInput{}, so set_stdin takes the buffer over
+        std::pmr::string batch_stdin;
+        size_t batch_size = 0;
+        for (size_t i = next; i < next + count; ++i) {
+            batch_size += records[i].size() + protocol.input_delimiter.size();
+        }
+        batch_stdin.reserve(batch_size);
+        for (size_t i = next; i < next + count; ++i) {
+            batch_stdin += records[i];
+            batch_stdin += protocol.input_delimiter;
+        }
+        
+        // Goes through run_test so the result cache and execution hook apply
+        auto process = run_test(TestInput{}.set_stdin(std::move(batch_stdin)));
+        auto share = process.execution_time / static_cast<int64_t>(count);
+        
+        std::string_view output{process.stdout_output};
+        size_t answered = 0;
+        while (answered < count) {
+            auto end = output.find(protocol.output_delimiter);
+            if (end == std::string_view::npos) break;
+            end += protocol.output_delimiter.size();
+            
+            auto& record = results[next + answered];
+            record.stdout_output = output.substr(0, end);
+            record.execution_time = share;
+            record.from_cache = process.from_cache;
+            output.remove_prefix(end);
+            ++answered;
+        }
+        
+        bool process_failed = !process.succeeded();
+        if (answered == count && !process_failed) {
+            next += count;
+            isolate = false;
+            continue;
+        }
+        
+        // Output of the failing record's predecessors may have been buffered
+        // and lost, so confirm the culprit by running it on its own
+        if (answered < count && count > 1) {
+            next += answered;
+            isolate = true;
+            continue;
+        }
+        
+        // Attribute the failure to the record being processed when it happened
+        isolate = false;
+        size_t failed = next + std::min(answered, count - 1);
+        auto& record = results[failed];
+        if (answered < count) {
+            record.stdout_output = output;
+            record.execution_time = share;
+            record.from_cache = process.from_cache;
+        }
+        record.exit_code = process.exit_code;
+        record.timed_out = process.timed_out;
+        record.stderr_output = std::move(process.stderr_output);
+        next = failed + 1;
+    }
+    
+    return results;
+}
+
+void AsmTestRunner::assert_batch(std::span<const std::pair<TestInput, ExpectedOutput>> cases) const {
+    std::vector<TestInput> inputs;
+    inputs.reserve(cases.size());
+    for (const auto& [input, expected] : cases) {
+        inputs.push_back(input);
+    }
+    
+    auto results = run_batch(inputs);
+    for (size_t i = 0; i < cases.size(); ++i) {
+        const auto& [input, expected] = cases[i];
+        auto report = expected.mismatch_report(results[i]);
+        if (report.empty()) continue;
+        
+        std::string arguments;
+        for (const auto& arg : input.args()) {
+            if (!arguments.empty()) arguments += ' ';
+            arguments += arg;
+        }
+        ADD_FAILURE() << std::format("Batch record {} failed for executable: {}\n", i, executable_path_.string())
+                      << std::format("Arguments: {}\n", arguments)
+                      << report.render();
+    }
+}
+
 bool AsmTestRunner::executable_exists() const noexcept {
     return std::filesystem::exists(executable_path_) && 
            std::filesystem::is_regular_file(executable_path_);
@@ -469,4 +1017,44 @@ std::string AsmTestRunner::get_syntax_string() const noexcept {
     }
 }
 
+std::string quote_cpp_string(std::string_view text) {
+    std::string quoted;
+    quoted.reserve(text.size() + 2);
+    quoted += '"';
+    
+    for (char c : text) {
+        switch (c) {
+            case '"':  quoted += "\\\""; break;
+            case '\\': quoted += "\\\\"; break;
+            case '\n': quoted += "\\n"; break;
+            case '\t': quoted += "\\t"; break;
+            case '\r': quoted += "\\r"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20 || static_cast<unsigned char>(c) >= 0x7f) {
+                    // Octal escapes cannot swallow following hex digits
+                    quoted += std::format("\\{:03o}", static_cast<unsigned char>(c));
+                } else {
+                    quoted += c;
+                }
+        }
+    }
+    
+    quoted += '"';
+    return quoted;
+}
+
+std::string format_make_input(const TestInput& input, std::string_view indent) {
+    std::string code = "make_input()";
+    
+    for (const auto& arg : input.args()) {
+        code += std::format("\n{}.add_arg({})", indent, quote_cpp_string(arg));
+    }
+    
+    if (input.stdin_data().has_value()) {
+        code += std::format("\n{}.set_stdin({})", indent, quote_cpp_string(*input.stdin_data()));
+    }
+    
+    return code;
+}
+
 } // namespace x86_asm_test
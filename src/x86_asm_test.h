@@ -13,12 +13,21 @@
 #include <concepts>
 #include <type_traits>
 #include <filesystem>
+#include <functional>
 #include <memory>
+#include <memory_resource>
+#include <array>
 #include <optional>
 #include <span>
 #include <chrono>
+#include <charconv>
+#include <iterator>
 #include <ranges>
 #include <sstream>
+#include <utility>
+#include <sys/types.h>
+
+struct rusage;
 
 /**
  * @namespace x86_asm_test
@@ -54,11 +63,44 @@ enum class AsmSyntax : uint8_t {
  * @brief Contains the results of executing an assembly program
  */
 struct ExecutionResult {
+    using allocator_type = std::pmr::polymorphic_allocator<char>;
+    
     int exit_code{0};                                    ///< Process exit code
-    std::string stdout_output;                           ///< Standard output content
-    std::string stderr_output;                           ///< Standard error content
+    std::pmr::string stdout_output;                      ///< Standard output content
+    std::pmr::string stderr_output;                      ///< Standard error content
     std::chrono::milliseconds execution_time{0};         ///< Execution duration
     bool timed_out{false};                               ///< Whether execution timed out
+    bool from_cache{false};                              ///< Whether the result came from TestConfig::result_cache
+    uint64_t run_id{0};                                  ///< RunInfo::id of the observed run, 0 if unobserved
+    
+    ExecutionResult() = default;
+    ExecutionResult(const ExecutionResult&) = default;
+    ExecutionResult(ExecutionResult&&) noexcept = default;
+    ExecutionResult& operator=(const ExecutionResult&) = default;
+    ExecutionResult& operator=(ExecutionResult&&) = default;
+    
+    /**
+     * @brief Create an empty result whose output is allocated from a resource
+     * @param allocator Allocator for the output strings
+     */
+    explicit ExecutionResult(const allocator_type& allocator)
+        : stdout_output(allocator), stderr_output(allocator) {}
+    
+    /**
+     * @brief Copy a result into another resource
+     * @param other Result to copy
+     * @param allocator Allocator for the output strings
+     */
+    ExecutionResult(const ExecutionResult& other, const allocator_type& allocator)
+        : exit_code(other.exit_code), stdout_output(other.stdout_output, allocator),
+          stderr_output(other.stderr_output, allocator), execution_time(other.execution_time),
+          timed_out(other.timed_out), from_cache(other.from_cache), run_id(other.run_id) {}
+    
+    /**
+     * @brief Get the allocator of the output strings
+     * @return Allocator
+     */
+    [[nodiscard]] allocator_type get_allocator() const noexcept { return stdout_output.get_allocator(); }
     
     /**
      * @brief Check if the execution succeeded (exit code 0 and no timeout)
@@ -77,6 +119,22 @@ struct ExecutionResult {
     }
 };
 
+/**
+ * @struct BatchProtocol
+ * @brief Record framing used by AsmTestRunner::run_batch
+ *
+ * Each TestInput becomes one stdin record: its arguments joined by
+ * arg_separator, then its stdin data (if any) after another separator,
+ * terminated by input_delimiter. The program answers every record with
+ * exactly one stdout record terminated by output_delimiter.
+ */
+struct BatchProtocol {
+    std::string input_delimiter{"\n"};   ///< Terminates each stdin record
+    std::string output_delimiter{"\n"};  ///< Terminates each stdout record
+    std::string arg_separator{" "};      ///< Joins a record's arguments and stdin
+    size_t max_records{0};               ///< Records per process (0 = all in one process)
+};
+
 /**
  * @struct TestConfig
  * @brief Configuration options for test execution
@@ -87,6 +145,39 @@ struct TestConfig {
     bool use_strace{false};                                                      ///< Enable strace debugging
     std::vector<std::string> strace_options{"-e", "trace=write,read,exit_group"}; ///< Strace command options
     std::filesystem::path working_directory{std::filesystem::current_path()};    ///< Working directory for execution
+    std::optional<std::filesystem::path> result_cache{};                         ///< Persistent result cache file (opt-in)
+    BatchProtocol batch{};                                                       ///< Record framing for run_batch()
+};
+
+class ResultCache;
+class AsmSession;
+struct ChunkedResult;
+template<typename T> class Task;
+
+namespace detail {
+struct Submissions;
+struct RunObservation;
+
+/**
+ * @brief Check whether a directory is the current one without allocating
+ *
+ * std::filesystem::current_path() returns a fresh path on every call,
+ * which would be the only allocation left on the execution fast path.
+ *
+ * @param directory Directory to compare
+ * @return true if it names the working directory of the process
+ */
+[[nodiscard]] bool is_current_directory(const std::filesystem::path& directory) noexcept;
+}
+
+/**
+ * @struct RunHandle
+ * @brief Identifies a run started with AsmTestRunner::submit()
+ */
+struct RunHandle {
+    uint64_t id{0};   ///< Unique per runner, never 0 for a submitted run
+
+    friend constexpr bool operator==(RunHandle, RunHandle) = default;
 };
 
 /**
@@ -95,14 +186,128 @@ struct TestConfig {
  * 
  * This class provides a fluent interface for building test input with
  * command-line arguments and stdin data.
+ *
+ * All arguments live in one NUL-separated block, so adding an argument
+ * rarely allocates and the argv handed to execv() points straight into
+ * the block instead of copying every argument. The storage comes from a
+ * std::pmr::memory_resource (the default resource unless one is given).
  */
 class TestInput {
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<char>;
+
 private:
-    std::vector<std::string> args_;
-    std::optional<std::string> stdin_data_;
+    std::pmr::string arg_block_;             ///< Every argument followed by a NUL
+    std::pmr::vector<size_t> arg_starts_;    ///< Offset of each argument in arg_block_
+    std::optional<std::pmr::string> stdin_data_;
+
+    void append_arg(std::string_view arg) {
+        arg_starts_.push_back(arg_block_.size());
+        arg_block_.append(arg);
+        arg_block_.push_back('\0');
+    }
 
 public:
+    /**
+     * @class ArgList
+     * @brief Random-access view of the arguments as string views
+     *
+     * Valid as long as the TestInput is alive and unmodified.
+     */
+    class ArgList {
+    public:
+        /**
+         * @brief Iterator yielding std::string_view by value
+         */
+        class iterator {
+        public:
+            using iterator_category = std::input_iterator_tag;
+            using iterator_concept = std::random_access_iterator_tag;
+            using value_type = std::string_view;
+            using difference_type = std::ptrdiff_t;
+            using reference = std::string_view;
+            using pointer = void;
+
+            iterator() = default;
+            iterator(const TestInput* input, size_t index) noexcept : input_(input), index_(index) {}
+
+            reference operator*() const noexcept { return input_->arg(index_); }
+            reference operator[](difference_type n) const noexcept {
+                return input_->arg(index_ + static_cast<size_t>(n));
+            }
+
+            iterator& operator++() noexcept { ++index_; return *this; }
+            iterator operator++(int) noexcept { auto copy = *this; ++index_; return copy; }
+            iterator& operator--() noexcept { --index_; return *this; }
+            iterator operator--(int) noexcept { auto copy = *this; --index_; return copy; }
+            iterator& operator+=(difference_type n) noexcept { index_ += static_cast<size_t>(n); return *this; }
+            iterator& operator-=(difference_type n) noexcept { index_ -= static_cast<size_t>(n); return *this; }
+
+            friend iterator operator+(iterator it, difference_type n) noexcept { return it += n; }
+            friend iterator operator+(difference_type n, iterator it) noexcept { return it += n; }
+            friend iterator operator-(iterator it, difference_type n) noexcept { return it -= n; }
+            friend difference_type operator-(iterator a, iterator b) noexcept {
+                return static_cast<difference_type>(a.index_) - static_cast<difference_type>(b.index_);
+            }
+            friend bool operator==(iterator a, iterator b) noexcept { return a.index_ == b.index_; }
+            friend auto operator<=>(iterator a, iterator b) noexcept { return a.index_ <=> b.index_; }
+
+        private:
+            const TestInput* input_{nullptr};
+            size_t index_{0};
+        };
+
+        explicit ArgList(const TestInput& input) noexcept : input_(&input) {}
+
+        [[nodiscard]] iterator begin() const noexcept { return {input_, 0}; }
+        [[nodiscard]] iterator end() const noexcept { return {input_, size()}; }
+        [[nodiscard]] size_t size() const noexcept { return input_->size(); }
+        [[nodiscard]] bool empty() const noexcept { return input_->empty(); }
+        [[nodiscard]] std::string_view operator[](size_t index) const noexcept { return input_->arg(index); }
+
+        /**
+         * @brief Get an argument as a NUL-terminated string
+         * @param index Argument index
+         * @return Pointer into the argument block
+         */
+        [[nodiscard]] const char* c_str(size_t index) const noexcept {
+            return input_->arg_block_.data() + input_->arg_starts_[index];
+        }
+
+    private:
+        const TestInput* input_;
+    };
+
     TestInput() = default;
+    TestInput(const TestInput&) = default;
+    TestInput(TestInput&&) noexcept = default;
+    TestInput& operator=(const TestInput&) = default;
+    TestInput& operator=(TestInput&&) = default;
+    
+    /**
+     * @brief Create an empty input allocating from a resource
+     * @param allocator Allocator for arguments and stdin data
+     */
+    explicit TestInput(const allocator_type& allocator)
+        : arg_block_(allocator), arg_starts_(allocator) {}
+    
+    /**
+     * @brief Copy an input into another resource
+     * @param other Input to copy
+     * @param allocator Allocator for arguments and stdin data
+     */
+    TestInput(const TestInput& other, const allocator_type& allocator)
+        : arg_block_(other.arg_block_, allocator), arg_starts_(other.arg_starts_, allocator) {
+        if (other.stdin_data_) {
+            stdin_data_.emplace(*other.stdin_data_, allocator);
+        }
+    }
+    
+    /**
+     * @brief Get the allocator used for arguments and stdin data
+     * @return Allocator
+     */
+    [[nodiscard]] allocator_type get_allocator() const noexcept { return arg_block_.get_allocator(); }
     
     /**
      * @brief Add a single string-like argument
@@ -111,22 +316,34 @@ public:
      * @return Reference to this object for chaining
      */
     template<StringLike T>
-    TestInput& add_arg(T&& arg) {
-        args_.emplace_back(std::forward<T>(arg));
+    TestInput& add_arg(T&& arg) & {
+        append_arg(std::string_view(arg));
         return *this;
     }
     
     /**
      * @brief Add an arithmetic argument (automatically converted to string)
+     *
+     * Numbers are formatted with std::to_chars (shortest round-trip form
+     * for floating point); bool becomes "1" or "0" and character types
+     * are added as the character itself.
+     *
      * @tparam T Arithmetic type
      * @param value The numeric value to add
      * @return Reference to this object for chaining
      */
     template<Arithmetic T>
-    TestInput& add_arg(T value) {
-        std::ostringstream oss;
-        oss << value;
-        args_.emplace_back(oss.str());
+    TestInput& add_arg(T value) & {
+        if constexpr (std::same_as<T, bool>) {
+            append_arg(value ? "1" : "0");
+        } else if constexpr (std::same_as<T, char> || std::same_as<T, signed char> ||
+                             std::same_as<T, unsigned char>) {
+            append_arg(std::string_view(reinterpret_cast<const char*>(&value), 1));
+        } else {
+            char buffer[64];
+            auto [end, error] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            append_arg(std::string_view(buffer, static_cast<size_t>(end - buffer)));
+        }
         return *this;
     }
     
@@ -137,7 +354,7 @@ public:
      * @return Reference to this object for chaining
      */
     template<std::ranges::input_range R>
-    TestInput& add_args(R&& range) {
+    TestInput& add_args(R&& range) & {
         for (const auto& item : range) {
             add_arg(item);
         }
@@ -151,34 +368,199 @@ public:
      * @return Reference to this object for chaining
      */
     template<StringLike T>
-    TestInput& set_stdin(T&& data) {
-        stdin_data_ = std::forward<T>(data);
+    TestInput& set_stdin(T&& data) & {
+        stdin_data_.emplace(std::string_view(data), get_allocator());
+        return *this;
+    }
+    
+    /**
+     * @brief Set stdin data, taking over the string's buffer
+     *
+     * The buffer is moved when the string uses this input's memory
+     * resource and copied otherwise.
+     * @param data The data to send to stdin
+     * @return Reference to this object for chaining
+     */
+    TestInput& set_stdin(std::pmr::string&& data) & {
+        stdin_data_.emplace(std::move(data), get_allocator());
         return *this;
     }
     
     /**
-     * @brief Get arguments as a span
-     * @return Span view of the arguments
+     * @name Rvalue overloads
+     * Chaining on a temporary (make_input().add_arg(1)) moves the input
+     * out instead of copying it, so it keeps its memory resource. The
+     * result is returned by value: binding it to a reference extends its
+     * lifetime instead of dangling.
+     * @{
+     */
+    template<StringLike T>
+    TestInput add_arg(T&& arg) && { return std::move(add_arg(std::forward<T>(arg))); }
+    template<Arithmetic T>
+    TestInput add_arg(T value) && { return std::move(add_arg(value)); }
+    template<std::ranges::input_range R>
+    TestInput add_args(R&& range) && { return std::move(add_args(std::forward<R>(range))); }
+    template<StringLike T>
+    TestInput set_stdin(T&& data) && { return std::move(set_stdin(std::forward<T>(data))); }
+    /** @} */
+    
+    /**
+     * @brief Remove all arguments and stdin data
+     *
+     * The argument block keeps its capacity, so refilling an input of
+     * similar size does not allocate.
+     */
+    void clear() noexcept {
+        arg_block_.clear();
+        arg_starts_.clear();
+        stdin_data_.reset();
+    }
+    
+    /**
+     * @brief Get arguments as a view
+     * @return Random-access view of the arguments
      */
-    [[nodiscard]] std::span<const std::string> args() const noexcept { return args_; }
+    [[nodiscard]] ArgList args() const noexcept { return ArgList(*this); }
+    
+    /**
+     * @brief Get a single argument
+     * @param index Argument index (must be below size())
+     * @return View into the argument block
+     */
+    [[nodiscard]] std::string_view arg(size_t index) const noexcept {
+        size_t start = arg_starts_[index];
+        size_t stop = index + 1 < arg_starts_.size() ? arg_starts_[index + 1] : arg_block_.size();
+        return std::string_view(arg_block_).substr(start, stop - start - 1);
+    }
+    
+    /**
+     * @brief Build the argv array for execv() without copying arguments
+     * @param program Path placed in argv[0]
+     * @param argv Receives program, pointers into the argument block and a
+     *             terminating nullptr; its capacity is reused
+     */
+    void fill_argv(const char* program, std::vector<char*>& argv) const {
+        argv.clear();
+        argv.push_back(const_cast<char*>(program));
+        for (size_t start : arg_starts_) {
+            argv.push_back(const_cast<char*>(arg_block_.data() + start));
+        }
+        argv.push_back(nullptr);
+    }
     
     /**
      * @brief Get stdin data
      * @return Optional stdin data
      */
-    [[nodiscard]] const std::optional<std::string>& stdin_data() const noexcept { return stdin_data_; }
+    [[nodiscard]] const std::optional<std::pmr::string>& stdin_data() const noexcept { return stdin_data_; }
     
     /**
      * @brief Check if no arguments have been added
      * @return true if empty
      */
-    [[nodiscard]] bool empty() const noexcept { return args_.empty(); }
+    [[nodiscard]] bool empty() const noexcept { return arg_starts_.empty(); }
     
     /**
      * @brief Get number of arguments
      * @return Number of arguments
      */
-    [[nodiscard]] size_t size() const noexcept { return args_.size(); }
+    [[nodiscard]] size_t size() const noexcept { return arg_starts_.size(); }
+};
+
+/**
+ * @struct MismatchReport
+ * @brief Compact record of why a result did not match an ExpectedOutput
+ *
+ * Built without allocating: each failed expectation keeps sizes, the
+ * offset of the first differing byte, hashes of both sides and short
+ * excerpts instead of whole outputs. Text is only produced by render(),
+ * which caps its size, so failure-heavy runs (fuzzing, mutation testing,
+ * big batches) do not spend their time formatting megabytes of output.
+ */
+struct MismatchReport {
+    static constexpr size_t kExcerptSize = 32;   ///< Bytes kept per excerpt
+    static constexpr size_t kMaxEntries = 8;     ///< Failures recorded in detail
+
+    /**
+     * @enum Kind
+     * @brief Which expectation failed
+     */
+    enum class Kind : uint8_t {
+        ExitCode,        ///< Exit code differs
+        StdoutDiffers,   ///< stdout_equals() failed
+        StderrDiffers,   ///< stderr_equals() failed
+        StdoutMissing,   ///< A stdout_contains() pattern was not found
+        StderrMissing    ///< A stderr_contains() pattern was not found
+    };
+
+    /**
+     * @struct Excerpt
+     * @brief A few bytes of a longer text
+     */
+    struct Excerpt {
+        size_t offset{0};                           ///< Position of the first byte in the text
+        size_t size{0};                             ///< Bytes stored
+        std::array<char, kExcerptSize> bytes{};
+
+        [[nodiscard]] std::string_view view() const noexcept { return {bytes.data(), size}; }
+    };
+
+    /**
+     * @struct Entry
+     * @brief One failed expectation
+     *
+     * For ExitCode only the codes are set. For the *Differs kinds the
+     * excerpts start shortly before first_difference; for the *Missing
+     * kinds "expected" holds the head of the pattern and "actual" the
+     * head of the output.
+     */
+    struct Entry {
+        Kind kind{Kind::ExitCode};
+        int expected_code{0};
+        int actual_code{0};
+        size_t first_difference{0};   ///< Offset of the first differing byte
+        size_t expected_size{0};      ///< Size of the expected text or pattern
+        size_t actual_size{0};        ///< Size of the actual output
+        uint64_t expected_hash{0};
+        uint64_t actual_hash{0};
+        Excerpt expected;
+        Excerpt actual;
+    };
+
+    std::array<Entry, kMaxEntries> entries{};
+    size_t count{0};     ///< Entries stored
+    size_t dropped{0};   ///< Failures beyond kMaxEntries, counted only
+
+    /**
+     * @brief Check whether every expectation held
+     * @return true if nothing failed
+     */
+    [[nodiscard]] bool empty() const noexcept { return count == 0 && dropped == 0; }
+
+    /**
+     * @brief Get the recorded failures
+     * @return Entries in expectation order
+     */
+    [[nodiscard]] std::span<const Entry> failures() const noexcept { return {entries.data(), count}; }
+
+    /**
+     * @brief Record a failure (counted in dropped once full)
+     * @param entry Failure to record
+     */
+    void add(const Entry& entry) noexcept {
+        if (count < kMaxEntries) {
+            entries[count++] = entry;
+        } else {
+            ++dropped;
+        }
+    }
+
+    /**
+     * @brief Format the report
+     * @param max_size Upper bound on the returned text
+     * @return Human-readable description, escaped and truncated
+     */
+    [[nodiscard]] std::string render(size_t max_size = 4096) const;
 };
 
 /**
@@ -189,15 +571,48 @@ public:
  * or substring containment checks.
  */
 class ExpectedOutput {
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<char>;
+
 private:
-    std::optional<std::string> exact_stdout_;
-    std::optional<std::string> exact_stderr_;
-    std::vector<std::string> stdout_contains_;
-    std::vector<std::string> stderr_contains_;
+    std::optional<std::pmr::string> exact_stdout_;
+    std::optional<std::pmr::string> exact_stderr_;
+    std::pmr::vector<std::pmr::string> stdout_contains_;
+    std::pmr::vector<std::pmr::string> stderr_contains_;
     std::optional<int> expected_exit_code_;
     
 public:
     ExpectedOutput() = default;
+    ExpectedOutput(const ExpectedOutput&) = default;
+    ExpectedOutput(ExpectedOutput&&) noexcept = default;
+    ExpectedOutput& operator=(const ExpectedOutput&) = default;
+    ExpectedOutput& operator=(ExpectedOutput&&) = default;
+    
+    /**
+     * @brief Create an empty expectation allocating from a resource
+     * @param allocator Allocator for the patterns
+     */
+    explicit ExpectedOutput(const allocator_type& allocator)
+        : stdout_contains_(allocator), stderr_contains_(allocator) {}
+    
+    /**
+     * @brief Copy an expectation into another resource
+     * @param other Expectation to copy
+     * @param allocator Allocator for the patterns
+     */
+    ExpectedOutput(const ExpectedOutput& other, const allocator_type& allocator)
+        : stdout_contains_(other.stdout_contains_, allocator),
+          stderr_contains_(other.stderr_contains_, allocator),
+          expected_exit_code_(other.expected_exit_code_) {
+        if (other.exact_stdout_) exact_stdout_.emplace(*other.exact_stdout_, allocator);
+        if (other.exact_stderr_) exact_stderr_.emplace(*other.exact_stderr_, allocator);
+    }
+    
+    /**
+     * @brief Get the allocator used for the patterns
+     * @return Allocator
+     */
+    [[nodiscard]] allocator_type get_allocator() const noexcept { return stdout_contains_.get_allocator(); }
     
     /**
      * @brief Expect exact stdout match
@@ -206,8 +621,8 @@ public:
      * @return Reference to this object for chaining
      */
     template<StringLike T>
-    ExpectedOutput& stdout_equals(T&& expected) {
-        exact_stdout_ = std::forward<T>(expected);
+    ExpectedOutput& stdout_equals(T&& expected) & {
+        exact_stdout_.emplace(std::string_view(expected), get_allocator());
         return *this;
     }
     
@@ -218,8 +633,8 @@ public:
      * @return Reference to this object for chaining
      */
     template<StringLike T>
-    ExpectedOutput& stderr_equals(T&& expected) {
-        exact_stderr_ = std::forward<T>(expected);
+    ExpectedOutput& stderr_equals(T&& expected) & {
+        exact_stderr_.emplace(std::string_view(expected), get_allocator());
         return *this;
     }
     
@@ -230,8 +645,8 @@ public:
      * @return Reference to this object for chaining
      */
     template<StringLike T>
-    ExpectedOutput& stdout_contains(T&& pattern) {
-        stdout_contains_.emplace_back(std::forward<T>(pattern));
+    ExpectedOutput& stdout_contains(T&& pattern) & {
+        stdout_contains_.emplace_back(std::string_view(pattern));
         return *this;
     }
     
@@ -242,8 +657,8 @@ public:
      * @return Reference to this object for chaining
      */
     template<StringLike T>
-    ExpectedOutput& stderr_contains(T&& pattern) {
-        stderr_contains_.emplace_back(std::forward<T>(pattern));
+    ExpectedOutput& stderr_contains(T&& pattern) & {
+        stderr_contains_.emplace_back(std::string_view(pattern));
         return *this;
     }
     
@@ -252,11 +667,29 @@ public:
      * @param code Expected exit code
      * @return Reference to this object for chaining
      */
-    ExpectedOutput& exit_code(int code) noexcept {
+    ExpectedOutput& exit_code(int code) & noexcept {
         expected_exit_code_ = code;
         return *this;
     }
     
+    /**
+     * @name Rvalue overloads
+     * Chaining on a temporary (expect_success().stdout_equals("1")) moves
+     * the expectation out instead of copying it, so it keeps its memory
+     * resource. The result is returned by value, as for TestInput.
+     * @{
+     */
+    template<StringLike T>
+    ExpectedOutput stdout_equals(T&& expected) && { return std::move(stdout_equals(std::forward<T>(expected))); }
+    template<StringLike T>
+    ExpectedOutput stderr_equals(T&& expected) && { return std::move(stderr_equals(std::forward<T>(expected))); }
+    template<StringLike T>
+    ExpectedOutput stdout_contains(T&& pattern) && { return std::move(stdout_contains(std::forward<T>(pattern))); }
+    template<StringLike T>
+    ExpectedOutput stderr_contains(T&& pattern) && { return std::move(stderr_contains(std::forward<T>(pattern))); }
+    ExpectedOutput exit_code(int code) && noexcept { return std::move(exit_code(code)); }
+    /** @} */
+    
     /**
      * @brief Check if the actual result matches expectations
      * @param result The execution result to check
@@ -264,12 +697,33 @@ public:
      */
     [[nodiscard]] bool matches(const ExecutionResult& result) const noexcept;
     
+    /**
+     * @brief Check a chunked result without joining its output
+     * @param result Result of AsmTestRunner::run_chunked()
+     * @return true if all expectations match
+     */
+    [[nodiscard]] bool matches(const ChunkedResult& result) const noexcept;
+    
     /**
      * @brief Get a description of mismatches
      * @param result The execution result to compare against
      * @return String describing what didn't match
      */
     [[nodiscard]] std::string get_mismatch_description(const ExecutionResult& result) const;
+    
+    /**
+     * @brief Record mismatches without formatting anything
+     * @param result The execution result to compare against
+     * @return Report, empty if the result matches
+     */
+    [[nodiscard]] MismatchReport mismatch_report(const ExecutionResult& result) const noexcept;
+    
+    /**
+     * @brief Get a description of mismatches of a chunked result
+     * @param result Result of AsmTestRunner::run_chunked()
+     * @return String describing what didn't match
+     */
+    [[nodiscard]] std::string get_mismatch_description(const ChunkedResult& result) const;
 };
 
 /**
@@ -284,32 +738,34 @@ private:
     std::filesystem::path executable_path_;
     AsmSyntax syntax_;
     TestConfig config_;
+    std::shared_ptr<ResultCache> cache_;
+    std::shared_ptr<detail::Submissions> submissions_;   ///< Created by the first submit()/event_fd()
     
     /**
      * @brief Execute process with regular system calls
-     * @param args Command line arguments
-     * @param stdin_data Optional stdin data
-     * @return Execution result
+     * @param input Arguments and stdin data
+     * @param result Overwritten with the result; its buffers are reused
+     * @param observed Observers to notify, nullptr if none are registered
      */
-    [[nodiscard]] ExecutionResult execute_process(
-        std::span<const std::string> args,
-        const std::optional<std::string>& stdin_data = std::nullopt
-    ) const;
+    void execute_process(const TestInput& input, ExecutionResult& result,
+                         detail::RunObservation* observed) const;
     
     /**
      * @brief Execute process with strace for debugging
-     * @param args Command line arguments
-     * @param stdin_data Optional stdin data
-     * @return Execution result
+     * @param input Arguments and stdin data
+     * @param result Overwritten with the result
+     * @param observed Observers to notify, nullptr if none are registered
      */
-    [[nodiscard]] ExecutionResult execute_with_strace(
-        std::span<const std::string> args,
-        const std::optional<std::string>& stdin_data = std::nullopt
-    ) const;
+    void execute_with_strace(const TestInput& input, ExecutionResult& result,
+                             detail::RunObservation* observed) const;
 
 public:
     /**
      * @brief Construct a test runner for an assembly executable
+     *
+     * If set_executable_substitution() names executable_path, its
+     * replacement is run instead (used by mutation testing).
+     *
      * @param executable_path Path to the executable
      * @param syntax Assembly syntax used (default: Intel)
      * @param config Test configuration (default: empty config)
@@ -333,11 +789,46 @@ public:
     
     /**
      * @brief Execute the assembly program with given input
+     *
+     * With TestConfig::result_cache set, a result recorded earlier for the
+     * same executable contents, input and config is returned without
+     * running the program. Timed-out and strace runs are never cached.
+     *
      * @param input Test input containing arguments and stdin data
      * @return Execution result
      */
     [[nodiscard]] ExecutionResult run_test(const TestInput& input) const;
-    
+
+    /**
+     * @brief Execute the program into an existing result
+     *
+     * Same as run_test(const TestInput&), but the output strings of
+     * result are cleared and refilled instead of reallocated. Once they
+     * have grown to the program's output size, an uncached run performs
+     * no heap allocation, which keeps sweeps over millions of inputs off
+     * the allocator.
+     *
+     * @param input Test input containing arguments and stdin data
+     * @param result Overwritten with the execution result
+     */
+    void run_test(const TestInput& input, ExecutionResult& result) const;
+
+    /**
+     * @brief Execute the program, capturing output into pooled chunks
+     *
+     * For programs with very large output: stdout and stderr are read
+     * straight into 64 KB chunks recycled through OutputChunkPool instead
+     * of one growing string. Match the result with
+     * ExpectedOutput::matches(const ChunkedResult&), which only joins the
+     * chunks when a mismatch has to be described. The result cache,
+     * execution hooks and strace are not used. Include x86_asm_output.h
+     * to use it.
+     *
+     * @param input Test input containing arguments and stdin data
+     * @return Execution result with chunked output
+     */
+    [[nodiscard]] ChunkedResult run_chunked(const TestInput& input) const;
+
     /**
      * @brief Execute and assert that output matches expectations
      * @param input Test input
@@ -346,6 +837,104 @@ public:
      */
     void assert_output(const TestInput& input, const ExpectedOutput& expected) const;
     
+    /**
+     * @brief Run many inputs through as few processes as possible
+     *
+     * Inputs are framed with TestConfig::batch and written to one process
+     * (or one per max_records), and stdout is split back into records. A
+     * record's stdout keeps its delimiter, so with the default newline
+     * framing expectations written for single runs still match. A record
+     * that completes has exit code 0 and a share of the process time.
+     *
+     * If the process exits or times out early, the first unanswered record
+     * is re-run on its own (the output of earlier records may have been
+     * buffered and lost). If it fails again it receives the exit code,
+     * timeout flag, stderr and any partial output of that run, and the
+     * remaining records continue in a fresh process.
+     *
+     * @param inputs Inputs, one record each
+     * @return One result per input, in order
+     * @throws std::invalid_argument if a delimiter is empty or a record contains the input delimiter
+     */
+    [[nodiscard]] std::vector<ExecutionResult> run_batch(std::span<const TestInput> inputs) const;
+    
+    /**
+     * @brief Run a batch and check every record against its expectation
+     * @param cases Inputs with their expected output
+     * @throws Google Test non-fatal failure for each mismatching record
+     */
+    void assert_batch(std::span<const std::pair<TestInput, ExpectedOutput>> cases) const;
+    
+    /**
+     * @brief Start the program for a request/response conversation
+     *
+     * Defined in x86_asm_session.h, which must be included to use the
+     * returned session. Sessions do not use the result cache or strace.
+     *
+     * @param args Command-line arguments (stdin data is ignored)
+     * @return Session owning the running process
+     * @throws std::runtime_error if the process cannot be started
+     */
+    [[nodiscard]] AsmSession open_session(const TestInput& args = {}) const;
+    
+    /**
+     * @brief Run the program without blocking the calling thread
+     *
+     * Defined in x86_asm_async.h. The returned task starts the process
+     * when awaited and completes when it exited and its output was read;
+     * many runs progress together on the awaiting thread's reactor. With
+     * strace or an execution hook active, the run happens synchronously
+     * inside this call instead.
+     *
+     * @param input Test input (copied into the task)
+     * @return Task producing the execution result; the runner must outlive it
+     */
+    [[nodiscard]] Task<ExecutionResult> run_async(const TestInput& input) const;
+    
+    /**
+     * @brief Start a run for an external event loop, without blocking
+     *
+     * Defined in x86_asm_async.cpp. Runs progress only inside poll(), so
+     * the caller waits on event_fd() and polls when it becomes readable.
+     * Unlike run_async(), submitted runs always start a fresh process:
+     * they neither consult nor fill the result cache, and config.use_strace
+     * and execution hooks are ignored. Not thread-safe: use from the thread running the event loop.
+     *
+     * @param input Test input (copied)
+     * @return Handle to poll or cancel the run; if the process could not
+     *         be started, poll() rethrows the error
+     */
+    [[nodiscard]] RunHandle submit(const TestInput& input);
+    
+    /**
+     * @brief Get a descriptor that becomes readable when poll() can make progress
+     *
+     * It is an epoll descriptor covering the pipes, pidfds and timeout
+     * timer of all submitted runs; add it to an existing epoll or poll set.
+     *
+     * @return File descriptor owned by the runner
+     */
+    [[nodiscard]] int event_fd();
+    
+    /**
+     * @brief Advance submitted runs without blocking and check one of them
+     *
+     * A finished run's handle is released when its result is returned.
+     *
+     * @param handle Handle returned by submit()
+     * @return The result if the run finished, nullopt otherwise
+     * @throws std::invalid_argument if the handle is unknown or already released
+     * @throws std::runtime_error if the run could not be started
+     */
+    [[nodiscard]] std::optional<ExecutionResult> poll(RunHandle handle);
+    
+    /**
+     * @brief Kill a submitted run and release its handle
+     * @param handle Handle returned by submit()
+     * @return false if the handle was unknown or already released
+     */
+    bool cancel(RunHandle handle);
+    
     /**
      * @brief Get current test configuration
      * @return Reference to current config
@@ -355,8 +944,9 @@ public:
     /**
      * @brief Set new test configuration
      * @param new_config New configuration to use
+     * @throws std::runtime_error if the configured result cache cannot be opened
      */
-    void set_config(TestConfig new_config) noexcept { config_ = std::move(new_config); }
+    void set_config(TestConfig new_config);
     
     /**
      * @brief Get current assembly syntax
@@ -391,14 +981,218 @@ public:
     [[nodiscard]] std::string get_syntax_string() const noexcept;
 };
 
+/**
+ * @brief Process-wide replacement for starting the program under test
+ *
+ * While installed, AsmTestRunner::run_test calls the hook instead of
+ * executing the program itself, bypassing the result cache. The hook may be
+ * called concurrently. Used to collect coverage from ordinary tests.
+ *
+ * Run observers see a hooked run through the hook: if it returns a result
+ * with run_id set (CoverageTracer::run observes its runs), that run with
+ * all its phases stands for the call; otherwise only on_run() is notified.
+ */
+using ExecutionHook = std::function<ExecutionResult(const AsmTestRunner&, const TestInput&)>;
+
+/**
+ * @brief Install or remove (with an empty hook) the process-wide execution hook
+ * @param hook Hook to install
+ */
+void set_execution_hook(ExecutionHook hook);
+
+/**
+ * @brief Check whether an execution hook is installed
+ * @return true while set_execution_hook() holds a hook
+ */
+[[nodiscard]] bool has_execution_hook() noexcept;
+
+/**
+ * @brief Make AsmTestRunners for one executable run another instead
+ *
+ * Applies to runners constructed afterwards whose path refers to the same
+ * file as original. Used by mutation testing to run existing tests against
+ * a mutant. An empty original removes the substitution.
+ *
+ * @param original Executable the tests name
+ * @param replacement Executable to run in its place
+ */
+void set_executable_substitution(std::filesystem::path original, std::filesystem::path replacement);
+
+/**
+ * @struct ResourceUsage
+ * @brief Resources a reaped child consumed (from wait4())
+ */
+struct ResourceUsage {
+    std::chrono::microseconds user_time{0};     ///< CPU time in user mode
+    std::chrono::microseconds system_time{0};   ///< CPU time in the kernel
+    long max_rss_kb{0};                         ///< Peak resident set size
+    long minor_faults{0};                       ///< Page faults served without I/O
+    long major_faults{0};                       ///< Page faults that needed I/O
+    long voluntary_switches{0};                 ///< Context switches while waiting
+    long involuntary_switches{0};               ///< Context switches by preemption
+};
+
+/**
+ * @struct RunInfo
+ * @brief Identity and timestamps of one observed run
+ *
+ * Timestamps are filled in as the run progresses; a callback can read
+ * every timestamp of the phases before it.
+ */
+struct RunInfo {
+    using Clock = std::chrono::steady_clock;
+
+    uint64_t id{0};                                  ///< Unique per run in this process
+    const std::filesystem::path* executable{nullptr};
+    const TestInput* input{nullptr};
+    bool asynchronous{false};                        ///< Started by submit() or run_async()
+    Clock::time_point queued{};                      ///< submit() or entry into run_test()
+    Clock::time_point spawned{};                     ///< Before the pipes and fork()
+    Clock::time_point executed{};                    ///< fork() returned in the parent
+    Clock::time_point first_output{};                ///< First output chunk, after its on_output()
+    Clock::time_point exited{};                      ///< The child was reaped
+    uint64_t output_bytes{0};                        ///< Output received before the current chunk
+    uint64_t output_chunks{0};                       ///< Output chunks before the current one
+    ResourceUsage usage{};                           ///< Child's resource usage, set before on_exit()
+};
+
+/**
+ * @enum OutputStream
+ * @brief Stream an output chunk was read from
+ */
+enum class OutputStream : uint8_t { Stdout, Stderr };
+
+/**
+ * @class RunObserver
+ * @brief Callbacks at well-defined points of every run, with monotonic timestamps
+ *
+ * Register with add_run_observer(). Callbacks run on the thread that
+ * advances the run (the caller of run_test(), or a reactor thread for
+ * asynchronous runs), possibly concurrently, and must not throw. While
+ * no observer is registered, a run costs one atomic load and a null
+ * check per instrumentation point.
+ */
+class RunObserver {
+public:
+    using Clock = RunInfo::Clock;
+
+    virtual ~RunObserver() = default;
+
+    /// Before the pipes are created and the child is forked
+    virtual void on_spawn(const RunInfo&, Clock::time_point) noexcept {}
+    /// The child was forked and is executing the program
+    virtual void on_exec(const RunInfo&, Clock::time_point, pid_t) noexcept {}
+    /// A chunk of stdout or stderr was read (uncaptured stderr included)
+    virtual void on_output(const RunInfo&, Clock::time_point, OutputStream, std::string_view) noexcept {}
+    /// The child was reaped
+    virtual void on_exit(const RunInfo&, Clock::time_point, int /*exit_code*/, bool /*timed_out*/) noexcept {}
+    /// The run finished, including runs answered by the cache or an execution hook
+    virtual void on_run(const RunInfo&, Clock::time_point, const ExecutionResult&) noexcept {}
+    /// ExpectedOutput::matches() checked a result; only run.id (the result's run_id) is set
+    virtual void on_match(const RunInfo&, Clock::time_point /*begin*/, Clock::time_point /*end*/,
+                          bool /*matched*/) noexcept {}
+    /// ExpectedOutput::mismatch_report() described a result; only run.id (the result's run_id) is set
+    virtual void on_report(const RunInfo&, Clock::time_point /*begin*/, Clock::time_point /*end*/,
+                           const MismatchReport&) noexcept {}
+};
+
+/**
+ * @brief Register a process-wide run observer
+ *
+ * Runs already in progress keep the observers they started with.
+ *
+ * @param observer Observer to notify (shared with runs in progress)
+ */
+void add_run_observer(std::shared_ptr<RunObserver> observer);
+
+/**
+ * @brief Unregister a run observer
+ * @param observer Observer passed to add_run_observer()
+ */
+void remove_run_observer(const RunObserver* observer);
+
+/**
+ * @brief Check whether a run observer is registered
+ * @return true while at least one observer is registered
+ */
+[[nodiscard]] bool has_run_observers() noexcept;
+
+namespace detail {
+
+using RunObserverList = std::vector<std::shared_ptr<RunObserver>>;
+
+/**
+ * @brief Snapshot of the registered observers
+ * @return nullptr (after a single atomic load) if none are registered
+ */
+[[nodiscard]] std::shared_ptr<const RunObserverList> current_run_observers() noexcept;
+
+/**
+ * @brief Allocate a run id
+ * @return Id unique within the process
+ */
+[[nodiscard]] uint64_t next_run_id() noexcept;
+
+/**
+ * @struct RunObservation
+ * @brief Observers captured when a run starts, and its RunInfo
+ */
+struct RunObservation {
+    std::shared_ptr<const RunObserverList> observers;
+    RunInfo info;
+
+    /**
+     * @brief Call a RunObserver member on every observer, passing info first
+     */
+    template<typename Event, typename... Args>
+    void notify(Event event, const Args&... args) const noexcept {
+        for (const auto& observer : *observers) {
+            ((*observer).*event)(info, args...);
+        }
+    }
+
+    /**
+     * @brief Notify an output chunk, then count it in info
+     */
+    void output(RunInfo::Clock::time_point at, OutputStream stream, std::string_view data) noexcept {
+        notify(&RunObserver::on_output, at, stream, data);
+        if (info.output_chunks++ == 0) info.first_output = at;
+        info.output_bytes += data.size();
+    }
+
+    /**
+     * @brief Record how the child ended and notify on_exit()
+     * @param usage rusage filled by wait4()
+     */
+    void exit(RunInfo::Clock::time_point at, int exit_code, bool timed_out, const ::rusage& usage) noexcept;
+};
+
+} // namespace detail
+
 /**
  * @class AsmTestFixture
  * @brief Google Test fixture for assembly testing with RAII resource management
  * 
  * This class provides a convenient base for writing Google Test test cases
  * that test assembly programs. It handles runner lifecycle automatically.
+ *
+ * Inputs and expectations built with the fixture's make_input(),
+ * expect_success() and expect_failure() allocate from a per-test
+ * monotonic arena that is released in TearDown(), so suites creating
+ * many of them stay off the global heap. The arena is not thread-safe:
+ * grow such objects on the test's thread only (copies use the default
+ * resource and may go anywhere).
+ *
+ * Such objects, and anything they were moved into, must not outlive the
+ * test: after TearDown() their memory is gone. To keep one (in a static,
+ * a corpus or a runner that outlives the fixture), store a copy rather
+ * than moving it.
  */
 class AsmTestFixture : public ::testing::Test {
+private:
+    alignas(std::max_align_t) std::byte arena_buffer_[16 * 1024];
+    std::pmr::monotonic_buffer_resource arena_{arena_buffer_, sizeof(arena_buffer_)};
+
 protected:
     std::unique_ptr<AsmTestRunner> runner_;
     
@@ -410,12 +1204,38 @@ protected:
     }
     
     /**
-     * @brief Clean up the test fixture (automatic due to RAII)
+     * @brief Clean up the test fixture and release the per-test arena
      */
     void TearDown() override {
         runner_.reset();
+        arena_.release();
     }
     
+    /**
+     * @brief Get the per-test arena
+     * @return Memory resource released in TearDown()
+     */
+    [[nodiscard]] std::pmr::memory_resource* memory_resource() noexcept { return &arena_; }
+    
+    /**
+     * @brief Create an empty TestInput in the per-test arena
+     * @return New TestInput object, valid until TearDown()
+     */
+    [[nodiscard]] TestInput make_input() { return TestInput(&arena_); }
+    
+    /**
+     * @brief Create an ExpectedOutput for successful execution in the per-test arena
+     * @return ExpectedOutput configured for success (exit code 0)
+     */
+    [[nodiscard]] ExpectedOutput expect_success() { return ExpectedOutput(&arena_).exit_code(0); }
+    
+    /**
+     * @brief Create an ExpectedOutput for failed execution in the per-test arena
+     * @param code Expected exit code (default: 1)
+     * @return ExpectedOutput configured for failure
+     */
+    [[nodiscard]] ExpectedOutput expect_failure(int code = 1) { return ExpectedOutput(&arena_).exit_code(code); }
+    
 public:
     /**
      * @brief Create a new test runner with the given arguments
@@ -487,4 +1307,19 @@ public:
     return ExpectedOutput{}.exit_code(code);
 }
 
+/**
+ * @brief Quote a string as a C++ string literal
+ * @param text Raw bytes
+ * @return Literal including the surrounding quotes, with escapes
+ */
+[[nodiscard]] std::string quote_cpp_string(std::string_view text);
+
+/**
+ * @brief Render a TestInput as the make_input() expression that rebuilds it
+ * @param input Input to render
+ * @param indent Indentation used for the chained calls
+ * @return C++ source text, e.g. make_input()\n        .add_arg("10")
+ */
+[[nodiscard]] std::string format_make_input(const TestInput& input, std::string_view indent = "        ");
+
 } // namespace x86_asm_test
@@ -0,0 +1,302 @@
+/**
+ * @file x86_asm_trace.cpp
+ * @brief Implementation of the Chrome trace recorder
+ */
+
+#include "x86_asm_trace.h"
+#include <cstdio>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace x86_asm_test {
+
+namespace {
+
+void append_json_string(std::string& out, std::string_view text) {
+    out += '"';
+    for (char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    out += std::format("\\u{:04x}", static_cast<unsigned>(c));
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+/**
+ * @brief Turns run notifications into timeline events
+ */
+class TraceObserver : public RunObserver {
+public:
+    explicit TraceObserver(TraceRecorder& recorder) : recorder_(recorder) {}
+
+    void on_spawn(const RunInfo& run, Clock::time_point at) noexcept override {
+        if (run.asynchronous) recorder_.async_span("queued", run.id, run.queued, at);
+    }
+
+    void on_exec(const RunInfo& run, Clock::time_point at, pid_t) noexcept override {
+        recorder_.span("spawn", run.spawned, at);
+        recorder_.process_started(at);
+    }
+
+    void on_output(const RunInfo& run, Clock::time_point at, OutputStream, std::string_view) noexcept override {
+        if (run.output_bytes == 0) recorder_.instant("first byte", at);
+    }
+
+    void on_exit(const RunInfo& run, Clock::time_point at, int exit_code, bool) noexcept override {
+        // Asynchronous runs overlap on the reactor thread
+        if (run.asynchronous) {
+            recorder_.async_span("exec", run.id, run.executed, at);
+        } else {
+            recorder_.span("exec", run.executed, at);
+        }
+        recorder_.process_exited(at, exit_code);
+    }
+
+    void on_run(const RunInfo& run, Clock::time_point at, const ExecutionResult&) noexcept override {
+        if (run.asynchronous) return;
+        try {
+            std::string detail = run.executable->filename().string();
+            for (auto arg : run.input->args()) {
+                detail += ' ';
+                detail += arg;
+            }
+            recorder_.span("run", run.queued, at, detail);
+        } catch (...) {
+        }
+    }
+
+    void on_match(const RunInfo&, Clock::time_point begin, Clock::time_point end, bool) noexcept override {
+        recorder_.span("match", begin, end);
+    }
+
+    void on_report(const RunInfo&, Clock::time_point begin, Clock::time_point end, const MismatchReport&) noexcept override {
+        recorder_.span("report", begin, end);
+    }
+
+private:
+    TraceRecorder& recorder_;
+};
+
+} // namespace
+
+TraceRecorder& TraceRecorder::instance() {
+    static TraceRecorder recorder;
+    return recorder;
+}
+
+void TraceRecorder::start() {
+    {
+        std::lock_guard lock(tracks_mutex_);
+        for (auto& track : tracks_) {
+            std::lock_guard track_lock(track->mutex);
+            track->events.clear();
+        }
+        in_flight_ = 0;
+        recorded_.store(0, std::memory_order_relaxed);
+        dropped_.store(0, std::memory_order_relaxed);
+        origin_ns_.store(Clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+        enabled_.store(true, std::memory_order_relaxed);
+        if (observer_) return;
+        observer_ = std::make_shared<TraceObserver>(*this);
+    }
+    add_run_observer(observer_);
+}
+
+void TraceRecorder::stop() {
+    std::shared_ptr<RunObserver> observer;
+    {
+        std::lock_guard lock(tracks_mutex_);
+        enabled_.store(false, std::memory_order_relaxed);
+        observer = std::move(observer_);
+    }
+    if (observer) remove_run_observer(observer.get());
+}
+
+TraceRecorder::Track& TraceRecorder::current_track() {
+    // Tracks are never destroyed, so the pointer stays valid across start()
+    thread_local Track* track = nullptr;
+    if (!track) {
+        std::lock_guard lock(tracks_mutex_);
+        auto id = static_cast<uint32_t>(tracks_.size() + 1);
+        tracks_.push_back(std::make_unique<Track>());
+        track = tracks_.back().get();
+        track->id = id;
+        track->name = std::format("thread {}", id);
+    }
+    return *track;
+}
+
+void TraceRecorder::record(Event event) noexcept {
+    if (recorded_.fetch_add(1, std::memory_order_relaxed) >= event_limit()) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    try {
+        auto& track = current_track();
+        std::lock_guard lock(track.mutex);
+        track.events.push_back(std::move(event));
+    } catch (...) {
+        // Tracing must never fail a test; the event is dropped
+    }
+}
+
+int64_t TraceRecorder::since_origin(Clock::time_point at) const noexcept {
+    return at.time_since_epoch().count() - origin_ns_.load(std::memory_order_relaxed);
+}
+
+void TraceRecorder::span(const char* name, Clock::time_point begin, Clock::time_point end,
+                         std::string_view detail) noexcept {
+    if (!enabled()) return;
+    try {
+        record({name, 'X', since_origin(begin), (end - begin).count(), nullptr, 0, std::string(detail)});
+    } catch (...) {
+    }
+}
+
+void TraceRecorder::async_span(const char* name, uint64_t id, Clock::time_point begin,
+                               Clock::time_point end) noexcept {
+    if (!enabled()) return;
+    record({name, 'A', since_origin(begin), (end - begin).count(), nullptr, static_cast<int64_t>(id), {}});
+}
+
+void TraceRecorder::instant(const char* name, Clock::time_point at, const char* value_name, int64_t value) noexcept {
+    if (!enabled()) return;
+    record({name, 'i', since_origin(at), 0, value_name, value, {}});
+}
+
+void TraceRecorder::process_started(Clock::time_point at) noexcept {
+    if (!enabled()) return;
+    int64_t count = ++in_flight_;
+    record({"in-flight processes", 'C', since_origin(at), 0, "processes", count, {}});
+}
+
+void TraceRecorder::process_exited(Clock::time_point at, int exit_code) noexcept {
+    if (!enabled()) return;
+    instant("exit", at, "exit_code", exit_code);
+    int64_t count = --in_flight_;
+    record({"in-flight processes", 'C', since_origin(at), 0, "processes", count, {}});
+}
+
+void TraceRecorder::name_thread(std::string_view name) {
+    auto& track = current_track();
+    std::lock_guard lock(track.mutex);
+    track.name = name;
+}
+
+size_t TraceRecorder::event_count() const {
+    std::lock_guard lock(tracks_mutex_);
+    size_t count = 0;
+    for (const auto& track : tracks_) {
+        std::lock_guard track_lock(track->mutex);
+        count += track->events.size();
+    }
+    return count;
+}
+
+std::string TraceRecorder::to_json() const {
+    int pid = static_cast<int>(getpid());
+    std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    auto separate = [&] {
+        if (!first) json += ",\n";
+        first = false;
+    };
+
+    std::lock_guard lock(tracks_mutex_);
+    for (const auto& track : tracks_) {
+        std::lock_guard track_lock(track->mutex);
+        if (track->events.empty()) continue;
+
+        separate();
+        json += std::format(R"({{"name":"thread_name","ph":"M","pid":{},"tid":{},"args":{{"name":)", pid, track->id);
+        append_json_string(json, track->name);
+        json += "}}";
+
+        for (const auto& event : track->events) {
+            separate();
+            if (event.phase == 'A') {
+                auto id = static_cast<uint64_t>(event.value);
+                json += std::format(R"({{"name":"{}","cat":"x86_asm_test","ph":"b","id":"{:#x}","pid":{},"tid":{},"ts":{:.3f}}},)"
+                                    "\n",
+                                    event.name, id, pid, track->id, event.begin_ns / 1000.0);
+                json += std::format(R"({{"name":"{}","cat":"x86_asm_test","ph":"e","id":"{:#x}","pid":{},"tid":{},"ts":{:.3f}}})",
+                                    event.name, id, pid, track->id, (event.begin_ns + event.duration_ns) / 1000.0);
+                continue;
+            }
+            json += std::format(R"({{"name":"{}","cat":"x86_asm_test","ph":"{}","pid":{},"tid":{},"ts":{:.3f})",
+                                event.name, event.phase, pid, track->id, event.begin_ns / 1000.0);
+            if (event.phase == 'X') {
+                json += std::format(R"(,"dur":{:.3f})", event.duration_ns / 1000.0);
+            } else if (event.phase == 'i') {
+                json += R"(,"s":"t")";
+            }
+            if (event.value_name) {
+                json += std::format(R"(,"args":{{"{}":{}}})", event.value_name, event.value);
+            } else if (!event.detail.empty()) {
+                json += R"(,"args":{"detail":)";
+                append_json_string(json, event.detail);
+                json += '}';
+            }
+            json += '}';
+        }
+    }
+    json += std::format("\n],\"otherData\":{{\"dropped_events\":{},\"event_limit\":{}}}}}\n",
+                        dropped_events(), event_limit());
+    return json;
+}
+
+void TraceRecorder::write(const std::filesystem::path& path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << to_json();
+    if (!file) {
+        throw std::runtime_error(std::format("Cannot write trace {}", path.string()));
+    }
+}
+
+TraceExporter::TraceExporter(std::filesystem::path path) : path_(std::move(path)) {}
+
+void TraceExporter::OnTestProgramStart(const ::testing::UnitTest&) {
+    TraceRecorder::instance().name_thread("main");
+}
+
+void TraceExporter::OnTestStart(const ::testing::TestInfo&) {
+    test_start_ = TraceRecorder::Clock::now();
+}
+
+void TraceExporter::OnTestEnd(const ::testing::TestInfo& test_info) {
+    TraceRecorder::instance().span("test", test_start_, TraceRecorder::Clock::now(),
+                                   std::format("{}.{}", test_info.test_suite_name(), test_info.name()));
+}
+
+void TraceExporter::OnTestProgramEnd(const ::testing::UnitTest&) {
+    auto& recorder = TraceRecorder::instance();
+    recorder.stop();
+    if (recorder.dropped_events() > 0) {
+        std::fprintf(stderr, "Trace dropped %zu events over the limit of %zu\n",
+                     recorder.dropped_events(), recorder.event_limit());
+    }
+    try {
+        recorder.write(path_);
+    } catch (const std::exception& e) {
+        // The test results stand; only the trace is lost
+        std::fprintf(stderr, "%s\n", e.what());
+    }
+}
+
+void enable_trace_export(const std::filesystem::path& path) {
+    TraceRecorder::instance().start();
+    ::testing::UnitTest::GetInstance()->listeners().Append(new TraceExporter(path));
+}
+
+} // namespace x86_asm_test
@@ -0,0 +1,230 @@
+/**
+ * @file x86_asm_trace.h
+ * @brief Chrome trace (Perfetto-compatible JSON) timeline of test execution
+ */
+
+#pragma once
+
+#include "x86_asm_test.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace x86_asm_test {
+
+/**
+ * @class TraceRecorder
+ * @brief Process-wide recorder of timeline events
+ *
+ * Every thread that records gets its own track (a Chrome trace "tid")
+ * and its own event buffer, so parallel workers do not contend. While
+ * recording, the recorder is registered as a RunObserver; while it is
+ * off, runs do not call into it at all.
+ *
+ * These events are recorded per run:
+ * - "queued": from submit() until an asynchronous run is started
+ * - "run": AsmTestRunner::run_test(), including cache and hooks
+ * - "spawn": pipe setup and fork()
+ * - "exec": from fork() until the child is reaped
+ * - "first byte" (instant): first stdout or stderr data
+ * - "exit" (instant): the child was reaped, with its exit code
+ * - "match", "report": checking a result and describing a mismatch
+ * - "in-flight processes" (counter): children currently alive
+ *
+ * Runs advanced by the epoll reactor overlap on its thread, so their
+ * "queued" and "exec" spans are async slices keyed by the run.
+ *
+ * At most event_limit() events are kept per recording; later events are
+ * counted as dropped and the count is written into the trace metadata.
+ */
+class TraceRecorder {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Get the recorder
+     * @return Process-wide instance
+     */
+    [[nodiscard]] static TraceRecorder& instance();
+
+    static constexpr size_t kDefaultEventLimit = 1'000'000;
+
+    /**
+     * @brief Discard previous events and start recording
+     */
+    void start();
+
+    /**
+     * @brief Stop recording; recorded events are kept
+     */
+    void stop();
+
+    /**
+     * @brief Check whether events are being recorded
+     * @return true between start() and stop()
+     */
+    [[nodiscard]] bool enabled() const noexcept { return enabled_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Record a complete span on the calling thread's track
+     * @param name Event name (must outlive the recorder, e.g. a literal)
+     * @param begin Start time
+     * @param end End time
+     * @param detail Free text shown with the event
+     */
+    void span(const char* name, Clock::time_point begin, Clock::time_point end,
+              std::string_view detail = {}) noexcept;
+
+    /**
+     * @brief Record a span that may overlap others on the same thread
+     * @param name Event name (must outlive the recorder)
+     * @param id Identifies the operation; spans with the same id share a row
+     * @param begin Start time
+     * @param end End time
+     */
+    void async_span(const char* name, uint64_t id, Clock::time_point begin, Clock::time_point end) noexcept;
+
+    /**
+     * @brief Record an instant event on the calling thread's track
+     * @param name Event name (must outlive the recorder)
+     * @param at Time of the event
+     * @param value_name Name of an integer argument, nullptr for none
+     * @param value Argument value
+     */
+    void instant(const char* name, Clock::time_point at,
+                 const char* value_name = nullptr, int64_t value = 0) noexcept;
+
+    /**
+     * @brief Count a child process as started
+     * @param at Time of the fork
+     */
+    void process_started(Clock::time_point at) noexcept;
+
+    /**
+     * @brief Count a child process as reaped
+     * @param at Time it was reaped
+     * @param exit_code Its exit code
+     */
+    void process_exited(Clock::time_point at, int exit_code) noexcept;
+
+    /**
+     * @brief Name the calling thread's track (default: "thread <N>")
+     * @param name Track name
+     */
+    void name_thread(std::string_view name);
+
+    /**
+     * @brief Get the number of recorded events
+     * @return Event count over all tracks
+     */
+    [[nodiscard]] size_t event_count() const;
+
+    /**
+     * @brief Limit the number of events kept per recording
+     * @param limit Maximum event count (default kDefaultEventLimit)
+     */
+    void set_event_limit(size_t limit) noexcept { event_limit_.store(limit, std::memory_order_relaxed); }
+
+    /**
+     * @brief Get the event limit
+     * @return Maximum event count per recording
+     */
+    [[nodiscard]] size_t event_limit() const noexcept { return event_limit_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Get the number of events dropped because of the limit
+     * @return Dropped events since start()
+     */
+    [[nodiscard]] size_t dropped_events() const noexcept { return dropped_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Render the events as Chrome trace JSON
+     *
+     * Loads in chrome://tracing and ui.perfetto.dev.
+     *
+     * @return {"traceEvents": [...]} document
+     */
+    [[nodiscard]] std::string to_json() const;
+
+    /**
+     * @brief Write to_json() to a file
+     * @param path Output file
+     * @throws std::runtime_error if the file cannot be written
+     */
+    void write(const std::filesystem::path& path) const;
+
+private:
+    struct Event {
+        const char* name;
+        char phase;                  ///< 'X' span, 'A' async span, 'i' instant, 'C' counter
+        int64_t begin_ns;
+        int64_t duration_ns;
+        const char* value_name;
+        int64_t value;               ///< Argument value, or the id of an async span
+        std::string detail;
+    };
+
+    struct Track {
+        uint32_t id;
+        std::string name;
+        mutable std::mutex mutex;    ///< Uncontended except while exporting
+        std::vector<Event> events;
+    };
+
+    TraceRecorder() = default;
+
+    Track& current_track();
+    void record(Event event) noexcept;
+    [[nodiscard]] int64_t since_origin(Clock::time_point at) const noexcept;
+
+    std::atomic<bool> enabled_{false};
+    std::shared_ptr<RunObserver> observer_;   ///< Registered between start() and stop()
+    std::atomic<int64_t> in_flight_{0};
+    std::atomic<int64_t> origin_ns_{0};       ///< Clock epoch offset of ts 0, set by start()
+    std::atomic<size_t> event_limit_{kDefaultEventLimit};
+    std::atomic<size_t> recorded_{0};         ///< Events accepted or dropped since start()
+    std::atomic<size_t> dropped_{0};
+    mutable std::mutex tracks_mutex_;
+    std::deque<std::unique_ptr<Track>> tracks_;
+};
+
+/**
+ * @class TraceExporter
+ * @brief Google Test listener adding a span per test and writing the trace at the end
+ */
+class TraceExporter : public ::testing::EmptyTestEventListener {
+public:
+    /**
+     * @brief Create an exporter
+     * @param path Trace file written when the test program ends
+     */
+    explicit TraceExporter(std::filesystem::path path);
+
+    void OnTestProgramStart(const ::testing::UnitTest& unit_test) override;
+    void OnTestStart(const ::testing::TestInfo& test_info) override;
+    void OnTestEnd(const ::testing::TestInfo& test_info) override;
+    void OnTestProgramEnd(const ::testing::UnitTest& unit_test) override;
+
+private:
+    std::filesystem::path path_;
+    TraceRecorder::Clock::time_point test_start_;
+};
+
+/**
+ * @brief Record a timeline of the whole test program
+ *
+ * Call after ::testing::InitGoogleTest(). Starts the TraceRecorder and
+ * appends a TraceExporter that writes the trace to path at the end.
+ *
+ * @param path Trace file (open in ui.perfetto.dev or chrome://tracing)
+ */
+void enable_trace_export(const std::filesystem::path& path);
+
+} // namespace x86_asm_test
@@ -0,0 +1,110 @@
+/**
+ * @file x86_asm_workers.h
+ * @brief Worker threads and bounded failure collection shared by the parallel runners
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace x86_asm_test::detail {
+
+/**
+ * @brief Run a worker on jobs threads, the calling thread being one of them
+ *
+ * The first exception thrown by a worker is kept and stop() is called so
+ * the other workers run out of work; it is rethrown once all have joined.
+ *
+ * @param jobs Number of workers (at least one runs)
+ * @param worker Callable run by every thread until it runs out of work
+ * @param stop Callable making the remaining work appear empty
+ */
+template<typename Worker, typename Stop>
+void run_workers(size_t jobs, Worker worker, Stop stop) {
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    auto guarded = [&] {
+        try {
+            worker();
+        } catch (...) {
+            {
+                std::lock_guard lock(error_mutex);
+                if (!error) error = std::current_exception();
+            }
+            stop();
+        }
+    };
+
+    std::vector<std::jthread> threads;
+    for (size_t t = 1; t < jobs; ++t) {
+        threads.emplace_back(guarded);
+    }
+    guarded();
+    threads.clear();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+/**
+ * @class LowestFailures
+ * @brief Thread-safe collection keeping only the failures with the lowest indices
+ *
+ * A max-heap on index holds at most max_kept failures, so memory stays
+ * bounded however many cases fail. Check wanted() before describing a
+ * failure to skip the work for those that would be dropped.
+ */
+template<typename Failure>
+class LowestFailures {
+public:
+    explicit LowestFailures(size_t max_kept) : max_kept_(max_kept) {
+        heap_.reserve(std::min<size_t>(max_kept, 1024));
+    }
+
+    /**
+     * @brief Check whether a failure at this index would currently be kept
+     */
+    [[nodiscard]] bool wanted(size_t index) {
+        std::lock_guard lock(mutex_);
+        return heap_.size() < max_kept_ || (!heap_.empty() && index < heap_.front().index);
+    }
+
+    /**
+     * @brief Keep a failure if it is among the lowest indices seen so far
+     */
+    void add(Failure failure) {
+        std::lock_guard lock(mutex_);
+        if (heap_.size() < max_kept_) {
+            heap_.push_back(std::move(failure));
+        } else if (!heap_.empty() && failure.index < heap_.front().index) {
+            std::ranges::pop_heap(heap_, {}, &Failure::index);
+            heap_.back() = std::move(failure);
+        } else {
+            return;
+        }
+        std::ranges::push_heap(heap_, {}, &Failure::index);
+    }
+
+    /**
+     * @brief Take the kept failures
+     * @return Failures by ascending index
+     */
+    [[nodiscard]] std::vector<Failure> take() {
+        std::lock_guard lock(mutex_);
+        std::ranges::sort_heap(heap_, {}, &Failure::index);
+        return std::exchange(heap_, {});
+    }
+
+private:
+    size_t max_kept_;
+    std::mutex mutex_;
+    std::vector<Failure> heap_;
+};
+
+} // namespace x86_asm_test::detail
@@ -0,0 +1,307 @@
+# calc_batch.s - Batch-mode calculator in Intel syntax
+#
+# Reads one record per stdin line, "<num1> <num2> <operation>", and writes
+# exactly one output line per record: the result, or an error message.
+# Output is buffered and flushed whenever the program is about to block
+# on stdin, so a driver sees finished records without waiting for EOF.
+.intel_syntax noprefix
+.global _start
+
+.section .text
+_start:
+record_loop:
+    call read_line          # rax = record length, -1 at end of input
+    cmp rax, -1
+    je finish
+    lea rdi, [rip + line_buffer]
+    call process_record
+    jmp record_loop
+
+finish:
+    call flush_output
+    mov rax, 60             # sys_exit
+    xor rdi, rdi            # Success
+    syscall
+
+# Evaluate one record and append its output line
+# Input: rdi = NUL-terminated record
+process_record:
+    push r12
+    push r13
+
+    call parse_int          # First number
+    test rdx, rdx
+    jz record_invalid
+    mov r12, rax
+
+    call parse_int          # Second number
+    test rdx, rdx
+    jz record_invalid
+    mov r13, rax
+
+    call skip_spaces        # Operation, matched on its first character
+    mov al, [rdi]
+    cmp al, 'a'
+    je batch_add
+    cmp al, 's'
+    je batch_sub
+    cmp al, 'm'
+    je batch_mul
+    cmp al, 'd'
+    je batch_div
+    jmp record_invalid
+
+batch_add:
+    mov rax, r12
+    add rax, r13
+    jmp record_result
+
+batch_sub:
+    mov rax, r12
+    sub rax, r13
+    jmp record_result
+
+batch_mul:
+    mov rax, r12
+    imul rax, r13
+    jmp record_result
+
+batch_div:
+    cmp r13, 0
+    je record_div_error
+    mov rax, r12
+    cqo                     # Sign extend
+    idiv r13
+    jmp record_result
+
+record_result:
+    mov rdi, rax
+    call append_int
+    lea rsi, [rip + newline]
+    mov rdx, 1
+    call append_bytes
+    jmp record_done
+
+record_div_error:
+    lea rsi, [rip + div_msg]
+    mov rdx, offset div_msg_len
+    call append_bytes
+    jmp record_done
+
+record_invalid:
+    lea rsi, [rip + invalid_msg]
+    mov rdx, offset invalid_msg_len
+    call append_bytes
+
+record_done:
+    pop r13
+    pop r12
+    ret
+
+# Skip spaces and tabs
+# Input/Output: rdi = string pointer
+skip_spaces:
+    cmp byte ptr [rdi], ' '
+    je skip_one
+    cmp byte ptr [rdi], 9   # tab
+    je skip_one
+    ret
+skip_one:
+    inc rdi
+    jmp skip_spaces
+
+# Parse a signed decimal integer
+# Input: rdi = string pointer
+# Output: rax = value, rdi = first byte after the number, rdx = digit count
+parse_int:
+    call skip_spaces
+    xor eax, eax            # result = 0
+    xor ecx, ecx            # sign = 0
+    xor edx, edx            # digit count = 0
+
+    cmp byte ptr [rdi], '-'
+    jne parse_digits
+    mov ecx, 1              # negative flag
+    inc rdi                 # skip minus
+
+parse_digits:
+    movzx r8d, byte ptr [rdi]
+    sub r8d, '0'
+    cmp r8d, 9              # unsigned: also rejects bytes below '0'
+    ja parse_done
+    imul rax, rax, 10       # result *= 10
+    add rax, r8             # result += digit
+    inc rdi
+    inc rdx
+    jmp parse_digits
+
+parse_done:
+    test rcx, rcx           # check sign
+    jz parse_return
+    neg rax                 # make negative
+parse_return:
+    ret
+
+# Read the next stdin line into line_buffer (NUL-terminated, newline dropped)
+# Output: rax = length, -1 at end of input; longer lines are truncated
+read_line:
+    push rbx
+    push r12
+    xor ebx, ebx            # stored length
+    xor r12d, r12d          # bytes consumed
+
+read_line_loop:
+    call next_char          # rax = byte, -1 at end of input
+    cmp rax, -1
+    je read_line_eof
+    inc r12
+    cmp al, 10              # newline ends the record
+    je read_line_done
+    cmp rbx, 255
+    jae read_line_loop
+    lea rcx, [rip + line_buffer]
+    mov [rcx + rbx], al
+    inc rbx
+    jmp read_line_loop
+
+read_line_eof:
+    test r12, r12           # a final record without newline still counts
+    jnz read_line_done
+    mov rax, -1
+    jmp read_line_return
+
+read_line_done:
+    lea rcx, [rip + line_buffer]
+    mov byte ptr [rcx + rbx], 0
+    mov rax, rbx
+
+read_line_return:
+    pop r12
+    pop rbx
+    ret
+
+# Consume one byte of stdin, refilling the input buffer as needed
+# Output: rax = byte, -1 at end of input
+next_char:
+    mov rax, [rip + in_pos]
+    cmp rax, [rip + in_len]
+    jb next_char_ready
+
+    call flush_output       # About to block: publish finished records
+    mov rax, 0              # sys_read
+    mov rdi, 0              # stdin
+    lea rsi, [rip + in_buffer]
+    mov rdx, 4096
+    syscall
+    test rax, rax
+    jle next_char_eof
+    mov [rip + in_len], rax
+    xor eax, eax
+
+next_char_ready:
+    lea rcx, [rip + in_buffer]
+    movzx edx, byte ptr [rcx + rax]
+    inc rax
+    mov [rip + in_pos], rax
+    mov rax, rdx
+    ret
+
+next_char_eof:
+    mov qword ptr [rip + in_pos], 0
+    mov qword ptr [rip + in_len], 0
+    mov rax, -1
+    ret
+
+# Append an integer in decimal to the output buffer
+# Input: rdi = integer
+append_int:
+    test rdi, rdi
+    jns append_positive
+
+    push rdi
+    lea rsi, [rip + minus_sign]
+    mov rdx, 1
+    call append_bytes
+    pop rdi
+    neg rdi
+
+append_positive:
+    mov rax, rdi
+    lea rsi, [rip + number_buffer + 20]  # One past the last digit
+    mov r8, 10
+
+append_digit:
+    xor edx, edx
+    div r8                  # rax = rax/10, rdx = remainder
+    add dl, '0'             # Convert to ASCII
+    dec rsi
+    mov [rsi], dl
+    test rax, rax
+    jnz append_digit
+
+    lea rdx, [rip + number_buffer + 20]
+    sub rdx, rsi            # Digit count
+    jmp append_bytes
+
+# Append bytes to the output buffer, flushing first if they do not fit
+# Input: rsi = source, rdx = length (at most 4096)
+append_bytes:
+    mov rax, [rip + out_len]
+    add rax, rdx
+    cmp rax, 4096
+    jbe append_copy
+    push rsi
+    push rdx
+    call flush_output
+    pop rdx
+    pop rsi
+
+append_copy:
+    lea rdi, [rip + out_buffer]
+    add rdi, [rip + out_len]
+    mov rcx, rdx
+    rep movsb
+    add [rip + out_len], rdx
+    ret
+
+# Write the output buffer to stdout
+flush_output:
+    push rbx
+    xor ebx, ebx            # Bytes written so far
+
+flush_loop:
+    mov rdx, [rip + out_len]
+    sub rdx, rbx
+    jle flush_done
+    mov rax, 1              # sys_write
+    mov rdi, 1              # stdout
+    lea rsi, [rip + out_buffer]
+    add rsi, rbx
+    syscall
+    test rax, rax
+    jle flush_done          # Reader gone: drop the output
+    add rbx, rax
+    jmp flush_loop
+
+flush_done:
+    mov qword ptr [rip + out_len], 0
+    pop rbx
+    ret
+
+.section .data
+newline:        .ascii "\n"
+minus_sign:     .ascii "-"
+div_msg:        .ascii "Error: division by zero\n"
+div_msg_len = . - div_msg
+invalid_msg:    .ascii "Error: invalid record\n"
+invalid_msg_len = . - invalid_msg
+
+.section .bss
+.balign 8
+in_pos:         .space 8
+in_len:         .space 8
+out_len:        .space 8
+in_buffer:      .space 4096
+out_buffer:     .space 4096
+line_buffer:    .space 256
+number_buffer:  .space 20